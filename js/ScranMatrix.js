@@ -27,6 +27,7 @@ export class ScranMatrix {
      * @param {boolean} [options.copy=true] - Whether to copy `contents` when constructing the {@linkplain ScranMatrix}.
      * If `false`, the returned {@linkplain ScranMatrix} will refer to the same allocation as `contents`,
      * so callers should make sure that it does not outlive `contents`.
+     * Results computed from such a matrix are not memoized, see {@linkcode setMemoizationBudget}.
      *
      * @return {ScranMatrix} A {@linkplain ScranMatrix} containing the matrix contents.
      */
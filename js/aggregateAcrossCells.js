@@ -122,3 +122,188 @@ export function aggregateAcrossCells(x, groups, { average = false, numberOfThrea
 
     return output;
 }
+
+/**
+ * Wrapper for the sparse cell aggregation results, produced by {@linkcode aggregateAcrossCellsSparse}.
+ * @hideconstructor
+ */
+export class AggregateAcrossCellsSparseResults {
+    #id;
+    #results;
+
+    constructor(id, raw) {
+        this.#id = id;
+        this.#results = raw;
+        return;
+    }
+
+    /**
+     * @return {number} Number of groups, i.e., unique combinations of factor levels.
+     */
+    numberOfGroups() {
+        return this.#results.num_groups();
+    }
+
+    /**
+     * @return {number} Number of genes.
+     */
+    numberOfGenes() {
+        return this.#results.num_genes();
+    }
+
+    /**
+     * @param {object} [options={}] - Optional parameters.
+     * @param {(string|boolean)} [options.copy=true] - Copying mode, see {@linkcode possibleCopy} for details.
+     *
+     * @return {Int32Array|Int32WasmArray} Array of length equal to the number of cells, containing the group assignment for each cell.
+     * Each entry is an index into the arrays returned by {@linkcode AggregateAcrossCellsSparseResults#combinations combinations}.
+     */
+    groups({ copy = true } = {}) {
+        return utils.possibleCopy(this.#results.group_ids(), copy);
+    }
+
+    /**
+     * @param {object} [options={}] - Optional parameters.
+     * @param {(string|boolean)} [options.copy=true] - Copying mode, see {@linkcode possibleCopy} for details.
+     *
+     * @return {Int32Array|Int32WasmArray} Array of length equal to the number of groups, containing the number of cells in each group.
+     */
+    groupSizes({ copy = true } = {}) {
+        return utils.possibleCopy(this.#results.group_sizes(), copy);
+    }
+
+    /**
+     * @param {object} [options={}] - Optional parameters.
+     * @param {(string|boolean)} [options.copy=true] - Copying mode, see {@linkcode possibleCopy} for details.
+     *
+     * @return {Array} Array of length equal to the number of factors supplied to {@linkcode aggregateAcrossCellsSparse}.
+     * Each entry is an Int32Array (or Int32WasmArray) of length equal to the number of groups, containing the level of the corresponding factor for each group.
+     * Groups are sorted lexicographically by their factor levels, in the order in which the factors were supplied.
+     */
+    combinations({ copy = true } = {}) {
+        let output = [];
+        for (var f = 0; f < this.#results.num_factors(); f++) {
+            output.push(utils.possibleCopy(this.#results.combination(f), copy));
+        }
+        return output;
+    }
+
+    /**
+     * @param {number} group - Index of the group.
+     * This should be non-negative and less than {@linkcode AggregateAcrossCellsSparseResults#numberOfGroups numberOfGroups}.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {(string|boolean)} [options.copy=true] - Copying mode, see {@linkcode possibleCopy} for details.
+     *
+     * @return {object} Object containing `indices`, an Int32Array (or Int32WasmArray) of the row indices of the genes with non-zero expression in `group`;
+     * and `values`, a Float64Array (or Float64WasmArray) containing the summed value for each of those genes across all cells in `group`.
+     * If {@linkcode aggregateAcrossCellsSparse} was run with `average = true`, `values` contains the mean instead of the sum.
+     */
+    sums(group, { copy = true } = {}) {
+        return { 
+            indices: utils.possibleCopy(this.#results.group_indices(group), copy),
+            values: utils.possibleCopy(this.#results.group_sums(group), copy)
+        };
+    }
+
+    /**
+     * @param {number} group - Index of the group.
+     * This should be non-negative and less than {@linkcode AggregateAcrossCellsSparseResults#numberOfGroups numberOfGroups}.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {(string|boolean)} [options.copy=true] - Copying mode, see {@linkcode possibleCopy} for details.
+     *
+     * @return {object} Object containing `indices`, an Int32Array (or Int32WasmArray) of the row indices of the genes with non-zero expression in `group`;
+     * and `values`, a Float64Array (or Float64WasmArray) containing the number of detected cells for each of those genes in `group`.
+     * If {@linkcode aggregateAcrossCellsSparse} was run with `average = true`, `values` contains the proportion of cells with detected expression.
+     */
+    detected(group, { copy = true } = {}) {
+        return { 
+            indices: utils.possibleCopy(this.#results.group_indices(group), copy),
+            values: utils.possibleCopy(this.#results.group_detected(group), copy)
+        };
+    }
+
+    /**
+     * @param {object} [options={}] - Optional parameters.
+     * @param {boolean} [options.detected=false] - Whether to return the detected counts instead of the sums.
+     *
+     * @return {ScranMatrix} A sparse matrix where each row is a gene and each column is a group,
+     * containing the sums (or detected counts) for each gene in each group.
+     */
+    asMatrix({ detected = false } = {}) {
+        return gc.call(module => this.#results.as_matrix(detected), ScranMatrix);
+    }
+
+    /**
+     * @return Frees the memory allocated on the Wasm heap for this object.
+     * This invalidates this object and all references to it.
+     */
+    free() {
+        if (this.#results !== null) {
+            gc.release(this.#id);
+            this.#results = null;
+        }
+        return;
+    }
+}
+
+/**
+ * Aggregate per-cell expression profiles for each combination of levels across multiple factors, e.g., for each sample and cluster.
+ * Unlike {@linkcode aggregateAcrossCells}, the results are stored in a sparse format,
+ * which avoids allocating dense arrays when there are many groups but each group only expresses a fraction of the genes.
+ *
+ * @param {ScranMatrix} x - Some expression matrix, typically containing normalized log-expression values.
+ * @param {Array} factors - Array of factors.
+ * Each entry should be an Array, TypedArray or Int32WasmArray of length equal to the number of cells, containing non-negative integer levels for each cell. 
+ * Any array of group IDs as described in {@linkcode aggregateAcrossCells} is also acceptable.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {boolean} [options.average=false] - Whether to compute the average expression instead of the sum for each group.
+ * Similarly, the proportion of detected expression is reported, rather than the number of detected cells in each group.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {AggregateAcrossCellsSparseResults} Object containing the aggregation results.
+ */
+export function aggregateAcrossCellsSparse(x, factors, { average = false, numberOfThreads = null } = {}) {
+    let factor_data = [];
+    let factor_ptrs;
+    let output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    try {
+        let nfactors = factors.length;
+        if (nfactors == 0) {
+            throw new Error("'factors' should contain at least one factor");
+        }
+
+        for (var f = 0; f < nfactors; f++) {
+            let current = utils.wasmifyArray(factors[f], "Int32WasmArray");
+            factor_data.push(current);
+            if (current.length != x.numberOfColumns()) {
+                throw new Error("length of each array in 'factors' should be equal to number of columns in 'x'");
+            }
+        }
+
+        factor_ptrs = utils.createBigUint64WasmArray(nfactors);
+        let fparr = factor_ptrs.array();
+        for (var f = 0; f < nfactors; f++) {
+            fparr[f] = BigInt(factor_data[f].offset);
+        }
+
+        output = gc.call(
+            module => module.aggregate_across_cells_sparse(x.matrix, nfactors, factor_ptrs.offset, average, nthreads),
+            AggregateAcrossCellsSparseResults 
+        );
+
+    } catch (e) {
+        utils.free(output);
+        throw e;
+
+    } finally {
+        utils.free(factor_ptrs);
+        for (const f of factor_data) {
+            utils.free(f);
+        }
+    }
+
+    return output;
+}
@@ -0,0 +1,153 @@
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+import { TsneStatus } from "./runTsne.js";
+import { UmapStatus } from "./runUmap.js";
+
+/**
+ * Bin the cells of a 2-dimensional embedding into a regular grid, e.g., to render density maps or aggregated colours for large datasets.
+ *
+ * @param {(TsneStatus|UmapStatus|object|Float64WasmArray|Array|TypedArray)} x - Coordinates of each cell in the embedding.
+ * This may be a {@linkplain TsneStatus} or {@linkplain UmapStatus}, in which case the current coordinates are used directly from the Wasm heap;
+ * an object with `x` and `y` arrays, as returned by {@linkcode runTsne} or {@linkcode runUmap};
+ * or an array of interleaved coordinates, i.e., x and y for the first cell, then x and y for the second cell, and so on.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {number} [options.numberOfXBins=256] - Number of bins along the x-axis.
+ * @param {number} [options.numberOfYBins=256] - Number of bins along the y-axis.
+ * @param {?object} [options.range=null] - Object with the `xmin`, `xmax`, `ymin` and `ymax` properties, specifying the extent of the grid.
+ * Cells outside of this range are ignored.
+ * If `null`, the range is set to the extent of the coordinates.
+ * @param {?(Float64WasmArray|Array|TypedArray)} [options.values=null] - Value for each cell, e.g., the expression of a gene.
+ * If provided, the mean value in each bin is reported.
+ * @param {?(Int32WasmArray|Array|TypedArray)} [options.groups=null] - Group assignment for each cell, e.g., a cluster identity.
+ * Values should be integers in `[0, N)` for `N` groups.
+ * If provided, the most frequent group in each bin is reported.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {object} Object containing:
+ *
+ * - `counts`: an Int32Array containing the number of cells in each bin.
+ *   Bins are stored in row-major order, i.e., the bin for the `i`-th x-interval and `j`-th y-interval is at position `j * numberOfXBins + i`.
+ * - `range`: an object with the `xmin`, `xmax`, `ymin` and `ymax` properties, containing the extent of the grid.
+ * - `means`: a Float64Array containing the mean of `values` in each bin, or `NaN` for empty bins.
+ *   Only reported if `values` is provided.
+ * - `majority`: an Int32Array containing the most frequent group in each bin, or -1 for empty bins.
+ *   Ties are broken in favor of the lower group index.
+ *   Only reported if `groups` is provided.
+ */
+export function binEmbedding(x, { numberOfXBins = 256, numberOfYBins = 256, range = null, values = null, groups = null, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    let temps = [];
+    let output = {};
+
+    try {
+        let coord_offset;
+        let ncells;
+
+        if (x instanceof TsneStatus || x instanceof UmapStatus) {
+            ncells = x.numberOfCells();
+            coord_offset = x.coordinates.offset;
+
+        } else if ("x" in x && "y" in x && !ArrayBuffer.isView(x)) {
+            ncells = x.x.length;
+            if (x.y.length != ncells) {
+                throw new Error("'x.x' and 'x.y' should have the same length");
+            }
+            let interleaved = utils.createFloat64WasmArray(2 * ncells);
+            temps.push(interleaved);
+            let arr = interleaved.array();
+            for (var i = 0; i < ncells; i++) {
+                arr[2 * i] = x.x[i];
+                arr[2 * i + 1] = x.y[i];
+            }
+            coord_offset = interleaved.offset;
+
+        } else {
+            let coord_data = utils.wasmifyArray(x, "Float64WasmArray");
+            temps.push(coord_data);
+            if (coord_data.length % 2 != 0) {
+                throw new Error("length of interleaved coordinates in 'x' should be a multiple of 2");
+            }
+            ncells = coord_data.length / 2;
+            coord_offset = coord_data.offset;
+        }
+
+        let range_data = utils.createFloat64WasmArray(4);
+        temps.push(range_data);
+        let use_range = (range !== null);
+        if (use_range) {
+            range_data.set([ range.xmin, range.xmax, range.ymin, range.ymax ]);
+        }
+
+        let use_values = (values !== null);
+        let value_offset = 0;
+        if (use_values) {
+            let value_data = utils.wasmifyArray(values, "Float64WasmArray");
+            temps.push(value_data);
+            if (value_data.length != ncells) {
+                throw new Error("length of 'values' should be equal to the number of cells");
+            }
+            value_offset = value_data.offset;
+        }
+
+        let use_groups = (groups !== null);
+        let group_offset = 0;
+        let ngroups = 0;
+        if (use_groups) {
+            let group_data = utils.wasmifyArray(groups, "Int32WasmArray");
+            temps.push(group_data);
+            if (group_data.length != ncells) {
+                throw new Error("length of 'groups' should be equal to the number of cells");
+            }
+            for (const g of group_data.array()) {
+                if (g >= ngroups) {
+                    ngroups = g + 1;
+                }
+            }
+            group_offset = group_data.offset;
+        }
+
+        let nbins = numberOfXBins * numberOfYBins;
+        let counts = utils.createInt32WasmArray(nbins);
+        temps.push(counts);
+        let means = utils.createFloat64WasmArray(use_values ? nbins : 0);
+        temps.push(means);
+        let majority = utils.createInt32WasmArray(use_groups ? nbins : 0);
+        temps.push(majority);
+
+        wasm.call(module => module.bin_embedding(
+            coord_offset,
+            ncells,
+            numberOfXBins,
+            numberOfYBins,
+            use_range,
+            range_data.offset,
+            use_values,
+            value_offset,
+            use_groups,
+            group_offset,
+            ngroups,
+            counts.offset,
+            means.offset,
+            majority.offset,
+            nthreads
+        ));
+
+        output.counts = counts.slice();
+        let rarr = range_data.array();
+        output.range = { xmin: rarr[0], xmax: rarr[1], ymin: rarr[2], ymax: rarr[3] };
+        if (use_values) {
+            output.means = means.slice();
+        }
+        if (use_groups) {
+            output.majority = majority.slice();
+        }
+
+    } finally {
+        for (const t of temps) {
+            utils.free(t);
+        }
+    }
+
+    return output;
+}
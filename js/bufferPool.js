@@ -0,0 +1,58 @@
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+
+/**
+ * Set the maximum size of the pool of result buffers.
+ * When a result object is freed, its buffers are kept in this pool so that they can be recycled by later results of the same size,
+ * e.g., when {@linkcode perCellRnaQcMetrics}, {@linkcode clusterKmeans} or {@linkcode scoreFeatureSets} are repeatedly called on the same dataset.
+ * Buffers that would cause the pool to exceed this limit are released to the allocator instead.
+ *
+ * Idle buffers in the pool count towards the Wasm heap, which does not shrink when they are eventually released.
+ * Applications should only enable pooling if they expect to repeat computations on datasets of the same size,
+ * and should choose a limit that they are willing to retain on the heap for the rest of the session.
+ *
+ * @param {number} bytes - Maximum size of all idle buffers in the pool, in bytes.
+ * If zero, buffers are never pooled, which is the default.
+ *
+ * @return The limit is set, and the pool is emptied if it currently exceeds the new limit.
+ */
+export function setBufferPoolLimit(bytes) {
+    wasm.call(module => module.set_buffer_pool_limit(bytes));
+    return;
+}
+
+/**
+ * @return All idle buffers in the pool are released to the allocator.
+ * The limit and statistics are not changed.
+ */
+export function clearBufferPool() {
+    wasm.call(module => module.clear_buffer_pool());
+    return;
+}
+
+/**
+ * @param {object} [options={}] - Optional parameters.
+ * @param {boolean} [options.reset=false] - Whether to reset the reuse and allocation counts after reporting them.
+ *
+ * @return {object} Object containing:
+ *
+ * - `limit`: the maximum size of the pool, in bytes.
+ * - `idle`: the total size of the idle buffers in the pool, in bytes.
+ * - `reused`: the number of buffers that were recycled from the pool.
+ * - `allocated`: the number of buffers that had to be freshly allocated.
+ */
+export function bufferPoolStatistics({ reset = false } = {}) {
+    let buffer;
+    let output;
+
+    try {
+        buffer = utils.createFloat64WasmArray(4);
+        wasm.call(module => module.buffer_pool_statistics(buffer.offset, reset));
+        let arr = buffer.array();
+        output = { limit: arr[0], idle: arr[1], reused: arr[2], allocated: arr[3] };
+    } finally {
+        utils.free(buffer);
+    }
+
+    return output;
+}
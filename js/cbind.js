@@ -74,6 +74,12 @@ export function rbind(inputs) {
  * @param {Array} names - Array of length equal to `inputs`.
  * Each entry should be an Array containing the row names of the corresponding entry of `inputs`.
  * Names should correspond to the rows of that entry of `inputs`.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {boolean} [options.realize=false] - Whether to realize the combined matrix into a single compressed sparse matrix.
+ * This avoids repeated indirection through per-matrix subsets during later row or column access, at the cost of a copy.
+ * Integer counts are stored in the smallest unsigned integer type that fits each row.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {object} An object containing:
  * - `matrix`, a {@linkplain ScranMatrix} containing the combined matrices.
@@ -83,12 +89,13 @@ export function rbind(inputs) {
  * - `names`, an array of names identifying the rows of `matrix`.
  *    This is constructed by indexing the first entry of `names` with `indices`.
  */
-export function cbindWithNames(x, names) {
+export function cbindWithNames(x, names, { realize = false, numberOfThreads = null } = {}) {
     let mat_ptrs;
     let renamed = [];
     let name_ptrs;
     let indices;
     let output = {};
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     try {
         // Building a common set of rownames.
@@ -128,7 +135,7 @@ export function cbindWithNames(x, names) {
         mat_ptrs = harvest_matrices(x);
         indices = utils.createInt32WasmArray(x[0].numberOfRows());
         output.matrix = gc.call(
-            module => module.cbind_with_rownames(x.length, mat_ptrs.offset, name_ptrs.offset, indices.offset),
+            module => module.cbind_with_rownames(x.length, mat_ptrs.offset, name_ptrs.offset, indices.offset, realize, nthreads),
             ScranMatrix
         );
 
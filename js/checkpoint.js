@@ -0,0 +1,426 @@
+import * as gc from "./gc.js";
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+import * as wa from "wasmarrays.js";
+import { ScranMatrix } from "./ScranMatrix.js";
+import { RunPcaResults } from "./runPca.js";
+import { FindNearestNeighborsResults } from "./findNearestNeighbors.js";
+import { BuildSnnGraphResults } from "./clusterSnnGraph.js";
+import { TsneStatus } from "./runTsne.js";
+import { UmapStatus } from "./runUmap.js";
+import { ScoreMarkersResults } from "./scoreMarkers.js";
+import { loadBuiltLabelledReferenceFromBuffer, loadIntegratedLabelledReferencesFromBuffer } from "./labelCells.js";
+
+/**
+ * Writer for a checkpoint, i.e., a single binary file containing multiple analysis results.
+ * Each result is stored in a named section that is compressed independently,
+ * so that individual results can be restored without decompressing the rest of the checkpoint.
+ * This is typically created with {@linkcode createCheckpointWriter}.
+ *
+ * @hideconstructor
+ */
+export class CheckpointWriter {
+    #id;
+    #writer;
+
+    constructor(id, raw) {
+        this.#id = id;
+        this.#writer = raw;
+        return;
+    }
+
+    #add(name, kind, FUN) {
+        let serialized;
+        try {
+            serialized = wasm.call(FUN);
+            wasm.call(module => this.#writer.add(name, kind, serialized));
+        } finally {
+            if (serialized) {
+                serialized.delete();
+            }
+        }
+    }
+
+    /**
+     * @return {number} Number of sections that have been added to the checkpoint.
+     */
+    numberOfSections() {
+        return this.#writer.num_sections();
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {ScranMatrix} x - A matrix, typically the count or log-expression matrix.
+     * Sparse matrices are stored in compressed sparse column format with the smallest possible value type.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addMatrix(name, x, { numberOfThreads = null } = {}) {
+        let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+        this.#add(name, "matrix", module => module.save_numeric_matrix(x.matrix, nthreads));
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {RunPcaResults} x - PCA results, typically from {@linkcode runPca}.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addPca(name, x) {
+        let pcs = x.principalComponents({ copy: "view" });
+        let ve = x.varianceExplained({ copy: "view" });
+        this.#add(name, "pca", module => module.save_pca_results(x.numberOfPCs(), x.numberOfCells(), pcs.offset, ve.offset, x.totalVariance()));
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {FindNearestNeighborsResults} x - Nearest neighbor search results, typically from {@linkcode findNearestNeighbors}.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addNeighbors(name, x) {
+        this.#add(name, "neighbors", module => module.save_neighbor_results(x.results));
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {BuildSnnGraphResults} x - Shared nearest neighbor graph, typically from {@linkcode buildSnnGraph}.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addSnnGraph(name, x) {
+        this.#add(name, "snn_graph", module => module.save_snn_graph(x.graph));
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {TsneStatus} x - t-SNE status, typically from {@linkcode runTsne}.
+     * Only the perplexity and current coordinates are stored.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addTsne(name, x) {
+        this.#add(name, "tsne", module => module.save_tsne(x.status, x.coordinates.offset));
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {UmapStatus} x - UMAP status, typically from {@linkcode runUmap}.
+     * Only the parameters and current coordinates are stored.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addUmap(name, x) {
+        this.#add(name, "umap", module => module.save_umap(x.status, x.coordinates.offset));
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {ScoreMarkersResults} x - Marker detection results, typically from {@linkcode scoreMarkers}.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addMarkers(name, x) {
+        this.#add(name, "markers", module => module.save_marker_results(x.results));
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {BuildLabelledReferenceResults} x - Built reference dataset, typically from {@linkcode buildLabelledReference}.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addLabelledReference(name, x) {
+        this.#add(name, "labelled_reference", module => module.save_built_singlepp_reference(x.reference));
+    }
+
+    /**
+     * @param {string} name - Name of the section, unique within the checkpoint.
+     * @param {IntegrateLabelledReferencesResults} x - Integrated references, typically from {@linkcode integrateLabelledReferences}.
+     *
+     * @return `x` is added to the checkpoint.
+     */
+    addIntegratedLabelledReferences(name, x) {
+        this.#add(name, "integrated_labelled_references", module => module.save_integrated_singlepp_references(x.integrated));
+    }
+
+    /**
+     * Assemble the checkpoint in memory.
+     * All sections are removed from the writer, which can then be re-used for another checkpoint.
+     *
+     * @param {object} [options={}] - Optional parameters.
+     * @param {number} [options.compression=6] - Deflate compression level for each section.
+     * If negative, sections are stored without compression.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use for compressing sections in parallel.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     *
+     * @return {Uint8Array} Buffer containing the checkpoint.
+     * This can be restored with {@linkcode openCheckpoint}.
+     */
+    save({ compression = 6, numberOfThreads = null } = {}) {
+        let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+        let serialized;
+        let output;
+        try {
+            serialized = wasm.call(module => this.#writer.finish(compression, nthreads));
+            output = serialized.buffer().slice();
+        } finally {
+            if (serialized) {
+                serialized.delete();
+            }
+        }
+        return output;
+    }
+
+    /**
+     * Assemble the checkpoint and save it to a file.
+     * All sections are removed from the writer, which can then be re-used for another checkpoint.
+     *
+     * @param {string} path - Path to the output file.
+     * For browsers, the file will be saved to the virtual filesystem.
+     * @param {object} [options={}] - Optional parameters, see {@linkcode CheckpointWriter#save save}.
+     *
+     * @return The checkpoint is written to `path`.
+     */
+    saveToFile(path, { compression = 6, numberOfThreads = null } = {}) {
+        let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+        wasm.call(module => this.#writer.finish_to_file(path, compression, nthreads));
+    }
+
+    /**
+     * @return Frees the memory allocated on the Wasm heap for this object.
+     * This invalidates this object and all references to it.
+     */
+    free() {
+        if (this.#writer !== null) {
+            gc.release(this.#id);
+            this.#writer = null;
+        }
+        return;
+    }
+}
+
+/**
+ * @return {CheckpointWriter} A new writer for a checkpoint.
+ */
+export function createCheckpointWriter() {
+    return gc.call(module => new module.CheckpointWriter, CheckpointWriter);
+}
+
+/**
+ * Reader for a checkpoint created by {@linkplain CheckpointWriter}.
+ * Only the index of sections is parsed upon opening; each section is decompressed and restored when requested.
+ * This is typically created with {@linkcode openCheckpoint}.
+ *
+ * @hideconstructor
+ */
+export class CheckpointReader {
+    #id;
+    #reader;
+    #buffer;
+
+    constructor(id, raw, buffer) {
+        this.#id = id;
+        this.#reader = raw;
+        this.#buffer = buffer;
+        return;
+    }
+
+    /**
+     * @return {Array} Array of objects, one per section.
+     * Each object contains `name`, the name of the section; `kind`, the type of result in the section, e.g., `"pca"`;
+     * and `size`, the size of the section in bytes after decompression.
+     */
+    sections() {
+        let output = [];
+        let n = this.#reader.num_sections();
+        for (var i = 0; i < n; i++) {
+            output.push({ name: this.#reader.name(i), kind: this.#reader.kind(i), size: this.#reader.raw_size(i) });
+        }
+        return output;
+    }
+
+    /**
+     * @param {string} name - Name of a section.
+     * @return {boolean} Whether the section is present in the checkpoint.
+     */
+    has(name) {
+        return this.#reader.has(name);
+    }
+
+    #restore(name, FUN) {
+        let serialized;
+        try {
+            serialized = wasm.call(module => this.#reader.extract(name));
+            return FUN(serialized);
+        } finally {
+            if (serialized) {
+                serialized.delete();
+            }
+        }
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addMatrix addMatrix}.
+     * @return {ScranMatrix} The restored matrix.
+     */
+    restoreMatrix(name) {
+        return this.#restore(name, buf => gc.call(module => module.load_numeric_matrix(buf.offset(), buf.size()), ScranMatrix));
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addPca addPca}.
+     * @return {RunPcaResults} The restored PCA results.
+     */
+    restorePca(name) {
+        return this.#restore(name, buf => gc.call(module => module.load_pca_results(buf.offset(), buf.size()), RunPcaResults));
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addNeighbors addNeighbors}.
+     * @return {FindNearestNeighborsResults} The restored neighbor search results.
+     */
+    restoreNeighbors(name) {
+        return this.#restore(name, buf => gc.call(module => module.load_neighbor_results(buf.offset(), buf.size()), FindNearestNeighborsResults));
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addSnnGraph addSnnGraph}.
+     * @return {BuildSnnGraphResults} The restored graph.
+     */
+    restoreSnnGraph(name) {
+        return this.#restore(name, buf => gc.call(module => module.load_snn_graph(buf.offset(), buf.size()), BuildSnnGraphResults));
+    }
+
+    #restoreEmbedding(name, neighbors, nthreads, loader, cls) {
+        let raw_coords;
+        let output;
+        try {
+            raw_coords = utils.createFloat64WasmArray(2 * neighbors.numberOfCells());
+            output = this.#restore(name, buf => gc.call(
+                module => loader(module)(buf.offset(), buf.size(), neighbors.results, raw_coords.offset, nthreads),
+                cls,
+                raw_coords
+            ));
+        } catch (e) {
+            utils.free(output);
+            utils.free(raw_coords);
+            throw e;
+        }
+        return output;
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addTsne addTsne}.
+     * @param {FindNearestNeighborsResults} neighbors - Neighbor search results used to create the original t-SNE, e.g., from {@linkcode CheckpointReader#restoreNeighbors restoreNeighbors}.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     *
+     * @return {TsneStatus} The restored t-SNE status, containing the saved coordinates.
+     * The iteration counter is reset to zero, so further calls to {@linkcode TsneStatus#run run} will continue optimization from the saved coordinates.
+     */
+    restoreTsne(name, neighbors, { numberOfThreads = null } = {}) {
+        let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+        return this.#restoreEmbedding(name, neighbors, nthreads, module => module.load_tsne, TsneStatus);
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addUmap addUmap}.
+     * @param {FindNearestNeighborsResults} neighbors - Neighbor search results used to create the original UMAP, e.g., from {@linkcode CheckpointReader#restoreNeighbors restoreNeighbors}.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     *
+     * @return {UmapStatus} The restored UMAP status, containing the saved coordinates.
+     * The epoch counter is reset to zero, so further calls to {@linkcode UmapStatus#run run} will continue optimization from the saved coordinates.
+     */
+    restoreUmap(name, neighbors, { numberOfThreads = null } = {}) {
+        let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+        return this.#restoreEmbedding(name, neighbors, nthreads, module => module.load_umap, UmapStatus);
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addMarkers addMarkers}.
+     * @return {ScoreMarkersResults} The restored marker detection results.
+     */
+    restoreMarkers(name) {
+        return this.#restore(name, buf => gc.call(module => module.load_marker_results(buf.offset(), buf.size()), ScoreMarkersResults));
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addLabelledReference addLabelledReference}.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use for rebuilding the search indices.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     *
+     * @return {BuildLabelledReferenceResults} The restored reference dataset.
+     */
+    restoreLabelledReference(name, { numberOfThreads = null } = {}) {
+        return this.#restore(name, buf => loadBuiltLabelledReferenceFromBuffer(utils.possibleCopy(buf.buffer(), "view"), { numberOfThreads }));
+    }
+
+    /**
+     * @param {string} name - Name of a section created by {@linkcode CheckpointWriter#addIntegratedLabelledReferences addIntegratedLabelledReferences}.
+     * @return {IntegrateLabelledReferencesResults} The restored integrated references.
+     */
+    restoreIntegratedLabelledReferences(name) {
+        return this.#restore(name, buf => loadIntegratedLabelledReferencesFromBuffer(utils.possibleCopy(buf.buffer(), "view")));
+    }
+
+    /**
+     * @return Frees the memory allocated on the Wasm heap for this object.
+     * This invalidates this object and all references to it.
+     */
+    free() {
+        if (this.#reader !== null) {
+            gc.release(this.#id);
+            this.#reader = null;
+        }
+        utils.free(this.#buffer);
+        this.#buffer = null;
+        return;
+    }
+}
+
+/**
+ * Open a checkpoint created by {@linkplain CheckpointWriter}.
+ *
+ * @param {Uint8Array|Uint8WasmArray|string} x - Buffer containing the checkpoint.
+ * This is copied into a buffer that is owned by the returned reader, so `x` may be modified or freed after this function returns.
+ * Alternatively, a path to a checkpoint file; in this case, only the index is read upon opening,
+ * and each section is read from the file when it is restored.
+ *
+ * @return {CheckpointReader} Reader for the checkpoint.
+ */
+export function openCheckpoint(x) {
+    if (typeof x == "string") {
+        return gc.call(module => new module.CheckpointReader(x), CheckpointReader, null);
+    }
+
+    let buf;
+    let output;
+    try {
+        // The reader refers to the buffer for its entire lifetime, so we
+        // always make a copy rather than a view of a caller-owned WasmArray.
+        if (x instanceof wa.WasmArray) {
+            if (x.constructor.className != "Uint8WasmArray") {
+                throw new Error("expected 'Uint8WasmArray', got '" + x.constructor.className + "'");
+            }
+            buf = utils.createUint8WasmArray(x.length);
+            buf.set(x.array());
+        } else {
+            buf = utils.wasmifyArray(x, "Uint8WasmArray");
+        }
+        output = gc.call(module => new module.CheckpointReader(buf.offset, buf.length), CheckpointReader, buf);
+    } catch (e) {
+        utils.free(output);
+        utils.free(buf);
+        throw e;
+    }
+
+    return output;
+}
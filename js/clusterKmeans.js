@@ -1,5 +1,6 @@
 import * as utils from "./utils.js";
 import * as gc from "./gc.js";
+import * as wa from "wasmarrays.js";
 import { RunPcaResults } from "./runPca.js";
 
 /**
@@ -213,10 +214,15 @@ export class ClusterKmeansResults {
  * Larger values (up to 1) will prioritize partitioning of clusters with more cells.
  * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
  * If `null`, defaults to {@linkcode maximumThreads}.
+ * @param {?object} [options.buffers=null] - Caller-provided buffers in which to store the results.
+ * This should contain `centers`, a Float64WasmArray of length equal to the product of the number of dimensions and `clusters`;
+ * and `clusters`, an Int32WasmArray of length equal to the number of cells.
+ * The returned object will then use these buffers directly instead of allocating its own, so they should not be freed before the returned object.
+ * If `null`, storage is allocated by the returned object, possibly recycling memory from previously freed results.
  *
  * @return {ClusterKmeansResults} Object containing the clustering results.
  */
-export function clusterKmeans(x, clusters, { numberOfDims = null, numberOfCells = null, initMethod = "pca-part", initSeed = 5768, initPCASizeAdjust = 1, numberOfThreads = null } = {}) {
+export function clusterKmeans(x, clusters, { numberOfDims = null, numberOfCells = null, initMethod = "pca-part", initSeed = 5768, initPCASizeAdjust = 1, numberOfThreads = null, buffers = null } = {}) {
     var buffer;
     var output;
     let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
@@ -243,8 +249,22 @@ export function clusterKmeans(x, clusters, { numberOfDims = null, numberOfCells
             pptr = buffer.offset;
         }
 
+        let use_buffers = (buffers !== null);
+        let center_offset = 0;
+        let cluster_offset = 0;
+        if (use_buffers) {
+            if (!(buffers.centers instanceof wa.Float64WasmArray) || buffers.centers.length != numberOfDims * clusters) {
+                throw new Error("'buffers.centers' should be a Float64WasmArray of length equal to the product of the number of dimensions and 'clusters'");
+            }
+            if (!(buffers.clusters instanceof wa.Int32WasmArray) || buffers.clusters.length != numberOfCells) {
+                throw new Error("'buffers.clusters' should be an Int32WasmArray of length equal to the number of cells");
+            }
+            center_offset = buffers.centers.offset;
+            cluster_offset = buffers.clusters.offset;
+        }
+
         output = gc.call(
-            module => module.cluster_kmeans(pptr, numberOfDims, numberOfCells, clusters, initMethod, initSeed, initPCASizeAdjust, nthreads),
+            module => module.cluster_kmeans(pptr, numberOfDims, numberOfCells, clusters, initMethod, initSeed, initPCASizeAdjust, use_buffers, center_offset, cluster_offset, nthreads),
             ClusterKmeansResults
         );
 
@@ -0,0 +1,136 @@
+import * as gc from "./gc.js";
+import * as utils from "./utils.js";
+
+/**
+ * Wrapper for the gene-gene correlations on the Wasm heap, produced by {@linkcode computeGeneCorrelations}.
+ * @hideconstructor
+ */
+export class ComputeGeneCorrelationsResults {
+    #id;
+    #results;
+
+    constructor(id, raw) {
+        this.#id = id;
+        this.#results = raw;
+        return;
+    }
+
+    /**
+     * @return {number} Number of query genes.
+     */
+    numberOfQueries() {
+        return this.#results.num_queries();
+    }
+
+    /**
+     * @param {number} i - Index of the query gene, i.e., its position in the `queries` array used in {@linkcode computeGeneCorrelations}.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {boolean|string} [options.copy=true] - Whether to copy the results from the Wasm heap, see {@linkcode possibleCopy}.
+     *
+     * @return {object} Object containing:
+     *
+     * - `indices`: an Int32Array containing the row indices of the partner genes.
+     * - `correlations`: a Float64Array containing the correlation of each partner with the query gene.
+     *
+     * Partners are sorted by decreasing correlation.
+     */
+    partners(i, { copy = true } = {}) {
+        return {
+            indices: utils.possibleCopy(this.#results.partner_indices(i), copy),
+            correlations: utils.possibleCopy(this.#results.partner_correlations(i), copy)
+        };
+    }
+
+    /**
+     * @return Frees the memory allocated on the Wasm heap for this object.
+     * This invalidates this object and all references to it.
+     */
+    free() {
+        if (this.#results !== null) {
+            gc.release(this.#id);
+            this.#results = null;
+        }
+        return;
+    }
+}
+
+/**
+ * Compute correlations between genes, reporting the most strongly correlated partners for each query gene.
+ * Correlations are computed natively from sparse dot products, so this is much faster than extracting rows into Javascript.
+ *
+ * @param {ScranMatrix} x - Matrix of (usually log-normalized) expression values, where rows are genes and columns are cells.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?(Int32WasmArray|Array|TypedArray)} [options.queries=null] - Row indices of the query genes.
+ * If `null`, all rows are used as queries.
+ * @param {?(Int32WasmArray|Array|TypedArray)} [options.targets=null] - Row indices of the genes that may be reported as partners.
+ * If `null`, all rows are used as targets.
+ * @param {string} [options.method="pearson"] - Correlation method, either `"pearson"` or `"spearman"`.
+ * @param {number} [options.numberOfPartners=10] - Maximum number of partners to report for each query gene.
+ * If zero, all partners are reported, subject to `threshold`.
+ * @param {?number} [options.threshold=null] - Minimum correlation for a partner to be reported.
+ * If `null`, no threshold is applied.
+ * @param {?number} [options.blockSize=null] - Number of query genes to process at once.
+ * If `null`, this is chosen automatically based on the number of cells.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {ComputeGeneCorrelationsResults} Object containing the partners of each query gene.
+ * Genes with zero variance are never reported as partners, and have no partners themselves.
+ */
+export function computeGeneCorrelations(x, { queries = null, targets = null, method = "pearson", numberOfPartners = 10, threshold = null, blockSize = null, numberOfThreads = null } = {}) {
+    let spearman;
+    if (method == "pearson") {
+        spearman = false;
+    } else if (method == "spearman") {
+        spearman = true;
+    } else {
+        throw new Error("'method' should be either 'pearson' or 'spearman'");
+    }
+
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    let query_data;
+    let target_data;
+    let output;
+
+    function prepareRows(rows) {
+        if (rows === null) {
+            let all = utils.createInt32WasmArray(x.numberOfRows());
+            all.array().forEach((y, i, arr) => { arr[i] = i; });
+            return all;
+        } else {
+            return utils.wasmifyArray(rows, "Int32WasmArray");
+        }
+    }
+
+    try {
+        query_data = prepareRows(queries);
+        target_data = prepareRows(targets);
+
+        output = gc.call(
+            module => module.compute_gene_correlations(
+                x.matrix,
+                query_data.length,
+                query_data.offset,
+                target_data.length,
+                target_data.offset,
+                spearman,
+                numberOfPartners,
+                threshold !== null,
+                (threshold === null ? 0 : threshold),
+                (blockSize === null ? 0 : blockSize),
+                nthreads
+            ),
+            ComputeGeneCorrelationsResults
+        );
+
+    } catch (e) {
+        utils.free(output);
+        throw e;
+
+    } finally {
+        utils.free(query_data);
+        utils.free(target_data);
+    }
+
+    return output;
+}
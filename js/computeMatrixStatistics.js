@@ -0,0 +1,107 @@
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+
+const codes = { sum: 0, mean: 1, variance: 2, detected: 3, proportion: 4, min: 5, max: 6 };
+
+/**
+ * Compute summary statistics for each row or column of a {@linkplain ScranMatrix} in a single pass.
+ * This works on any matrix, including delayed and layered matrices, and only visits the non-zero entries of sparse matrices.
+ *
+ * @param {ScranMatrix} x - The matrix of interest.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {string} [options.margin="row"] - Whether to compute statistics for each `"row"` or `"column"`.
+ * @param {Array} [options.statistics=["sum","mean","variance","detected"]] - Statistics to compute.
+ * This may contain any of `"sum"`, `"mean"`, `"variance"`, `"detected"` (number of non-zero values), `"proportion"` (proportion of non-zero values), `"min"` and `"max"`.
+ * @param {?(Int32WasmArray|Array|TypedArray)} [options.groups=null] - Array of group assignments along the other dimension, e.g., for each column if `margin = "row"`.
+ * Values should be integers in `[0, N)` for `N` groups.
+ * If `null`, statistics are computed across all entries of each row/column.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {object} Object where each key is a requested statistic.
+ * If `groups = null`, each value is a Float64Array of length equal to the number of rows or columns (depending on `margin`).
+ * Otherwise, each value is an array of such Float64Arrays, one per group.
+ * Means, variances, proportions and extrema are `NaN` for empty groups, as are variances for groups with only one entry.
+ */
+export function computeMatrixStatistics(x, { margin = "row", statistics = ["sum", "mean", "variance", "detected"], groups = null, numberOfThreads = null } = {}) {
+    let by_row;
+    if (margin == "row") {
+        by_row = true;
+    } else if (margin == "column") {
+        by_row = false;
+    } else {
+        throw new Error("'margin' should be either 'row' or 'column'");
+    }
+
+    let nmargin = (by_row ? x.numberOfRows() : x.numberOfColumns());
+    let nother = (by_row ? x.numberOfColumns() : x.numberOfRows());
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    let nstats = statistics.length;
+
+    let stat_data;
+    let output_offsets;
+    let group_data;
+    let outputs = [];
+    let results = {};
+
+    try {
+        stat_data = utils.createInt32WasmArray(nstats);
+        let stat_arr = stat_data.array();
+        statistics.forEach((s, i) => {
+            if (!(s in codes)) {
+                throw new Error("unknown statistic '" + s + "'");
+            }
+            stat_arr[i] = codes[s];
+        });
+
+        let use_groups = (groups !== null);
+        let ngroups = 1;
+        let group_offset = 0;
+        if (use_groups) {
+            group_data = utils.wasmifyArray(groups, "Int32WasmArray");
+            if (group_data.length != nother) {
+                throw new Error("length of 'groups' should be equal to the number of " + (by_row ? "columns" : "rows") + " of 'x'");
+            }
+            ngroups = 0;
+            for (const g of group_data.array()) {
+                if (g >= ngroups) {
+                    ngroups = g + 1;
+                }
+            }
+            group_offset = group_data.offset;
+        }
+
+        output_offsets = utils.createBigUint64WasmArray(nstats);
+        let offset_arr = output_offsets.array();
+        for (var i = 0; i < nstats; i++) {
+            let current = utils.createFloat64WasmArray(nmargin * ngroups);
+            outputs.push(current);
+            offset_arr[i] = BigInt(current.offset);
+        }
+
+        wasm.call(module => module.compute_matrix_statistics(x.matrix, by_row, nstats, stat_data.offset, output_offsets.offset, use_groups, group_offset, ngroups, nthreads));
+
+        statistics.forEach((s, i) => {
+            let values = outputs[i].array();
+            if (use_groups) {
+                let per_group = [];
+                for (var g = 0; g < ngroups; g++) {
+                    per_group.push(values.slice(g * nmargin, (g + 1) * nmargin));
+                }
+                results[s] = per_group;
+            } else {
+                results[s] = values.slice();
+            }
+        });
+
+    } finally {
+        utils.free(stat_data);
+        utils.free(output_offsets);
+        utils.free(group_data);
+        for (const o of outputs) {
+            utils.free(o);
+        }
+    }
+
+    return results;
+}
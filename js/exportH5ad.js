@@ -0,0 +1,268 @@
+import * as wa from "wasmarrays.js";
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+import * as packer from "./internal/pack_strings.js";
+import { convertToFactor } from "./factorize.js";
+import { RunPcaResults } from "./runPca.js";
+
+function wasmify_numeric(x) {
+    // TypedArray views on the Wasm heap are converted into WasmArray views,
+    // so that they are passed by offset without any copying.
+    if (ArrayBuffer.isView(x) && x.buffer === wasm.buffer()) {
+        return utils.possibleCopy(x, "view");
+    }
+    return utils.wasmifyArray(x, null);
+}
+
+function type_of(x) {
+    return x.constructor.className.replace(/WasmArray$/, "");
+}
+
+function is_numeric_array(x) {
+    if (ArrayBuffer.isView(x) || x instanceof wa.WasmArray) {
+        return true;
+    }
+    if (Array.isArray(x)) {
+        return x.every(y => typeof y == "number");
+    }
+    return false;
+}
+
+function write_numeric(writer, name, x, shape, compression) {
+    let y;
+    let shape_arr;
+    try {
+        y = wasmify_numeric(x);
+        if (shape === null) {
+            shape = [y.length];
+        }
+        shape_arr = utils.wasmifyArray(shape, "Int32WasmArray");
+        wasm.call(module => writer.write_array(name, shape_arr.length, shape_arr.offset, type_of(y), y.offset, compression));
+    } finally {
+        utils.free(y);
+        utils.free(shape_arr);
+    }
+}
+
+function write_columns(writer, name, columns, compression) {
+    let collected = [];
+    let ptrs;
+    try {
+        for (const col of columns) {
+            collected.push(wasmify_numeric(col));
+        }
+
+        let nrow = collected[0].length;
+        let type = type_of(collected[0]);
+        for (const col of collected) {
+            if (col.length != nrow) {
+                throw new Error("all columns of '" + name + "' should have the same length");
+            }
+            if (type_of(col) != type) {
+                throw new Error("all columns of '" + name + "' should have the same type");
+            }
+        }
+
+        ptrs = utils.createBigUint64WasmArray(collected.length);
+        let parr = ptrs.array();
+        collected.forEach((col, i) => { parr[i] = BigInt(col.offset); });
+        wasm.call(module => writer.write_array_columns(name, nrow, collected.length, ptrs.offset, type, compression));
+    } finally {
+        for (const col of collected) {
+            utils.free(col);
+        }
+        utils.free(ptrs);
+    }
+}
+
+function write_strings(writer, name, x, compression) {
+    let [ lengths, buffer ] = packer.repack_strings(x);
+    try {
+        wasm.call(module => writer.write_string_array(name, lengths.length, lengths.offset, buffer.offset, compression));
+    } finally {
+        utils.free(lengths);
+        utils.free(buffer);
+    }
+}
+
+function write_categorical(writer, name, ids, levels, compression) {
+    let codes;
+    let lengths;
+    let buffer;
+    try {
+        codes = utils.wasmifyArray(ids, "Int32WasmArray");
+        [ lengths, buffer ] = packer.repack_strings(levels.map(String));
+        wasm.call(module => writer.write_categorical(name, codes.length, codes.offset, lengths.length, lengths.offset, buffer.offset, compression));
+    } finally {
+        utils.free(codes);
+        utils.free(lengths);
+        utils.free(buffer);
+    }
+}
+
+function column_length(x) {
+    if ("ids" in x && "levels" in x) {
+        return x.ids.length;
+    } else {
+        return x.length;
+    }
+}
+
+function write_dataframe(writer, group, columns, names, nrows, compression) {
+    wasm.call(module => writer.write_group(group, "dataframe"));
+
+    let colnames = Object.keys(columns);
+    for (const k of colnames) {
+        let current = columns[k];
+        if (column_length(current) != nrows) {
+            throw new Error("length of column '" + k + "' in '" + group + "' is not consistent with the number of rows");
+        }
+
+        let path = group + "/" + k;
+        if ("ids" in current && "levels" in current) {
+            write_categorical(writer, path, current.ids, current.levels, compression);
+        } else if (is_numeric_array(current)) {
+            write_numeric(writer, path, current, null, compression);
+        } else {
+            let fac = convertToFactor(current, { action: "none", placeholder: -1 });
+            try {
+                write_categorical(writer, path, fac.ids, fac.levels, compression);
+            } finally {
+                utils.free(fac.ids);
+            }
+        }
+    }
+
+    if (names === null) {
+        names = Array.from(Array(nrows).keys()).map(String);
+    } else if (names.length != nrows) {
+        throw new Error("length of the names for '" + group + "' is not consistent with the number of rows");
+    }
+    write_strings(writer, group + "/_index", names, compression);
+
+    let [ lengths, buffer ] = packer.repack_strings(colnames);
+    try {
+        wasm.call(module => writer.write_dataframe_attributes(group, lengths.length, lengths.offset, buffer.offset));
+    } finally {
+        utils.free(lengths);
+        utils.free(buffer);
+    }
+}
+
+function write_uns(writer, group, values, compression) {
+    wasm.call(module => writer.write_group(group, "dict"));
+
+    for (const [k, v] of Object.entries(values)) {
+        let path = group + "/" + k;
+        if (typeof v == "number") {
+            write_numeric(writer, path, [v], [], compression);
+        } else if (typeof v == "string") {
+            wasm.call(module => writer.write_string_scalar(path, v));
+        } else if (is_numeric_array(v)) {
+            write_numeric(writer, path, v, null, compression);
+        } else if (Array.isArray(v)) {
+            write_strings(writer, path, v.map(String), compression);
+        } else if (v instanceof Object) {
+            write_uns(writer, path, v, compression);
+        } else {
+            throw new Error("unsupported type for '" + path + "'");
+        }
+    }
+}
+
+function infer_number_of_rows(names, columns) {
+    if (names !== null) {
+        return names.length;
+    }
+    for (const v of Object.values(columns)) {
+        return column_length(v);
+    }
+    return null;
+}
+
+/**
+ * Export analysis results into a HDF5 file that follows the H5AD conventions.
+ * All results are written through a single open file handle,
+ * and numeric arrays on the Wasm heap (e.g., those obtained with `copy: "view"` from result objects) are written directly from Wasm memory without any copies.
+ *
+ * @param {string} path - Path to the HDF5 file.
+ * For browsers, the file will be saved to the virtual filesystem.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {object} [options.obs={}] - Per-cell annotations, where each key is the name of a column and each value is one of:
+ *
+ * - a TypedArray, WasmArray or Array of numbers, saved as a numeric column.
+ * - an object containing `ids` (an array of integer codes, where -1 denotes missing values) and `levels` (an array of levels), saved as a categorical column.
+ * - any other Array, which is converted into a categorical column with {@linkcode convertToFactor}.
+ *
+ * All columns should have length equal to the number of cells.
+ * @param {?Array} [options.obsNames=null] - Array of strings containing the cell names.
+ * If `null`, names are generated from the cell indices.
+ * @param {object} [options.var={}] - Per-feature annotations, with the same structure as `obs`.
+ * @param {?Array} [options.varNames=null] - Array of strings containing the feature names.
+ * If `null` and `var` is empty, no `var` group is created.
+ * @param {object} [options.obsm={}] - Multi-dimensional per-cell results, where each key is the name of an embedding (e.g., `"X_pca"`) and each value is one of:
+ *
+ * - a {@linkplain RunPcaResults} object, from which the principal components are written.
+ * - an Array of TypedArrays or WasmArrays, where each entry contains the values for one dimension, e.g., the `x` and `y` coordinates from {@linkcode TsneStatus#extractCoordinates extractCoordinates}.
+ * - an object containing `values`, a TypedArray or WasmArray of values in row-major order (i.e., all dimensions for the first cell, then the second cell, etc.);
+ *   and `columns`, the number of dimensions.
+ *
+ * @param {object} [options.uns={}] - Unstructured results, where each value may be a number, string, TypedArray, WasmArray, Array of strings, or a nested object of such values.
+ * @param {boolean} [options.overwrite=false] - Whether to overwrite an existing file at `path`.
+ * If `false`, results are added to an existing file, e.g., one containing the count matrix from {@linkcode writeSparseMatrixToHdf5}.
+ * @param {number} [options.compression=6] - Deflate compression level for all datasets.
+ * If negative, no compression is performed.
+ *
+ * @return The results are written to `path`.
+ * No return value is provided.
+ */
+export function exportToH5ad(path, { obs = {}, obsNames = null, var: vars = {}, varNames = null, obsm = {}, uns = {}, overwrite = false, compression = 6 } = {}) {
+    let nobs = infer_number_of_rows(obsNames, obs);
+    let writer = wasm.call(module => new module.H5adWriter(path, overwrite));
+
+    try {
+        wasm.call(module => writer.write_group("obsm", "dict"));
+        for (const [k, v] of Object.entries(obsm)) {
+            let name = "obsm/" + k;
+            let nrows;
+
+            if (v instanceof RunPcaResults) {
+                nrows = v.numberOfCells();
+                write_numeric(writer, name, v.principalComponents({ copy: "view" }), [nrows, v.numberOfPCs()], compression);
+            } else if (Array.isArray(v)) {
+                if (v.length == 0) {
+                    throw new Error("'" + name + "' should contain at least one dimension");
+                }
+                nrows = v[0].length;
+                write_columns(writer, name, v, compression);
+            } else {
+                nrows = v.values.length / v.columns;
+                if (!Number.isInteger(nrows)) {
+                    throw new Error("length of 'values' for '" + name + "' should be a multiple of 'columns'");
+                }
+                write_numeric(writer, name, v.values, [nrows, v.columns], compression);
+            }
+
+            if (nobs === null) {
+                nobs = nrows;
+            } else if (nobs != nrows) {
+                throw new Error("number of rows for '" + name + "' is not consistent with the number of cells");
+            }
+        }
+
+        if (nobs !== null) {
+            write_dataframe(writer, "obs", obs, obsNames, nobs, compression);
+        }
+
+        let nvar = infer_number_of_rows(varNames, vars);
+        if (nvar !== null) {
+            write_dataframe(writer, "var", vars, varNames, nvar, compression);
+        }
+
+        write_uns(writer, "uns", uns, compression);
+
+    } finally {
+        writer.close();
+        writer.delete();
+    }
+}
@@ -1,5 +1,102 @@
 import * as wa from "wasmarrays.js";
 import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+import * as packer from "./internal/pack_strings.js";
+
+function wasmify_as(x, type) {
+    if (x instanceof wa.WasmArray && x.constructor.className != type) {
+        // Copying to a JS array first, as the allocation could invalidate any view.
+        return utils.wasmifyArray(x.slice(), type);
+    }
+    return utils.wasmifyArray(x, type);
+}
+
+function factorize_natively(x, buffer, asWasmArray, placeholder, failure, nthreads) {
+    let is_string = false;
+    if (x instanceof wa.WasmArray || (ArrayBuffer.isView(x) && !(x instanceof BigInt64Array) && !(x instanceof BigUint64Array))) {
+        ;
+    } else if (Array.isArray(x) && x.every(y => typeof y == "string")) {
+        is_string = true;
+    } else if (Array.isArray(x) && x.every(y => typeof y == "number")) {
+        ;
+    } else {
+        return null;
+    }
+
+    let codes;
+    let firsts;
+    let counts;
+    let values;
+    let lengths;
+    let packed;
+    let mapping;
+    let levels;
+
+    try {
+        let n = x.length;
+        codes = (asWasmArray ? buffer : utils.createInt32WasmArray(n));
+        firsts = utils.createInt32WasmArray(n);
+        counts = utils.createInt32WasmArray(2);
+
+        if (is_string) {
+            [ lengths, packed ] = packer.repack_strings(x);
+            wasm.call(module => module.factorize_strings(n, packed.offset, lengths.offset, codes.offset, firsts.offset, counts.offset, nthreads));
+        } else {
+            values = wasmify_as(x, "Float64WasmArray");
+            wasm.call(module => module.factorize_numbers(n, values.offset, codes.offset, firsts.offset, counts.offset, nthreads));
+        }
+
+        let carr = counts.array();
+        let nlevels = carr[0];
+        if (carr[1] > 0) {
+            failure();
+        }
+
+        let farr = firsts.array();
+        levels = new Array(nlevels);
+        if (x instanceof wa.WasmArray) {
+            let xarr = x.array();
+            for (var l = 0; l < nlevels; l++) {
+                levels[l] = xarr[farr[l]];
+            }
+        } else {
+            for (var l = 0; l < nlevels; l++) {
+                levels[l] = x[farr[l]];
+            }
+        }
+
+        // Sorting the levels and remapping the codes accordingly.
+        let order = levels.map((y, i) => i);
+        if (is_string) {
+            order.sort((a, b) => (levels[a] < levels[b] ? -1 : (levels[a] > levels[b] ? 1 : 0)));
+        } else {
+            order.sort((a, b) => levels[a] - levels[b]);
+        }
+
+        mapping = utils.createInt32WasmArray(nlevels);
+        let marr = mapping.array();
+        order.forEach((o, i) => { marr[o] = i; });
+        levels = order.map(o => levels[o]);
+        wasm.call(module => module.remap_factor(n, codes.offset, nlevels, mapping.offset, placeholder));
+
+        if (!asWasmArray) {
+            buffer.set(codes.array());
+        }
+
+    } finally {
+        if (!asWasmArray) {
+            utils.free(codes);
+        }
+        utils.free(firsts);
+        utils.free(counts);
+        utils.free(values);
+        utils.free(lengths);
+        utils.free(packed);
+        utils.free(mapping);
+    }
+
+    return levels;
+}
 
 /**
  * Convert an arbitrary array into a R-style factor, with integer indices into an array of levels.
@@ -25,6 +122,10 @@ import * as utils from "./utils.js";
  * - `"error"`: an error is raised.
  * 
  * @param {number} [options.placeholder=-1] - Placeholder index to use upon detecting invalid values in `x`.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ * Only used if `levels = null` and `x` contains only strings or only numbers,
+ * in which case the factorization is performed on the Wasm heap.
  *
  * @return {object} Object containing:
  *
@@ -34,7 +135,7 @@ import * as utils from "./utils.js";
  *
  * If `buffer` was supplied, it is used as the value of the `ids` property.
  */
-export function convertToFactor(x, { asWasmArray = true, buffer = null, levels = null, action = "error", placeholder = -1 } = {}) {
+export function convertToFactor(x, { asWasmArray = true, buffer = null, levels = null, action = "error", placeholder = -1, numberOfThreads = null } = {}) {
     let local_buffer;
 
     let failure;
@@ -67,6 +168,14 @@ export function convertToFactor(x, { asWasmArray = true, buffer = null, levels =
             asWasmArray = buffer instanceof wa.Int32WasmArray;
         }
 
+        if (levels == null) {
+            let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+            let native_levels = factorize_natively(x, buffer, asWasmArray, placeholder, failure, nthreads);
+            if (native_levels !== null) {
+                return { ids: buffer, levels: native_levels };
+            }
+        }
+
         let barr = (asWasmArray ? buffer.array() : buffer); // no allocations from this point onwards!
         let mapping = new Map;
 
@@ -142,21 +251,44 @@ export function factorize(x, options = {}) {
  * This is done by adjusting the indices such that every index from `[0, N)` is represented at least once, where `N` is the number of (used) levels.
  *
  * @param {Int32WasmArray|TypedArray|Array} x - Array of factor indices such as that produced by {@linkcode convertToFactor}. 
+ * For Int32WasmArrays, this is performed on the Wasm heap.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use for Int32WasmArray inputs.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {Array} `x` is modified in place to remove unused levels.
  *
  * An array (denoted here as `y`) is returned that represents the mapping between the original and modified IDs,
+ * where the original IDs are sorted in increasing numeric order for all input types,
  * i.e., running `x.map(i => y[i])` will recover the input `x`.
  * This is most commonly used to create a new array of levels, i.e., `y.map(i => old_levels[i])` will drop the unused levels. 
  */
-export function dropUnusedLevels(x) {
+export function dropUnusedLevels(x, { numberOfThreads = null } = {}) {
+    if (x instanceof wa.Int32WasmArray) {
+        let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+        let used;
+        let wx;
+        let output;
+        try {
+            wx = utils.wasmifyArray(x, "Int32WasmArray");
+            used = utils.createInt32WasmArray(x.length);
+            let nused = wasm.call(module => module.drop_unused_levels(wx.length, wx.offset, used.offset, nthreads));
+            output = Array.from(used.array().slice(0, nused));
+        } finally {
+            utils.free(wx);
+            utils.free(used);
+        }
+        return output;
+    }
+
     if (x instanceof wa.WasmArray) {
         // No more wasm allocations past this point!
         x = x.array();
     }
 
+    // Numeric sort to match the ordering of the native implementation.
     let uniq = new Set(x);
-    let uniq_arr = Array.from(uniq).sort();
+    let uniq_arr = Array.from(uniq).sort((a, b) => a - b);
     let mapping = {};
     uniq_arr.forEach((y, i) => { mapping[y] = i; });
 
@@ -278,7 +410,39 @@ export function resetLevels(x, newLevels, { action = "error", placeholder = -1 }
 export function subsetFactor(x, subset, { drop = true, filter = null, buffer = null } = {}) {
     let output = { ids: null, levels: x.levels };
 
-    if (x.ids instanceof wa.WasmArray) {
+    if (x.ids instanceof wa.Int32WasmArray && (buffer == null || buffer instanceof wa.Int32WasmArray)) {
+        let n = wa.checkSubsetLength(subset, filter, x.ids.length, "x.ids");
+        let local_buffer;
+        let wsub;
+        let wids;
+
+        try {
+            if (buffer == null) {
+                local_buffer = utils.createInt32WasmArray(n);
+                buffer = local_buffer;
+            } else if (buffer.length !== n) {
+                throw new Error("length of 'buffer' is not consistent with 'subset'");
+            }
+
+            wsub = wasmify_as(subset, (filter === null ? "Int32WasmArray" : "Uint8WasmArray"));
+            wids = utils.wasmifyArray(x.ids, "Int32WasmArray");
+            let outbuf = utils.wasmifyArray(buffer, "Int32WasmArray");
+            try {
+                wasm.call(module => module.subset_factor(wids.length, wids.offset, wsub.length, wsub.offset, filter !== null, filter === false, outbuf.offset));
+            } finally {
+                utils.free(outbuf);
+            }
+        } catch (e) {
+            utils.free(local_buffer);
+            throw e;
+        } finally {
+            utils.free(wsub);
+            utils.free(wids);
+        }
+
+        output.ids = buffer;
+
+    } else if (x.ids instanceof wa.WasmArray) {
         output.ids = wa.subsetWasmArray(x.ids, subset, { filter, buffer });
     } else {
         let n = wa.checkSubsetLength(subset, filter, x.length, "x");
@@ -1,5 +1,6 @@
 import * as utils from "./utils.js";
 import * as wasm from "./wasm.js";
+import * as gc from "./gc.js";
 import * as packer from "./internal/pack_strings.js";
 import * as fac from "./factorize.js";
 
@@ -196,11 +197,13 @@ export class H5Base {
      * @param {?number} [options.maxStringLength=null] - Maximum length of the strings to be saved.
      * Only used when `type = "String"`.
      * If `null`, this is inferred from the maximum length of strings in `x`.
+     * @param {boolean} [options.variableLength=false] - Whether to save strings with a variable-length UTF-8 type.
+     * Only used when `type = "String"`, in which case `maxStringLength` is ignored.
      * @param {?Array} [options.levels=null] - Array of strings containing enum levels when `type = "Enum"`.
      * If supplied, `x` should be an array of integers that index into `levels`.
      * Alternatively, `levels` may be `null`, in which case `x` should be an array of strings that is used to infer `levels`.
      */
-    writeAttribute(attr, type, shape, x, { maxStringLength = null, levels = null } = {}) {
+    writeAttribute(attr, type, shape, x, { maxStringLength = null, variableLength = false, levels = null } = {}) {
         if (x === null) {
             throw new Error("cannot write 'null' to HDF5"); 
         }
@@ -212,7 +215,9 @@ export class H5Base {
         if (type == "String") {
             let [ lengths, buffer ] = packer.repack_strings(x);
             try {
-                if (maxStringLength == null) {
+                if (variableLength) {
+                    maxStringLength = -1;
+                } else if (maxStringLength == null) {
                     maxStringLength = fetch_max_string_length(lengths);
                 }
                 this.#create_attribute(attr, type, shape, { maxStringLength: maxStringLength });
@@ -359,6 +364,8 @@ export class H5Group extends H5Base {
      * @param {object} [options={}] - Optional parameters.
      * @param {number} [options.maxStringLength=10] - Maximum length of the strings to be saved.
      * Only used when `type = "String"`.
+     * @param {boolean} [options.variableLength=false] - Whether to create a variable-length UTF-8 string type.
+     * Only used when `type = "String"`, in which case `maxStringLength` is ignored.
      * @param {number} [options.compression=6] - Deflate compression level.
      * @param {?Array} [options.chunks=null] - Array containing the chunk dimensions.
      * This should have length equal to `shape`, with each value being no greater than the corresponding value of `shape`.
@@ -369,7 +376,7 @@ export class H5Group extends H5Base {
      * @return {H5DataSet} A dataset of the specified type and shape is created as an immediate child of the current group.
      * A {@linkplain H5DataSet} object is returned representing this new dataset.
      */
-    createDataSet(name, type, shape, { maxStringLength = 10, levels = null, compression = 6, chunks = null } = {}) {
+    createDataSet(name, type, shape, { maxStringLength = 10, variableLength = false, levels = null, compression = 6, chunks = null } = {}) {
         let new_name = this.#child_name(name);
 
         let shape_arr;
@@ -387,7 +394,7 @@ export class H5Group extends H5Base {
             }
 
             if (type == "String") {
-                wasm.call(module => module.create_string_hdf5_dataset(this.file, new_name, shape_arr.length, shape_arr.offset, compression, chunk_offset, maxStringLength));
+                wasm.call(module => module.create_string_hdf5_dataset(this.file, new_name, shape_arr.length, shape_arr.offset, compression, chunk_offset, (variableLength ? -1 : maxStringLength)));
             } else if (type == "Enum") {
                 if (levels == null) {
                     throw new Error("levels must be supplied if 'type = \"Enum\"'");
@@ -423,6 +430,8 @@ export class H5Group extends H5Base {
      * @param {?Array} [options.levels=null] - Array of strings containing enum levels when `type = "Enum"`.
      * If supplied, `x` should be an array of integers that index into `levels`.
      * Alternatively, `levels` may be `null`, in which case `x` should be an array of strings that is used to infer `levels`.
+     * @param {boolean} [options.variableLength=false] - Whether to save strings with a variable-length UTF-8 type.
+     * Only used when `type = "String"`.
      * @param {number} [options.compression=6] - Deflate compression level.
      * @param {?Array} [options.chunks=null] - Array containing the chunk dimensions.
      * This should have length equal to `shape`, with each value being no greater than the corresponding value of `shape`.
@@ -433,7 +442,7 @@ export class H5Group extends H5Base {
      * The same dataset is then filled with the contents of `x`.
      * A {@linkplain H5DataSet} object is returned representing this new dataset.
      */
-     writeDataSet(name, type, shape, x, { levels = null, compression = 6, chunks = null, cache = false } = {}) {
+     writeDataSet(name, type, shape, x, { levels = null, variableLength = false, compression = 6, chunks = null, cache = false } = {}) {
         if (x === null) {
             throw new Error("cannot write 'null' to HDF5"); 
         }
@@ -447,7 +456,7 @@ export class H5Group extends H5Base {
             let [ lengths, buffer ] = packer.repack_strings(x);
             try {
                 let maxlen = fetch_max_string_length(lengths);
-                handle = this.createDataSet(name, "String", shape, { maxStringLength: maxlen, compression: compression, chunks: chunks });
+                handle = this.createDataSet(name, "String", shape, { maxStringLength: maxlen, variableLength: variableLength, compression: compression, chunks: chunks });
                 wasm.call(module => module.write_string_hdf5_dataset(handle.file, handle.name, lengths.length, lengths.offset, buffer.offset));
             } finally {
                 utils.free(lengths);
@@ -467,6 +476,59 @@ export class H5Group extends H5Base {
 
         return handle;
     }
+
+    /**
+     * Create a numeric dataset that is filled by appending successive slabs, see {@linkplain H5DataSetWriter}.
+     * This avoids holding the entire dataset in memory at once.
+     *
+     * @param {string} name - Name of the dataset to create.
+     * @param {string} type - Type of dataset to create.
+     * This can be `"IntX"` or `"UintX"` for `X` of 8, 16, 32, or 64;
+     * or `"FloatX"` for `X` of 32 or 64.
+     * @param {Array} shape - Array containing the dimensions of the dataset to create.
+     * Slabs are appended along the first dimension.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {number} [options.compression=6] - Deflate compression level.
+     * If negative, no compression is performed.
+     * @param {?number} [options.chunkLength=null] - Length of each chunk along the first dimension.
+     * Chunks always span the full extent of all other dimensions.
+     * If `null`, this is chosen so that each chunk contains around 100,000 elements.
+     *
+     * @return {H5DataSetWriter} A writer for the newly created dataset, which is an immediate child of the current group.
+     */
+    createDataSetWriter(name, type, shape, { compression = 6, chunkLength = null } = {}) {
+        if (type == "String" || type == "Enum") {
+            throw new Error("dataset writers only support numeric types");
+        }
+        if (shape.length == 0) {
+            throw new Error("dataset writers do not support scalar datasets");
+        }
+
+        if (chunkLength === null) {
+            let row_size = shape.slice(1).reduce((a, b) => a * b, 1);
+            chunkLength = Math.max(1, Math.floor(100000 / Math.max(1, row_size)));
+        }
+
+        let new_name = this.#child_name(name);
+        let shape_arr;
+        let output;
+        try {
+            shape_arr = utils.wasmifyArray(shape, "Int32WasmArray");
+            output = gc.call(
+                module => new module.Hdf5DataSetWriter(this.file, new_name, shape_arr.length, shape_arr.offset, type, compression, chunkLength),
+                H5DataSetWriter,
+                this.file,
+                new_name,
+                type,
+                shape
+            );
+        } finally {
+            utils.free(shape_arr);
+        }
+
+        this.children[name] = "DataSet";
+        return output;
+    }
 }
 
 /**
@@ -708,6 +770,99 @@ export class H5DataSet extends H5Base {
     }
 }
 
+/**
+ * Writer for a numeric HDF5 dataset that is filled by appending successive slabs along the first dimension.
+ * This is useful for exporting large results without first assembling the entire dataset as a single array.
+ * Complete chunks are compressed in parallel and written directly to file,
+ * while any leftover rows are buffered until the next slab is appended.
+ *
+ * @hideconstructor
+ */
+export class H5DataSetWriter {
+    #id;
+    #writer;
+    #file;
+    #name;
+    #type;
+    #shape;
+
+    constructor(id, raw, file, name, type, shape) {
+        this.#id = id;
+        this.#writer = raw;
+        this.#file = file;
+        this.#name = name;
+        this.#type = type;
+        this.#shape = shape;
+    }
+
+    #check() {
+        if (this.#writer === null) {
+            throw new Error("writer has already been finished or freed");
+        }
+    }
+
+    /**
+     * @return {number} Number of entries along the first dimension that have been appended so far.
+     */
+    numberOfWritten() {
+        this.#check();
+        return this.#writer.num_written();
+    }
+
+    /**
+     * @param {(WasmArray|TypedArray|Array)} x - Values to append to the dataset.
+     * This should contain an integer number of slices along the first dimension, i.e., its length should be a multiple of the product of all other dimensions.
+     * Values should be arranged in row-major order, i.e., with the last dimension being the fastest-changing.
+     * WasmArrays on the **scran.js** heap (e.g., views from other results) are used directly without copying.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use for compression.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     *
+     * @return `x` is appended to the dataset.
+     * No return value is provided.
+     */
+    append(x, { numberOfThreads = null } = {}) {
+        this.#check();
+        forbid_strings(x);
+        let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+        let y;
+        try {
+            y = utils.wasmifyArray(x, null);
+            let input_type = y.constructor.className.replace(/WasmArray$/, "");
+            wasm.call(module => this.#writer.append(y.offset, y.length, input_type, nthreads));
+        } finally {
+            utils.free(y);
+        }
+    }
+
+    /**
+     * Complete the dataset by writing any buffered rows.
+     * All entries along the first dimension should have been appended before calling this method.
+     * This object is freed afterwards.
+     *
+     * @return {H5DataSet} Representation of the completed dataset.
+     */
+    finish() {
+        this.#check();
+        wasm.call(module => this.#writer.finish());
+        this.free();
+        return new H5DataSet(this.#file, this.#name, { newlyCreated: true, type: this.#type, shape: this.#shape });
+    }
+
+    /**
+     * @return Frees the memory allocated on the Wasm heap for this object.
+     * This invalidates this object and all references to it.
+     * Any buffered rows that have not yet been written are discarded.
+     */
+    free() {
+        if (this.#writer !== null) {
+            gc.release(this.#id);
+            this.#writer = null;
+        }
+    }
+}
+
 function extract_names(host, output, recursive = true) {
     for (const [key, val] of Object.entries(host.children)) {
         if (val == "Group") {
@@ -1,4 +1,4 @@
-export { initialize, terminate, wasmArraySpace, heapSize, maximumThreads } from "./wasm.js";
+export { initialize, loadThreads, terminate, wasmArraySpace, heapSize, maximumThreads, setDeterministicThreading } from "./wasm.js";
 export { createUint8WasmArray, createInt32WasmArray, createFloat64WasmArray, free } from "./utils.js";
 
 export * from "./initializeSparseMatrix.js";
@@ -7,14 +7,20 @@ export * from "./file.js";
 
 export * from "./hdf5.js";
 export * from "./writeSparseMatrixToHdf5.js";
+export * from "./exportH5ad.js";
 
 export * from "./guessFeatures.js";
 export * from "./block.js";
 export * from "./factorize.js";
 
 export * from "./cbind.js";
+export * from "./mergeMatrices.js";
 export * from "./subset.js";
 export * from "./delayed.js";
+export * from "./multiplyMatrix.js";
+export * from "./computeMatrixStatistics.js";
+export * from "./computeGeneCorrelations.js";
+export * from "./quantizeExpression.js";
 
 export * from "./perCellRnaQcMetrics.js";
 export * from "./perCellAdtQcMetrics.js";
@@ -37,6 +43,8 @@ export * from "./findNearestNeighbors.js";
 export * from "./clusterSnnGraph.js";
 export * from "./runTsne.js";
 export * from "./runUmap.js";
+export * from "./sketchCells.js";
+export * from "./binEmbedding.js";
 
 export * from "./clusterKmeans.js";
 
@@ -47,6 +55,10 @@ export * from "./scaleByNeighbors.js";
 export * from "./scoreMarkers.js";
 export * from "./labelCells.js";
 
+export * from "./checkpoint.js";
+export * from "./memoCache.js";
+export * from "./bufferPool.js";
+
 export * from "./scoreFeatureSet.js";
 export * from "./hypergeometricTest.js";
 export * from "./testFeatureSetEnrichment.js";
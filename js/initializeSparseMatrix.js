@@ -15,12 +15,16 @@ import { ScranMatrix } from "./ScranMatrix.js";
  * @param {boolean} [options.layered=true] - Whether to create a layered sparse matrix, see [**tatami_layered**](https://github.com/tatami-inc/tatami_layered) for more details.
  * Only used if `values` contains an integer type and/or `forceInteger = true`.
  * Setting to `true` assumes that `values` contains only non-negative integers.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use for conversion into the layered sparse representation.
+ * Only used if `layered = true`.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {ScranMatrix} Matrix containing sparse data.
  */
-export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColumns, values, { forceInteger = true, layered = true } = {}) {
+export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColumns, values, { forceInteger = true, layered = true, numberOfThreads = null } = {}) {
     var val_data; 
     var output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     try {
         val_data = utils.wasmifyArray(values, null);
@@ -35,7 +39,8 @@ export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColum
                 val_data.offset, 
                 val_data.constructor.className.replace("Wasm", ""),
                 forceInteger,
-                layered
+                layered,
+                nthreads
             ),
             ScranMatrix
         );
@@ -69,14 +74,18 @@ export function initializeSparseMatrixFromDenseArray(numberOfRows, numberOfColum
  * @param {boolean} [options.layered=true] - Whether to create a layered sparse matrix, see [**tatami_layered**](https://github.com/tatami-inc/tatami_layered) for more details.
  * Only used if `values` contains an integer type and/or `forceInteger = true`.
  * Setting to `true` assumes that `values` contains only non-negative integers.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use for conversion into the layered sparse representation.
+ * Only used if `layered = true`.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {ScranMatrix} Matrix containing sparse data.
  */ 
-export function initializeSparseMatrixFromCompressedVectors(numberOfRows, numberOfColumns, values, indices, pointers, { byRow = true, forceInteger = true, layered = true } = {}) {
+export function initializeSparseMatrixFromCompressedVectors(numberOfRows, numberOfColumns, values, indices, pointers, { byRow = true, forceInteger = true, layered = true, numberOfThreads = null } = {}) {
     var val_data;
     var ind_data;
     var indp_data;
     var output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     try {
         val_data = utils.wasmifyArray(values, null);
@@ -102,7 +111,8 @@ export function initializeSparseMatrixFromCompressedVectors(numberOfRows, number
                 indp_data.constructor.className.replace("Wasm", ""), 
                 byRow,
                 forceInteger,
-                layered
+                layered,
+                nthreads
             ),
             ScranMatrix
         );
@@ -233,13 +243,17 @@ export function extractMatrixMarketDimensions(x, { compressed = null } = {}) {
  * All indices must be non-negative integers less than the number of rows in the sparse matrix.
  * @param {?(Array|TypedArray|Int32WasmArray)} [options.subsetColumn=null] - Column indices to extract.
  * All indices must be non-negative integers less than the number of columns in the sparse matrix.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use for conversion into the layered sparse representation.
+ * Only used for sparse matrices, whose components are loaded into memory before the conversion; dense matrices are always converted on a single thread.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {ScranMatrix} Matrix containing sparse data.
  */
-export function initializeSparseMatrixFromHdf5(file, name, { forceInteger = true, layered = true, subsetRow = null, subsetColumn = null } = {}) {
+export function initializeSparseMatrixFromHdf5(file, name, { forceInteger = true, layered = true, subsetRow = null, subsetColumn = null, numberOfThreads = null } = {}) {
     var ids = null;
     var output;
     let wasm_row, wasm_col;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     try {
         let use_row_subset = (subsetRow !== null);
@@ -259,7 +273,7 @@ export function initializeSparseMatrixFromHdf5(file, name, { forceInteger = true
         }
 
         output = gc.call(
-            module => module.read_hdf5_matrix(file, name, forceInteger, layered, use_row_subset, row_offset, row_length, use_col_subset, col_offset, col_length),
+            module => module.read_hdf5_matrix(file, name, forceInteger, layered, use_row_subset, row_offset, row_length, use_col_subset, col_offset, col_length, nthreads),
             ScranMatrix
         );
 
@@ -361,16 +375,20 @@ export function initializeDenseMatrixFromDenseArray(numberOfRows, numberOfColumn
  * @param {boolean} [options.layered=true] - Whether to create a layered sparse matrix, see [**tatami_layered**](https://github.com/tatami-inc/tatami_layered) for more details.
  * Only used if the R matrix is of an integer type and/or `forceInteger = true`.
  * Setting to `true` assumes that the matrix contains only non-negative integers.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use for conversion into the layered sparse representation.
+ * Only used if `layered = true`.
+ * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {ScranMatrix} Sparse matrix.
  */
-export function initializeSparseMatrixFromRds(x, { forceInteger = true, layered = true } = {}) {
+export function initializeSparseMatrixFromRds(x, { forceInteger = true, layered = true, numberOfThreads = null } = {}) {
     var ids = null;
     var output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
 
     try {
         output = gc.call(
-            module => module.initialize_sparse_matrix_from_rds(x.object.$$.ptr, forceInteger, layered),
+            module => module.initialize_sparse_matrix_from_rds(x.object.$$.ptr, forceInteger, layered, nthreads),
             ScranMatrix
         );
     } catch(e) {
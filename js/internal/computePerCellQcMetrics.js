@@ -44,3 +44,12 @@ export function computePerCellQcMetrics(x, subsets, run) {
 
     return output;
 }
+
+export function checkBuffer(buffer, type, length, name) {
+    if (!(buffer instanceof wa[type])) {
+        throw new Error("'buffers." + name + "' should be a " + type);
+    }
+    if (buffer.length != length) {
+        throw new Error("length of 'buffers." + name + "' should be equal to the number of cells");
+    }
+}
@@ -1,17 +1,63 @@
 import * as utils from "../utils.js";
 
+function is_ascii(buffer) {
+    for (const b of buffer) {
+        if (b >= 128) {
+            return false;
+        }
+    }
+    return true;
+}
+
 export function unpack_strings(buffer, lengths) {
+    // Copying once, as the buffer is usually a view on the Wasm heap. This is
+    // a SharedArrayBuffer in pthread builds, which TextDecoder refuses to read.
+    buffer = buffer.slice();
+
     let dec = new TextDecoder();
-    let names = [];
+    let names = new Array(lengths.length);
     let sofar = 0;
-    for (const l of lengths) {
-        let view = buffer.slice(sofar, sofar + l);
-        names.push(dec.decode(view));
-        sofar += l;
+
+    if (is_ascii(buffer)) {
+        // Each byte is a character, so we decode everything at once and slice the result.
+        let combined = dec.decode(buffer);
+        lengths.forEach((l, i) => {
+            names[i] = combined.slice(sofar, sofar + l);
+            sofar += l;
+        });
+    } else {
+        lengths.forEach((l, i) => {
+            names[i] = dec.decode(buffer.subarray(sofar, sofar + l));
+            sofar += l;
+        });
     }
+
     return names;
 }
 
+function utf8_length(x) {
+    let total = 0;
+    for (var i = 0; i < x.length; i++) {
+        let c = x.charCodeAt(i);
+        if (c < 0x80) {
+            total += 1;
+        } else if (c < 0x800) {
+            total += 2;
+        } else if (c >= 0xD800 && c < 0xDC00 && i + 1 < x.length) {
+            let next = x.charCodeAt(i + 1);
+            if (next >= 0xDC00 && next < 0xE000) {
+                total += 4; // valid surrogate pair.
+                i++;
+            } else {
+                total += 3; // lone surrogates are replaced with U+FFFD.
+            }
+        } else {
+            total += 3;
+        }
+    }
+    return total;
+}
+
 export function repack_strings(x) {
     let buffer;
     let lengths;
@@ -27,23 +73,22 @@ export function repack_strings(x) {
         let lengths_arr = lengths.array();
 
         let total = 0;
-        const enc = new TextEncoder;
-        let contents = new Array(x.length);
-
         x.forEach((y, i) => {
-            let e = enc.encode(y);
-            lengths_arr[i] = e.length;
-            contents[i] = e;
-            total += e.length;
+            let l = utf8_length(y);
+            lengths_arr[i] = l;
+            total += l;
         });
 
+        // Encoding directly into the Wasm buffer, without any intermediate arrays.
         buffer = utils.createUint8WasmArray(total);
+        lengths_arr = lengths.array(); // refreshing in case the allocation invalidated the view.
         let buffer_arr = buffer.array();
+        const enc = new TextEncoder;
         total = 0;
-
-        contents.forEach(y => {
-            buffer_arr.set(y, total);
-            total += y.length;
+        x.forEach((y, i) => {
+            let l = lengths_arr[i];
+            enc.encodeInto(y, buffer_arr.subarray(total, total + l));
+            total += l;
         });
     } catch (e) {
         utils.free(buffer);
@@ -269,6 +269,69 @@ export function buildLabelledReference(features, loaded, referenceFeatures, { to
     return output;
 }
 
+function save_serialized(FUN) {
+    let serialized;
+    let output;
+    try {
+        serialized = wasm.call(FUN);
+        output = serialized.buffer().slice();
+    } finally {
+        if (serialized) {
+            serialized.delete();
+        }
+    }
+    return output;
+}
+
+/**
+ * Save a built reference dataset to a compact binary buffer.
+ * This can be reloaded in a later session with {@linkcode loadBuiltLabelledReferenceFromBuffer},
+ * avoiding the need to load and build the reference from scratch.
+ *
+ * @param {BuildLabelledReferenceResults} built - A built reference dataset, typically generated by {@linkcode buildLabelledReference}.
+ *
+ * @return {Uint8Array} Buffer containing the serialized reference.
+ */
+export function saveBuiltLabelledReference(built) {
+    return save_serialized(module => module.save_built_singlepp_reference(built.reference));
+}
+
+/**
+ * Load a built reference dataset from a buffer created by {@linkcode saveBuiltLabelledReference}.
+ * Loading does not require any decompression or re-ranking of the reference profiles, though the neighbor search indices for each label are rebuilt.
+ *
+ * @param {Uint8Array|Uint8WasmArray} buffer - Buffer containing the serialized reference.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use for rebuilding the search indices.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {BuildLabelledReferenceResults} Object containing the built reference dataset.
+ * This can be used in {@linkcode labelCells} with a test matrix that has the same features as that used in the original call to {@linkcode buildLabelledReference}.
+ */
+export function loadBuiltLabelledReferenceFromBuffer(buffer, { numberOfThreads = null } = {}) {
+    let buf;
+    let output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    try {
+        buf = utils.wasmifyArray(buffer, "Uint8WasmArray");
+        output = gc.call(
+            module => module.load_built_singlepp_reference(buf.offset, buf.length, nthreads),
+            BuildLabelledReferenceResults
+        );
+        output.expectedNumberOfFeatures = output.reference.num_features();
+
+    } catch (e) {
+        utils.free(output);
+        throw e;
+
+    } finally {
+        utils.free(buf);
+    }
+
+    return output;
+}
+
 /**************************************************
  **************************************************/
 
@@ -433,19 +496,107 @@ function label_cells(x, expectedNumberOfFeatures, numberOfFeatures, numberOfCell
  * @param {?number} [options.numberOfFeatures=null] - Number of features, used when `x` is a Float64WasmArray.
  * @param {?number} [options.numberOfCells=null] - Number of cells, used when `x` is a Float64WasmArray.
  * @param {number} [options.quantile=0.8] - Quantile on the correlations to use to compute the score for each label.
+ * @param {boolean} [options.cacheMarkers=false] - Whether to use a native fine-tuning engine that caches the marker-related calculations for each combination of candidate labels.
+ * This can be much faster for large datasets with many labels, as cells with the same candidates do not need to repeat the same work.
+ * The predicted labels and scores are the same as those from the default fine-tuning,
+ * though the deltas may differ by floating-point round-off due to differences in the computation of the correlations.
+ * @param {number} [options.fineTuneThreshold=0.05] - Threshold on the difference from the maximum score, used to define the candidate labels in each round of fine-tuning.
+ * Only used if `cacheMarkers = true`.
+ * @param {number} [options.fineTuneCacheBytes=64e6] - Maximum size of the cache, in bytes.
+ * Each cached combination of candidate labels holds the scaled ranks of all reference profiles for those labels at their markers,
+ * so the size of each entry increases with the number of markers and profiles.
+ * Combinations that do not fit in the cache are still processed correctly but are recomputed for each cell.
+ * Setting this to zero disables caching altogether.
+ * Only used if `cacheMarkers = true`.
  * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
  * If `null`, defaults to {@linkcode maximumThreads}.
  *
  * @return {LabelCellsResults} Labelling results for each cell in `x`.
  */
-export function labelCells(x, reference, { numberOfFeatures = null, numberOfCells = null, quantile = 0.8, numberOfThreads = null } = {}) {
+export function labelCells(x, reference, { numberOfFeatures = null, numberOfCells = null, quantile = 0.8, cacheMarkers = false, fineTuneThreshold = 0.05, fineTuneCacheBytes = 64e6, numberOfThreads = null } = {}) {
     let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
     let FUN = (target, ptr) => {
-        return gc.call(module => module.run_singlepp(target, reference.reference, quantile, nthreads), LabelCellsResults);
+        if (cacheMarkers) {
+            return gc.call(module => module.run_singlepp_cached(target, reference.reference, quantile, fineTuneThreshold, fineTuneCacheBytes, nthreads), LabelCellsResults);
+        } else {
+            return gc.call(module => module.run_singlepp(target, reference.reference, quantile, nthreads), LabelCellsResults);
+        }
     };
     return label_cells(x, reference.expectedNumberOfFeatures, numberOfFeatures, numberOfCells, FUN, "reference");
 }
 
+/**
+ * Label cells in chunks of contiguous columns, based on similarity in expression to a reference dataset.
+ * This is a generator that yields the results for each chunk in turn,
+ * allowing callers to classify large datasets in bounded memory and to pipeline the labelling with other steps.
+ * Each chunk is still processed in parallel, and the results for each cell are the same as those from {@linkcode labelCells}.
+ *
+ * @param {ScranMatrix} x - The count matrix, or log-normalized matrix, containing features in the rows and cells in the columns.
+ * @param {BuildLabelledReferenceResults} reference - A built reference dataset, typically generated by {@linkcode buildLabelledReference}.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {number} [options.chunkSize=10000] - Number of cells in each chunk.
+ * @param {?number} [options.numberOfTopScores=null] - Number of top-scoring labels to report for each cell.
+ * If `null`, the scores for all labels are reported instead.
+ * @param {number} [options.quantile=0.8] - Quantile on the correlations to use to compute the score for each label.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @yields {object} Object containing the results for each chunk:
+ *
+ * - `start`: the index of the first cell in the chunk.
+ * - `end`: one past the index of the last cell in the chunk.
+ * - `predictedLabels`: an Int32Array containing the index of the best label for each cell in the chunk.
+ * - `fineTuningDelta`: a Float64Array containing the difference in scores between the best and second-best label during fine-tuning.
+ * - `scores`: an Array of Float64Arrays, one per label, containing the score for each cell in the chunk.
+ *   Only reported if `numberOfTopScores` is `null`, which is the default.
+ * - `topLabels`: an Int32Array of length equal to the number of cells in the chunk multiplied by `numberOfTopScores`,
+ *   containing the labels with the highest scores for each cell, in decreasing order of score.
+ *   Only reported if `numberOfTopScores` is a number, in which case `scores` is not reported.
+ * - `topScores`: a Float64Array of the same length as `topLabels`, containing the scores for each of the labels in `topLabels`.
+ *   Only reported if `numberOfTopScores` is a number, in which case `scores` is not reported.
+ */
+export function* labelCellsInChunks(x, reference, { chunkSize = 10000, numberOfTopScores = null, quantile = 0.8, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    if (x.numberOfRows() != reference.expectedNumberOfFeatures) {
+        throw new Error("number of rows in 'x' should be equal to length of 'features' used to build 'reference'");
+    }
+    if (chunkSize <= 0) {
+        throw new Error("'chunkSize' should be positive");
+    }
+
+    let top = (numberOfTopScores === null ? -1 : numberOfTopScores);
+    let NC = x.numberOfColumns();
+
+    for (var start = 0; start < NC; start += chunkSize) {
+        let len = Math.min(chunkSize, NC - start);
+        let raw;
+        let output = { start: start, end: start + len };
+
+        try {
+            raw = wasm.call(module => module.run_singlepp_chunk(x.matrix, start, len, reference.reference, quantile, top, nthreads));
+            output.predictedLabels = raw.get_best().slice();
+            output.fineTuningDelta = raw.get_delta().slice();
+
+            if (raw.has_scores()) {
+                output.scores = [];
+                for (var l = 0; l < raw.num_labels(); l++) {
+                    output.scores.push(raw.get_scores_for_label(l).slice());
+                }
+            } else {
+                output.topLabels = raw.get_top_labels().slice();
+                output.topScores = raw.get_top_scores().slice();
+            }
+
+        } finally {
+            if (raw) {
+                raw.delete();
+            }
+        }
+
+        yield output;
+    }
+}
+
 /**************************************************
  **************************************************/
 
@@ -590,6 +741,48 @@ export function integrateLabelledReferences(features, loaded, referenceFeatures,
     return output;
 }
 
+/**
+ * Save integrated reference datasets to a compact binary buffer.
+ * This can be reloaded in a later session with {@linkcode loadIntegratedLabelledReferencesFromBuffer}.
+ *
+ * @param {IntegrateLabelledReferencesResults} integrated - Integrated references, typically generated by {@linkcode integrateLabelledReferences}.
+ *
+ * @return {Uint8Array} Buffer containing the serialized references.
+ */
+export function saveIntegratedLabelledReferences(integrated) {
+    return save_serialized(module => module.save_integrated_singlepp_references(integrated.integrated));
+}
+
+/**
+ * Load integrated reference datasets from a buffer created by {@linkcode saveIntegratedLabelledReferences}.
+ *
+ * @param {Uint8Array|Uint8WasmArray} buffer - Buffer containing the serialized references.
+ *
+ * @return {IntegrateLabelledReferencesResults} Object containing the integrated references.
+ */
+export function loadIntegratedLabelledReferencesFromBuffer(buffer) {
+    let buf;
+    let output;
+
+    try {
+        buf = utils.wasmifyArray(buffer, "Uint8WasmArray");
+        output = gc.call(
+            module => module.load_integrated_singlepp_references(buf.offset, buf.length),
+            IntegrateLabelledReferencesResults
+        );
+        output.expectedNumberOfFeatures = output.integrated.num_features();
+
+    } catch (e) {
+        utils.free(output);
+        throw e;
+
+    } finally {
+        utils.free(buf);
+    }
+
+    return output;
+}
+
 /**
  * Wrapper around the integrated cell labelling results on the Wasm heap, typically produced by {@linkcode labelCells}.
  * @hideconstructor
@@ -0,0 +1,62 @@
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+
+/**
+ * Set the memory budget for memoization of expensive computations, currently {@linkcode runPca} and {@linkcode scoreMarkers}.
+ * Results are keyed by a fingerprint of the input {@linkplain ScranMatrix} (i.e., its original source and any subsequent subsetting, normalization or delayed operations),
+ * the contents of any input arrays and all parameters other than the number of threads.
+ * Repeated calls with the same inputs will then return a copy of the cached result instead of recomputing it.
+ * Once the budget is exceeded, the least recently used results are evicted.
+ * Results are never cached for matrices that are views of a caller-owned buffer (i.e., created by {@linkcode ScranMatrix.createDenseMatrix} with `copy = false`) or derived from such views,
+ * as the contents of the buffer may change without any change to the fingerprint.
+ *
+ * @param {number} bytes - Maximum size of all cached results, in bytes.
+ * If zero, caching is disabled, which is the default.
+ *
+ * @return The memory budget is set, and cached results are evicted until they fit within the new budget.
+ */
+export function setMemoizationBudget(bytes) {
+    wasm.call(module => module.set_memo_cache_budget(bytes));
+    return;
+}
+
+/**
+ * @return All cached results are removed.
+ * The budget and statistics are not changed.
+ */
+export function clearMemoizationCache() {
+    wasm.call(module => module.clear_memo_cache());
+    return;
+}
+
+/**
+ * @param {object} [options={}] - Optional parameters.
+ * @param {boolean} [options.reset=false] - Whether to reset the hit, miss and eviction counts after reporting them.
+ *
+ * @return {object} Object containing:
+ *
+ * - `budget`: the memory budget, in bytes.
+ * - `used`: the estimated memory used by the cached results, in bytes.
+ * - `entries`: the number of cached results.
+ * - `hits`: the number of calls that returned a cached result.
+ * - `misses`: the number of calls that had to compute their result.
+ * - `evictions`: the number of results that were evicted to stay within the budget.
+ */
+export function memoizationStatistics({ reset = false } = {}) {
+    let buffer;
+    let output;
+
+    try {
+        buffer = utils.createFloat64WasmArray(6);
+        wasm.call(module => module.memo_cache_statistics(buffer.offset));
+        let arr = buffer.array();
+        output = { budget: arr[0], used: arr[1], entries: arr[2], hits: arr[3], misses: arr[4], evictions: arr[5] };
+        if (reset) {
+            wasm.call(module => module.reset_memo_cache_statistics());
+        }
+    } finally {
+        utils.free(buffer);
+    }
+
+    return output;
+}
@@ -0,0 +1,230 @@
+import * as gc from "./gc.js";
+import * as utils from "./utils.js";
+import { ScranMatrix } from "./ScranMatrix.js";
+import { initializeSparseMatrixFromMatrixMarket, initializeSparseMatrixFromCompressedVectors } from "./initializeSparseMatrix.js";
+
+/**
+ * Merge multiple samples into a single sparse matrix, by appending each sample's columns as it is loaded.
+ * This avoids holding all samples in memory at once before combining them with {@linkcode cbindWithNames}.
+ * Each append reallocates the merged matrix to its new size, so peak memory usage is roughly twice the size of the merged matrix plus that of the largest sample;
+ * this can be reduced to the size of the final matrix plus the largest sample by specifying `expectedNonZero` in {@linkcode createSparseMatrixMerger}.
+ * The same applies when a sample contains larger (or non-integer) values than those seen previously,
+ * as the existing values are then converted to a larger type.
+ *
+ * Rows of each sample are aligned to a reference set of features, specified in {@linkcode createSparseMatrixMerger}.
+ * Rows in a sample that are not in the reference are discarded, while reference features that are absent from a sample are assigned zero counts.
+ * If a sample contains duplicated names, only the last occurrence of each name is used.
+ *
+ * @hideconstructor
+ */
+export class SparseMatrixMerger {
+    #id;
+    #merger;
+    #features;
+
+    constructor(id, raw, features) {
+        this.#id = id;
+        this.#merger = raw;
+
+        this.#features = new Map;
+        features.forEach((x, i) => {
+            if (!this.#features.has(x)) {
+                this.#features.set(x, i);
+            }
+        });
+    }
+
+    #check() {
+        if (this.#merger === null) {
+            throw new Error("merger has already been finalized or freed");
+        }
+    }
+
+    #create_mapping(names) {
+        let mapping = utils.createInt32WasmArray(names.length);
+        try {
+            let marr = mapping.array();
+            marr.fill(-1);
+            let last = new Map;
+            names.forEach((x, i) => {
+                let found = this.#features.get(x);
+                if (found !== undefined) {
+                    last.set(found, i);
+                }
+            });
+            for (const [f, i] of last) {
+                marr[i] = f;
+            }
+        } catch (e) {
+            utils.free(mapping);
+            throw e;
+        }
+        return mapping;
+    }
+
+    /**
+     * @return {number} Number of features in the merged matrix, i.e., the length of the reference set.
+     */
+    numberOfFeatures() {
+        this.#check();
+        return this.#merger.num_features();
+    }
+
+    /**
+     * @param {number} nonZero - Expected total number of non-zero elements across all samples, including those already appended.
+     * Space is reserved for the merged matrix so that it does not need to be reallocated for each sample.
+     */
+    reserve(nonZero) {
+        this.#check();
+        this.#merger.reserve(nonZero);
+    }
+
+    /**
+     * @return {number} Number of columns that have been appended so far.
+     */
+    numberOfColumns() {
+        this.#check();
+        return this.#merger.num_columns();
+    }
+
+    /**
+     * Append columns from an existing matrix.
+     *
+     * @param {ScranMatrix} x - Matrix containing data for a single sample.
+     * @param {Array} names - Array of row names for `x`.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {boolean} [options.free=false] - Whether to free `x` after its contents have been appended.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     */
+    addMatrix(x, names, { free = false, numberOfThreads = null } = {}) {
+        this.#check();
+        if (x.numberOfRows() !== names.length) {
+            throw new Error("length of 'names' should equal the number of rows of 'x'");
+        }
+
+        let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+        let mapping;
+        try {
+            mapping = this.#create_mapping(names);
+            this.#merger.append_matrix(x.matrix, mapping.offset, nthreads);
+        } finally {
+            utils.free(mapping);
+            if (free) {
+                utils.free(x);
+            }
+        }
+    }
+
+    /**
+     * Append columns from a MatrixMarket file.
+     * The file is loaded into memory, appended, and then immediately freed.
+     *
+     * @param {Uint8WasmArray|Array|TypedArray|string} x - Contents of or path to a MatrixMarket file, see {@linkcode initializeSparseMatrixFromMatrixMarket}.
+     * @param {Array} names - Array of row names for the matrix in `x`.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {?boolean} [options.compressed=null] - Whether the buffer is Gzip-compressed, see {@linkcode initializeSparseMatrixFromMatrixMarket}.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     */
+    addMatrixMarket(x, names, { compressed = null, numberOfThreads = null } = {}) {
+        this.#check();
+        let mat = initializeSparseMatrixFromMatrixMarket(x, { compressed });
+        this.addMatrix(mat, names, { free: true, numberOfThreads });
+    }
+
+    /**
+     * Append columns from compressed sparse vectors.
+     * The vectors are loaded into a temporary matrix that is freed immediately after appending.
+     *
+     * @param {number} numberOfRows - Number of rows in the sample.
+     * @param {number} numberOfColumns - Number of columns in the sample.
+     * @param {WasmArray} values - Values of the non-zero elements, see {@linkcode initializeSparseMatrixFromCompressedVectors}.
+     * @param {WasmArray} indices - Indices of the non-zero elements.
+     * @param {WasmArray} pointers - Pointers to the start of each row or column.
+     * @param {Array} names - Array of row names for the sample.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {boolean} [options.byRow=true] - Whether the input arrays are supplied in the compressed sparse row format.
+     * @param {boolean} [options.forceInteger=true] - Whether to coerce `values` to integers via truncation.
+     * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+     * If `null`, defaults to {@linkcode maximumThreads}.
+     */
+    addCompressedVectors(numberOfRows, numberOfColumns, values, indices, pointers, names, { byRow = true, forceInteger = true, numberOfThreads = null } = {}) {
+        this.#check();
+        let mat = initializeSparseMatrixFromCompressedVectors(numberOfRows, numberOfColumns, values, indices, pointers, { byRow, forceInteger, layered: false });
+        this.addMatrix(mat, names, { free: true, numberOfThreads });
+    }
+
+    /**
+     * Append columns from a matrix in a HDF5 file.
+     * Data is streamed directly from the file without first loading the entire matrix into memory.
+     *
+     * @param {string} file - Path to the HDF5 file.
+     * For browsers, the file should have been saved to the virtual filesystem.
+     * @param {string} name - Name of the matrix inside the file, see {@linkcode initializeSparseMatrixFromHdf5}.
+     * @param {Array} names - Array of row names for the matrix.
+     * @param {object} [options={}] - Optional parameters.
+     * @param {boolean} [options.forceInteger=true] - Whether to coerce all elements to integers via truncation.
+     */
+    addHdf5(file, name, names, { forceInteger = true } = {}) {
+        this.#check();
+        let mapping;
+        try {
+            mapping = this.#create_mapping(names);
+            this.#merger.append_hdf5(file, name, forceInteger, mapping.offset);
+        } finally {
+            utils.free(mapping);
+        }
+    }
+
+    /**
+     * Create the merged matrix.
+     * After this method is called, no further samples can be added and this object is freed.
+     *
+     * @return {ScranMatrix} Sparse matrix containing the merged samples,
+     * where the rows correspond to the reference features in {@linkcode createSparseMatrixMerger}.
+     */
+    finalize() {
+        this.#check();
+        let output = gc.call(module => this.#merger.finalize(), ScranMatrix);
+        this.free();
+        return output;
+    }
+
+    /**
+     * @return Frees the memory allocated on the Wasm heap for this object.
+     * This invalidates this object and all references to it.
+     */
+    free() {
+        if (this.#merger !== null) {
+            gc.release(this.#id);
+            this.#merger = null;
+        }
+    }
+}
+
+/**
+ * Create a merger to combine multiple samples into a single sparse matrix.
+ *
+ * @param {Array} features - Array of names of the reference features.
+ * All samples are aligned to these features, which define the rows of the merged matrix.
+ * If there are duplicates, only the first occurrence is used and the other rows will be all-zero.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?number} [options.expectedNonZero=null] - Expected total number of non-zero elements across all samples.
+ * If provided, space is reserved for the merged matrix up front so that it does not need to be reallocated for each sample.
+ * Overestimates waste memory, while underestimates cause reallocation once the reservation is exceeded.
+ *
+ * @return {SparseMatrixMerger} A merger to which samples can be added.
+ */
+export function createSparseMatrixMerger(features, { expectedNonZero = null } = {}) {
+    let output = gc.call(module => new module.SparseMatrixMerger(features.length), SparseMatrixMerger, features);
+    if (expectedNonZero !== null) {
+        try {
+            output.reserve(expectedNonZero);
+        } catch (e) {
+            output.free();
+            throw e;
+        }
+    }
+    return output;
+}
@@ -0,0 +1,101 @@
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+
+/**
+ * Multiply a {@linkplain ScranMatrix} by a dense vector or block of vectors.
+ * This works on any matrix, including delayed and layered matrices, and only visits the non-zero entries of sparse matrices.
+ *
+ * @param {ScranMatrix} x - The matrix of interest.
+ * @param {(Float64WasmArray|Array|TypedArray)} y - Dense block of vectors in column-major format.
+ * Each vector should be of length equal to the number of columns of `x`, or the number of rows if `transpose = true`.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {number} [options.numberOfVectors=1] - Number of vectors in `y`.
+ * @param {boolean} [options.transpose=false] - Whether to multiply by the transpose of `x`.
+ * @param {?Float64WasmArray} [options.buffer=null] - Buffer in which to store the product.
+ * If supplied, this should have length equal to the product of `numberOfVectors` and the number of rows of `x` (or the number of columns, if `transpose = true`).
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {Float64Array|Float64WasmArray} Product of `x` (or its transpose) and `y`, in column-major format with one column per vector.
+ * If `buffer` was supplied, it is returned directly.
+ */
+export function multiplyMatrix(x, y, { numberOfVectors = 1, transpose = false, buffer = null, numberOfThreads = null } = {}) {
+    let inner = (transpose ? x.numberOfRows() : x.numberOfColumns());
+    let outer = (transpose ? x.numberOfColumns() : x.numberOfRows());
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    let y_data;
+    let local_buffer;
+
+    try {
+        y_data = utils.wasmifyArray(y, "Float64WasmArray");
+        if (y_data.length != inner * numberOfVectors) {
+            throw new Error("length of 'y' should be equal to the product of 'numberOfVectors' and the " + (transpose ? "rows" : "columns") + " of 'x'");
+        }
+
+        if (buffer === null) {
+            local_buffer = utils.createFloat64WasmArray(outer * numberOfVectors);
+            buffer = local_buffer;
+        } else if (buffer.length != outer * numberOfVectors) {
+            throw new Error("length of 'buffer' should be equal to the product of 'numberOfVectors' and the " + (transpose ? "columns" : "rows") + " of 'x'");
+        }
+
+        wasm.call(module => module.multiply_dense(x.matrix, numberOfVectors, y_data.offset, transpose, buffer.offset, nthreads));
+        if (local_buffer !== undefined) {
+            return local_buffer.slice();
+        }
+
+    } finally {
+        utils.free(y_data);
+        utils.free(local_buffer);
+    }
+
+    return buffer;
+}
+
+/**
+ * Multiply a {@linkplain ScranMatrix} by a sparse vector, i.e., compute a weighted sum of a subset of its columns (or rows, if `transpose = true`).
+ * Only the selected columns or rows are extracted, which is much cheaper than {@linkcode multiplyMatrix} for small selections.
+ *
+ * @param {ScranMatrix} x - The matrix of interest.
+ * @param {(Int32WasmArray|Array|TypedArray)} indices - Indices of the non-zero entries of the sparse vector, i.e., the selected columns of `x` (or rows, if `transpose = true`).
+ * @param {?(Float64WasmArray|Array|TypedArray)} weights - Values of the non-zero entries of the sparse vector, of the same length as `indices`.
+ * If `null`, all weights are set to 1, i.e., the selected columns/rows are summed.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {boolean} [options.transpose=false] - Whether to multiply by the transpose of `x`.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {Float64Array} Product of `x` (or its transpose) and the sparse vector,
+ * of length equal to the number of rows of `x` (or the number of columns, if `transpose = true`).
+ */
+export function multiplyMatrixSparse(x, indices, weights, { transpose = false, numberOfThreads = null } = {}) {
+    let outer = (transpose ? x.numberOfColumns() : x.numberOfRows());
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    let index_data;
+    let weight_data;
+    let output;
+
+    try {
+        index_data = utils.wasmifyArray(indices, "Int32WasmArray");
+        if (weights === null) {
+            weight_data = utils.createFloat64WasmArray(index_data.length);
+            weight_data.array().fill(1);
+        } else {
+            weight_data = utils.wasmifyArray(weights, "Float64WasmArray");
+            if (weight_data.length != index_data.length) {
+                throw new Error("'indices' and 'weights' should have the same length");
+            }
+        }
+
+        output = utils.createFloat64WasmArray(outer);
+        wasm.call(module => module.multiply_selector(x.matrix, index_data.length, index_data.offset, weight_data.offset, transpose, output.offset, nthreads));
+        return output.slice();
+
+    } finally {
+        utils.free(index_data);
+        utils.free(weight_data);
+        utils.free(output);
+    }
+}
@@ -134,18 +134,53 @@ export class PerCellRnaQcMetricsResults {
  * @param {object} [options={}] - Optional parameters.
  * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
  * If `null`, defaults to {@linkcode maximumThreads}.
+ * @param {?object} [options.buffers=null] - Caller-provided buffers in which to store the QC metrics.
+ * This should contain `sums`, a Float64WasmArray; `detected`, an Int32WasmArray; and `subsetProportions`, an array of Float64WasmArrays, one per subset.
+ * Each array should be of length equal to the number of columns of `x`.
+ * The returned object will then use these buffers directly instead of allocating its own, so they should not be freed before the returned object.
+ * If `null`, storage is allocated by the returned object, possibly recycling memory from previously freed results.
  *
  * @return {PerCellRnaQcMetricsResults} Object containing the QC metrics.
  */
-export function perCellRnaQcMetrics(x, subsets, { numberOfThreads = null } = {}) {
+export function perCellRnaQcMetrics(x, subsets, { numberOfThreads = null, buffers = null } = {}) {
     let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
-     return internal.computePerCellQcMetrics(
+    return internal.computePerCellQcMetrics(
         x, 
         subsets, 
-        (matrix, nsubsets, subset_offset) => gc.call(
-            module => module.per_cell_rna_qc_metrics(matrix, nsubsets, subset_offset, nthreads),
-            PerCellRnaQcMetricsResults
-        )
+        (matrix, nsubsets, subset_offset) => {
+            if (buffers === null) {
+                return gc.call(
+                    module => module.per_cell_rna_qc_metrics(matrix, nsubsets, subset_offset, false, 0, 0, 0, nthreads),
+                    PerCellRnaQcMetricsResults
+                );
+            }
+
+            let ncells = x.numberOfColumns();
+            internal.checkBuffer(buffers.sums, "Float64WasmArray", ncells, "sums");
+            internal.checkBuffer(buffers.detected, "Int32WasmArray", ncells, "detected");
+
+            let props = buffers.subsetProportions;
+            if (!(props instanceof Array) || props.length != nsubsets) {
+                throw new Error("'buffers.subsetProportions' should be an array of length equal to the number of subsets");
+            }
+
+            let prop_offsets;
+            try {
+                prop_offsets = utils.createBigUint64WasmArray(nsubsets);
+                let prop_arr = prop_offsets.array();
+                for (var i = 0; i < nsubsets; i++) {
+                    internal.checkBuffer(props[i], "Float64WasmArray", ncells, "subsetProportions");
+                    prop_arr[i] = BigInt(props[i].offset);
+                }
+
+                return gc.call(
+                    module => module.per_cell_rna_qc_metrics(matrix, nsubsets, subset_offset, true, buffers.sums.offset, buffers.detected.offset, prop_offsets.offset, nthreads),
+                    PerCellRnaQcMetricsResults
+                );
+            } finally {
+                utils.free(prop_offsets);
+            }
+        }
     );
 }
 
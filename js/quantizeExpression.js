@@ -0,0 +1,71 @@
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+
+/**
+ * Quantize the expression values of a batch of genes into 8-bit codes, typically for colouring cells in an embedding.
+ * Each gene is scaled to its own range and values are linearly mapped to integers in `[0, 255]`, clipping values outside of the range.
+ * This is 8-fold smaller than extracting each gene as a Float64Array, and the scaling is performed natively across multiple threads.
+ *
+ * @param {ScranMatrix} x - Matrix of (usually log-normalized) expression values, where rows are genes and columns are cells.
+ * @param {(Int32WasmArray|Array|TypedArray)} rows - Row indices of the genes to quantize.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {string} [options.scale="minmax"] - How to define the range for each gene.
+ * This can be `"minmax"`, to use the minimum and maximum values; or `"quantile"`, to use the quantiles defined by `lowerQuantile` and `upperQuantile`.
+ * @param {number} [options.lowerQuantile=0.01] - Probability for the lower quantile, only used when `scale = "quantile"`.
+ * @param {number} [options.upperQuantile=0.99] - Probability for the upper quantile, only used when `scale = "quantile"`.
+ * @param {?Uint8WasmArray} [options.buffer=null] - Buffer in which to store the quantized values.
+ * If supplied, this should have length equal to the product of the length of `rows` and the number of columns of `x`.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {object} Object containing:
+ *
+ * - `values`: a Uint8Array (or `buffer`, if supplied) containing the quantized values.
+ *   Values for each gene are contiguous, i.e., the `i`-th gene occupies the `i * numberOfColumns()`-th to the `(i + 1) * numberOfColumns() - 1`-th entries.
+ * - `lower`: a Float64Array containing the lower end of the range for each gene, corresponding to a code of 0.
+ * - `upper`: a Float64Array containing the upper end of the range for each gene, corresponding to a code of 255.
+ *
+ * An original value can be approximated as `lower + code / 255 * (upper - lower)`.
+ */
+export function quantizeExpression(x, rows, { scale = "minmax", lowerQuantile = 0.01, upperQuantile = 0.99, buffer = null, numberOfThreads = null } = {}) {
+    let use_quantiles;
+    if (scale == "minmax") {
+        use_quantiles = false;
+    } else if (scale == "quantile") {
+        use_quantiles = true;
+    } else {
+        throw new Error("'scale' should be either 'minmax' or 'quantile'");
+    }
+
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+    let row_data;
+    let range_data;
+    let local_buffer;
+    let output = {};
+
+    try {
+        row_data = utils.wasmifyArray(rows, "Int32WasmArray");
+        let total = row_data.length * x.numberOfColumns();
+        if (buffer === null) {
+            local_buffer = utils.createUint8WasmArray(total);
+            buffer = local_buffer;
+        } else if (buffer.length != total) {
+            throw new Error("length of 'buffer' should be equal to the product of the length of 'rows' and the number of columns of 'x'");
+        }
+
+        range_data = utils.createFloat64WasmArray(row_data.length * 2);
+        wasm.call(module => module.quantize_expression(x.matrix, row_data.length, row_data.offset, use_quantiles, lowerQuantile, upperQuantile, buffer.offset, range_data.offset, nthreads));
+
+        output.values = (local_buffer !== undefined ? local_buffer.slice() : buffer);
+        let ranges = range_data.array();
+        output.lower = ranges.filter((y, i) => i % 2 == 0);
+        output.upper = ranges.filter((y, i) => i % 2 == 1);
+
+    } finally {
+        utils.free(row_data);
+        utils.free(range_data);
+        utils.free(local_buffer);
+    }
+
+    return output;
+}
@@ -72,6 +72,16 @@ export class TsneStatus {
         wasm.call(module => module.run_tsne(this.#status, runTime, maxIterations, this.#coordinates.offset));
     }
 
+    // internal use only.
+    get status() {
+        return this.#status;
+    }
+
+    // internal use only.
+    get coordinates() {
+        return this.#coordinates;
+    }
+
     /**
      * @return Frees the memory allocated on the Wasm heap for this object.
      * This invalidates this object and all references to it.
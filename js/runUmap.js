@@ -80,6 +80,16 @@ export class UmapStatus {
         return utils.extractXY(this.numberOfCells(), this.#coordinates.array()); 
     }
 
+    // internal use only.
+    get status() {
+        return this.#status;
+    }
+
+    // internal use only.
+    get coordinates() {
+        return this.#coordinates;
+    }
+
     /**
      * @return Frees the memory allocated on the Wasm heap for this object.
      * This invalidates this object and all references to it.
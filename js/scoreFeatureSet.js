@@ -62,3 +62,80 @@ export function scoreFeatureSet(x, features, { block = null, scale = false, numb
 
     return output;
 }
+
+/**
+ * Compute per-cell scores for the activity of multiple feature sets.
+ * This is equivalent to calling {@linkcode scoreFeatureSet} on each set, 
+ * but is more efficient as the rows in the union of all sets are only extracted once from `x`.
+ *
+ * @param {ScranMatrix} x - Log-normalized expression matrix.
+ * @param {Array} featureSets - Array containing the feature sets.
+ * Each entry corresponds to a single feature set and may be an Array or TypedArray.
+ * Each array should contain unique row indices of `x` for the features belonging to the set.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?(Int32WasmArray|Array|TypedArray)} [options.block=null] - Array containing the block assignment for each cell, see {@linkcode scoreFeatureSet} for details.
+ * @param {boolean} [options.scale=false] - Whether to scale the expression matrix to unit variance for each feature before computing the per-feature weights.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {Array} Array of length equal to `featureSets`.
+ * Each entry is an object containing `weights` and `scores` for the corresponding feature set, as described in {@linkcode scoreFeatureSet}.
+ * Note that the `weights` are reported for the features in increasing order of their row indices.
+ */
+export function scoreFeatureSets(x, featureSets, { block = null, scale = false, numberOfThreads = null } = {}) {
+    let temp;
+    let output = [];
+    let pointer_data, index_data, block_data;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    try {
+        // Setting up the sparse set membership matrix.
+        let nsets = featureSets.length;
+        pointer_data = utils.createInt32WasmArray(nsets + 1);
+        let pointer_arr = pointer_data.array();
+        pointer_arr[0] = 0;
+        for (var s = 0; s < nsets; s++) {
+            pointer_arr[s + 1] = pointer_arr[s] + featureSets[s].length;
+        }
+
+        index_data = utils.createInt32WasmArray(pointer_arr[nsets]);
+        let index_arr = index_data.array();
+        let NR = x.numberOfRows();
+        for (var s = 0; s < nsets; s++) {
+            let start = pointer_arr[s];
+            featureSets[s].forEach((j, i) => {
+                if (j < 0 || j >= NR) {
+                    throw new Error("feature set " + String(s) + " contains out-of-range indices (" + String(j) + ")");
+                }
+                index_arr[start + i] = j;
+            });
+        }
+
+        // Setting up the blocks.
+        var bptr = 0;
+        var use_blocks = false;
+        if (block !== null) {
+            block_data = utils.wasmifyArray(block, "Int32WasmArray");
+            if (block_data.length != x.numberOfColumns()) {
+                throw new Error("'block' must be of length equal to the number of columns in 'x'");
+            }
+            use_blocks = true;
+            bptr = block_data.offset;
+        }
+
+        temp = wasm.call(module => module.score_feature_sets(x.matrix, nsets, pointer_data.offset, index_data.offset, use_blocks, bptr, scale, nthreads));
+        for (var s = 0; s < nsets; s++) {
+            output.push({ weights: temp.weights(s).slice(), scores: temp.scores(s).slice() });
+        }
+
+    } finally {
+        utils.free(block_data);
+        utils.free(pointer_data);
+        utils.free(index_data);
+        if (temp) {
+            temp.delete();
+        }
+    }
+
+    return output;
+}
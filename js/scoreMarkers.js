@@ -142,6 +142,11 @@ export class ScoreMarkersResults {
         return utils.possibleCopy(wasm.call(_ => this.#results.delta_detected(group, summary)), copy);
     }
 
+    // internal use only.
+    get results() {
+        return this.#results;
+    }
+
     /**
      * @return Frees the memory allocated on the Wasm heap for this object.
      * This invalidates this object and all references to it.
@@ -0,0 +1,163 @@
+import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
+import { RunPcaResults } from "./runPca.js";
+
+function extractCoordinates(x, numberOfDims, numberOfCells, temps) {
+    if (x instanceof RunPcaResults) {
+        return { 
+            offset: x.principalComponents({ copy: false }).byteOffset,
+            ndim: x.numberOfPCs(),
+            ncells: x.numberOfCells()
+        };
+    }
+
+    if (numberOfDims === null || numberOfCells === null) {
+        throw new Error("'numberOfDims' and 'numberOfCells' must be specified when 'x' is an Array");
+    }
+
+    let buffer = utils.wasmifyArray(x, "Float64WasmArray");
+    temps.push(buffer);
+    if (buffer.length != numberOfDims * numberOfCells) {
+        throw new Error("length of 'x' must be the product of 'numberOfDims' and 'numberOfCells'");
+    }
+
+    return { offset: buffer.offset, ndim: numberOfDims, ncells: numberOfCells };
+}
+
+/**
+ * Select a representative subset of cells by geometric sketching (Hie et al., 2019).
+ * Cells are assigned to equally-sized hypercubes in the low-dimensional space, and one cell is sampled from each occupied hypercube in turn.
+ * This preserves rare subpopulations better than uniform downsampling, as each region of the space contributes to the sketch regardless of its density.
+ * Downstream steps like {@linkcode runTsne}, {@linkcode runUmap} or {@linkcode clusterSnnGraph} can then be applied to the sketch,
+ * and their results transferred back to all cells with {@linkcode propagateSketchLabels} or {@linkcode propagateSketchCoordinates}.
+ *
+ * @param {(RunPcaResults|Float64WasmArray|Array|TypedArray)} x - Numeric coordinates of each cell in the dataset.
+ * For array inputs, this is expected to be in column-major format where the rows are the variables and the columns are the cells.
+ * For a {@linkplain RunPcaResults} input, we extract the principal components.
+ * @param {number} size - Number of cells to retain in the sketch.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?number} [options.numberOfDims=null] - Number of variables/dimensions per cell.
+ * Only used (and required) for array-like `x`.
+ * @param {?number} [options.numberOfCells=null] - Number of cells.
+ * Only used (and required) for array-like `x`.
+ * @param {number} [options.iterations=20] - Number of bisection steps used to choose the hypercube size.
+ * @param {number} [options.seed=42] - Seed for the random number generator.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {Int32Array} Sorted indices of the cells in the sketch.
+ * This has length equal to the smaller of `size` and the number of cells.
+ */
+export function sketchCells(x, size, { numberOfDims = null, numberOfCells = null, iterations = 20, seed = 42, numberOfThreads = null } = {}) {
+    let temps = [];
+    let output;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    try {
+        let coords = extractCoordinates(x, numberOfDims, numberOfCells, temps);
+        output = utils.createInt32WasmArray(Math.min(size, coords.ncells));
+        wasm.call(module => module.geometric_sketch(coords.offset, coords.ndim, coords.ncells, size, iterations, seed, output.offset, nthreads));
+        return output.slice();
+
+    } finally {
+        utils.free(output);
+        for (const t of temps) {
+            utils.free(t);
+        }
+    }
+}
+
+function propagate(x, sketch, numberOfDims, numberOfCells, run) {
+    let temps = [];
+
+    try {
+        let coords = extractCoordinates(x, numberOfDims, numberOfCells, temps);
+        let sketch_data = utils.wasmifyArray(sketch, "Int32WasmArray");
+        temps.push(sketch_data);
+        for (const s of sketch_data.array()) {
+            if (s < 0 || s >= coords.ncells) {
+                throw new Error("'sketch' contains out-of-range indices");
+            }
+        }
+        return run(coords, sketch_data, temps);
+
+    } finally {
+        for (const t of temps) {
+            utils.free(t);
+        }
+    }
+}
+
+/**
+ * Propagate labels from the sketched cells to all cells in the dataset.
+ * Each cell is assigned the most frequent label among its nearest neighbors in the sketch, with ties broken in favor of the closest neighbor.
+ *
+ * @param {(RunPcaResults|Float64WasmArray|Array|TypedArray)} x - Numeric coordinates of each cell in the dataset, as used in {@linkcode sketchCells}.
+ * @param {(Int32WasmArray|Array|TypedArray)} sketch - Indices of the sketched cells, usually from {@linkcode sketchCells}.
+ * @param {(Int32WasmArray|Array|TypedArray)} labels - Label for each sketched cell, e.g., a cluster assignment.
+ * This should have the same length as `sketch`.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?number} [options.numberOfDims=null] - Number of variables/dimensions per cell.
+ * Only used (and required) for array-like `x`.
+ * @param {?number} [options.numberOfCells=null] - Number of cells.
+ * Only used (and required) for array-like `x`.
+ * @param {number} [options.numberOfNeighbors=5] - Number of nearest sketched cells to use for voting.
+ * @param {boolean} [options.approximate=true] - Whether to use an approximate neighbor search.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {Int32Array} Label for each cell in the dataset.
+ */
+export function propagateSketchLabels(x, sketch, labels, { numberOfDims = null, numberOfCells = null, numberOfNeighbors = 5, approximate = true, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    return propagate(x, sketch, numberOfDims, numberOfCells, (coords, sketch_data, temps) => {
+        let label_data = utils.wasmifyArray(labels, "Int32WasmArray");
+        temps.push(label_data);
+        if (label_data.length != sketch_data.length) {
+            throw new Error("'labels' and 'sketch' should have the same length");
+        }
+
+        let output = utils.createInt32WasmArray(coords.ncells);
+        temps.push(output);
+        wasm.call(module => module.propagate_sketch_labels(coords.offset, coords.ndim, coords.ncells, sketch_data.length, sketch_data.offset, label_data.offset, numberOfNeighbors, approximate, output.offset, nthreads));
+        return output.slice();
+    });
+}
+
+/**
+ * Propagate coordinates from the sketched cells to all cells in the dataset, e.g., to obtain a t-SNE or UMAP embedding for all cells.
+ * Each cell is placed at the average position of its nearest neighbors in the sketch.
+ *
+ * @param {(RunPcaResults|Float64WasmArray|Array|TypedArray)} x - Numeric coordinates of each cell in the dataset, as used in {@linkcode sketchCells}.
+ * @param {(Int32WasmArray|Array|TypedArray)} sketch - Indices of the sketched cells, usually from {@linkcode sketchCells}.
+ * @param {(Float64WasmArray|Array|TypedArray)} coordinates - Coordinates for the sketched cells, in column-major format where the rows are dimensions and the columns are the sketched cells.
+ * @param {number} numberOfCoordinateDims - Number of dimensions in `coordinates`.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?number} [options.numberOfDims=null] - Number of variables/dimensions per cell.
+ * Only used (and required) for array-like `x`.
+ * @param {?number} [options.numberOfCells=null] - Number of cells.
+ * Only used (and required) for array-like `x`.
+ * @param {number} [options.numberOfNeighbors=3] - Number of nearest sketched cells to average over.
+ * @param {boolean} [options.approximate=true] - Whether to use an approximate neighbor search.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {Float64Array} Coordinates for all cells in the dataset, in column-major format where the rows are dimensions and the columns are cells.
+ */
+export function propagateSketchCoordinates(x, sketch, coordinates, numberOfCoordinateDims, { numberOfDims = null, numberOfCells = null, numberOfNeighbors = 3, approximate = true, numberOfThreads = null } = {}) {
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    return propagate(x, sketch, numberOfDims, numberOfCells, (coords, sketch_data, temps) => {
+        let coord_data = utils.wasmifyArray(coordinates, "Float64WasmArray");
+        temps.push(coord_data);
+        if (coord_data.length != sketch_data.length * numberOfCoordinateDims) {
+            throw new Error("length of 'coordinates' should be the product of 'numberOfCoordinateDims' and the length of 'sketch'");
+        }
+
+        let output = utils.createFloat64WasmArray(coords.ncells * numberOfCoordinateDims);
+        temps.push(output);
+        wasm.call(module => module.propagate_sketch_coordinates(coords.offset, coords.ndim, coords.ncells, sketch_data.length, sketch_data.offset, coord_data.offset, numberOfCoordinateDims, numberOfNeighbors, approximate, output.offset, nthreads));
+        return output.slice();
+    });
+}
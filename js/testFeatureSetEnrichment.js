@@ -1,5 +1,6 @@
 import { hypergeometricTest } from "./hypergeometricTest.js";
 import * as utils from "./utils.js";
+import * as wasm from "./wasm.js";
 
 /**
  * Test for feature set enrichment among markers using the {@linkcode hypergeometricTest} function.
@@ -24,6 +25,7 @@ import * as utils from "./utils.js";
  *
  * - `count`: Int32Array containing the number of markers present in each set.
  * - `size`: Int32Array containing the size of each set.
+ *   Duplicated indices in a set are only counted once, for both the size and the overlaps.
  * - `pvalue`: Float64Array containing the p-value for enrichment in each set.
  */
 export function testFeatureSetEnrichment(markers, featureSets, totalFeatures, { numberOfThreads = null } = {}) {
@@ -63,6 +65,124 @@ export function testFeatureSetEnrichment(markers, featureSets, totalFeatures, {
     };
 }
 
+function pack_index_arrays(arrays, totalFeatures, msg) {
+    let n = arrays.length;
+    let pointers = utils.createInt32WasmArray(n + 1);
+    let indices;
+
+    try {
+        let parr = pointers.array();
+        parr[0] = 0;
+        for (var i = 0; i < n; i++) {
+            parr[i + 1] = parr[i] + arrays[i].length;
+        }
+
+        indices = utils.createInt32WasmArray(parr[n]);
+        let iarr = indices.array();
+        for (var i = 0; i < n; i++) {
+            let start = parr[i];
+            let current = arrays[i];
+            for (var j = 0; j < current.length; j++) {
+                let k = current[j];
+                if (k < 0 || k >= totalFeatures) {
+                    throw new Error(msg + " " + String(i) + " contains out-of-range indices (" + String(k) + ")");
+                }
+                iarr[start + j] = k;
+            }
+        }
+
+    } catch (e) {
+        utils.free(pointers);
+        utils.free(indices);
+        throw e;
+    }
+
+    return { pointers, indices };
+}
+
+/**
+ * Test for feature set enrichment among the markers of multiple groups, e.g., for all clusters in a dataset.
+ * This is equivalent to calling {@linkcode testFeatureSetEnrichment} on the markers for each group,
+ * but the overlaps and p-values for all combinations of groups and sets are computed natively and in parallel.
+ * P-values are computed with the same interpretation as {@linkcode hypergeometricTest}, though they may differ by floating-point error.
+ *
+ * @param {Array} markers - Array of length equal to the number of groups.
+ * Each entry is an Array or TypedArray containing the marker identities for the corresponding group,
+ * as unique integer indices into the common namespace (see the argument of the same name in {@linkcode testFeatureSetEnrichment}).
+ * @param {Array} featureSets - Array containing the feature sets, see the argument of the same name in {@linkcode testFeatureSetEnrichment}.
+ * @param {number} totalFeatures - Total number of features in the common namespace. 
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads to use.
+ * If `null`, defaults to {@linkcode maximumThreads}.
+ *
+ * @return {object} Object containing:
+ *
+ * - `count`: Array of length equal to the number of groups.
+ *   Each entry is an Int32Array containing the number of that group's markers present in each set.
+ * - `size`: Int32Array containing the size of each set.
+ *   Duplicated indices in a set are only counted once, for both the size and the overlaps.
+ * - `pvalue`: Array of length equal to the number of groups.
+ *   Each entry is a Float64Array containing the p-value for enrichment of that group's markers in each set.
+ */
+export function testFeatureSetEnrichmentForGroups(markers, featureSets, totalFeatures, { numberOfThreads = null } = {}) {
+    let marker_data;
+    let set_data;
+    let size_data;
+    let count_data;
+    let pvalue_data;
+    let nthreads = utils.chooseNumberOfThreads(numberOfThreads);
+
+    let ngroups = markers.length;
+    let nsets = featureSets.length;
+    let output = { count: [], size: new Int32Array(nsets), pvalue: [] };
+
+    try {
+        marker_data = pack_index_arrays(markers, totalFeatures, "markers for group");
+        set_data = pack_index_arrays(featureSets, totalFeatures, "feature set");
+        size_data = utils.createInt32WasmArray(nsets);
+        count_data = utils.createInt32WasmArray(ngroups * nsets);
+        pvalue_data = utils.createFloat64WasmArray(ngroups * nsets);
+
+        wasm.call(module => module.hypergeometric_enrichment(
+            ngroups,
+            marker_data.pointers.offset,
+            marker_data.indices.offset,
+            nsets,
+            set_data.pointers.offset,
+            set_data.indices.offset,
+            totalFeatures,
+            size_data.offset,
+            count_data.offset,
+            pvalue_data.offset,
+            nthreads
+        ));
+
+        let carr = count_data.array();
+        let parr = pvalue_data.array();
+        for (var g = 0; g < ngroups; g++) {
+            output.count.push(carr.slice(g * nsets, (g + 1) * nsets));
+            output.pvalue.push(parr.slice(g * nsets, (g + 1) * nsets));
+        }
+
+        output.size.set(size_data.array());
+
+    } finally {
+        if (marker_data) {
+            utils.free(marker_data.pointers);
+            utils.free(marker_data.indices);
+        }
+        if (set_data) {
+            utils.free(set_data.pointers);
+            utils.free(set_data.indices);
+        }
+        utils.free(size_data);
+        utils.free(count_data);
+        utils.free(pvalue_data);
+    }
+
+    return output;
+}
+
 /**
  * Remap feature sets from a "reference" feature namespace to a "target" namespace.
  * This involves defining a common namespace consisting of feature names that are shared in both namespaces,
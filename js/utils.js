@@ -1,4 +1,4 @@
-import { buffer, wasmArraySpace, maximumThreads } from "./wasm.js";
+import { buffer, wasmArraySpace, maximumThreads, availableThreads, deterministicWorkers } from "./wasm.js";
 import * as wa from "wasmarrays.js";
 
 /**
@@ -78,10 +78,20 @@ export function wasmifyArray(x, expected) {
 
 export function chooseNumberOfThreads(threads) {
     if (threads == null) {
-        return maximumThreads();
-    } else {
-        return threads;
+        threads = maximumThreads();
     }
+
+    // Falling back to the main thread if the workers are still loading.
+    threads = availableThreads(threads);
+
+    // In deterministic mode, we always use the fixed number of logical workers,
+    // which are run on the threads specified in setDeterministicThreading().
+    let workers = deterministicWorkers();
+    if (workers !== null) {
+        return workers;
+    }
+
+    return threads;
 }
 
 /**
@@ -11,12 +11,18 @@ const cache = {};
  * @param {boolean} [options.localFile=false] - Whether or not to look for the Wasm and worker scripts locally.
  * This should only be `true` when using old versions of Node.js where file URLs are not supported, 
  * and is ignored completely outside of Node.js contexts.
+ * @param {boolean} [options.lazyThreads=false] - Whether to defer loading of the Wasm module into the workers until the first parallel computation.
+ * If `true`, this function returns as soon as the main module is ready, which reduces the time to the first result.
+ * Computations will run on a single thread until the workers are loaded in the background, see {@linkcode loadThreads} for details.
+ * This fallback is silent, i.e., any `numberOfThreads` option (or the default of {@linkcode maximumThreads}) is ignored for computations that start before the workers are loaded;
+ * applications that need all threads for a particular computation should `await` the Promise returned by {@linkcode loadThreads} beforehand.
+ * If `false`, this function waits for all workers to be loaded.
  *
  * @return {boolean}
  * The Wasm bindings are initialized and `true` is returned.
  * If the bindings were already initialized (e.g., by a previous call), nothing is done and `false` is returned.
  */
-export async function initialize({ numberOfThreads = 4, localFile = false } = {}) {
+export async function initialize({ numberOfThreads = 4, localFile = false, lazyThreads = false } = {}) {
     if ("module" in cache) {
         return false;
     }
@@ -31,13 +37,63 @@ export async function initialize({ numberOfThreads = 4, localFile = false } = {}
 
     cache.module = await loadScran(options);
     cache.space = register(cache.module);
+    cache.threadsLoading = null;
+    cache.threadsReady = false;
+    cache.deterministic = null;
+
+    if (!lazyThreads) {
+        await loadThreads();
+    }
 
     return true;
 }
 
+/**
+ * Load the Wasm module into all worker threads.
+ * This is only necessary if `lazyThreads = true` in {@linkcode initialize}, in which case loading is otherwise triggered by the first parallel computation.
+ * Until loading is complete, all computations are performed on the main thread,
+ * as threads cannot be started synchronously before their workers are ready.
+ *
+ * @return {Promise} Promise that resolves when all workers are loaded.
+ * Repeated calls return the same Promise.
+ */
+export function loadThreads() {
+    if (! ("module" in cache)) {
+        throw new Error("Wasm module needs to be initialized via 'initialize()'");
+    }
+
+    if (cache.threadsLoading === null) {
+        cache.threadsLoading = new Promise(resolve => {
+            // Older versions of Emscripten accept a callback, newer versions return a Promise.
+            let out = cache.module.PThread.loadWasmModuleToAllWorkers(resolve);
+            if (out && typeof out.then == "function") {
+                out.then(resolve);
+            }
+        }).then(() => { 
+            if ("module" in cache) {
+                cache.threadsReady = true;
+                applyThreadLimit();
+            }
+        });
+    }
+
+    return cache.threadsLoading;
+}
+
+// internal use only. This silently falls back to a single thread if the
+// workers are not yet loaded, as documented for 'lazyThreads' in initialize().
+export function availableThreads(requested) {
+    if (cache.threadsReady) {
+        return requested;
+    }
+    loadThreads();
+    return 1;
+}
+
 /**
  * Maximum number of threads available for computation.
  * This depends on the value specified during module initialization in {@linkcode initialize}. 
+ * If `lazyThreads = true` in {@linkcode initialize}, only one thread is used until the workers are loaded, see {@linkcode loadThreads}.
  *
  * @return {number} Maximum number of available threads.
  */
@@ -45,6 +101,56 @@ export function maximumThreads() {
     return cache.module.scran_custom_nthreads;
 }
 
+/**
+ * Enable or disable deterministic threading.
+ * In deterministic mode, each parallel computation is always split into the same number of logical workers,
+ * which are then executed on a fixed number of threads.
+ * This ensures that floating-point reductions (e.g., per-gene variances, size factors, PCA) yield bit-identical results regardless of the number of threads.
+ * While deterministic mode is enabled, the `numberOfThreads` option in each function is ignored.
+ *
+ * @param {?number} numberOfWorkers - Number of logical workers to use for all parallel computations.
+ * This should be at least as large as `numberOfThreads`, otherwise some threads will be idle.
+ * If `null`, deterministic mode is disabled and each computation is split into as many workers as there are threads.
+ * @param {object} [options={}] - Optional parameters.
+ * @param {?number} [options.numberOfThreads=null] - Number of threads used to execute the logical workers.
+ * This does not affect the results.
+ * If `null`, this defaults to {@linkcode maximumThreads}, and larger values are capped at {@linkcode maximumThreads}.
+ * If the workers are still being loaded (see {@linkcode loadThreads}), the logical workers are executed on the main thread until loading is complete.
+ */
+export function setDeterministicThreading(numberOfWorkers, { numberOfThreads = null } = {}) {
+    if (numberOfWorkers === null) {
+        cache.deterministic = null;
+    } else {
+        if (!Number.isInteger(numberOfWorkers) || numberOfWorkers < 1) {
+            throw new Error("'numberOfWorkers' should be a positive integer");
+        }
+        if (numberOfThreads === null) {
+            numberOfThreads = maximumThreads();
+        } else if (!Number.isInteger(numberOfThreads) || numberOfThreads < 1) {
+            throw new Error("'numberOfThreads' should be a positive integer");
+        }
+        cache.deterministic = numberOfWorkers;
+        cache.deterministicThreads = Math.min(numberOfThreads, maximumThreads());
+    }
+    applyThreadLimit();
+    return;
+}
+
+// The limit is only used in deterministic mode, where it is set by
+// setDeterministicThreading() and updated once the workers are loaded.
+function applyThreadLimit() {
+    let limit = 0;
+    if (cache.deterministic !== null) {
+        limit = (cache.threadsReady ? cache.deterministicThreads : 1);
+    }
+    call(module => module.set_parallel_thread_limit(limit));
+}
+
+// internal use only.
+export function deterministicWorkers() {
+    return cache.deterministic;
+}
+
 export function call(func) {
     if (! ("module" in cache)) {
         throw new Error("Wasm module needs to be initialized via 'initialize()'");
@@ -86,6 +192,10 @@ export function wasmArraySpace() {
 export function terminate() {
     cache.module.PThread.terminateAllThreads();
     delete cache.module;
+    delete cache.deterministic;
+    delete cache.deterministicThreads;
+    delete cache.threadsLoading;
+    delete cache.threadsReady;
     return;
 }
 
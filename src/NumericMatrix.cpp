@@ -1,11 +1,12 @@
 #include <emscripten/bind.h>
 #include "NumericMatrix.h"
 
-NumericMatrix::NumericMatrix() {}
+NumericMatrix::NumericMatrix() : fingerprint(new_seed_fingerprint()) {}
 
 NumericMatrix::NumericMatrix(const tatami::NumericMatrix* p) : NumericMatrix(std::shared_ptr<const tatami::NumericMatrix>(p)) {}
 
-NumericMatrix::NumericMatrix(std::shared_ptr<const tatami::NumericMatrix> p) : ptr(std::move(p)), by_row(ptr->dense_row()), by_column(ptr->dense_column()) {}
+NumericMatrix::NumericMatrix(std::shared_ptr<const tatami::NumericMatrix> p) : 
+    ptr(std::move(p)), by_row(ptr->dense_row()), by_column(ptr->dense_column()), fingerprint(new_seed_fingerprint()) {}
 
 template<class Vector_>
 tatami::NumericMatrix* create_NumericMatrix(int nr, int nc, Vector_ vec, bool colmajor) {
@@ -22,10 +23,11 @@ void NumericMatrix::reset_ptr(std::shared_ptr<const tatami::NumericMatrix> p) {
     by_column = ptr->dense_column();
 }
 
-NumericMatrix::NumericMatrix(int nr, int nc, uintptr_t values, bool colmajor, bool copy) {
+NumericMatrix::NumericMatrix(int nr, int nc, uintptr_t values, bool colmajor, bool copy) : fingerprint(new_seed_fingerprint()) {
     size_t product = static_cast<size_t>(nr) * static_cast<size_t>(nc);
     auto iptr = reinterpret_cast<const double*>(values);
     if (!copy) {
+        memoizable = false;
         reset_ptr(std::shared_ptr<const tatami::NumericMatrix>(create_NumericMatrix(nr, nc, tatami::ArrayView<double>(iptr, product), colmajor)));
     } else {
         reset_ptr(std::shared_ptr<const tatami::NumericMatrix>(create_NumericMatrix(nr, nc, std::vector<double>(iptr, iptr + product), colmajor)));
@@ -57,7 +59,10 @@ bool NumericMatrix::sparse() const {
 }
 
 NumericMatrix NumericMatrix::clone() const {
-    return NumericMatrix(ptr);
+    NumericMatrix output(ptr);
+    output.fingerprint = fingerprint;
+    output.memoizable = memoizable;
+    return output;
 }
 
 EMSCRIPTEN_BINDINGS(NumericMatrix) {
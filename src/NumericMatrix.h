@@ -2,6 +2,7 @@
 #define NUMERIC_MATRIX_H
 
 #include "parallel.h"
+#include "fingerprint.h"
 
 #include "tatami/tatami.hpp"
 
@@ -34,6 +35,16 @@ public:
     std::unique_ptr<tatami::FullDenseExtractor<double, int> > by_row, by_column;
 
     void reset_ptr(std::shared_ptr<const tatami::NumericMatrix>);
+
+    // Identifies the seed and the chain of delayed operations, see fingerprint.h.
+    // Functions that derive a matrix from an existing one should update this
+    // from the parent's fingerprint; otherwise, a fresh seed identity is used.
+    uint64_t fingerprint;
+
+    // Whether results computed from this matrix can be memoized. This is false
+    // for views of caller-owned buffers (and anything derived from them), as the
+    // contents may be modified without any change to the fingerprint.
+    bool memoizable = true;
 };
 
 #endif
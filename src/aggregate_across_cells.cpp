@@ -2,9 +2,12 @@
 
 #include <cstdint>
 #include <algorithm>
+#include <vector>
+#include <stdexcept>
 
 #include "NumericMatrix.h"
 #include "parallel.h"
+#include "utils.h"
 
 #include "scran/scran.hpp"
 
@@ -83,9 +86,456 @@ AggregateAcrossCells_Results aggregate_across_cells(const NumericMatrix& mat, ui
     return output;
 }
 
+/*****************************************/
+
+struct AggregateAcrossCellsSparse_Results {
+    int ngenes;
+    std::vector<int> groups;
+    std::vector<int> sizes;
+    std::vector<std::vector<int> > combinations;
+
+    std::vector<size_t> pointers;
+    std::vector<int> indices;
+    std::vector<double> sums;
+    std::vector<double> detected;
+
+    int num_genes() const {
+        return ngenes;
+    }
+
+    int num_groups() const {
+        return sizes.size();
+    }
+
+    int num_factors() const {
+        return combinations.size();
+    }
+
+    emscripten::val group_ids() const {
+        return emscripten::val(emscripten::typed_memory_view(groups.size(), groups.data()));
+    }
+
+    emscripten::val group_sizes() const {
+        return emscripten::val(emscripten::typed_memory_view(sizes.size(), sizes.data()));
+    }
+
+    emscripten::val combination(int f) const {
+        const auto& current = combinations[f];
+        return emscripten::val(emscripten::typed_memory_view(current.size(), current.data()));
+    }
+
+    int group_nonzero(int g) const {
+        return pointers[g + 1] - pointers[g];
+    }
+
+    emscripten::val group_indices(int g) const {
+        return emscripten::val(emscripten::typed_memory_view(group_nonzero(g), indices.data() + pointers[g]));
+    }
+
+    emscripten::val group_sums(int g) const {
+        return emscripten::val(emscripten::typed_memory_view(group_nonzero(g), sums.data() + pointers[g]));
+    }
+
+    emscripten::val group_detected(int g) const {
+        return emscripten::val(emscripten::typed_memory_view(group_nonzero(g), detected.data() + pointers[g]));
+    }
+
+    NumericMatrix as_matrix(bool use_detected) const {
+        const auto& values = (use_detected ? detected : sums);
+        return NumericMatrix(new tatami::CompressedSparseColumnMatrix<double, int>(ngenes, sizes.size(), values, indices, pointers));
+    }
+};
+
+/*
+ * Combining factors one at a time, where each combination is defined by the
+ * previous combination and the next factor. Unique combinations are sorted
+ * lexicographically by the levels of the factors, in the order of supply.
+ */
+void combine_factors(size_t NC, const std::vector<const int32_t*>& factors, AggregateAcrossCellsSparse_Results& output) {
+    size_t nfactors = factors.size();
+    output.groups.resize(NC);
+    output.combinations.resize(nfactors);
+
+    uint64_t ncombined = 1;
+    std::vector<uint64_t> codes(NC);
+    std::vector<uint64_t> unique_codes;
+
+    for (size_t f = 0; f < nfactors; ++f) {
+        auto fptr = factors[f];
+        uint64_t nlevels = 0;
+        for (size_t c = 0; c < NC; ++c) {
+            if (fptr[c] < 0) {
+                throw std::runtime_error("factor levels should be non-negative");
+            }
+            nlevels = std::max(nlevels, static_cast<uint64_t>(fptr[c]) + 1);
+        }
+
+        for (size_t c = 0; c < NC; ++c) {
+            codes[c] = static_cast<uint64_t>(f ? output.groups[c] : 0) * nlevels + fptr[c];
+        }
+
+        unique_codes = codes;
+        std::sort(unique_codes.begin(), unique_codes.end());
+        unique_codes.erase(std::unique(unique_codes.begin(), unique_codes.end()), unique_codes.end());
+
+        for (size_t c = 0; c < NC; ++c) {
+            output.groups[c] = std::lower_bound(unique_codes.begin(), unique_codes.end(), codes[c]) - unique_codes.begin();
+        }
+
+        ncombined = unique_codes.size();
+        for (size_t f2 = 0; f2 < f; ++f2) {
+            auto& previous = output.combinations[f2];
+            std::vector<int> replacement(ncombined);
+            for (size_t g = 0; g < ncombined; ++g) {
+                replacement[g] = previous[unique_codes[g] / nlevels];
+            }
+            previous.swap(replacement);
+        }
+
+        auto& latest = output.combinations[f];
+        latest.resize(ncombined);
+        for (size_t g = 0; g < ncombined; ++g) {
+            latest[g] = unique_codes[g] % nlevels;
+        }
+    }
+
+    output.sizes.resize(nfactors ? ncombined : 0);
+    if (nfactors) {
+        for (auto g : output.groups) {
+            ++output.sizes[g];
+        }
+    }
+}
+
+/*
+ * Column-based aggregation, for matrices that prefer column access. Fills
+ * 'group_indices', 'group_sums' and 'group_detected' with the sorted row
+ * indices and the corresponding (unaveraged) statistics for each group.
+ */
+void aggregate_sparse_by_column(
+    const tatami::NumericMatrix* mat,
+    const std::vector<int>& groups,
+    const std::vector<int>& sizes,
+    std::vector<std::vector<int> >& group_indices,
+    std::vector<std::vector<double> >& group_sums,
+    std::vector<std::vector<double> >& group_detected,
+    int nthreads)
+{
+    size_t NR = mat->nrow(), NC = mat->ncol();
+    size_t ngroups = sizes.size();
+
+    // Ordering cells by group and splitting the ordered cells into
+    // contiguous ranges for each thread. This means that each thread only
+    // needs a dense buffer for one group at a time, which is compressed into
+    // a sparse partial sum whenever the group changes. Parallelization is
+    // thus independent of the number of groups; only groups that straddle
+    // the boundaries between threads need to be merged afterwards.
+    std::vector<size_t> starts(ngroups + 1);
+    for (size_t g = 0; g < ngroups; ++g) {
+        starts[g + 1] = starts[g] + sizes[g];
+    }
+
+    std::vector<int> ordered(NC);
+    {
+        auto positions = starts;
+        for (size_t c = 0; c < NC; ++c) {
+            ordered[positions[groups[c]]++] = c;
+        }
+    }
+
+    struct Partial {
+        int group;
+        std::vector<int> indices;
+        std::vector<double> sums, detected;
+    };
+    std::vector<std::vector<Partial> > partials(nthreads);
+
+    run_parallel_new([&](int t, size_t start, size_t length) -> void {
+        auto ext = mat->sparse_column();
+        std::vector<double> vbuffer(NR);
+        std::vector<int> ibuffer(NR);
+
+        std::vector<double> sum_buffer(NR), det_buffer(NR);
+        std::vector<uint8_t> touched(NR);
+        std::vector<int> touched_list;
+        auto& current_partials = partials[t];
+
+        auto flush = [&](int g) -> void {
+            std::sort(touched_list.begin(), touched_list.end());
+            current_partials.emplace_back();
+            auto& part = current_partials.back();
+            part.group = g;
+            part.indices.reserve(touched_list.size());
+            part.sums.reserve(touched_list.size());
+            part.detected.reserve(touched_list.size());
+
+            for (auto r : touched_list) {
+                part.indices.push_back(r);
+                part.sums.push_back(sum_buffer[r]);
+                part.detected.push_back(det_buffer[r]);
+                sum_buffer[r] = 0;
+                det_buffer[r] = 0;
+                touched[r] = 0;
+            }
+            touched_list.clear();
+        };
+
+        int current_group = -1;
+        for (size_t i = start, end = start + length; i < end; ++i) {
+            auto c = ordered[i];
+            int g = groups[c];
+            if (g != current_group) {
+                if (current_group >= 0) {
+                    flush(current_group);
+                }
+                current_group = g;
+            }
+
+            auto range = ext->fetch(c, vbuffer.data(), ibuffer.data());
+            for (int k = 0; k < range.number; ++k) {
+                auto val = range.value[k];
+                if (val == 0) {
+                    continue;
+                }
+
+                auto r = range.index[k];
+                if (!touched[r]) {
+                    touched[r] = 1;
+                    touched_list.push_back(r);
+                }
+                sum_buffer[r] += val;
+                det_buffer[r] += (val > 0);
+            }
+        }
+
+        if (current_group >= 0) {
+            flush(current_group);
+        }
+    }, NC, nthreads);
+
+    // Collecting the partial sums for each group in thread order, so that
+    // the merged results do not depend on the scheduling of the threads.
+    std::vector<std::vector<Partial*> > group_parts(ngroups);
+    for (auto& current : partials) {
+        for (auto& part : current) {
+            group_parts[part.group].push_back(&part);
+        }
+    }
+
+    run_parallel_old(ngroups, [&](size_t first, size_t last) -> void {
+        std::vector<double> sum_buffer, det_buffer;
+        std::vector<uint8_t> touched;
+        std::vector<int> touched_list;
+
+        for (size_t g = first; g < last; ++g) {
+            const auto& parts = group_parts[g];
+            auto& gi = group_indices[g];
+            auto& gs = group_sums[g];
+            auto& gd = group_detected[g];
+
+            if (parts.size() == 1) {
+                gi.swap(parts[0]->indices);
+                gs.swap(parts[0]->sums);
+                gd.swap(parts[0]->detected);
+            } else if (parts.size() > 1) {
+                if (touched.empty()) {
+                    sum_buffer.resize(NR);
+                    det_buffer.resize(NR);
+                    touched.resize(NR);
+                }
+
+                for (auto part : parts) {
+                    for (size_t k = 0, nnz = part->indices.size(); k < nnz; ++k) {
+                        auto r = part->indices[k];
+                        if (!touched[r]) {
+                            touched[r] = 1;
+                            touched_list.push_back(r);
+                        }
+                        sum_buffer[r] += part->sums[k];
+                        det_buffer[r] += part->detected[k];
+                    }
+                    std::vector<int>().swap(part->indices);
+                    std::vector<double>().swap(part->sums);
+                    std::vector<double>().swap(part->detected);
+                }
+
+                std::sort(touched_list.begin(), touched_list.end());
+                gi.reserve(touched_list.size());
+                gs.reserve(touched_list.size());
+                gd.reserve(touched_list.size());
+                for (auto r : touched_list) {
+                    gi.push_back(r);
+                    gs.push_back(sum_buffer[r]);
+                    gd.push_back(det_buffer[r]);
+                    sum_buffer[r] = 0;
+                    det_buffer[r] = 0;
+                    touched[r] = 0;
+                }
+                touched_list.clear();
+            }
+        }
+    }, nthreads);
+}
+
+/*
+ * Row-based aggregation, for matrices that prefer row access (e.g., layered
+ * or CSR matrices). Each thread handles a contiguous range of rows and only
+ * needs a dense buffer of length equal to the number of groups. Each row's
+ * non-zero sums are appended to per-thread lists for each group, which are
+ * concatenated in thread order so that the row indices remain sorted.
+ */
+void aggregate_sparse_by_row(
+    const tatami::NumericMatrix* mat,
+    const std::vector<int>& groups,
+    const std::vector<int>& sizes,
+    std::vector<std::vector<int> >& group_indices,
+    std::vector<std::vector<double> >& group_sums,
+    std::vector<std::vector<double> >& group_detected,
+    int nthreads)
+{
+    size_t NR = mat->nrow(), NC = mat->ncol();
+    size_t ngroups = sizes.size();
+
+    struct Collected {
+        std::vector<std::vector<int> > indices;
+        std::vector<std::vector<double> > sums, detected;
+    };
+    std::vector<Collected> by_thread(nthreads);
+
+    run_parallel_new([&](int t, size_t start, size_t length) -> void {
+        auto ext = mat->sparse_row();
+        std::vector<double> vbuffer(NC);
+        std::vector<int> ibuffer(NC);
+
+        std::vector<double> sum_buffer(ngroups), det_buffer(ngroups);
+        std::vector<uint8_t> touched(ngroups);
+        std::vector<int> touched_list;
+
+        auto& current = by_thread[t];
+        current.indices.resize(ngroups);
+        current.sums.resize(ngroups);
+        current.detected.resize(ngroups);
+
+        for (size_t r = start, end = start + length; r < end; ++r) {
+            auto range = ext->fetch(r, vbuffer.data(), ibuffer.data());
+            for (int k = 0; k < range.number; ++k) {
+                auto val = range.value[k];
+                if (val == 0) {
+                    continue;
+                }
+
+                auto g = groups[range.index[k]];
+                if (!touched[g]) {
+                    touched[g] = 1;
+                    touched_list.push_back(g);
+                }
+                sum_buffer[g] += val;
+                det_buffer[g] += (val > 0);
+            }
+
+            for (auto g : touched_list) {
+                current.indices[g].push_back(r);
+                current.sums[g].push_back(sum_buffer[g]);
+                current.detected[g].push_back(det_buffer[g]);
+                sum_buffer[g] = 0;
+                det_buffer[g] = 0;
+                touched[g] = 0;
+            }
+            touched_list.clear();
+        }
+    }, NR, nthreads);
+
+    run_parallel_old(ngroups, [&](size_t first, size_t last) -> void {
+        for (size_t g = first; g < last; ++g) {
+            auto& gi = group_indices[g];
+            auto& gs = group_sums[g];
+            auto& gd = group_detected[g];
+
+            for (auto& current : by_thread) {
+                if (current.indices.empty()) {
+                    continue;
+                }
+                if (gi.empty()) {
+                    gi.swap(current.indices[g]);
+                    gs.swap(current.sums[g]);
+                    gd.swap(current.detected[g]);
+                } else {
+                    gi.insert(gi.end(), current.indices[g].begin(), current.indices[g].end());
+                    gs.insert(gs.end(), current.sums[g].begin(), current.sums[g].end());
+                    gd.insert(gd.end(), current.detected[g].begin(), current.detected[g].end());
+                    std::vector<int>().swap(current.indices[g]);
+                    std::vector<double>().swap(current.sums[g]);
+                    std::vector<double>().swap(current.detected[g]);
+                }
+            }
+        }
+    }, nthreads);
+}
+
+AggregateAcrossCellsSparse_Results aggregate_across_cells_sparse(const NumericMatrix& mat, int nfactors, uintptr_t factors, bool average, int nthreads) {
+    if (nfactors == 0) {
+        throw std::runtime_error("need at least one factor for aggregation");
+    }
+
+    size_t NR = mat.ptr->nrow();
+    size_t NC = mat.ptr->ncol();
+    auto fptrs = convert_array_of_offsets<const int32_t*>(nfactors, factors);
+
+    AggregateAcrossCellsSparse_Results output;
+    output.ngenes = NR;
+    combine_factors(NC, fptrs, output);
+    size_t ngroups = output.sizes.size();
+
+    std::vector<std::vector<int> > group_indices(ngroups);
+    std::vector<std::vector<double> > group_sums(ngroups), group_detected(ngroups);
+    if (mat.ptr->prefer_rows()) {
+        aggregate_sparse_by_row(mat.ptr.get(), output.groups, output.sizes, group_indices, group_sums, group_detected, nthreads);
+    } else {
+        aggregate_sparse_by_column(mat.ptr.get(), output.groups, output.sizes, group_indices, group_sums, group_detected, nthreads);
+    }
+
+    if (average) {
+        run_parallel_old(ngroups, [&](size_t first, size_t last) -> void {
+            for (size_t g = first; g < last; ++g) {
+                double n = output.sizes[g];
+                for (auto& x : group_sums[g]) {
+                    x /= n;
+                }
+                for (auto& x : group_detected[g]) {
+                    x /= n;
+                }
+            }
+        }, nthreads);
+    }
+
+    output.pointers.resize(ngroups + 1);
+    for (size_t g = 0; g < ngroups; ++g) {
+        output.pointers[g + 1] = output.pointers[g] + group_indices[g].size();
+    }
+
+    size_t total = output.pointers.back();
+    output.indices.reserve(total);
+    output.sums.reserve(total);
+    output.detected.reserve(total);
+    for (size_t g = 0; g < ngroups; ++g) {
+        output.indices.insert(output.indices.end(), group_indices[g].begin(), group_indices[g].end());
+        std::vector<int>().swap(group_indices[g]);
+        output.sums.insert(output.sums.end(), group_sums[g].begin(), group_sums[g].end());
+        std::vector<double>().swap(group_sums[g]);
+        output.detected.insert(output.detected.end(), group_detected[g].begin(), group_detected[g].end());
+        std::vector<double>().swap(group_detected[g]);
+    }
+
+    return output;
+}
+
+/*****************************************/
+
 EMSCRIPTEN_BINDINGS(aggregate_across_cells) {
     emscripten::function("aggregate_across_cells", &aggregate_across_cells);
 
+    emscripten::function("aggregate_across_cells_sparse", &aggregate_across_cells_sparse);
+
     emscripten::class_<AggregateAcrossCells_Results>("AggregateAcrossCells_Results")
         .function("group_sums", &AggregateAcrossCells_Results::group_sums)
         .function("all_sums", &AggregateAcrossCells_Results::all_sums)
@@ -94,5 +544,19 @@ EMSCRIPTEN_BINDINGS(aggregate_across_cells) {
         .function("num_genes", &AggregateAcrossCells_Results::num_genes)
         .function("num_groups", &AggregateAcrossCells_Results::num_groups)
         ;
+
+    emscripten::class_<AggregateAcrossCellsSparse_Results>("AggregateAcrossCellsSparse_Results")
+        .function("num_genes", &AggregateAcrossCellsSparse_Results::num_genes)
+        .function("num_groups", &AggregateAcrossCellsSparse_Results::num_groups)
+        .function("num_factors", &AggregateAcrossCellsSparse_Results::num_factors)
+        .function("group_ids", &AggregateAcrossCellsSparse_Results::group_ids)
+        .function("group_sizes", &AggregateAcrossCellsSparse_Results::group_sizes)
+        .function("combination", &AggregateAcrossCellsSparse_Results::combination)
+        .function("group_nonzero", &AggregateAcrossCellsSparse_Results::group_nonzero)
+        .function("group_indices", &AggregateAcrossCellsSparse_Results::group_indices)
+        .function("group_sums", &AggregateAcrossCellsSparse_Results::group_sums)
+        .function("group_detected", &AggregateAcrossCellsSparse_Results::group_detected)
+        .function("as_matrix", &AggregateAcrossCellsSparse_Results::as_matrix)
+        ;
 }
 
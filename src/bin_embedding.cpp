@@ -0,0 +1,195 @@
+#include <emscripten/bind.h>
+
+#include "parallel.h"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+/*
+ * Binning of a 2-dimensional embedding into a regular grid, e.g., to render
+ * density maps for millions of cells. Coordinates are interleaved as in the
+ * t-SNE/UMAP outputs, i.e., (x, y) for each cell. Bins are stored in
+ * row-major order, i.e., bin (i, j) for the i-th x-interval and j-th
+ * y-interval is at position 'j * nx + i'. Points outside of the range are
+ * ignored, except for those lying exactly on the upper boundary, which are
+ * assigned to the last bin.
+ *
+ * Cells are assigned to bins in parallel and then grouped by bin with a
+ * counting sort, after which each worker computes the statistics for its
+ * own range of bins. This avoids per-worker copies of the grid, which would
+ * be prohibitively large for fine grids with many groups (e.g., 1024 x 1024
+ * bins with 50 groups is 200 MB per worker). Values are summed in cell order
+ * within each bin, so results are identical for any number of threads.
+ */
+
+namespace {
+
+int find_bin(double val, double lower, double upper, double width, int n) {
+    if (!(val >= lower)) { // also catches NaNs.
+        return -1;
+    }
+    double pos = (val - lower) / width;
+    if (pos < n) {
+        return pos;
+    }
+    return (val == upper ? n - 1 : -1);
+}
+
+}
+
+void bin_embedding(
+    uintptr_t coordinates,
+    int ncells,
+    int nx,
+    int ny,
+    bool use_range,
+    uintptr_t range,
+    bool use_values,
+    uintptr_t values,
+    bool use_groups,
+    uintptr_t groups,
+    int ngroups,
+    uintptr_t counts,
+    uintptr_t means,
+    uintptr_t majority,
+    int nthreads)
+{
+    if (nx <= 0 || ny <= 0) {
+        throw std::runtime_error("number of bins should be positive in each dimension");
+    }
+
+    auto cptr = reinterpret_cast<const double*>(coordinates);
+    double xmin, xmax, ymin, ymax;
+    if (use_range) {
+        auto rptr = reinterpret_cast<const double*>(range);
+        xmin = rptr[0];
+        xmax = rptr[1];
+        ymin = rptr[2];
+        ymax = rptr[3];
+    } else {
+        xmin = ymin = std::numeric_limits<double>::infinity();
+        xmax = ymax = -std::numeric_limits<double>::infinity();
+        for (int c = 0; c < ncells; ++c) {
+            xmin = std::min(xmin, cptr[2 * c]);
+            xmax = std::max(xmax, cptr[2 * c]);
+            ymin = std::min(ymin, cptr[2 * c + 1]);
+            ymax = std::max(ymax, cptr[2 * c + 1]);
+        }
+
+        // Expanding zero-width ranges so that all points are binned.
+        if (ncells == 0) {
+            xmin = ymin = 0;
+        }
+        if (!(xmax > xmin)) {
+            xmax = xmin + 1;
+        }
+        if (!(ymax > ymin)) {
+            ymax = ymin + 1;
+        }
+
+        // Reporting the range that was actually used.
+        auto rptr = reinterpret_cast<double*>(range);
+        rptr[0] = xmin;
+        rptr[1] = xmax;
+        rptr[2] = ymin;
+        rptr[3] = ymax;
+    }
+
+    if (!(xmax > xmin) || !(ymax > ymin)) {
+        throw std::runtime_error("upper limit of the range should be greater than the lower limit in each dimension");
+    }
+
+    double xwidth = (xmax - xmin) / nx;
+    double ywidth = (ymax - ymin) / ny;
+    size_t nbins = static_cast<size_t>(nx) * ny;
+
+    auto vptr = reinterpret_cast<const double*>(values);
+    auto gptr = reinterpret_cast<const int32_t*>(groups);
+    if (use_groups) {
+        for (int c = 0; c < ncells; ++c) {
+            if (gptr[c] < 0 || gptr[c] >= ngroups) {
+                throw std::runtime_error("group assignments should be non-negative and less than the number of groups");
+            }
+        }
+    }
+
+    std::vector<int32_t> assigned(ncells);
+    run_parallel_new([&](int, int start, int length) -> void {
+        for (int c = start, end = start + length; c < end; ++c) {
+            int bx = find_bin(cptr[2 * c], xmin, xmax, xwidth, nx);
+            int by = find_bin(cptr[2 * c + 1], ymin, ymax, ywidth, ny);
+            assigned[c] = (bx < 0 || by < 0 ? -1 : by * nx + bx);
+        }
+    }, ncells, nthreads);
+
+    auto countptr = reinterpret_cast<int32_t*>(counts);
+    auto meanptr = reinterpret_cast<double*>(means);
+    auto majptr = reinterpret_cast<int32_t*>(majority);
+
+    std::fill(countptr, countptr + nbins, 0);
+    for (int c = 0; c < ncells; ++c) {
+        if (assigned[c] >= 0) {
+            ++countptr[assigned[c]];
+        }
+    }
+
+    // Only need to sort the cells if we have per-cell values or groups.
+    if (!use_values && !use_groups) {
+        return;
+    }
+
+    std::vector<size_t> offsets(nbins + 1);
+    for (size_t b = 0; b < nbins; ++b) {
+        offsets[b + 1] = offsets[b] + countptr[b];
+    }
+
+    std::vector<int32_t> ordered(offsets[nbins]);
+    {
+        std::vector<size_t> next(offsets.begin(), offsets.begin() + nbins);
+        for (int c = 0; c < ncells; ++c) {
+            if (assigned[c] >= 0) {
+                ordered[next[assigned[c]]++] = c;
+            }
+        }
+    }
+
+    run_parallel_old(nbins, [&](size_t first, size_t last) -> void {
+        std::vector<int32_t> group_counts(use_groups ? ngroups : 0);
+        for (size_t b = first; b < last; ++b) {
+            auto start = ordered.begin() + offsets[b], end = ordered.begin() + offsets[b + 1];
+            int32_t total = countptr[b];
+
+            if (use_values) {
+                double sum = 0;
+                for (auto it = start; it != end; ++it) {
+                    sum += vptr[*it];
+                }
+                meanptr[b] = (total ? sum / total : std::numeric_limits<double>::quiet_NaN());
+            }
+
+            if (use_groups) {
+                if (total == 0) {
+                    majptr[b] = -1;
+                } else {
+                    std::fill(group_counts.begin(), group_counts.end(), 0);
+                    for (auto it = start; it != end; ++it) {
+                        ++group_counts[gptr[*it]];
+                    }
+
+                    // Ties are broken in favor of the earliest group.
+                    majptr[b] = std::max_element(group_counts.begin(), group_counts.end()) - group_counts.begin();
+                }
+            }
+        }
+    }, nthreads);
+
+    return;
+}
+
+EMSCRIPTEN_BINDINGS(bin_embedding) {
+    emscripten::function("bin_embedding", &bin_embedding);
+}
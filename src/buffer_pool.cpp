@@ -0,0 +1,38 @@
+#include <emscripten/bind.h>
+
+#include "buffer_pool.h"
+
+BufferPool& buffer_pool() {
+    static BufferPool pool;
+    return pool;
+}
+
+void set_buffer_pool_limit(double bytes) {
+    buffer_pool().set_limit(bytes > 0 ? static_cast<size_t>(bytes) : 0);
+}
+
+void clear_buffer_pool() {
+    buffer_pool().clear();
+}
+
+// Stored in 'output' as (limit, idle bytes, reused, allocated).
+void buffer_pool_statistics(uintptr_t output, bool reset) {
+    auto& pool = buffer_pool();
+    auto optr = reinterpret_cast<double*>(output);
+    optr[0] = pool.get_limit();
+    optr[1] = pool.idle_bytes();
+    optr[2] = pool.reused;
+    optr[3] = pool.allocated;
+    if (reset) {
+        pool.reused = 0;
+        pool.allocated = 0;
+    }
+}
+
+EMSCRIPTEN_BINDINGS(buffer_pool) {
+    emscripten::function("set_buffer_pool_limit", &set_buffer_pool_limit);
+
+    emscripten::function("clear_buffer_pool", &clear_buffer_pool);
+
+    emscripten::function("buffer_pool_statistics", &buffer_pool_statistics);
+}
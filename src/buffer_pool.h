@@ -0,0 +1,122 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+/*
+ * Pool of result buffers, keyed by their size in bytes. Interactive sessions
+ * tend to repeat the same computation on the same number of cells, e.g., QC
+ * metrics or k-means with different parameters, so a buffer released by one
+ * result object can usually be recycled by the next without going back to
+ * the allocator. The total size of idle buffers is capped by a limit; any
+ * buffer that would exceed the limit is simply freed. The limit is zero by
+ * default, i.e., pooling is opt-in, as idle buffers are retained on the Wasm
+ * heap (which never shrinks) even if no further results are computed.
+ *
+ * Buffers are plain byte vectors, whose storage is suitably aligned for any
+ * arithmetic type by the default allocator. The pool is only accessed from
+ * the main thread, so no locking is required.
+ */
+
+class BufferPool {
+private:
+    std::unordered_map<size_t, std::vector<std::vector<unsigned char> > > idle;
+    size_t limit = 0;
+    size_t held = 0;
+
+public:
+    size_t reused = 0;
+    size_t allocated = 0;
+
+public:
+    std::vector<unsigned char> acquire(size_t nbytes) {
+        auto it = idle.find(nbytes);
+        if (it != idle.end() && !it->second.empty()) {
+            auto output = std::move(it->second.back());
+            it->second.pop_back();
+            held -= nbytes;
+            ++reused;
+            return output;
+        }
+
+        ++allocated;
+        return std::vector<unsigned char>(nbytes);
+    }
+
+    void release(std::vector<unsigned char> buffer) {
+        size_t nbytes = buffer.size();
+        if (nbytes == 0 || held + nbytes > limit) {
+            return;
+        }
+        idle[nbytes].push_back(std::move(buffer));
+        held += nbytes;
+    }
+
+    void set_limit(size_t l) {
+        limit = l;
+        if (held > limit) {
+            clear();
+        }
+    }
+
+    size_t get_limit() const {
+        return limit;
+    }
+
+    size_t idle_bytes() const {
+        return held;
+    }
+
+    void clear() {
+        idle.clear();
+        held = 0;
+    }
+};
+
+BufferPool& buffer_pool();
+
+/*
+ * Move-only handle to a pooled buffer, which is returned to the pool upon
+ * destruction. Result classes should hold these instead of std::vectors so
+ * that their storage is recycled when the JS wrapper is freed.
+ */
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+
+    PooledBuffer(size_t nbytes) : contents(buffer_pool().acquire(nbytes)) {}
+
+    PooledBuffer(PooledBuffer&& other) : contents(std::move(other.contents)) {
+        other.contents.clear();
+    }
+
+    PooledBuffer& operator=(PooledBuffer&& other) {
+        if (this != &other) {
+            buffer_pool().release(std::move(contents));
+            contents = std::move(other.contents);
+            other.contents.clear();
+        }
+        return *this;
+    }
+
+    PooledBuffer(const PooledBuffer&) = delete;
+
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    ~PooledBuffer() {
+        buffer_pool().release(std::move(contents));
+    }
+
+private:
+    std::vector<unsigned char> contents;
+
+public:
+    template<typename T>
+    T* data() {
+        return reinterpret_cast<T*>(contents.data());
+    }
+};
+
+#endif
@@ -5,13 +5,25 @@
 #include <stdexcept>
 #include <unordered_set>
 #include <unordered_map>
+#include <algorithm>
 
 #include "parallel.h"
 #include "NumericMatrix.h"
 #include "utils.h"
+#include "layered_utils.h"
 
 #include "tatami/tatami.hpp"
 
+// Bound matrices hold references to their inputs, so they are only memoizable
+// if all inputs are.
+static NumericMatrix create_bound(std::shared_ptr<const tatami::NumericMatrix> bound, const std::vector<const NumericMatrix*>& inputs) {
+    NumericMatrix output(std::move(bound));
+    for (auto x : inputs) {
+        output.memoizable = output.memoizable && x->memoizable;
+    }
+    return output;
+}
+
 NumericMatrix cbind(int n, uintptr_t mats) {
     if (n == 0) {
         throw std::runtime_error("need at least one matrix to cbind");
@@ -33,7 +45,7 @@ NumericMatrix cbind(int n, uintptr_t mats) {
         collected.push_back(current.ptr);
     }
 
-    return NumericMatrix(tatami::make_DelayedBind<1>(std::move(collected)));
+    return create_bound(tatami::make_DelayedBind<1>(std::move(collected)), mat_ptrs);
 }
 
 NumericMatrix rbind(int n, uintptr_t mats) {
@@ -57,31 +69,106 @@ NumericMatrix rbind(int n, uintptr_t mats) {
         collected.push_back(current.ptr);
     }
 
-    return NumericMatrix(tatami::make_DelayedBind<0>(std::move(collected)));
+    return create_bound(tatami::make_DelayedBind<0>(std::move(collected)), mat_ptrs);
 }
 
-NumericMatrix cbind_with_rownames(int n, uintptr_t mats, uintptr_t names, uintptr_t indices) {
+NumericMatrix cbind_with_rownames(int n, uintptr_t mats, uintptr_t names, uintptr_t indices, bool realize, int nthreads) {
     if (n == 0) {
         throw std::runtime_error("need at least one matrix to cbind");
     }
 
     auto mat_ptrs = convert_array_of_offsets<const NumericMatrix*>(n, mats);
-    const auto& first = *(mat_ptrs[0]);
-    std::vector<std::remove_reference<decltype(first.ptr)>::type> inputs;
-    inputs.reserve(n);
+    auto name_ptrs = convert_array_of_offsets<const int32_t*>(n, names);
+    std::vector<int> nrows(n);
     for (int i = 0; i < n; ++i) {
-        inputs.push_back(mat_ptrs[i]->ptr);
+        nrows[i] = mat_ptrs[i]->ptr->nrow();
     }
 
-    auto name_ptrs = convert_array_of_offsets<const int32_t*>(n, names);
-    auto out = tatami::bind_intersection<1>(inputs, name_ptrs);
+    // Names are integer identifiers in [0, universe), so we can use them to
+    // directly address a lookup table for each matrix. Each table is built in
+    // parallel; for the first matrix, we record the first occurrence of each
+    // name, while for all other matrices, we use the last occurrence.
+    int32_t universe = 0;
+    for (int i = 0; i < n; ++i) {
+        auto nptr = name_ptrs[i];
+        for (int r = 0; r < nrows[i]; ++r) {
+            if (nptr[r] < 0) {
+                throw std::runtime_error("name identifiers should be non-negative");
+            }
+            universe = std::max(universe, nptr[r] + 1);
+        }
+    }
+
+    std::vector<std::vector<int> > lookup(n);
+    run_parallel_old(n, [&](int first, int last) -> void {
+        for (int i = first; i < last; ++i) {
+            auto& current = lookup[i];
+            current.resize(universe, -1);
+            auto nptr = name_ptrs[i];
+            if (i == 0) {
+                for (int r = nrows[i]; r > 0; --r) {
+                    current[nptr[r - 1]] = r - 1;
+                }
+            } else {
+                for (int r = 0; r < nrows[i]; ++r) {
+                    current[nptr[r]] = r;
+                }
+            }
+        }
+    }, nthreads);
+
+    // Probing each row of the first matrix against all other tables, keeping
+    // rows in their original order within and across threads.
+    std::vector<std::vector<int> > thread_kept(nthreads);
+    run_parallel_new([&](int t, int start, int length) -> void {
+        auto nptr = name_ptrs[0];
+        auto& kept = thread_kept[t];
+        for (int r = start, end = start + length; r < end; ++r) {
+            auto id = nptr[r];
+            if (lookup[0][id] != r) {
+                continue;
+            }
+
+            bool found = true;
+            for (int i = 1; i < n; ++i) {
+                if (lookup[i][id] < 0) {
+                    found = false;
+                    break;
+                }
+            }
+            if (found) {
+                kept.push_back(r);
+            }
+        }
+    }, nrows[0], nthreads);
+
+    std::vector<int> common;
+    for (const auto& kept : thread_kept) {
+        common.insert(common.end(), kept.begin(), kept.end());
+    }
 
     // Save the direct row indices for the first matrix.
-    const auto& idx = out.second;
     auto idptr = reinterpret_cast<int*>(indices);
-    std::copy(idx.begin(), idx.end(), idptr);
+    std::copy(common.begin(), common.end(), idptr);
 
-    return NumericMatrix(std::move(out.first));
+    std::vector<std::shared_ptr<const tatami::Matrix<double, int> > > collected;
+    collected.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        std::vector<int> rows;
+        rows.reserve(common.size());
+        auto nptr = name_ptrs[0];
+        for (auto r : common) {
+            rows.push_back(lookup[i][nptr[r]]);
+        }
+        collected.push_back(tatami::make_DelayedSubset<0>(mat_ptrs[i]->ptr, std::move(rows)));
+    }
+
+    auto bound = tatami::make_DelayedBind<1>(std::move(collected));
+    if (realize) {
+        return NumericMatrix(convert_to_layered_sparse_parallel(bound.get(), true, nthreads));
+    } else {
+        return create_bound(std::move(bound), mat_ptrs);
+    }
 }
 
 EMSCRIPTEN_BINDINGS(cbind) {
@@ -0,0 +1,556 @@
+#include <emscripten/bind.h>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "NumericMatrix.h"
+#include "NeighborIndex.h"
+#include "serialize_utils.h"
+#include "layered_utils.h"
+#include "parallel.h"
+
+#include "tatami/tatami.hpp"
+#include "zlib.h"
+
+/*
+ * Checkpoints combine multiple serialized objects into a single container.
+ * Each object is stored as a separately compressed section, and the index of
+ * all sections is stored at the start of the container. This means that a
+ * checkpoint can be opened by reading only the index, after which individual
+ * sections can be decompressed and restored on demand. For checkpoints on
+ * the (virtual) filesystem, each section is read from the file as required,
+ * so that the entire file is never held in memory at once.
+ *
+ * Each section is created by the save_* function for the corresponding
+ * object, e.g., save_built_singlepp_reference(); the checkpoint itself does
+ * not need to know anything about the contents of each section.
+ */
+
+static constexpr uint32_t checkpoint_serialization_version = 1;
+
+static const std::string checkpoint_tag = "ScranCheckpoint";
+
+// Length of the fixed prefix, i.e., the tag, version and index size.
+static constexpr size_t checkpoint_prefix_size = sizeof(uint64_t) + 15 + sizeof(uint32_t) + sizeof(uint64_t);
+
+struct CheckpointSection {
+    std::string name;
+    std::string kind;
+    uint64_t offset = 0;
+    uint64_t compressed_size = 0;
+    uint64_t raw_size = 0;
+    int32_t level = -1;
+};
+
+class CheckpointWriter {
+public:
+    CheckpointWriter() {}
+
+private:
+    std::vector<CheckpointSection> sections;
+    std::vector<std::vector<unsigned char> > payloads;
+
+public:
+    // Contents of 'buffer' are moved into the writer to avoid a copy.
+    void add(std::string name, std::string kind, SerializedBuffer& buffer) {
+        for (const auto& s : sections) {
+            if (s.name == name) {
+                throw std::runtime_error("duplicate section name '" + name + "' in checkpoint");
+            }
+        }
+
+        CheckpointSection current;
+        current.name = std::move(name);
+        current.kind = std::move(kind);
+        current.raw_size = buffer.contents.size();
+        sections.push_back(std::move(current));
+
+        payloads.emplace_back();
+        payloads.back().swap(buffer.contents);
+    }
+
+    size_t num_sections() const {
+        return sections.size();
+    }
+
+private:
+    // Compressing each section in parallel, replacing the raw payloads.
+    void compress(int level, int nthreads) {
+        size_t nsections = sections.size();
+        std::vector<uint8_t> failed(nsections);
+
+        run_parallel_old(nsections, [&](size_t first, size_t last) -> void {
+            for (size_t s = first; s < last; ++s) {
+                sections[s].level = level;
+                if (level < 0) {
+                    sections[s].compressed_size = payloads[s].size();
+                    continue;
+                }
+
+                auto& raw = payloads[s];
+                uLongf destlen = compressBound(raw.size());
+                std::vector<unsigned char> compressed(destlen);
+                if (compress2(compressed.data(), &destlen, raw.data(), raw.size(), level) != Z_OK) {
+                    failed[s] = 1;
+                    continue;
+                }
+                compressed.resize(destlen);
+                compressed.shrink_to_fit();
+                raw.swap(compressed);
+                sections[s].compressed_size = destlen;
+            }
+        }, nthreads);
+
+        if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+            throw std::runtime_error("failed to compress a section of the checkpoint");
+        }
+    }
+
+    // Creating the prefix and index, which precede the compressed sections.
+    // 'total' is filled with the total size of the compressed sections.
+    SerializedBuffer create_header(uint64_t& total) {
+        SerializedBuffer index;
+        index.write<uint64_t>(sections.size());
+        uint64_t offset = 0;
+        for (auto& s : sections) {
+            s.offset = offset;
+            offset += s.compressed_size;
+            index.write_string(s.name);
+            index.write_string(s.kind);
+            index.write(s.offset);
+            index.write(s.compressed_size);
+            index.write(s.raw_size);
+            index.write(s.level);
+        }
+
+        SerializedBuffer output(checkpoint_tag, checkpoint_serialization_version);
+        output.write<uint64_t>(index.size());
+        auto& contents = output.contents;
+        contents.insert(contents.end(), index.contents.begin(), index.contents.end());
+        total = offset;
+        return output;
+    }
+
+public:
+    SerializedBuffer finish(int level, int nthreads) {
+        compress(level, nthreads);
+        uint64_t total = 0;
+        auto output = create_header(total);
+
+        auto& contents = output.contents;
+        contents.reserve(contents.size() + total);
+        for (auto& p : payloads) {
+            contents.insert(contents.end(), p.begin(), p.end());
+            std::vector<unsigned char>().swap(p);
+        }
+
+        sections.clear();
+        payloads.clear();
+        return output;
+    }
+
+    // Writing the header and then each compressed section in turn, releasing
+    // each section after it is written. This avoids assembling the entire
+    // checkpoint in memory before it is written to file.
+    void finish_to_file(std::string path, int level, int nthreads) {
+        compress(level, nthreads);
+        uint64_t total = 0;
+        auto header = create_header(total);
+
+        auto handle = std::fopen(path.c_str(), "wb");
+        if (!handle) {
+            throw std::runtime_error("failed to open '" + path + "' for writing the checkpoint");
+        }
+
+        bool okay = (std::fwrite(header.contents.data(), 1, header.size(), handle) == header.size());
+        for (auto& p : payloads) {
+            if (okay) {
+                okay = (std::fwrite(p.data(), 1, p.size(), handle) == p.size());
+            }
+            std::vector<unsigned char>().swap(p);
+        }
+        okay = (std::fclose(handle) == 0) && okay;
+
+        sections.clear();
+        payloads.clear();
+        if (!okay) {
+            throw std::runtime_error("failed to write the checkpoint to '" + path + "'");
+        }
+    }
+};
+
+class CheckpointReader {
+public:
+    CheckpointReader(uintptr_t buffer, size_t len) : memory(reinterpret_cast<const unsigned char*>(buffer)), memory_size(len) {
+        if (len < checkpoint_prefix_size) {
+            throw std::runtime_error("checkpoint buffer is truncated");
+        }
+        auto index_size = parse_prefix(memory);
+        if (len < checkpoint_prefix_size + index_size) {
+            throw std::runtime_error("checkpoint buffer is truncated");
+        }
+        parse_index(memory + checkpoint_prefix_size, index_size);
+    }
+
+    CheckpointReader(std::string p) : path(std::move(p)) {
+        std::vector<unsigned char> prefix(checkpoint_prefix_size);
+        read_from_file(0, prefix.size(), prefix.data());
+        auto index_size = parse_prefix(prefix.data());
+        std::vector<unsigned char> index(index_size);
+        read_from_file(checkpoint_prefix_size, index_size, index.data());
+        parse_index(index.data(), index_size);
+    }
+
+private:
+    const unsigned char* memory = NULL;
+    size_t memory_size = 0;
+    std::string path;
+
+    uint64_t data_start = 0;
+    std::vector<CheckpointSection> sections;
+    std::unordered_map<std::string, size_t> by_name;
+
+    uint64_t parse_prefix(const unsigned char* ptr) {
+        SerializedReader reader(ptr, checkpoint_prefix_size);
+        reader.check_header(checkpoint_tag, checkpoint_serialization_version);
+        return reader.read_scalar<uint64_t>();
+    }
+
+    void parse_index(const unsigned char* ptr, size_t len) {
+        SerializedReader reader(ptr, len);
+        auto nsections = reader.read_scalar<uint64_t>();
+        sections.resize(nsections);
+        for (size_t s = 0; s < nsections; ++s) {
+            auto& current = sections[s];
+            current.name = reader.read_string();
+            current.kind = reader.read_string();
+            reader.read(current.offset);
+            reader.read(current.compressed_size);
+            reader.read(current.raw_size);
+            reader.read(current.level);
+            by_name[current.name] = s;
+        }
+        data_start = checkpoint_prefix_size + len;
+    }
+
+    void read_from_file(uint64_t offset, size_t n, unsigned char* output) const {
+        auto handle = std::fopen(path.c_str(), "rb");
+        if (!handle) {
+            throw std::runtime_error("failed to open checkpoint file '" + path + "'");
+        }
+        bool okay = (std::fseek(handle, offset, SEEK_SET) == 0 && std::fread(output, 1, n, handle) == n);
+        std::fclose(handle);
+        if (!okay) {
+            throw std::runtime_error("checkpoint file '" + path + "' is truncated");
+        }
+    }
+
+    const CheckpointSection& find(const std::string& name) const {
+        auto it = by_name.find(name);
+        if (it == by_name.end()) {
+            throw std::runtime_error("no section named '" + name + "' in the checkpoint");
+        }
+        return sections[it->second];
+    }
+
+public:
+    size_t num_sections() const {
+        return sections.size();
+    }
+
+    std::string name(int i) const {
+        return sections[i].name;
+    }
+
+    std::string kind(int i) const {
+        return sections[i].kind;
+    }
+
+    double raw_size(int i) const {
+        return sections[i].raw_size;
+    }
+
+    bool has(std::string name) const {
+        return by_name.find(name) != by_name.end();
+    }
+
+    SerializedBuffer extract(std::string name) const {
+        const auto& current = find(name);
+        uint64_t start = data_start + current.offset;
+
+        std::vector<unsigned char> compressed;
+        const unsigned char* source;
+        if (memory) {
+            if (start + current.compressed_size > memory_size) {
+                throw std::runtime_error("checkpoint buffer is truncated");
+            }
+            source = memory + start;
+        } else {
+            compressed.resize(current.compressed_size);
+            read_from_file(start, compressed.size(), compressed.data());
+            source = compressed.data();
+        }
+
+        SerializedBuffer output;
+        if (current.level < 0) {
+            output.contents.insert(output.contents.end(), source, source + current.compressed_size);
+        } else {
+            output.contents.resize(current.raw_size);
+            uLongf destlen = current.raw_size;
+            if (uncompress(output.contents.data(), &destlen, source, current.compressed_size) != Z_OK || destlen != current.raw_size) {
+                throw std::runtime_error("failed to decompress section '" + name + "' of the checkpoint");
+            }
+        }
+        return output;
+    }
+};
+
+/*****************************************/
+
+/*
+ * Sparse matrices are saved in compressed sparse column format, using the
+ * smallest value type that can hold all non-zero values. Dense matrices are
+ * saved in column-major format.
+ */
+static constexpr uint32_t matrix_serialization_version = 1;
+
+SerializedBuffer save_numeric_matrix(const NumericMatrix& mat, int nthreads) {
+    SerializedBuffer output("NumericMatrix", matrix_serialization_version);
+    const auto* ptr = mat.ptr.get();
+    int NR = ptr->nrow(), NC = ptr->ncol();
+    bool sparse = ptr->sparse();
+    output.write<uint64_t>(NR);
+    output.write<uint64_t>(NC);
+    output.write<uint8_t>(sparse);
+
+    if (!sparse) {
+        std::vector<double> values(static_cast<size_t>(NR) * static_cast<size_t>(NC));
+        run_parallel_new([&](int, int start, int length) -> void {
+            auto ext = ptr->dense_column();
+            for (int c = start, end = start + length; c < end; ++c) {
+                ext->fetch_copy(c, values.data() + static_cast<size_t>(c) * static_cast<size_t>(NR));
+            }
+        }, NC, nthreads);
+        output.write(values);
+        return output;
+    }
+
+    auto loop = [&](auto fun) -> void {
+        run_parallel_new([&](int t, int start, int length) -> void {
+            auto ext = ptr->sparse_column();
+            std::vector<double> vbuffer(NR);
+            std::vector<int> ibuffer(NR);
+            for (int c = start, end = start + length; c < end; ++c) {
+                auto range = ext->fetch(c, vbuffer.data(), ibuffer.data());
+                fun(t, c, range);
+            }
+        }, NC, nthreads);
+    };
+
+    std::vector<uint64_t> pointers(NC + 1);
+    std::vector<double> thread_max(nthreads);
+    std::vector<uint8_t> thread_invalid(nthreads);
+    loop([&](int t, int c, const auto& range) -> void {
+        auto& count = pointers[c + 1];
+        auto& curmax = thread_max[t];
+        for (int k = 0; k < range.number; ++k) {
+            auto val = range.value[k];
+            if (val == 0) {
+                continue;
+            }
+            ++count;
+            if (val > curmax) {
+                curmax = val;
+            }
+            if (val < 0 || val != std::floor(val)) {
+                thread_invalid[t] = 1;
+            }
+        }
+    });
+    for (int c = 0; c < NC; ++c) {
+        pointers[c + 1] += pointers[c];
+    }
+
+    SparseLayer level = SparseLayer::F64;
+    if (std::find(thread_invalid.begin(), thread_invalid.end(), 1) == thread_invalid.end()) {
+        double maxed = (NC ? *std::max_element(thread_max.begin(), thread_max.end()) : 0);
+        if (maxed <= std::numeric_limits<uint8_t>::max()) {
+            level = SparseLayer::U8;
+        } else if (maxed <= std::numeric_limits<uint16_t>::max()) {
+            level = SparseLayer::U16;
+        } else if (maxed <= std::numeric_limits<uint32_t>::max()) {
+            level = SparseLayer::U32;
+        }
+    }
+
+    std::vector<int> indices(pointers.back());
+    auto fill = [&](auto& values) -> void {
+        values.resize(pointers.back());
+        loop([&](int, int c, const auto& range) -> void {
+            auto offset = pointers[c];
+            for (int k = 0; k < range.number; ++k) {
+                auto val = range.value[k];
+                if (val == 0) {
+                    continue;
+                }
+                values[offset] = val;
+                indices[offset] = range.index[k];
+                ++offset;
+            }
+        });
+    };
+
+    output.write<uint8_t>(static_cast<uint8_t>(level));
+    output.write(pointers);
+    switch (level) {
+        case SparseLayer::U8:
+            {
+                std::vector<uint8_t> values;
+                fill(values);
+                output.write(indices);
+                output.write(values);
+            }
+            break;
+        case SparseLayer::U16:
+            {
+                std::vector<uint16_t> values;
+                fill(values);
+                output.write(indices);
+                output.write(values);
+            }
+            break;
+        case SparseLayer::U32:
+            {
+                std::vector<uint32_t> values;
+                fill(values);
+                output.write(indices);
+                output.write(values);
+            }
+            break;
+        default:
+            {
+                std::vector<double> values;
+                fill(values);
+                output.write(indices);
+                output.write(values);
+            }
+    }
+
+    return output;
+}
+
+NumericMatrix load_numeric_matrix(uintptr_t buffer, size_t len) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("NumericMatrix", matrix_serialization_version);
+    int NR = reader.read_scalar<uint64_t>();
+    int NC = reader.read_scalar<uint64_t>();
+    bool sparse = reader.read_scalar<uint8_t>();
+
+    if (!sparse) {
+        std::vector<double> values;
+        reader.read(values);
+        if (values.size() != static_cast<size_t>(NR) * static_cast<size_t>(NC)) {
+            throw std::runtime_error("inconsistent length of the values for a serialized dense matrix");
+        }
+        return NumericMatrix(std::shared_ptr<const tatami::NumericMatrix>(new tatami::DenseColumnMatrix<double, int>(NR, NC, std::move(values))));
+    }
+
+    auto level = static_cast<SparseLayer>(reader.read_scalar<uint8_t>());
+    std::vector<uint64_t> raw_pointers;
+    reader.read(raw_pointers);
+    std::vector<size_t> pointers(raw_pointers.begin(), raw_pointers.end());
+    std::vector<int> indices;
+    reader.read(indices);
+
+    auto create = [&](auto values) -> NumericMatrix {
+        typedef decltype(values) ValueStorage;
+        return NumericMatrix(std::shared_ptr<const tatami::NumericMatrix>(
+            new tatami::CompressedSparseColumnMatrix<double, int, ValueStorage, std::vector<int>, std::vector<size_t> >(
+                NR, NC, std::move(values), std::move(indices), std::move(pointers)
+            )
+        ));
+    };
+
+    switch (level) {
+        case SparseLayer::U8:
+            {
+                std::vector<uint8_t> values;
+                reader.read(values);
+                return create(std::move(values));
+            }
+        case SparseLayer::U16:
+            {
+                std::vector<uint16_t> values;
+                reader.read(values);
+                return create(std::move(values));
+            }
+        case SparseLayer::U32:
+            {
+                std::vector<uint32_t> values;
+                reader.read(values);
+                return create(std::move(values));
+            }
+        default:
+            {
+                std::vector<double> values;
+                reader.read(values);
+                return create(std::move(values));
+            }
+    }
+}
+
+/*****************************************/
+
+static constexpr uint32_t neighbors_serialization_version = 1;
+
+SerializedBuffer save_neighbor_results(const NeighborResults& results) {
+    SerializedBuffer output("NeighborResults", neighbors_serialization_version);
+    output.write(results.neighbors);
+    return output;
+}
+
+NeighborResults load_neighbor_results(uintptr_t buffer, size_t len) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("NeighborResults", neighbors_serialization_version);
+    NeighborResults output(0);
+    reader.read(output.neighbors);
+    return output;
+}
+
+/*****************************************/
+
+EMSCRIPTEN_BINDINGS(checkpoint) {
+    emscripten::class_<CheckpointWriter>("CheckpointWriter")
+        .constructor<>()
+        .function("add", &CheckpointWriter::add)
+        .function("num_sections", &CheckpointWriter::num_sections)
+        .function("finish", &CheckpointWriter::finish)
+        .function("finish_to_file", &CheckpointWriter::finish_to_file)
+        ;
+
+    emscripten::class_<CheckpointReader>("CheckpointReader")
+        .constructor<uintptr_t, size_t>()
+        .constructor<std::string>()
+        .function("num_sections", &CheckpointReader::num_sections)
+        .function("name", &CheckpointReader::name)
+        .function("kind", &CheckpointReader::kind)
+        .function("raw_size", &CheckpointReader::raw_size)
+        .function("has", &CheckpointReader::has)
+        .function("extract", &CheckpointReader::extract)
+        ;
+
+    emscripten::function("save_numeric_matrix", &save_numeric_matrix);
+
+    emscripten::function("load_numeric_matrix", &load_numeric_matrix);
+
+    emscripten::function("save_neighbor_results", &save_neighbor_results);
+
+    emscripten::function("load_neighbor_results", &load_neighbor_results);
+}
@@ -4,54 +4,86 @@
 #include <memory>
 
 #include "parallel.h"
+#include "buffer_pool.h"
 
 #include "kmeans/Kmeans.hpp"
 #include "kmeans/InitializePCAPartition.hpp"
 
 struct ClusterKmeans_Result {
-    kmeans::Kmeans<>::Results store;
+    typedef decltype(kmeans::Kmeans<>::Results::details) Details;
+
+    size_t nobs, ndim;
+    double* center_ptr;
+    int* cluster_ptr;
+    Details details;
+
+    // Only used when the results are not stored in caller-provided buffers.
+    PooledBuffer owned_centers, owned_clusters;
+
+    ClusterKmeans_Result(int num_obs, int num_clusters, int num_dims) : 
+        nobs(num_obs), 
+        ndim(num_dims), 
+        owned_centers(static_cast<size_t>(num_clusters) * num_dims * sizeof(double)), 
+        owned_clusters(num_obs * sizeof(int))
+    {
+        center_ptr = owned_centers.data<double>();
+        cluster_ptr = owned_clusters.data<int>();
+        details.sizes.resize(num_clusters);
+        details.withinss.resize(num_clusters);
+    }
 
-    ClusterKmeans_Result(kmeans::Kmeans<>::Results s) : store(std::move(s)) {}
+    ClusterKmeans_Result(size_t num_obs, size_t num_dims, uintptr_t centers, uintptr_t clusters) :
+        nobs(num_obs),
+        ndim(num_dims),
+        center_ptr(reinterpret_cast<double*>(centers)),
+        cluster_ptr(reinterpret_cast<int*>(clusters))
+    {}
 
 public:
     size_t num_obs() const {
-        return store.clusters.size();
+        return nobs;
     }
 
     size_t num_clusters() const {
-        return store.details.sizes.size();
+        return details.sizes.size();
     }
 
     emscripten::val clusters() const {
-        const auto& c = store.clusters;
-        return emscripten::val(emscripten::typed_memory_view(c.size(), c.data()));
+        return emscripten::val(emscripten::typed_memory_view(nobs, cluster_ptr));
     }
 
     emscripten::val cluster_sizes() const {
-        const auto& s = store.details.sizes;
+        const auto& s = details.sizes;
         return emscripten::val(emscripten::typed_memory_view(s.size(), s.data()));
     }
 
     emscripten::val wcss() const {
-        const auto& s = store.details.withinss;
+        const auto& s = details.withinss;
         return emscripten::val(emscripten::typed_memory_view(s.size(), s.data()));
     }
 
     int iterations() const {
-        return store.details.iterations;
+        return details.iterations;
+    }
+
+    void set_iterations(int i) {
+        details.iterations = i;
     }
 
     int status() const {
-        return store.details.status;
+        return details.status;
+    }
+
+    void set_status(int s) {
+        details.status = s;
     }
 
     emscripten::val centers() const {
-        const auto& s = store.centers;
-        return emscripten::val(emscripten::typed_memory_view(s.size(), s.data()));
+        return emscripten::val(emscripten::typed_memory_view(ndim * details.sizes.size(), center_ptr));
     }
 };
 
-ClusterKmeans_Result cluster_kmeans(uintptr_t mat, int nr, int nc, int k, std::string init_method, int init_seed, double init_pca_adjust, int nthreads) {
+ClusterKmeans_Result cluster_kmeans(uintptr_t mat, int nr, int nc, int k, std::string init_method, int init_seed, double init_pca_adjust, bool use_buffers, uintptr_t centers, uintptr_t clusters, int nthreads) {
     const double* ptr = reinterpret_cast<const double*>(mat);
 
     std::shared_ptr<kmeans::Initialize<> > iptr;
@@ -76,17 +108,22 @@ ClusterKmeans_Result cluster_kmeans(uintptr_t mat, int nr, int nc, int k, std::s
         throw std::runtime_error("unknown initialization method '" + init_method + "'");
     }
 
+    auto output = (use_buffers ? 
+        ClusterKmeans_Result(nc, nr, centers, clusters) : 
+        ClusterKmeans_Result(nc, k, nr));
+
     kmeans::Kmeans clust;
     clust.set_num_threads(nthreads);
-    auto output = clust.run(nr, nc, ptr, k, iptr.get());
+    output.details = clust.run(nr, nc, ptr, k, output.center_ptr, output.cluster_ptr, iptr.get());
 
-    return ClusterKmeans_Result(std::move(output));
+    return output;
 }
 
 EMSCRIPTEN_BINDINGS(cluster_kmeans) {
     emscripten::function("cluster_kmeans", &cluster_kmeans);
 
     emscripten::class_<ClusterKmeans_Result>("ClusterKmeans_Result")
+        .constructor<int, int, int>()
         .function("num_obs", &ClusterKmeans_Result::num_obs)
         .function("num_clusters", &ClusterKmeans_Result::num_clusters)
         .function("cluster_sizes", &ClusterKmeans_Result::cluster_sizes)
@@ -94,6 +131,8 @@ EMSCRIPTEN_BINDINGS(cluster_kmeans) {
         .function("clusters", &ClusterKmeans_Result::clusters)
         .function("centers", &ClusterKmeans_Result::centers)
         .function("iterations", &ClusterKmeans_Result::iterations)
+        .function("set_iterations", &ClusterKmeans_Result::set_iterations)
         .function("status", &ClusterKmeans_Result::status)
+        .function("set_status", &ClusterKmeans_Result::set_status)
         ;
 }
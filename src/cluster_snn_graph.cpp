@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "NeighborIndex.h"
+#include "serialize_utils.h"
 #include "parallel.h"
 
 #include "scran/scran.hpp"
@@ -44,6 +45,32 @@ BuildSnnGraph_Result build_snn_graph(const NeighborResults& neighbors, std::stri
     return BuildSnnGraph_Result(builder.run(indices));
 }
 
+static constexpr uint32_t snn_graph_serialization_version = 1;
+
+SerializedBuffer save_snn_graph(const BuildSnnGraph_Result& graph) {
+    const auto& store = graph.graph;
+    SerializedBuffer output("SnnGraph", snn_graph_serialization_version);
+    output.write<uint64_t>(store.ncells);
+    output.write(store.edges);
+    output.write(store.weights);
+    return output;
+}
+
+BuildSnnGraph_Result load_snn_graph(uintptr_t buffer, size_t len) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("SnnGraph", snn_graph_serialization_version);
+
+    scran::BuildSnnGraph::Results store;
+    store.ncells = reader.read_scalar<uint64_t>();
+    reader.read(store.edges);
+    reader.read(store.weights);
+    if (store.edges.size() != 2 * store.weights.size()) {
+        throw std::runtime_error("inconsistent number of edges and weights in the serialized SNN graph");
+    }
+
+    return BuildSnnGraph_Result(std::move(store));
+}
+
 /**********************************/
 
 struct ClusterSnnGraphMultiLevel_Result {
@@ -153,6 +180,10 @@ EMSCRIPTEN_BINDINGS(cluster_snn_graph) {
 
     emscripten::class_<BuildSnnGraph_Result>("BuildSnnGraph_Result");
 
+    emscripten::function("save_snn_graph", &save_snn_graph);
+
+    emscripten::function("load_snn_graph", &load_snn_graph);
+
     emscripten::function("cluster_snn_graph_multilevel", &cluster_snn_graph_multilevel);
 
     emscripten::class_<ClusterSnnGraphMultiLevel_Result>("ClusterSnnGraphMultiLevel_Result")
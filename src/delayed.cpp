@@ -9,6 +9,7 @@
 #include "tatami/tatami.hpp"
 
 void delayed_arithmetic_scalar(NumericMatrix& x, std::string op, bool right, double val) {
+    auto fingerprint = Fingerprint(x.fingerprint).add_string("arith_scalar").add_string(op).add_scalar<uint8_t>(right).add_scalar(val).value();
     if (op == "+") {
         x.reset_ptr(tatami::make_DelayedUnaryIsometricOp(std::move(x.ptr), tatami::make_DelayedAddScalarHelper(val)));
     } else if (op == "*") {
@@ -28,6 +29,7 @@ void delayed_arithmetic_scalar(NumericMatrix& x, std::string op, bool right, dou
     } else {
         throw std::runtime_error("unknown arithmetic operation '" + op + "'");
     }
+    x.fingerprint = fingerprint;
 }
 
 void delayed_arithmetic_vector(NumericMatrix& x, std::string op, bool right, int margin, uintptr_t ptr, size_t n) {
@@ -36,6 +38,7 @@ void delayed_arithmetic_vector(NumericMatrix& x, std::string op, bool right, int
     }
     auto input = reinterpret_cast<const double*>(ptr);
     std::vector<double> store(input, input + n);
+    auto fingerprint = Fingerprint(x.fingerprint).add_string("arith_vector").add_string(op).add_scalar<uint8_t>(right).add_scalar<int32_t>(margin).add_array(input, n).value();
 
     if (op == "+") {
         if (margin == 1) {
@@ -80,9 +83,11 @@ void delayed_arithmetic_vector(NumericMatrix& x, std::string op, bool right, int
     } else {
         throw std::runtime_error("unknown arithmetic operation '" + op + "'");
     }
+    x.fingerprint = fingerprint;
 }
 
 void delayed_math(NumericMatrix& x, std::string op, double base) {
+    auto fingerprint = Fingerprint(x.fingerprint).add_string("math").add_string(op).add_scalar(base).value();
     if (op == "abs") {
         x.reset_ptr(tatami::make_DelayedUnaryIsometricOp(std::move(x.ptr), tatami::DelayedAbsHelper()));
     } else if (op == "sqrt") {
@@ -102,10 +107,12 @@ void delayed_math(NumericMatrix& x, std::string op, double base) {
     } else {
         throw std::runtime_error("unknown math operation '" + op + "'");
     }
+    x.fingerprint = fingerprint;
 }
 
 void transpose(NumericMatrix& x) {
     x.reset_ptr(tatami::make_DelayedTranspose(std::move(x.ptr)));
+    x.fingerprint = Fingerprint(x.fingerprint).add_string("transpose").value();
     return;
 }
 
@@ -0,0 +1,276 @@
+#include <emscripten/bind.h>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+
+#include "utils.h"
+#include "hdf5_write_utils.h"
+
+#include "H5Cpp.h"
+
+/*
+ * Writes results into a single open HDF5 file using the H5AD conventions,
+ * i.e., each group and dataset carries 'encoding-type' and 'encoding-version'
+ * attributes so that it can be read by anndata. All numeric data is read
+ * directly from the supplied addresses on the Wasm heap, so the caller can
+ * pass views of existing results without copying them into JS first.
+ *
+ * Multi-column arrays (e.g., in 'obsm') can be written from a single buffer
+ * in row-major order or from a separate buffer for each column, where the
+ * latter uses a strided selection in the file to avoid interleaving in memory.
+ */
+
+class H5adWriter {
+public:
+    H5adWriter(std::string path, bool truncate) {
+        bool exists = false;
+        if (!truncate) {
+            auto fptr = std::fopen(path.c_str(), "rb");
+            if (fptr) {
+                exists = true;
+                std::fclose(fptr);
+            }
+        }
+
+        handle = H5::H5File(path, exists ? H5F_ACC_RDWR : H5F_ACC_TRUNC);
+        set_encoding(handle, "anndata", "0.1.0");
+    }
+
+private:
+    H5::H5File handle;
+    bool closed = false;
+
+    void check_open() const {
+        if (closed) {
+            throw std::runtime_error("H5AD writer has already been closed");
+        }
+    }
+
+    static void set_string_attribute(H5::H5Object& obj, const std::string& attr, const std::string& value) {
+        if (obj.attrExists(attr)) {
+            obj.removeAttr(attr);
+        }
+        H5::StrType stype(0, H5T_VARIABLE);
+        stype.setCset(H5T_CSET_UTF8);
+        auto ahandle = obj.createAttribute(attr, stype, H5S_SCALAR);
+        ahandle.write(stype, value);
+    }
+
+    static void set_encoding(H5::H5Object& obj, const std::string& type, const std::string& version) {
+        set_string_attribute(obj, "encoding-type", type);
+        set_string_attribute(obj, "encoding-version", version);
+    }
+
+    static std::vector<std::string> unpack_strings(size_t n, uintptr_t lengths, uintptr_t buffer) {
+        auto lptr = reinterpret_cast<const int32_t*>(lengths);
+        auto bptr = reinterpret_cast<const char*>(buffer);
+        std::vector<std::string> output;
+        output.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            output.emplace_back(bptr, bptr + lptr[i]);
+            bptr += lptr[i];
+        }
+        return output;
+    }
+
+    void remove_existing(const std::string& name) {
+        if (handle.nameExists(name)) {
+            handle.unlink(name);
+        }
+    }
+
+    // Chunks span all non-first dimensions, with the first dimension chosen
+    // so that each chunk contains around 100,000 elements.
+    static H5::DSetCreatPropList create_plist(const std::vector<hsize_t>& dims, int deflate_level) {
+        H5::DSetCreatPropList plist;
+        if (deflate_level < 0 || dims.empty()) {
+            return plist;
+        }
+
+        hsize_t row_size = 1;
+        for (size_t d = 1; d < dims.size(); ++d) {
+            row_size *= dims[d];
+        }
+        if (dims[0] == 0 || row_size == 0) {
+            return plist;
+        }
+
+        std::vector<hsize_t> chunks(dims);
+        chunks[0] = std::max(static_cast<hsize_t>(1), std::min(dims[0], static_cast<hsize_t>(100000) / row_size));
+        plist.setChunk(chunks.size(), chunks.data());
+        plist.setDeflate(deflate_level);
+        return plist;
+    }
+
+    void write_strings_internal(const std::string& name, const std::vector<std::string>& values, int deflate_level) {
+        remove_existing(name);
+
+        std::vector<const char*> pointers;
+        pointers.reserve(values.size());
+        for (const auto& v : values) {
+            pointers.push_back(v.c_str());
+        }
+
+        H5::StrType stype(0, H5T_VARIABLE);
+        stype.setCset(H5T_CSET_UTF8);
+        std::vector<hsize_t> dims{ values.size() };
+        H5::DataSpace dspace(1, dims.data());
+        auto dhandle = handle.createDataSet(name, stype, dspace, create_plist(dims, deflate_level));
+        if (!values.empty()) {
+            dhandle.write(pointers.data(), stype);
+        }
+        set_encoding(dhandle, "string-array", "0.2.0");
+    }
+
+public:
+    void write_group(std::string name, std::string encoding) {
+        check_open();
+        H5::Group ghandle = (handle.nameExists(name) ? handle.openGroup(name) : handle.createGroup(name));
+        if (encoding == "dataframe") {
+            set_encoding(ghandle, encoding, "0.2.0");
+        } else {
+            set_encoding(ghandle, encoding, "0.1.0");
+        }
+    }
+
+    void write_array(std::string name, int nshape, uintptr_t shape, std::string type, uintptr_t data, int deflate_level) {
+        check_open();
+        remove_existing(name);
+
+        auto sptr = reinterpret_cast<const int32_t*>(shape);
+        std::vector<hsize_t> dims(sptr, sptr + nshape);
+        H5::DataSpace dspace;
+        if (nshape) {
+            dspace = H5::DataSpace(nshape, dims.data());
+        }
+
+        dispatch_numeric_type(type, [&](auto x, const H5::PredType& ptype) -> void {
+            typedef decltype(x) Type_;
+            auto dhandle = handle.createDataSet(name, ptype, dspace, create_plist(dims, deflate_level));
+            if (std::find(dims.begin(), dims.end(), 0) == dims.end()) {
+                dhandle.write(reinterpret_cast<const Type_*>(data), ptype);
+            }
+            set_encoding(dhandle, (nshape ? "array" : "numeric-scalar"), "0.2.0");
+        });
+    }
+
+    void write_array_columns(std::string name, int nrow, int ncol, uintptr_t columns, std::string type, int deflate_level) {
+        check_open();
+        remove_existing(name);
+
+        auto cptrs = convert_array_of_offsets<const void*>(ncol, columns);
+        std::vector<hsize_t> dims{ static_cast<hsize_t>(nrow), static_cast<hsize_t>(ncol) };
+        H5::DataSpace fspace(2, dims.data());
+
+        dispatch_numeric_type(type, [&](auto x, const H5::PredType& ptype) -> void {
+            typedef decltype(x) Type_;
+            auto dhandle = handle.createDataSet(name, ptype, fspace, create_plist(dims, deflate_level));
+
+            hsize_t mdims = nrow;
+            H5::DataSpace mspace(1, &mdims);
+            hsize_t count[2] = { static_cast<hsize_t>(nrow), 1 };
+            for (int c = 0; c < ncol; ++c) {
+                hsize_t start[2] = { 0, static_cast<hsize_t>(c) };
+                fspace.selectHyperslab(H5S_SELECT_SET, count, start);
+                dhandle.write(reinterpret_cast<const Type_*>(cptrs[c]), ptype, mspace, fspace);
+            }
+
+            set_encoding(dhandle, "array", "0.2.0");
+        });
+    }
+
+    void write_string_array(std::string name, size_t n, uintptr_t lengths, uintptr_t buffer, int deflate_level) {
+        check_open();
+        write_strings_internal(name, unpack_strings(n, lengths, buffer), deflate_level);
+    }
+
+    void write_string_scalar(std::string name, std::string value) {
+        check_open();
+        remove_existing(name);
+
+        H5::StrType stype(0, H5T_VARIABLE);
+        stype.setCset(H5T_CSET_UTF8);
+        auto dhandle = handle.createDataSet(name, stype, H5S_SCALAR);
+        dhandle.write(value, stype);
+        set_encoding(dhandle, "string", "0.2.0");
+    }
+
+    void write_categorical(std::string name, size_t n, uintptr_t codes, size_t nlevels, uintptr_t level_lengths, uintptr_t level_buffer, int deflate_level) {
+        check_open();
+        remove_existing(name);
+
+        auto cptr = reinterpret_cast<const int32_t*>(codes);
+        for (size_t i = 0; i < n; ++i) {
+            if (cptr[i] >= static_cast<int32_t>(nlevels)) {
+                throw std::runtime_error("categorical codes should be less than the number of levels");
+            }
+        }
+
+        auto ghandle = handle.createGroup(name);
+        set_encoding(ghandle, "categorical", "0.2.0");
+        {
+            auto attr = ghandle.createAttribute("ordered", H5::PredType::NATIVE_UINT8, H5S_SCALAR);
+            uint8_t ordered = 0;
+            attr.write(H5::PredType::NATIVE_UINT8, &ordered);
+        }
+
+        std::vector<hsize_t> dims{ n };
+        H5::DataSpace dspace(1, dims.data());
+        auto dhandle = ghandle.createDataSet("codes", H5::PredType::NATIVE_INT32, dspace, create_plist(dims, deflate_level));
+        if (n) {
+            dhandle.write(cptr, H5::PredType::NATIVE_INT32);
+        }
+        set_encoding(dhandle, "array", "0.2.0");
+
+        write_strings_internal(name + "/categories", unpack_strings(nlevels, level_lengths, level_buffer), deflate_level);
+    }
+
+    void write_dataframe_attributes(std::string name, size_t ncols, uintptr_t column_lengths, uintptr_t column_buffer) {
+        check_open();
+        auto ghandle = handle.openGroup(name);
+        set_string_attribute(ghandle, "_index", "_index");
+
+        auto columns = unpack_strings(ncols, column_lengths, column_buffer);
+        std::vector<const char*> pointers;
+        pointers.reserve(columns.size());
+        for (const auto& c : columns) {
+            pointers.push_back(c.c_str());
+        }
+
+        if (ghandle.attrExists("column-order")) {
+            ghandle.removeAttr("column-order");
+        }
+        H5::StrType stype(0, H5T_VARIABLE);
+        stype.setCset(H5T_CSET_UTF8);
+        hsize_t dim = columns.size();
+        auto ahandle = ghandle.createAttribute("column-order", stype, H5::DataSpace(1, &dim));
+        if (!columns.empty()) {
+            ahandle.write(stype, pointers.data());
+        }
+    }
+
+    void close() {
+        if (!closed) {
+            handle.close();
+            closed = true;
+        }
+    }
+};
+
+EMSCRIPTEN_BINDINGS(export_h5ad) {
+    emscripten::class_<H5adWriter>("H5adWriter")
+        .constructor<std::string, bool>()
+        .function("write_group", &H5adWriter::write_group)
+        .function("write_array", &H5adWriter::write_array)
+        .function("write_array_columns", &H5adWriter::write_array_columns)
+        .function("write_string_array", &H5adWriter::write_string_array)
+        .function("write_string_scalar", &H5adWriter::write_string_scalar)
+        .function("write_categorical", &H5adWriter::write_categorical)
+        .function("write_dataframe_attributes", &H5adWriter::write_dataframe_attributes)
+        .function("close", &H5adWriter::close)
+        ;
+}
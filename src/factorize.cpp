@@ -0,0 +1,236 @@
+#include <emscripten/bind.h>
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <string_view>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+
+#include "parallel.h"
+
+/*
+ * Hash-based factorization, parallelized by splitting the input into
+ * contiguous chunks. Each thread factorizes its own chunk with a local hash
+ * table, after which the local levels are merged in chunk order. This means
+ * that the global levels are reported in order of their first occurrence,
+ * regardless of the number of threads; the caller is responsible for any
+ * further sorting, which only involves the (typically few) unique levels.
+ */
+
+template<typename Key_, class Extract_, class Valid_>
+int32_t factorize_internal(size_t n, Extract_ extract, Valid_ valid, int32_t* codes, int32_t* firsts, int32_t placeholder, int nthreads) {
+    std::vector<std::vector<int32_t> > local_firsts(nthreads);
+
+    run_parallel_new([&](int t, size_t start, size_t length) -> void {
+        std::unordered_map<Key_, int32_t> found;
+        auto& lfirsts = local_firsts[t];
+        for (size_t i = start, end = start + length; i < end; ++i) {
+            if (!valid(i)) {
+                codes[i] = placeholder;
+                continue;
+            }
+
+            auto current = extract(i);
+            auto it = found.find(current);
+            if (it == found.end()) {
+                int32_t code = lfirsts.size();
+                found[current] = code;
+                lfirsts.push_back(i);
+                codes[i] = code;
+            } else {
+                codes[i] = it->second;
+            }
+        }
+    }, n, nthreads);
+
+    // Merging the local levels in chunk order.
+    std::unordered_map<Key_, int32_t> global;
+    std::vector<std::vector<int32_t> > remapping(nthreads);
+    int32_t nlevels = 0;
+    for (int t = 0; t < nthreads; ++t) {
+        auto& remap = remapping[t];
+        for (auto f : local_firsts[t]) {
+            auto current = extract(f);
+            auto it = global.find(current);
+            if (it == global.end()) {
+                global[current] = nlevels;
+                remap.push_back(nlevels);
+                firsts[nlevels] = f;
+                ++nlevels;
+            } else {
+                remap.push_back(it->second);
+            }
+        }
+    }
+
+    run_parallel_new([&](int t, size_t start, size_t length) -> void {
+        const auto& remap = remapping[t];
+        for (size_t i = start, end = start + length; i < end; ++i) {
+            if (valid(i)) {
+                codes[i] = remap[codes[i]];
+            }
+        }
+    }, n, nthreads);
+
+    return nlevels;
+}
+
+void factorize_strings(size_t n, uintptr_t buffer, uintptr_t lengths, uintptr_t codes, uintptr_t firsts, uintptr_t counts, int nthreads) {
+    auto bptr = reinterpret_cast<const char*>(buffer);
+    auto lptr = reinterpret_cast<const int32_t*>(lengths);
+    std::vector<size_t> offsets(n + 1);
+    for (size_t i = 0; i < n; ++i) {
+        offsets[i + 1] = offsets[i] + lptr[i];
+    }
+
+    auto cptr = reinterpret_cast<int32_t*>(codes);
+    auto fptr = reinterpret_cast<int32_t*>(firsts);
+    auto nlevels = factorize_internal<std::string_view>(
+        n,
+        [&](size_t i) -> std::string_view { return std::string_view(bptr + offsets[i], lptr[i]); },
+        [](size_t) -> bool { return true; },
+        cptr,
+        fptr,
+        -1,
+        nthreads
+    );
+
+    auto outcounts = reinterpret_cast<int32_t*>(counts);
+    outcounts[0] = nlevels;
+    outcounts[1] = 0;
+}
+
+void factorize_numbers(size_t n, uintptr_t values, uintptr_t codes, uintptr_t firsts, uintptr_t counts, int nthreads) {
+    auto vptr = reinterpret_cast<const double*>(values);
+    auto cptr = reinterpret_cast<int32_t*>(codes);
+    auto fptr = reinterpret_cast<int32_t*>(firsts);
+    auto nlevels = factorize_internal<double>(
+        n,
+        [&](size_t i) -> double {
+            auto val = vptr[i];
+            return (val == 0 ? 0.0 : val); // collapsing -0 and +0 into the same key.
+        },
+        [&](size_t i) -> bool { return std::isfinite(vptr[i]); },
+        cptr,
+        fptr,
+        -1,
+        nthreads
+    );
+
+    auto outcounts = reinterpret_cast<int32_t*>(counts);
+    outcounts[0] = nlevels;
+    outcounts[1] = 0;
+    for (size_t i = 0; i < n; ++i) {
+        outcounts[1] += !std::isfinite(vptr[i]);
+    }
+}
+
+/**********************************/
+
+// Negative codes are considered to be invalid and are replaced with the
+// placeholder, while all other codes are replaced with their mapped values.
+void remap_factor(size_t n, uintptr_t codes, size_t nlevels, uintptr_t mapping, int32_t placeholder) {
+    auto cptr = reinterpret_cast<int32_t*>(codes);
+    auto mptr = reinterpret_cast<const int32_t*>(mapping);
+    for (size_t i = 0; i < n; ++i) {
+        auto& current = cptr[i];
+        if (current < 0) {
+            current = placeholder;
+        } else if (static_cast<size_t>(current) >= nlevels) {
+            throw std::runtime_error("factor codes should be less than the number of levels");
+        } else {
+            current = mptr[current];
+        }
+    }
+}
+
+// Returns the number of used levels, whose original codes are stored in
+// 'used' in increasing order (i.e., 'used' should have length 'n').
+int32_t drop_unused_levels(size_t n, uintptr_t codes, uintptr_t used, int nthreads) {
+    auto cptr = reinterpret_cast<int32_t*>(codes);
+    auto uptr = reinterpret_cast<int32_t*>(used);
+    if (n == 0) {
+        return 0;
+    }
+
+    auto range = std::minmax_element(cptr, cptr + n);
+    int64_t lower = *(range.first), upper = *(range.second);
+    std::vector<int32_t> uniq;
+
+    if (static_cast<uint64_t>(upper - lower) <= n) {
+        // Codes are usually small non-negative integers, so we can use them
+        // to directly address a presence vector.
+        std::vector<uint8_t> present(upper - lower + 1);
+        for (size_t i = 0; i < n; ++i) {
+            present[cptr[i] - lower] = 1;
+        }
+        std::vector<int32_t> remapping(present.size());
+        for (size_t p = 0; p < present.size(); ++p) {
+            if (present[p]) {
+                remapping[p] = uniq.size();
+                uniq.push_back(p + lower);
+            }
+        }
+        run_parallel_old(n, [&](size_t start, size_t end) -> void {
+            for (size_t i = start; i < end; ++i) {
+                cptr[i] = remapping[cptr[i] - lower];
+            }
+        }, nthreads);
+
+    } else {
+        uniq.insert(uniq.end(), cptr, cptr + n);
+        std::sort(uniq.begin(), uniq.end());
+        uniq.erase(std::unique(uniq.begin(), uniq.end()), uniq.end());
+        run_parallel_old(n, [&](size_t start, size_t end) -> void {
+            for (size_t i = start; i < end; ++i) {
+                cptr[i] = std::lower_bound(uniq.begin(), uniq.end(), cptr[i]) - uniq.begin();
+            }
+        }, nthreads);
+    }
+
+    std::copy(uniq.begin(), uniq.end(), uptr);
+    return uniq.size();
+}
+
+// Subsetting by indices if 'use_filter = false', otherwise 'subset' is
+// treated as a filter of length 'n', where truthy values are retained if
+// 'keep = true' and discarded otherwise.
+void subset_factor(size_t n, uintptr_t codes, size_t nsubset, uintptr_t subset, bool use_filter, bool keep, uintptr_t output) {
+    auto cptr = reinterpret_cast<const int32_t*>(codes);
+    auto optr = reinterpret_cast<int32_t*>(output);
+
+    if (use_filter) {
+        auto fptr = reinterpret_cast<const uint8_t*>(subset);
+        for (size_t i = 0; i < n; ++i) {
+            if ((fptr[i] != 0) == keep) {
+                *optr = cptr[i];
+                ++optr;
+            }
+        }
+    } else {
+        auto sptr = reinterpret_cast<const int32_t*>(subset);
+        for (size_t s = 0; s < nsubset; ++s) {
+            auto i = sptr[s];
+            if (i < 0 || static_cast<size_t>(i) >= n) {
+                throw std::runtime_error("subset indices should be non-negative and less than the length of the factor");
+            }
+            optr[s] = cptr[i];
+        }
+    }
+}
+
+/**********************************/
+
+EMSCRIPTEN_BINDINGS(factorize) {
+    emscripten::function("factorize_strings", &factorize_strings);
+
+    emscripten::function("factorize_numbers", &factorize_numbers);
+
+    emscripten::function("remap_factor", &remap_factor);
+
+    emscripten::function("drop_unused_levels", &drop_unused_levels);
+
+    emscripten::function("subset_factor", &subset_factor);
+}
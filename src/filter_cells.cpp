@@ -1,18 +1,28 @@
 #include <emscripten/bind.h>
 
 #include <cstdint>
+#include <vector>
 
 #include "NumericMatrix.h"
+#include "subset_utils.h"
 #include "parallel.h"
 
-#include "scran/scran.hpp"
-
 NumericMatrix filter_cells(const NumericMatrix& mat, uintptr_t filter, bool keep) {
-    scran::FilterCells filterer;
-    if (keep) {
-        filterer.set_retain();
+    auto fptr = reinterpret_cast<const uint8_t*>(filter);
+    size_t NC = mat.ncol();
+
+    std::vector<int> retained;
+    retained.reserve(NC);
+    for (size_t c = 0; c < NC; ++c) {
+        if ((fptr[c] != 0) == keep) {
+            retained.push_back(c);
+        }
     }
-    return NumericMatrix(filterer.run(mat.ptr, reinterpret_cast<const uint8_t*>(filter)));
+
+    NumericMatrix output(subset_by_runs<1>(mat.ptr, std::move(retained)));
+    output.fingerprint = Fingerprint(mat.fingerprint).add_string("filter_cells").add_scalar<uint8_t>(keep).add_array(fptr, NC).value();
+    output.memoizable = mat.memoizable;
+    return output;
 }
 
 EMSCRIPTEN_BINDINGS(filter_cells) {
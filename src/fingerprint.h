@@ -0,0 +1,89 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <atomic>
+#include <type_traits>
+
+/*
+ * Cheap 64-bit fingerprints for memoization. Each seed matrix gets a unique
+ * identifier upon creation, and each delayed operation derives the child's
+ * fingerprint from the parent's fingerprint and the operation's parameters.
+ * This means that the same chain of operations on the same seed yields the
+ * same fingerprint without ever touching the matrix contents.
+ *
+ * Mixing uses the splitmix64 finalizer, which is fast and good enough to
+ * make accidental collisions negligible; this is not a cryptographic hash.
+ */
+
+class Fingerprint {
+public:
+    Fingerprint(uint64_t seed = 0x9e3779b97f4a7c15ull) : state(seed) {}
+
+private:
+    uint64_t state;
+
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+public:
+    Fingerprint& add(uint64_t x) {
+        state = mix(state ^ mix(x));
+        return *this;
+    }
+
+    template<typename T>
+    Fingerprint& add_scalar(T x) {
+        static_assert(std::is_arithmetic<T>::value && sizeof(T) <= sizeof(uint64_t));
+        uint64_t bits = 0;
+        std::memcpy(&bits, &x, sizeof(T));
+        return add(bits);
+    }
+
+    Fingerprint& add_string(const std::string& x) {
+        return add_bytes(x.data(), x.size());
+    }
+
+    Fingerprint& add_bytes(const void* ptr, size_t n) {
+        auto bytes = reinterpret_cast<const unsigned char*>(ptr);
+        add(n);
+        size_t full = n / sizeof(uint64_t);
+        for (size_t i = 0; i < full; ++i) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+            state = mix(state ^ word);
+        }
+
+        size_t leftover = n % sizeof(uint64_t);
+        if (leftover) {
+            uint64_t word = 0;
+            std::memcpy(&word, bytes + full * sizeof(uint64_t), leftover);
+            state = mix(state ^ word);
+        }
+        return *this;
+    }
+
+    template<typename T>
+    Fingerprint& add_array(const T* ptr, size_t n) {
+        static_assert(std::is_arithmetic<T>::value);
+        return add_bytes(ptr, n * sizeof(T));
+    }
+
+    uint64_t value() const {
+        return state;
+    }
+};
+
+// Unique identity for a new seed matrix.
+inline uint64_t new_seed_fingerprint() {
+    static std::atomic<uint64_t> counter(0);
+    return Fingerprint(0).add(++counter).value();
+}
+
+#endif
@@ -0,0 +1,248 @@
+#include <emscripten/bind.h>
+
+#include "NumericMatrix.h"
+#include "parallel.h"
+#include "sparse_row_utils.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+/*
+ * Gene-gene correlations between a set of query rows and a set of target
+ * rows of a NumericMatrix. Each gene is stored as a sparse vector along with
+ * its mean and sum of squares, so that the Pearson correlation is obtained
+ * from the sparse dot product as (dot - n * mean_x * mean_y) / sqrt(ss_x * ss_y)
+ * without ever centering (and densifying) the vectors. For Spearman, each
+ * gene is replaced by its ranks minus the (tied) rank of zero, which
+ * preserves sparsity and does not change the correlation.
+ *
+ * Queries are processed in blocks that are densified into a cell-major
+ * buffer, such that each non-zero of a target updates all queries in the
+ * block from a single contiguous cache line. Targets are distributed across
+ * threads within each block, and only the top partners of each query (or
+ * those above a threshold) are retained.
+ */
+
+namespace {
+
+struct SparseGene : public SparseRow {
+    double mean = 0, ss = 0;
+};
+
+// Replaces non-zero values with their ranks (averaged across ties) minus
+// the rank of the zeros, so that zeros remain zero.
+void rank_transform(SparseGene& gene, size_t ncells) {
+    size_t nnz = gene.value.size();
+    std::vector<std::pair<double, size_t> > sorted;
+    sorted.reserve(nnz);
+    for (size_t k = 0; k < nnz; ++k) {
+        sorted.emplace_back(gene.value[k], k);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    size_t nneg = 0;
+    while (nneg < nnz && sorted[nneg].first < 0) {
+        ++nneg;
+    }
+    double nzeros = ncells - nnz;
+    double zero_rank = nneg + (nzeros + 1) / 2;
+
+    size_t start = 0;
+    while (start < nnz) {
+        size_t end = start + 1;
+        while (end < nnz && sorted[end].first == sorted[start].first) {
+            ++end;
+        }
+
+        // Ranks are 1-based; positive values are shifted past the zeros.
+        double rank = (start + end + 1) / 2.0;
+        if (sorted[start].first > 0) {
+            rank += nzeros;
+        }
+        for (size_t k = start; k < end; ++k) {
+            gene.value[sorted[k].second] = rank - zero_rank;
+        }
+        start = end;
+    }
+}
+
+void compute_moments(SparseGene& gene, size_t ncells) {
+    double sum = 0, sumsq = 0;
+    for (auto v : gene.value) {
+        sum += v;
+        sumsq += v * v;
+    }
+    gene.mean = sum / ncells;
+    gene.ss = sumsq - ncells * gene.mean * gene.mean;
+}
+
+}
+
+struct GeneCorrelations_Results {
+    GeneCorrelations_Results(size_t n) : partners(n), correlations(n) {}
+
+    std::vector<std::vector<int32_t> > partners;
+
+    std::vector<std::vector<double> > correlations;
+
+public:
+    size_t num_queries() const {
+        return partners.size();
+    }
+
+    emscripten::val partner_indices(int i) const {
+        const auto& current = partners[i];
+        return emscripten::val(emscripten::typed_memory_view(current.size(), current.data()));
+    }
+
+    emscripten::val partner_correlations(int i) const {
+        const auto& current = correlations[i];
+        return emscripten::val(emscripten::typed_memory_view(current.size(), current.data()));
+    }
+};
+
+GeneCorrelations_Results compute_gene_correlations(
+    const NumericMatrix& mat,
+    int nqueries,
+    uintptr_t queries,
+    int ntargets,
+    uintptr_t targets,
+    bool spearman,
+    int top,
+    bool use_threshold,
+    double threshold,
+    int block_size,
+    int nthreads)
+{
+    const auto& ptr = mat.ptr;
+    size_t NR = ptr->nrow(), NC = ptr->ncol();
+
+    auto qptr = reinterpret_cast<const int32_t*>(queries);
+    auto tptr = reinterpret_cast<const int32_t*>(targets);
+    std::vector<int> rows;
+    std::vector<int> unique_position(NR, -1);
+    auto register_row = [&](int r) -> int {
+        if (r < 0 || static_cast<size_t>(r) >= NR) {
+            throw std::runtime_error("query and target indices should be less than the number of rows");
+        }
+        if (unique_position[r] < 0) {
+            unique_position[r] = rows.size();
+            rows.push_back(r);
+        }
+        return unique_position[r];
+    };
+
+    std::vector<int> qpos(nqueries), tpos(ntargets);
+    for (int q = 0; q < nqueries; ++q) {
+        qpos[q] = register_row(qptr[q]);
+    }
+    for (int t = 0; t < ntargets; ++t) {
+        tpos[t] = register_row(tptr[t]);
+    }
+
+    std::vector<SparseGene> genes;
+    extract_sparse_rows(ptr.get(), rows, genes, nthreads);
+    run_parallel_old(genes.size(), [&](size_t first, size_t last) -> void {
+        for (size_t g = first; g < last; ++g) {
+            if (spearman) {
+                rank_transform(genes[g], NC);
+            }
+            compute_moments(genes[g], NC);
+        }
+    }, nthreads);
+
+    // By default, the dense query block is capped at 32 MB so that it can
+    // be shared by all threads without blowing up the Wasm heap.
+    GeneCorrelations_Results output(nqueries);
+    if (block_size <= 0) {
+        size_t limit = (32 * 1024 * 1024) / (sizeof(double) * std::max(NC, static_cast<size_t>(1)));
+        block_size = std::max(static_cast<size_t>(1), std::min(limit, static_cast<size_t>(256)));
+    }
+
+    std::vector<double> dense, scores;
+    for (int qstart = 0; qstart < nqueries; qstart += block_size) {
+        int nblock = std::min(block_size, nqueries - qstart);
+
+        // Densifying the query block in cell-major order.
+        dense.clear();
+        dense.resize(NC * static_cast<size_t>(nblock));
+        for (int b = 0; b < nblock; ++b) {
+            const auto& current = genes[qpos[qstart + b]];
+            for (size_t k = 0, nnz = current.index.size(); k < nnz; ++k) {
+                dense[static_cast<size_t>(current.index[k]) * nblock + b] = current.value[k];
+            }
+        }
+
+        // Scores are stored as (target, query) in query-major order.
+        scores.resize(static_cast<size_t>(ntargets) * nblock);
+        run_parallel_old(ntargets, [&](int first, int last) -> void {
+            std::vector<double> dots(nblock);
+            for (int t = first; t < last; ++t) {
+                const auto& target = genes[tpos[t]];
+                std::fill(dots.begin(), dots.end(), 0);
+                for (size_t k = 0, nnz = target.index.size(); k < nnz; ++k) {
+                    auto row = dense.data() + static_cast<size_t>(target.index[k]) * nblock;
+                    auto val = target.value[k];
+                    for (int b = 0; b < nblock; ++b) {
+                        dots[b] += val * row[b];
+                    }
+                }
+
+                for (int b = 0; b < nblock; ++b) {
+                    const auto& query = genes[qpos[qstart + b]];
+                    double denom = std::sqrt(query.ss * target.ss);
+                    scores[t + static_cast<size_t>(b) * ntargets] = (dots[b] - NC * query.mean * target.mean) / denom;
+                }
+            }
+        }, nthreads);
+
+        // Choosing the partners for each query in this block.
+        run_parallel_old(nblock, [&](int first, int last) -> void {
+            std::vector<std::pair<double, int> > candidates;
+            for (int b = first; b < last; ++b) {
+                int q = qstart + b;
+                const double* current = scores.data() + static_cast<size_t>(b) * ntargets;
+
+                candidates.clear();
+                for (int t = 0; t < ntargets; ++t) {
+                    double r = current[t];
+                    if (tptr[t] == qptr[q] || std::isnan(r) || (use_threshold && r < threshold)) {
+                        continue;
+                    }
+                    candidates.emplace_back(-r, tptr[t]);
+                }
+
+                if (top > 0 && candidates.size() > static_cast<size_t>(top)) {
+                    std::partial_sort(candidates.begin(), candidates.begin() + top, candidates.end());
+                    candidates.resize(top);
+                } else {
+                    std::sort(candidates.begin(), candidates.end());
+                }
+
+                auto& partners = output.partners[q];
+                auto& correlations = output.correlations[q];
+                partners.reserve(candidates.size());
+                correlations.reserve(candidates.size());
+                for (const auto& c : candidates) {
+                    partners.push_back(c.second);
+                    correlations.push_back(std::max(-1.0, std::min(1.0, -c.first)));
+                }
+            }
+        }, nthreads);
+    }
+
+    return output;
+}
+
+EMSCRIPTEN_BINDINGS(gene_correlations) {
+    emscripten::function("compute_gene_correlations", &compute_gene_correlations);
+
+    emscripten::class_<GeneCorrelations_Results>("GeneCorrelations_Results")
+        .function("num_queries", &GeneCorrelations_Results::num_queries)
+        .function("partner_indices", &GeneCorrelations_Results::partner_indices)
+        .function("partner_correlations", &GeneCorrelations_Results::partner_correlations)
+        ;
+}
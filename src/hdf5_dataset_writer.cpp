@@ -0,0 +1,237 @@
+#include <emscripten/bind.h>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "parallel.h"
+#include "hdf5_write_utils.h"
+
+#include "H5Cpp.h"
+#include "zlib.h"
+
+/*
+ * Appendable writer for numeric HDF5 datasets. The dataset is created with
+ * its full dimensions, and successive slabs are appended along the first
+ * dimension. Chunks span the full extent of all other dimensions, so each
+ * slab can be split into whole chunks without any hyperslab bookkeeping;
+ * rows that do not fill a chunk are held in a small buffer until the next
+ * slab (or the end) arrives.
+ *
+ * Complete chunks are converted to the on-disk type and deflated in parallel,
+ * and then written sequentially with direct chunk writes. This bypasses the
+ * HDF5 filter pipeline, which would otherwise compress on a single thread.
+ * HDF5 itself is not thread-safe, so all library calls occur on the main
+ * thread; only the conversion and compression are done by the workers.
+ */
+
+class Hdf5DataSetWriter {
+public:
+    Hdf5DataSetWriter(std::string p, std::string n, int nshape, uintptr_t shape, std::string t, int deflate_level, int chunk_length) :
+        path(std::move(p)), name(std::move(n)), type(std::move(t)), level(deflate_level)
+    {
+        if (nshape == 0) {
+            throw std::runtime_error("dataset writer does not support scalar datasets");
+        }
+
+        auto sptr = reinterpret_cast<const int32_t*>(shape);
+        dims.insert(dims.end(), sptr, sptr + nshape);
+        total_rows = dims[0];
+        row_size = 1;
+        for (int d = 1; d < nshape; ++d) {
+            row_size *= dims[d];
+        }
+
+        H5::DataType dtype;
+        dispatch_numeric_type(type, [&](auto x, const H5::PredType& ptype) -> void {
+            dtype = ptype;
+            element_size = sizeof(x);
+        });
+
+        H5::DataSpace dspace(nshape, dims.data());
+        H5::DSetCreatPropList plist;
+        chunked = (total_rows > 0 && row_size > 0);
+        if (chunked) {
+            chunk_rows = std::max(1, std::min(chunk_length, static_cast<int>(total_rows)));
+            std::vector<hsize_t> chunk_dims(dims);
+            chunk_dims[0] = chunk_rows;
+            plist.setChunk(nshape, chunk_dims.data());
+            if (level >= 0) {
+                plist.setDeflate(level);
+            }
+        }
+
+        H5::H5File handle(path, H5F_ACC_RDWR);
+        handle.createDataSet(name, dtype, dspace, plist);
+    }
+
+private:
+    std::string path, name, type;
+    int level;
+
+    std::vector<hsize_t> dims;
+    hsize_t total_rows, row_size;
+    size_t element_size = 0;
+
+    bool chunked;
+    hsize_t chunk_rows = 0;
+    hsize_t rows_written = 0; // includes rows in the pending buffer.
+    hsize_t chunks_written = 0;
+
+    // Pending rows that do not yet fill a chunk, already converted to the
+    // on-disk type and stored as raw bytes.
+    std::vector<unsigned char> pending;
+
+private:
+    template<typename Input_>
+    void fill_chunk(const Input_* input, size_t n, unsigned char* output) const {
+        dispatch_numeric_type(type, [&](auto x, const H5::PredType&) -> void {
+            typedef decltype(x) Type_;
+            auto optr = reinterpret_cast<Type_*>(output);
+            std::copy(input, input + n, optr);
+        });
+    }
+
+    // Returns false if compression failed, as we can't throw inside a worker thread.
+    bool compress_chunk(std::vector<unsigned char>& raw, std::vector<unsigned char>& compressed) const {
+        if (level < 0) {
+            compressed.swap(raw);
+            return true;
+        }
+
+        uLongf destlen = compressBound(raw.size());
+        compressed.resize(destlen);
+        if (compress2(compressed.data(), &destlen, raw.data(), raw.size(), level) != Z_OK) {
+            return false;
+        }
+        compressed.resize(destlen);
+        return true;
+    }
+
+    void write_chunks(std::vector<std::vector<unsigned char> >& compressed) {
+        H5::H5File handle(path, H5F_ACC_RDWR);
+        auto dhandle = handle.openDataSet(name);
+
+        std::vector<hsize_t> offset(dims.size());
+        for (auto& chunk : compressed) {
+            offset[0] = chunks_written * chunk_rows;
+            if (H5Dwrite_chunk(dhandle.getId(), H5P_DEFAULT, 0, offset.data(), chunk.size(), chunk.data()) < 0) {
+                throw std::runtime_error("failed to write chunk to HDF5 dataset");
+            }
+            ++chunks_written;
+        }
+    }
+
+    template<typename Input_>
+    void append_chunked(const Input_* input, size_t n, int nthreads) {
+        size_t chunk_elements = chunk_rows * row_size;
+        size_t chunk_bytes = chunk_elements * element_size;
+
+        // Topping up the pending chunk first.
+        size_t pending_elements = pending.size() / element_size;
+        size_t topup = std::min(n, chunk_elements - pending_elements);
+        if (pending_elements || topup < chunk_elements) {
+            pending.resize((pending_elements + topup) * element_size);
+            fill_chunk(input, topup, pending.data() + pending_elements * element_size);
+            input += topup;
+            n -= topup;
+        }
+
+        bool pending_full = (pending.size() == chunk_bytes);
+        size_t nfull = n / chunk_elements;
+        size_t njobs = nfull + pending_full;
+
+        // Processing complete chunks in batches, to cap the memory used by
+        // the compressed buffers.
+        size_t batch_size = std::max(1, nthreads) * 4;
+        for (size_t start = 0; start < njobs; start += batch_size) {
+            size_t end = std::min(njobs, start + batch_size);
+            std::vector<std::vector<unsigned char> > compressed(end - start);
+            std::vector<uint8_t> failed(end - start);
+
+            run_parallel_old(end - start, [&](size_t first, size_t last) -> void {
+                std::vector<unsigned char> raw;
+                for (size_t j = first; j < last; ++j) {
+                    size_t job = start + j;
+                    if (pending_full && job == 0) {
+                        raw = pending;
+                    } else {
+                        raw.resize(chunk_bytes);
+                        fill_chunk(input + (job - pending_full) * chunk_elements, chunk_elements, raw.data());
+                    }
+                    failed[j] = !compress_chunk(raw, compressed[j]);
+                }
+            }, nthreads);
+
+            if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+                throw std::runtime_error("failed to deflate chunk for HDF5 writing");
+            }
+
+            write_chunks(compressed);
+        }
+
+        if (pending_full) {
+            pending.clear();
+        }
+
+        // Stashing the remainder for the next call.
+        size_t leftover = n - nfull * chunk_elements;
+        if (leftover) {
+            pending.resize(leftover * element_size);
+            fill_chunk(input + nfull * chunk_elements, leftover, pending.data());
+        }
+    }
+
+public:
+    void append(uintptr_t data, size_t n, std::string input_type, int nthreads) {
+        if (n == 0) {
+            return;
+        }
+        if (row_size == 0 || n % row_size != 0) {
+            throw std::runtime_error("length of each slab should be a multiple of the product of the non-first dimensions");
+        }
+        hsize_t nrows = n / row_size;
+        if (rows_written + nrows > total_rows) {
+            throw std::runtime_error("appended slabs exceed the first dimension of the dataset");
+        }
+
+        dispatch_numeric_type(input_type, [&](auto x, const H5::PredType&) -> void {
+            typedef decltype(x) Input_;
+            append_chunked(reinterpret_cast<const Input_*>(data), n, nthreads);
+        });
+        rows_written += nrows;
+    }
+
+    void finish() {
+        if (rows_written != total_rows) {
+            throw std::runtime_error("number of appended rows is less than the first dimension of the dataset");
+        }
+
+        // Padding the final partial chunk, as chunks are always stored at full size.
+        if (!pending.empty()) {
+            std::vector<std::vector<unsigned char> > compressed(1);
+            pending.resize(chunk_rows * row_size * element_size);
+            if (!compress_chunk(pending, compressed[0])) {
+                throw std::runtime_error("failed to deflate chunk for HDF5 writing");
+            }
+            write_chunks(compressed);
+            pending.clear();
+        }
+    }
+
+    double num_written() const {
+        return rows_written;
+    }
+};
+
+EMSCRIPTEN_BINDINGS(hdf5_dataset_writer) {
+    emscripten::class_<Hdf5DataSetWriter>("Hdf5DataSetWriter")
+        .constructor<std::string, std::string, int, uintptr_t, std::string, int, int>()
+        .function("append", &Hdf5DataSetWriter::append)
+        .function("finish", &Hdf5DataSetWriter::finish)
+        .function("num_written", &Hdf5DataSetWriter::num_written)
+        ;
+}
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
 #include <unordered_map>
 
@@ -399,17 +400,25 @@ protected:
             }
 
         } else if (type_ == "String") {
+            // Computing all lengths first so that the contiguous buffer is
+            // allocated once, and then filled with one copy per string.
             lengths_.resize(full_length);
 
             if (dtype.isVariableStr()) {
                 std::vector<char*> buffer(full_length);
                 Reader::read(handle, buffer.data(), dtype);
 
-                str_data.reserve(full_length); // guessing that each string is of at least length 1.
+                size_t total = 0;
                 for (size_t i = 0; i < full_length; ++i) {
-                    std::string current(buffer[i]);
-                    lengths_[i] = current.size();
-                    str_data.insert(str_data.end(), current.begin(), current.end());
+                    lengths_[i] = (buffer[i] == NULL ? 0 : std::strlen(buffer[i]));
+                    total += lengths_[i];
+                }
+
+                str_data.resize(total);
+                auto dest = str_data.data();
+                for (size_t i = 0; i < full_length; ++i) {
+                    std::memcpy(dest, buffer[i], lengths_[i]);
+                    dest += lengths_[i];
                 }
 
                 H5Dvlen_reclaim(dtype.getId(), dspace.getId(), H5P_DEFAULT, buffer.data());
@@ -419,13 +428,21 @@ protected:
                 std::vector<char> buffer(len * full_length);
                 Reader::read(handle, buffer.data(), dtype);
 
-                str_data.reserve(buffer.size()); // guessing that each string is of length 'len'.
+                size_t total = 0;
                 auto start = buffer.data();
                 for (size_t i = 0; i < full_length; ++i, start += len) {
                     size_t j = 0;
                     for (; j < len && start[j] != '\0'; ++j) {}
                     lengths_[i] = j;
-                    str_data.insert(str_data.end(), start, start + j);
+                    total += j;
+                }
+
+                str_data.resize(total);
+                auto dest = str_data.data();
+                start = buffer.data();
+                for (size_t i = 0; i < full_length; ++i, start += len) {
+                    std::memcpy(dest, start, lengths_[i]);
+                    dest += lengths_[i];
                 }
             }
 
@@ -587,6 +604,11 @@ H5::DataType choose_numeric_data_type(const std::string& type) {
 }
 
 H5::DataType choose_string_data_type(int max_str_len) {
+    if (max_str_len < 0) {
+        H5::StrType stype(0, H5T_VARIABLE);
+        stype.setCset(H5T_CSET_UTF8);
+        return stype;
+    }
     return H5::StrType(0, std::max(1, max_str_len)); // Make sure that is at least of length 1.
 }
 
@@ -643,7 +665,27 @@ void write_string_hdf5_base(Handle& handle, size_t n, uintptr_t lengths, uintptr
 
     auto stype = handle.getStrType();
     if (stype.isVariableStr()) {
-        throw std::runtime_error("writing variable-length strings is not yet supported");
+        // Adding null terminators in a single contiguous copy, and pointing
+        // into it for each string.
+        size_t total = 0;
+        for (size_t i = 0; i < n; ++i) {
+            total += len_ptr[i] + 1;
+        }
+
+        std::vector<char> temp(total);
+        std::vector<const char*> pointers(n);
+        auto it = temp.data();
+        for (size_t i = 0; i < n; ++i) {
+            pointers[i] = it;
+            std::memcpy(it, buf_ptr, len_ptr[i]);
+            it += len_ptr[i];
+            *it = '\0';
+            ++it;
+            buf_ptr += len_ptr[i];
+        }
+
+        Reader::write(handle, pointers.data(), stype);
+        return;
     }
 
     int32_t max_len = stype.getSize();
@@ -0,0 +1,42 @@
+#ifndef HDF5_WRITE_UTILS_H
+#define HDF5_WRITE_UTILS_H
+
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#include "H5Cpp.h"
+
+/*
+ * Calls 'fun' with a zero of the C++ type corresponding to 'type', along with
+ * the matching native HDF5 type. 'type' should be a WasmArray class name
+ * without the 'WasmArray' suffix, e.g., "Float64" or "BigInt64".
+ */
+template<class Function_>
+void dispatch_numeric_type(const std::string& type, Function_ fun) {
+    if (type == "Uint8") {
+        fun(static_cast<uint8_t>(0), H5::PredType::NATIVE_UINT8);
+    } else if (type == "Int8") {
+        fun(static_cast<int8_t>(0), H5::PredType::NATIVE_INT8);
+    } else if (type == "Uint16") {
+        fun(static_cast<uint16_t>(0), H5::PredType::NATIVE_UINT16);
+    } else if (type == "Int16") {
+        fun(static_cast<int16_t>(0), H5::PredType::NATIVE_INT16);
+    } else if (type == "Uint32") {
+        fun(static_cast<uint32_t>(0), H5::PredType::NATIVE_UINT32);
+    } else if (type == "Int32") {
+        fun(static_cast<int32_t>(0), H5::PredType::NATIVE_INT32);
+    } else if (type == "Uint64" || type == "BigUint64") {
+        fun(static_cast<uint64_t>(0), H5::PredType::NATIVE_UINT64);
+    } else if (type == "Int64" || type == "BigInt64") {
+        fun(static_cast<int64_t>(0), H5::PredType::NATIVE_INT64);
+    } else if (type == "Float32") {
+        fun(static_cast<float>(0), H5::PredType::NATIVE_FLOAT);
+    } else if (type == "Float64") {
+        fun(static_cast<double>(0), H5::PredType::NATIVE_DOUBLE);
+    } else {
+        throw std::runtime_error("unknown supported type '" + type + "' for HDF5 writing");
+    }
+}
+
+#endif
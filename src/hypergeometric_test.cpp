@@ -6,6 +6,12 @@
 
 #include "scran/scran.hpp"
 
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+
 void hypergeometric_test(
     int ntests,
     bool multi_markers_in_set, 
@@ -91,6 +97,165 @@ void hypergeometric_test(
     return;
 }
 
+/*****************************************/
+
+/*
+ * Upper tail of the hypergeometric distribution, i.e., P(X >= x), using a
+ * table of log-factorials that is shared across all tests with the same total
+ * number of features. Each tail is summed in log-space relative to its
+ * largest term to avoid underflow for very small p-values.
+ */
+class SharedHypergeometricTail {
+public:
+    SharedHypergeometricTail(int total) : lfactorials(total + 1) {
+        for (int i = 2; i <= total; ++i) {
+            lfactorials[i] = lfactorials[i - 1] + std::log(static_cast<double>(i));
+        }
+    }
+
+private:
+    std::vector<double> lfactorials;
+
+    double lchoose(int n, int k) const {
+        return lfactorials[n] - lfactorials[k] - lfactorials[n - k];
+    }
+
+public:
+    double run(int drawn_inside, int num_inside, int num_outside, int num_drawn) const {
+        int lower = std::max(0, num_drawn - num_outside);
+        if (drawn_inside <= lower) {
+            return 1;
+        }
+
+        int upper = std::min(num_inside, num_drawn);
+        if (drawn_inside > upper) {
+            return 0;
+        }
+
+        // Terms are decreasing beyond the mode, so the first term is the
+        // largest if it lies past the mode; otherwise we need to find it.
+        double denom = lchoose(num_inside + num_outside, num_drawn);
+        auto log_pmf = [&](int i) -> double {
+            return lchoose(num_inside, i) + lchoose(num_outside, num_drawn - i) - denom;
+        };
+
+        int mode = static_cast<int>(std::floor((static_cast<double>(num_drawn) + 1) * (static_cast<double>(num_inside) + 1) / (num_inside + num_outside + 2)));
+        int largest = std::max(drawn_inside, std::min(mode, upper));
+        double max_log = log_pmf(largest);
+
+        double sum = 0;
+        for (int i = drawn_inside; i <= upper; ++i) {
+            sum += std::exp(log_pmf(i) - max_log);
+        }
+
+        return std::min(1.0, std::exp(max_log + std::log(sum)));
+    }
+};
+
+typedef uint64_t BitWord;
+
+static constexpr int bits_per_word = 64;
+
+std::vector<BitWord> fill_bitsets(int n, const int32_t* pointers, const int32_t* indices, int num_features, int nthreads) {
+    size_t nwords = (num_features + bits_per_word - 1) / bits_per_word;
+    std::vector<BitWord> bits(nwords * n);
+
+    run_parallel_old(n, [&](int first, int last) -> void {
+        for (int i = first; i < last; ++i) {
+            auto current = bits.data() + nwords * i;
+            for (int32_t j = pointers[i], end = pointers[i + 1]; j < end; ++j) {
+                auto k = indices[j];
+                current[k / bits_per_word] |= (static_cast<BitWord>(1) << (k % bits_per_word));
+            }
+        }
+    }, nthreads);
+
+    return bits;
+}
+
+// Duplicated indices are only counted once, consistent with the bitset
+// representation of the overlaps.
+std::vector<int> count_bitsets(int n, const std::vector<BitWord>& bits, size_t nwords) {
+    std::vector<int> output(n);
+    for (int i = 0; i < n; ++i) {
+        auto current = bits.data() + nwords * i;
+        int total = 0;
+        for (size_t w = 0; w < nwords; ++w) {
+            total += __builtin_popcountll(current[w]);
+        }
+        output[i] = total;
+    }
+    return output;
+}
+
+void hypergeometric_enrichment(
+    int ngroups,
+    uintptr_t marker_pointers,
+    uintptr_t marker_indices,
+    int nsets,
+    uintptr_t set_pointers,
+    uintptr_t set_indices,
+    int num_features,
+    uintptr_t output_sizes,
+    uintptr_t output_counts,
+    uintptr_t output_pvalues,
+    int nthreads)
+{
+    const int32_t* mpptr = reinterpret_cast<const int32_t*>(marker_pointers);
+    const int32_t* miptr = reinterpret_cast<const int32_t*>(marker_indices);
+    const int32_t* spptr = reinterpret_cast<const int32_t*>(set_pointers);
+    const int32_t* siptr = reinterpret_cast<const int32_t*>(set_indices);
+
+    for (int32_t i = 0, end = mpptr[ngroups]; i < end; ++i) {
+        if (miptr[i] < 0 || miptr[i] >= num_features) {
+            throw std::runtime_error("marker indices should be non-negative and less than the number of features");
+        }
+    }
+    for (int32_t i = 0, end = spptr[nsets]; i < end; ++i) {
+        if (siptr[i] < 0 || siptr[i] >= num_features) {
+            throw std::runtime_error("feature set indices should be non-negative and less than the number of features");
+        }
+    }
+
+    size_t nwords = (num_features + bits_per_word - 1) / bits_per_word;
+    auto marker_bits = fill_bitsets(ngroups, mpptr, miptr, num_features, nthreads);
+    auto set_bits = fill_bitsets(nsets, spptr, siptr, num_features, nthreads);
+
+    auto num_markers = count_bitsets(ngroups, marker_bits, nwords);
+    auto set_sizes = count_bitsets(nsets, set_bits, nwords);
+    std::copy(set_sizes.begin(), set_sizes.end(), reinterpret_cast<int32_t*>(output_sizes));
+
+    SharedHypergeometricTail hyper(num_features);
+    int32_t* cptr = reinterpret_cast<int32_t*>(output_counts);
+    double* pptr = reinterpret_cast<double*>(output_pvalues);
+    size_t ntests = static_cast<size_t>(ngroups) * static_cast<size_t>(nsets);
+
+    run_parallel_old(ntests, [&](size_t first, size_t last) -> void {
+        for (size_t i = first; i < last; ++i) {
+            size_t g = i / nsets, s = i % nsets;
+            auto gbits = marker_bits.data() + nwords * g;
+            auto sbits = set_bits.data() + nwords * s;
+
+            int overlap = 0;
+            for (size_t w = 0; w < nwords; ++w) {
+                overlap += __builtin_popcountll(gbits[w] & sbits[w]);
+            }
+            cptr[i] = overlap;
+
+            // Same interpretation as in hypergeometric_test().
+            int num_white = set_sizes[s];
+            int num_black = num_features - num_white;
+            pptr[i] = hyper.run(overlap, num_white, num_black, num_markers[g]);
+        }
+    }, nthreads);
+
+    return;
+}
+
+/*****************************************/
+
 EMSCRIPTEN_BINDINGS(hypergeometric_test) {
     emscripten::function("hypergeometric_test", &hypergeometric_test);
+
+    emscripten::function("hypergeometric_enrichment", &hypergeometric_enrichment);
 }
@@ -49,15 +49,15 @@ std::pair<size_t, size_t> fetch_array_dimensions(const Vector* obj) {
 }
 
 template<typename T, class Vector>
-NumericMatrix convert_ordinary_array_to_sparse_matrix(const Vector* obj, bool layered) {
+NumericMatrix convert_ordinary_array_to_sparse_matrix(const Vector* obj, bool layered, int nthreads) {
     auto dims = fetch_array_dimensions(obj);
     tatami::ArrayView view(obj->data.data(), obj->data.size());
     tatami::DenseColumnMatrix<T, int, decltype(view)> raw(dims.first, dims.second, std::move(view));
-    return sparse_from_tatami(&raw, layered);
+    return sparse_from_tatami(&raw, layered, nthreads);
 }
 
 template<typename T>
-NumericMatrix convert_dgCMatrix_to_sparse_matrix(rds2cpp::S4Object* obj, bool layered) {
+NumericMatrix convert_dgCMatrix_to_sparse_matrix(rds2cpp::S4Object* obj, bool layered, int nthreads) {
     std::unordered_map<std::string, rds2cpp::RObject*> by_name;
     size_t nattr = obj->attributes.names.size();
     for (size_t a = 0; a < nattr; ++a) {
@@ -104,11 +104,11 @@ NumericMatrix convert_dgCMatrix_to_sparse_matrix(rds2cpp::S4Object* obj, bool la
     tatami::ArrayView iview(i.data(), i.size());
     tatami::ArrayView pview(p.data(), p.size());
     tatami::CompressedSparseColumnMatrix<T, int, decltype(xview), decltype(iview), decltype(pview)> mat(dims.first, dims.second, std::move(xview), std::move(iview), std::move(pview));
-    return sparse_from_tatami(&mat, layered);
+    return sparse_from_tatami(&mat, layered, nthreads);
 }
 
 template<typename T>
-NumericMatrix convert_dgTMatrix_to_sparse_matrix(rds2cpp::S4Object* obj, bool layered) {
+NumericMatrix convert_dgTMatrix_to_sparse_matrix(rds2cpp::S4Object* obj, bool layered, int nthreads) {
     std::unordered_map<std::string, rds2cpp::RObject*> by_name;
     size_t nattr = obj->attributes.names.size();
     for (size_t a = 0; a < nattr; ++a) {
@@ -164,24 +164,24 @@ NumericMatrix convert_dgTMatrix_to_sparse_matrix(rds2cpp::S4Object* obj, bool la
     auto p = tatami::compress_sparse_triplets<false>(dims.first, dims.second, xcopy, icopy, jcopy);
     mptr.reset(new Matrix(dims.first, dims.second, std::move(xcopy), std::move(icopy), std::move(p)));
 
-    return sparse_from_tatami(mptr.get(), layered);
+    return sparse_from_tatami(mptr.get(), layered, nthreads);
 }
 
-NumericMatrix initialize_sparse_matrix_from_rds(uintptr_t ptr, bool force_integer, bool layered) {
+NumericMatrix initialize_sparse_matrix_from_rds(uintptr_t ptr, bool force_integer, bool layered, int nthreads) {
     RdsObject* wrapper = reinterpret_cast<RdsObject*>(ptr);
     auto obj = wrapper->ptr;
 
     if (obj->type() == rds2cpp::SEXPType::INT) {
         auto ivec = static_cast<const rds2cpp::IntegerVector*>(obj);
-        return convert_ordinary_array_to_sparse_matrix<int>(ivec, layered);
+        return convert_ordinary_array_to_sparse_matrix<int>(ivec, layered, nthreads);
     }
 
     if (obj->type() == rds2cpp::SEXPType::REAL) {
         auto dvec = static_cast<const rds2cpp::DoubleVector*>(obj);
         if (force_integer) {
-            return convert_ordinary_array_to_sparse_matrix<int>(dvec, layered);
+            return convert_ordinary_array_to_sparse_matrix<int>(dvec, layered, nthreads);
         } else {
-            return convert_ordinary_array_to_sparse_matrix<double>(dvec, false);
+            return convert_ordinary_array_to_sparse_matrix<double>(dvec, false, nthreads);
         }
     }
 
@@ -192,9 +192,9 @@ NumericMatrix initialize_sparse_matrix_from_rds(uintptr_t ptr, bool force_intege
     auto s4 = static_cast<rds2cpp::S4Object*>(const_cast<rds2cpp::RObject*>(obj));
     if (s4->class_name == "dgCMatrix") {
         if (force_integer) {
-            return convert_dgCMatrix_to_sparse_matrix<int>(s4, layered);
+            return convert_dgCMatrix_to_sparse_matrix<int>(s4, layered, nthreads);
         } else {
-            return convert_dgCMatrix_to_sparse_matrix<double>(s4, false);
+            return convert_dgCMatrix_to_sparse_matrix<double>(s4, false, nthreads);
         }
     }
 
@@ -202,9 +202,9 @@ NumericMatrix initialize_sparse_matrix_from_rds(uintptr_t ptr, bool force_intege
         throw std::runtime_error("S4 object in an RDS file must be a dgTMatrix");
     }
     if (force_integer) {
-        return convert_dgTMatrix_to_sparse_matrix<int>(s4, layered); 
+        return convert_dgTMatrix_to_sparse_matrix<int>(s4, layered, nthreads); 
     } else {
-        return convert_dgTMatrix_to_sparse_matrix<double>(s4, false);
+        return convert_dgTMatrix_to_sparse_matrix<double>(s4, false, nthreads);
     }
 }
 
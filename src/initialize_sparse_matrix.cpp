@@ -49,17 +49,17 @@ bool is_type_integer(const std::string& type) {
 /**********************************/
 
 template<typename T>
-NumericMatrix initialize_sparse_matrix_from_dense_vector_internal(size_t nrows, size_t ncols, uintptr_t values, const std::string& type, bool layered) {
+NumericMatrix initialize_sparse_matrix_from_dense_vector_internal(size_t nrows, size_t ncols, uintptr_t values, const std::string& type, bool layered, int nthreads) {
     auto vals = create_SomeNumericArray<T>(values, nrows*ncols, type);
     tatami::DenseColumnMatrix<T, int, decltype(vals)> mat(nrows, ncols, vals);
-    return sparse_from_tatami(&mat, layered);
+    return sparse_from_tatami(&mat, layered, nthreads);
 }
 
-NumericMatrix initialize_sparse_matrix_from_dense_vector(size_t nrows, size_t ncols, uintptr_t values, std::string type, bool force_integer, bool layered) {
+NumericMatrix initialize_sparse_matrix_from_dense_vector(size_t nrows, size_t ncols, uintptr_t values, std::string type, bool force_integer, bool layered, int nthreads) {
     if (force_integer || is_type_integer(type)) {
-        return initialize_sparse_matrix_from_dense_vector_internal<int>(nrows, ncols, values, type, layered);
+        return initialize_sparse_matrix_from_dense_vector_internal<int>(nrows, ncols, values, type, layered, nthreads);
     } else {
-        return initialize_sparse_matrix_from_dense_vector_internal<double>(nrows, ncols, values, type, false);
+        return initialize_sparse_matrix_from_dense_vector_internal<double>(nrows, ncols, values, type, false, nthreads);
     }
 }
 
@@ -70,7 +70,7 @@ NumericMatrix initialize_sparse_matrix_internal(size_t nrows, size_t ncols, size
     uintptr_t values, const std::string& value_type,
     uintptr_t indices, const std::string& index_type,
     uintptr_t indptrs, const std::string& indptr_type,
-    bool by_row, bool layered)
+    bool by_row, bool layered, int nthreads)
 {
     auto val = create_SomeNumericArray<T>(values, nelements, value_type);
     auto idx = create_SomeNumericArray<int>(indices, nelements, index_type);
@@ -88,7 +88,7 @@ NumericMatrix initialize_sparse_matrix_internal(size_t nrows, size_t ncols, size
             auto ind = create_SomeNumericArray<size_t>(indptrs, ncols + 1, indptr_type);
             mat.reset(new tatami::CompressedSparseColumnMatrix<T, int, decltype(val), decltype(idx), decltype(ind)>(nrows, ncols, val, idx, ind));
         }
-        return sparse_from_tatami(mat.get(), layered);
+        return sparse_from_tatami(mat.get(), layered, nthreads);
     }
 }
 
@@ -96,12 +96,12 @@ NumericMatrix initialize_sparse_matrix(size_t nrows, size_t ncols, size_t neleme
     uintptr_t values, std::string value_type,
     uintptr_t indices, std::string index_type,
     uintptr_t indptrs, std::string indptr_type,
-    bool by_row, bool force_integer, bool layered)
+    bool by_row, bool force_integer, bool layered, int nthreads)
 {
     if (force_integer || is_type_integer(value_type)) {
-        return initialize_sparse_matrix_internal<int>(nrows, ncols, nelements, values, value_type, indices, index_type, indptrs, indptr_type, by_row, layered);
+        return initialize_sparse_matrix_internal<int>(nrows, ncols, nelements, values, value_type, indices, index_type, indptrs, indptr_type, by_row, layered, nthreads);
     } else {
-        return initialize_sparse_matrix_internal<double>(nrows, ncols, nelements, values, value_type, indices, index_type, indptrs, indptr_type, by_row, false);
+        return initialize_sparse_matrix_internal<double>(nrows, ncols, nelements, values, value_type, indices, index_type, indptrs, indptr_type, by_row, false, nthreads);
     }
 }
 
@@ -0,0 +1,424 @@
+#ifndef LAYERED_UTILS_H
+#define LAYERED_UTILS_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "parallel.h"
+
+#include "tatami/tatami.hpp"
+
+/*
+ * Multi-threaded conversion of any tatami::Matrix into a compressed sparse
+ * representation. Each row is assigned to a "layer" based on its maximum
+ * value, so that small counts are stored in the smallest possible unsigned
+ * integer type. As in tatami_layered, the columns are split into chunks of
+ * 65536 so that the column indices can be stored as 16-bit integers. Each
+ * layer of each chunk is a CSR matrix; the layers are combined by row, the
+ * chunks are combined by column, and the result is subsetted to restore the
+ * original row order.
+ *
+ * The conversion involves two passes over the matrix:
+ *
+ * 1. Compute the maximum value and the number of non-zero entries in each
+ *    row, for each "segment" of contiguous columns.
+ * 2. Allocate all arrays once and fill them, where each segment writes to
+ *    its own pre-computed positions in each row.
+ *
+ * For matrices that prefer row access, each thread processes a range of
+ * rows and the segments are just the chunks. As the rows are disjoint, the
+ * row maxima and the per-chunk counts can be written directly without any
+ * per-thread copies. For matrices that prefer column access, each segment is
+ * the intersection of a chunk with a thread's range of columns, and the
+ * maxima and counts are stored separately for each segment.
+ *
+ * If any value is negative, non-integer or too large for a 32-bit unsigned
+ * integer, all rows are stored in a single layer of double-precision values.
+ */
+
+enum class SparseLayer : uint8_t { U8, U16, U32, F64 };
+
+template<typename Value_, typename Index_>
+struct LayeredSparseBuilder {
+    LayeredSparseBuilder(const tatami::Matrix<Value_, Index_>* m, bool l, int n) : mat(m), layered(l), nthreads(n), NR(m->nrow()), NC(m->ncol()) {
+        nchunks = std::max(static_cast<size_t>(1), (NC + chunk_size - 1) / chunk_size);
+    }
+
+private:
+    static constexpr size_t chunk_size = static_cast<size_t>(std::numeric_limits<uint16_t>::max()) + 1;
+
+    const tatami::Matrix<Value_, Index_>* mat;
+    bool layered;
+    int nthreads;
+    size_t NR, NC, nchunks;
+
+    struct Segment {
+        size_t start, end, chunk;
+    };
+    std::vector<Segment> segments;
+
+    std::vector<SparseLayer> row_layer;
+    std::vector<int> row_position; // position of each row in its layer.
+    std::vector<std::vector<size_t> > segment_offsets; // for each segment, the count and then the start of its entries in each row.
+    std::vector<std::vector<std::vector<size_t> > > layer_pointers; // for each chunk and layer, the CSR pointers.
+
+    void define_segments(bool by_row) {
+        if (by_row) {
+            for (size_t k = 0; k < nchunks; ++k) {
+                segments.push_back(Segment{ k * chunk_size, std::min(NC, (k + 1) * chunk_size), k });
+            }
+            return;
+        }
+
+        size_t per_thread = (NC + nthreads - 1) / nthreads;
+        size_t start = 0;
+        while (start < NC) {
+            size_t chunk = start / chunk_size;
+            size_t end = std::min(NC, std::min((start / per_thread + 1) * per_thread, (chunk + 1) * chunk_size));
+            segments.push_back(Segment{ start, end, chunk });
+            start = end;
+        }
+    }
+
+    template<class Function_>
+    void loop_over_rows(Function_ fun) {
+        run_parallel_new([&](int t, Index_ start, Index_ length) -> void {
+            auto ext = mat->sparse_row();
+            std::vector<Value_> vbuffer(NC);
+            std::vector<Index_> ibuffer(NC);
+            for (Index_ r = start, end = start + length; r < end; ++r) {
+                auto range = ext->fetch(r, vbuffer.data(), ibuffer.data());
+                fun(t, r, range);
+            }
+        }, static_cast<Index_>(NR), nthreads);
+    }
+
+    template<class Function_>
+    void loop_over_segments(Function_ fun) {
+        run_parallel_old(segments.size(), [&](size_t first, size_t last) -> void {
+            auto ext = mat->sparse_column();
+            std::vector<Value_> vbuffer(NR);
+            std::vector<Index_> ibuffer(NR);
+            for (size_t s = first; s < last; ++s) {
+                const auto& seg = segments[s];
+                for (Index_ c = seg.start, end = seg.end; c < end; ++c) {
+                    auto range = ext->fetch(c, vbuffer.data(), ibuffer.data());
+                    fun(s, c, range);
+                }
+            }
+        }, nthreads);
+    }
+
+    static bool is_invalid(Value_ val) {
+        return val < 0 || val != std::floor(val);
+    }
+
+    void count(bool by_row) {
+        segment_offsets.resize(segments.size());
+        for (auto& counts : segment_offsets) {
+            counts.resize(NR);
+        }
+
+        std::vector<Value_> row_max(NR);
+        bool any_invalid = false;
+
+        if (by_row) {
+            std::vector<uint8_t> thread_invalid(nthreads);
+            loop_over_rows([&](int t, Index_ r, const auto& range) -> void {
+                auto& curmax = row_max[r];
+                for (Index_ k = 0; k < range.number; ++k) {
+                    auto val = range.value[k];
+                    if (val == 0) {
+                        continue;
+                    }
+
+                    ++segment_offsets[range.index[k] / chunk_size][r];
+                    if (val > curmax) {
+                        curmax = val;
+                    }
+                    if (is_invalid(val)) {
+                        thread_invalid[t] = 1;
+                    }
+                }
+            });
+            any_invalid = std::find(thread_invalid.begin(), thread_invalid.end(), 1) != thread_invalid.end();
+
+        } else {
+            std::vector<std::vector<Value_> > segment_max(segments.size(), std::vector<Value_>(NR));
+            std::vector<uint8_t> segment_invalid(segments.size());
+            loop_over_segments([&](size_t s, Index_, const auto& range) -> void {
+                auto& curmax = segment_max[s];
+                auto& curcount = segment_offsets[s];
+                for (Index_ k = 0; k < range.number; ++k) {
+                    auto val = range.value[k];
+                    if (val == 0) {
+                        continue;
+                    }
+
+                    auto r = range.index[k];
+                    ++curcount[r];
+                    if (val > curmax[r]) {
+                        curmax[r] = val;
+                    }
+                    if (is_invalid(val)) {
+                        segment_invalid[s] = 1;
+                    }
+                }
+            });
+            any_invalid = std::find(segment_invalid.begin(), segment_invalid.end(), 1) != segment_invalid.end();
+
+            for (const auto& curmax : segment_max) {
+                for (size_t r = 0; r < NR; ++r) {
+                    row_max[r] = std::max(row_max[r], curmax[r]);
+                }
+            }
+        }
+
+        bool use_layers = layered && !any_invalid;
+        row_layer.resize(NR);
+        row_position.resize(NR);
+        std::vector<int> layer_sizes(4);
+
+        for (size_t r = 0; r < NR; ++r) {
+            SparseLayer chosen = SparseLayer::F64;
+            if (use_layers) {
+                auto rmax = row_max[r];
+                if (rmax <= std::numeric_limits<uint8_t>::max()) {
+                    chosen = SparseLayer::U8;
+                } else if (rmax <= std::numeric_limits<uint16_t>::max()) {
+                    chosen = SparseLayer::U16;
+                } else if (rmax <= std::numeric_limits<uint32_t>::max()) {
+                    chosen = SparseLayer::U32;
+                }
+            }
+
+            auto& lsize = layer_sizes[static_cast<int>(chosen)];
+            row_layer[r] = chosen;
+            row_position[r] = lsize;
+            ++lsize;
+        }
+
+        // Computing the pointers for each layer of each chunk, and the start
+        // position of each segment's entries within each row. Segments are
+        // ordered by column, so the entries in each row remain sorted.
+        layer_pointers.resize(nchunks);
+        for (auto& chunk_pointers : layer_pointers) {
+            chunk_pointers.resize(4);
+            for (int l = 0; l < 4; ++l) {
+                chunk_pointers[l].resize(layer_sizes[l] + 1);
+            }
+        }
+
+        for (size_t s = 0, nseg = segments.size(); s < nseg; ++s) {
+            auto& chunk_pointers = layer_pointers[segments[s].chunk];
+            const auto& counts = segment_offsets[s];
+            for (size_t r = 0; r < NR; ++r) {
+                chunk_pointers[static_cast<int>(row_layer[r])][row_position[r] + 1] += counts[r];
+            }
+        }
+        for (auto& chunk_pointers : layer_pointers) {
+            for (auto& ptrs : chunk_pointers) {
+                for (size_t i = 1; i < ptrs.size(); ++i) {
+                    ptrs[i] += ptrs[i - 1];
+                }
+            }
+        }
+
+        for (size_t r = 0; r < NR; ++r) {
+            int l = static_cast<int>(row_layer[r]);
+            size_t sofar = 0;
+            for (size_t s = 0, nseg = segments.size(); s < nseg; ++s) {
+                auto chunk = segments[s].chunk;
+                if (s == 0 || chunk != segments[s - 1].chunk) {
+                    sofar = layer_pointers[chunk][l][row_position[r]];
+                }
+                auto& current = segment_offsets[s][r];
+                auto n = current;
+                current = sofar;
+                sofar += n;
+            }
+        }
+    }
+
+    template<typename Stored_>
+    struct LayerStore {
+        std::vector<Stored_> values;
+        std::vector<uint16_t> indices;
+
+        void allocate(size_t n) {
+            values.resize(n);
+            indices.resize(n);
+        }
+
+        void set(size_t pos, double val, uint16_t c) {
+            values[pos] = val;
+            indices[pos] = c;
+        }
+
+        std::shared_ptr<const tatami::NumericMatrix> create(size_t ncols, std::vector<size_t>& ptrs) {
+            size_t nrows = ptrs.size() - 1;
+            return std::shared_ptr<const tatami::NumericMatrix>(
+                new tatami::CompressedSparseRowMatrix<double, int, std::vector<Stored_>, std::vector<uint16_t>, std::vector<size_t> >(
+                    nrows, ncols, std::move(values), std::move(indices), std::move(ptrs)
+                )
+            );
+        }
+    };
+
+    struct ChunkStore {
+        LayerStore<uint8_t> store8;
+        LayerStore<uint16_t> store16;
+        LayerStore<uint32_t> store32;
+        LayerStore<double> store64;
+
+        void set(SparseLayer layer, size_t pos, double val, uint16_t c) {
+            switch (layer) {
+                case SparseLayer::U8:
+                    store8.set(pos, val, c);
+                    break;
+                case SparseLayer::U16:
+                    store16.set(pos, val, c);
+                    break;
+                case SparseLayer::U32:
+                    store32.set(pos, val, c);
+                    break;
+                default:
+                    store64.set(pos, val, c);
+            }
+        }
+    };
+
+public:
+    std::shared_ptr<const tatami::NumericMatrix> run() {
+        bool by_row = mat->prefer_rows();
+        define_segments(by_row);
+        count(by_row);
+
+        std::vector<ChunkStore> stores(nchunks);
+        for (size_t k = 0; k < nchunks; ++k) {
+            const auto& chunk_pointers = layer_pointers[k];
+            auto& current = stores[k];
+            current.store8.allocate(chunk_pointers[0].back());
+            current.store16.allocate(chunk_pointers[1].back());
+            current.store32.allocate(chunk_pointers[2].back());
+            current.store64.allocate(chunk_pointers[3].back());
+        }
+
+        if (by_row) {
+            loop_over_rows([&](int, Index_ r, const auto& range) -> void {
+                auto layer = row_layer[r];
+                for (Index_ k = 0; k < range.number; ++k) {
+                    auto val = range.value[k];
+                    if (val == 0) {
+                        continue;
+                    }
+
+                    size_t c = range.index[k];
+                    size_t chunk = c / chunk_size;
+                    auto& pos = segment_offsets[chunk][r];
+                    stores[chunk].set(layer, pos, val, c - chunk * chunk_size);
+                    ++pos;
+                }
+            });
+
+        } else {
+            loop_over_segments([&](size_t s, Index_ c, const auto& range) -> void {
+                auto& offsets = segment_offsets[s];
+                auto chunk = segments[s].chunk;
+                auto& current = stores[chunk];
+                uint16_t local = c - chunk * chunk_size;
+                for (Index_ k = 0; k < range.number; ++k) {
+                    auto val = range.value[k];
+                    if (val == 0) {
+                        continue;
+                    }
+
+                    auto r = range.index[k];
+                    auto& pos = offsets[r];
+                    current.set(row_layer[r], pos, val, local);
+                    ++pos;
+                }
+            });
+        }
+
+        std::vector<std::vector<size_t> >().swap(segment_offsets);
+
+        std::vector<int> layer_offsets(4);
+        int sofar = 0, nlayers = 0;
+        for (int l = 0; l < 4; ++l) {
+            layer_offsets[l] = sofar;
+            auto nrows = layer_pointers.front()[l].size() - 1;
+            sofar += nrows;
+            nlayers += (nrows > 0);
+        }
+
+        std::vector<std::shared_ptr<const tatami::NumericMatrix> > by_chunk;
+        by_chunk.reserve(nchunks);
+        for (size_t k = 0; k < nchunks; ++k) {
+            size_t ncols = (k + 1 < nchunks ? chunk_size : NC - k * chunk_size);
+            auto& current = stores[k];
+
+            std::vector<std::shared_ptr<const tatami::NumericMatrix> > collected;
+            for (int l = 0; l < 4; ++l) {
+                auto& ptrs = layer_pointers[k][l];
+                if (ptrs.size() == 1) {
+                    continue;
+                }
+
+                switch (static_cast<SparseLayer>(l)) {
+                    case SparseLayer::U8:
+                        collected.push_back(current.store8.create(ncols, ptrs));
+                        break;
+                    case SparseLayer::U16:
+                        collected.push_back(current.store16.create(ncols, ptrs));
+                        break;
+                    case SparseLayer::U32:
+                        collected.push_back(current.store32.create(ncols, ptrs));
+                        break;
+                    default:
+                        collected.push_back(current.store64.create(ncols, ptrs));
+                }
+            }
+
+            if (collected.empty()) {
+                std::vector<size_t> empty(NR + 1);
+                LayerStore<uint8_t> store;
+                by_chunk.push_back(store.create(ncols, empty));
+            } else if (collected.size() == 1) {
+                by_chunk.push_back(std::move(collected.front()));
+            } else {
+                by_chunk.push_back(tatami::make_DelayedBind<0>(std::move(collected)));
+            }
+        }
+
+        std::shared_ptr<const tatami::NumericMatrix> combined;
+        if (by_chunk.size() == 1) {
+            combined = std::move(by_chunk.front());
+        } else {
+            combined = tatami::make_DelayedBind<1>(std::move(by_chunk));
+        }
+
+        if (nlayers <= 1) {
+            // All rows are in the same layer and so are already in order.
+            return combined;
+        }
+
+        std::vector<int> reorder(NR);
+        for (size_t r = 0; r < NR; ++r) {
+            reorder[r] = layer_offsets[static_cast<int>(row_layer[r])] + row_position[r];
+        }
+        return tatami::make_DelayedSubset<0>(std::move(combined), std::move(reorder));
+    }
+};
+
+template<typename Value_, typename Index_>
+std::shared_ptr<const tatami::NumericMatrix> convert_to_layered_sparse_parallel(const tatami::Matrix<Value_, Index_>* mat, bool layered, int nthreads) {
+    LayeredSparseBuilder<Value_, Index_> builder(mat, layered, nthreads);
+    return builder.run();
+}
+
+#endif
@@ -29,11 +29,21 @@ NumericMatrix log_norm_counts(const NumericMatrix& mat,
         sf = tatami::column_sums(mat.ptr.get());
     }
 
+    Fingerprint fingerprint(mat.fingerprint);
+    fingerprint.add_string("log_norm_counts").add_scalar<uint8_t>(center).add_scalar<uint8_t>(allow_zero).add_array(sf.data(), sf.size());
     if (use_blocks) {
-        return NumericMatrix(norm.run_blocked(mat.ptr, std::move(sf), reinterpret_cast<const int32_t*>(blocks)));
+        fingerprint.add_array(reinterpret_cast<const int32_t*>(blocks), mat.ncol());
+    }
+
+    NumericMatrix output;
+    if (use_blocks) {
+        output = NumericMatrix(norm.run_blocked(mat.ptr, std::move(sf), reinterpret_cast<const int32_t*>(blocks)));
     } else {
-        return NumericMatrix(norm.run(mat.ptr, std::move(sf)));
+        output = NumericMatrix(norm.run(mat.ptr, std::move(sf)));
     }
+    output.fingerprint = fingerprint.value();
+    output.memoizable = mat.memoizable;
+    return output;
 }
 
 void center_size_factors(size_t n, uintptr_t ptr, bool use_blocks, uintptr_t blocks) {
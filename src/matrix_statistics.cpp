@@ -0,0 +1,243 @@
+#include <emscripten/bind.h>
+
+#include "NumericMatrix.h"
+#include "parallel.h"
+#include "utils.h"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+/*
+ * One-pass summary statistics for each row (or column) of a NumericMatrix,
+ * optionally split by a grouping factor along the other dimension. All
+ * requested statistics are computed from running accumulators that are
+ * updated in a single traversal along the matrix's preferred dimension:
+ *
+ * - If this is the margin of interest, each slice contains all values for
+ *   one row/column and is processed by a single worker.
+ * - Otherwise, each worker extracts a contiguous block of the margin from
+ *   every slice, so that no two workers update the same accumulator.
+ *
+ * Either way, each accumulator sees its values in the same order regardless
+ * of the number of threads. For sparse matrices, only the structural
+ * non-zeros are visited; the remaining zeros are folded into the running
+ * mean and variance at the end, using the group sizes.
+ */
+
+namespace {
+
+enum class Statistic : int32_t {
+    SUM = 0,
+    MEAN = 1,
+    VARIANCE = 2,
+    DETECTED = 3,
+    PROPORTION = 4,
+    MIN = 5,
+    MAX = 6
+};
+
+struct Accumulators {
+    Accumulators(size_t n, bool moments, bool extremes, bool detected) : count(n), sum(n) {
+        if (moments) {
+            mean.resize(n);
+            m2.resize(n);
+        }
+        if (extremes) {
+            min.resize(n, std::numeric_limits<double>::infinity());
+            max.resize(n, -std::numeric_limits<double>::infinity());
+        }
+        if (detected) {
+            nonzero.resize(n);
+        }
+    }
+
+    std::vector<double> count, sum, mean, m2, min, max, nonzero;
+
+    void add(size_t i, double val) {
+        ++count[i];
+        sum[i] += val;
+        if (!mean.empty()) {
+            double delta = val - mean[i];
+            mean[i] += delta / count[i];
+            m2[i] += delta * (val - mean[i]);
+        }
+        if (!min.empty()) {
+            min[i] = std::min(min[i], val);
+            max[i] = std::max(max[i], val);
+        }
+        if (!nonzero.empty()) {
+            nonzero[i] += (val != 0);
+        }
+    }
+
+    // Folds the unvisited zeros into the running statistics, given the total
+    // number of observations 'n' for entry 'i'.
+    void finalize(size_t i, double n) {
+        double visited = count[i];
+        double zeros = n - visited;
+        if (zeros <= 0) {
+            return;
+        }
+
+        if (!mean.empty()) {
+            double delta = -mean[i];
+            m2[i] += delta * delta * visited * zeros / n;
+            mean[i] = sum[i] / n;
+        }
+        if (!min.empty()) {
+            min[i] = std::min(min[i], 0.0);
+            max[i] = std::max(max[i], 0.0);
+        }
+        count[i] = n;
+    }
+};
+
+}
+
+void compute_matrix_statistics(const NumericMatrix& mat, bool by_row, int nstats, uintptr_t statistics, uintptr_t outputs, bool use_groups, uintptr_t groups, int ngroups, int nthreads) {
+    const auto& ptr = mat.ptr;
+    int NR = ptr->nrow(), NC = ptr->ncol();
+    int nmargin = (by_row ? NR : NC);
+    int nother = (by_row ? NC : NR);
+
+    auto stat_ptr = reinterpret_cast<const int32_t*>(statistics);
+    auto out_ptrs = convert_array_of_offsets<double*>(nstats, outputs);
+    bool moments = false, extremes = false, detected = false;
+    for (int s = 0; s < nstats; ++s) {
+        switch (static_cast<Statistic>(stat_ptr[s])) {
+            case Statistic::SUM:
+                break;
+            case Statistic::MEAN: case Statistic::VARIANCE:
+                moments = true;
+                break;
+            case Statistic::DETECTED: case Statistic::PROPORTION:
+                detected = true;
+                break;
+            case Statistic::MIN: case Statistic::MAX:
+                extremes = true;
+                break;
+            default:
+                throw std::runtime_error("unknown statistic code " + std::to_string(stat_ptr[s]));
+        }
+    }
+
+    const int32_t* gptr = NULL;
+    if (use_groups) {
+        gptr = reinterpret_cast<const int32_t*>(groups);
+    } else {
+        ngroups = 1;
+    }
+
+    std::vector<double> group_sizes(ngroups);
+    for (int j = 0; j < nother; ++j) {
+        int g = (gptr ? gptr[j] : 0);
+        if (g < 0 || g >= ngroups) {
+            throw std::runtime_error("group assignments should be non-negative and less than the number of groups");
+        }
+        ++group_sizes[g];
+    }
+
+    // Accumulators are stored as (margin, group) in column-major format.
+    size_t total = static_cast<size_t>(nmargin) * ngroups;
+    Accumulators acc(total, moments, extremes, detected);
+    bool sparse = ptr->sparse();
+
+    if (ptr->prefer_rows() == by_row) {
+        run_parallel_new([&](int, int start, int length) -> void {
+            std::vector<double> vbuffer(nother);
+            if (sparse) {
+                std::vector<int> ibuffer(nother);
+                auto ext = (by_row ? ptr->sparse_row() : ptr->sparse_column());
+                for (int i = start, end = start + length; i < end; ++i) {
+                    auto range = ext->fetch(i, vbuffer.data(), ibuffer.data());
+                    for (int k = 0; k < range.number; ++k) {
+                        int g = (gptr ? gptr[range.index[k]] : 0);
+                        acc.add(i + static_cast<size_t>(g) * nmargin, range.value[k]);
+                    }
+                }
+            } else {
+                auto ext = (by_row ? ptr->dense_row() : ptr->dense_column());
+                for (int i = start, end = start + length; i < end; ++i) {
+                    auto values = ext->fetch(i, vbuffer.data());
+                    for (int j = 0; j < nother; ++j) {
+                        int g = (gptr ? gptr[j] : 0);
+                        acc.add(i + static_cast<size_t>(g) * nmargin, values[j]);
+                    }
+                }
+            }
+        }, nmargin, nthreads);
+
+    } else {
+        run_parallel_new([&](int, int start, int length) -> void {
+            std::vector<double> vbuffer(length);
+            if (sparse) {
+                std::vector<int> ibuffer(length);
+                auto ext = (by_row ? ptr->sparse_column(start, length) : ptr->sparse_row(start, length));
+                for (int j = 0; j < nother; ++j) {
+                    auto range = ext->fetch(j, vbuffer.data(), ibuffer.data());
+                    size_t offset = static_cast<size_t>(gptr ? gptr[j] : 0) * nmargin;
+                    for (int k = 0; k < range.number; ++k) {
+                        acc.add(range.index[k] + offset, range.value[k]);
+                    }
+                }
+            } else {
+                auto ext = (by_row ? ptr->dense_column(start, length) : ptr->dense_row(start, length));
+                for (int j = 0; j < nother; ++j) {
+                    auto values = ext->fetch(j, vbuffer.data());
+                    size_t offset = static_cast<size_t>(gptr ? gptr[j] : 0) * nmargin;
+                    for (int k = 0; k < length; ++k) {
+                        acc.add(start + k + offset, values[k]);
+                    }
+                }
+            }
+        }, nmargin, nthreads);
+    }
+
+    // Finalizing and reporting each statistic.
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (int g = 0; g < ngroups; ++g) {
+        double n = group_sizes[g];
+        for (int i = 0; i < nmargin; ++i) {
+            size_t idx = i + static_cast<size_t>(g) * nmargin;
+            acc.finalize(idx, n);
+
+            for (int s = 0; s < nstats; ++s) {
+                double& out = out_ptrs[s][idx];
+                switch (static_cast<Statistic>(stat_ptr[s])) {
+                    case Statistic::SUM:
+                        out = acc.sum[idx];
+                        break;
+                    case Statistic::MEAN:
+                        out = (n > 0 ? acc.mean[idx] : nan);
+                        break;
+                    case Statistic::VARIANCE:
+                        out = (n > 1 ? acc.m2[idx] / (n - 1) : nan);
+                        break;
+                    case Statistic::DETECTED:
+                        out = acc.nonzero[idx];
+                        break;
+                    case Statistic::PROPORTION:
+                        out = (n > 0 ? acc.nonzero[idx] / n : nan);
+                        break;
+                    case Statistic::MIN:
+                        out = (n > 0 ? acc.min[idx] : nan);
+                        break;
+                    case Statistic::MAX:
+                        out = (n > 0 ? acc.max[idx] : nan);
+                        break;
+                }
+            }
+        }
+    }
+
+    return;
+}
+
+EMSCRIPTEN_BINDINGS(matrix_statistics) {
+    emscripten::function("compute_matrix_statistics", &compute_matrix_statistics);
+}
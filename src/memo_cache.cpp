@@ -0,0 +1,42 @@
+#include <emscripten/bind.h>
+
+#include "memo_cache.h"
+
+MemoCache& memo_cache() {
+    static MemoCache cache;
+    return cache;
+}
+
+void set_memo_cache_budget(double bytes) {
+    memo_cache().set_budget(bytes > 0 ? static_cast<size_t>(bytes) : 0);
+}
+
+void clear_memo_cache() {
+    memo_cache().clear();
+}
+
+void reset_memo_cache_statistics() {
+    memo_cache().reset_statistics();
+}
+
+// Stored in 'output' as (budget, memory used, entries, hits, misses, evictions).
+void memo_cache_statistics(uintptr_t output) {
+    const auto& cache = memo_cache();
+    auto optr = reinterpret_cast<double*>(output);
+    optr[0] = cache.get_budget();
+    optr[1] = cache.memory_used();
+    optr[2] = cache.num_entries();
+    optr[3] = cache.hits;
+    optr[4] = cache.misses;
+    optr[5] = cache.evictions;
+}
+
+EMSCRIPTEN_BINDINGS(memo_cache) {
+    emscripten::function("set_memo_cache_budget", &set_memo_cache_budget);
+
+    emscripten::function("clear_memo_cache", &clear_memo_cache);
+
+    emscripten::function("reset_memo_cache_statistics", &reset_memo_cache_statistics);
+
+    emscripten::function("memo_cache_statistics", &memo_cache_statistics);
+}
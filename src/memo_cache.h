@@ -0,0 +1,128 @@
+#ifndef MEMO_CACHE_H
+#define MEMO_CACHE_H
+
+#include <list>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+
+/*
+ * Memoization cache for expensive bindings, keyed by a fingerprint of the
+ * input matrix, input buffers and parameters (see fingerprint.h). Results are
+ * stored as shared pointers and each lookup returns a copy, as the caller
+ * (i.e., the JS wrapper) takes ownership of its result and may free it.
+ *
+ * Entries are evicted in least-recently-used order once the total size
+ * exceeds the memory budget. The budget is zero by default, in which case
+ * nothing is cached and the cache is a no-op; applications should opt in by
+ * setting a budget that is appropriate for the available Wasm heap.
+ *
+ * The cache is only accessed from the main thread, outside of any parallel
+ * sections, so no locking is required.
+ */
+
+class MemoCache {
+private:
+    struct Entry {
+        uint64_t key;
+        std::shared_ptr<const void> value;
+        size_t size;
+    };
+
+    std::list<Entry> entries; // most recently used at the front.
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+
+    size_t budget = 0;
+    size_t used = 0;
+
+public:
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+
+private:
+    void evict(size_t limit) {
+        while (used > limit && !entries.empty()) {
+            const auto& last = entries.back();
+            used -= last.size;
+            index.erase(last.key);
+            entries.pop_back();
+            ++evictions;
+        }
+    }
+
+public:
+    void set_budget(size_t b) {
+        budget = b;
+        evict(budget);
+    }
+
+    size_t get_budget() const {
+        return budget;
+    }
+
+    size_t memory_used() const {
+        return used;
+    }
+
+    size_t num_entries() const {
+        return entries.size();
+    }
+
+    void clear() {
+        entries.clear();
+        index.clear();
+        used = 0;
+    }
+
+    void reset_statistics() {
+        hits = 0;
+        misses = 0;
+        evictions = 0;
+    }
+
+public:
+    /*
+     * Returns a copy of the cached result for 'key', or computes it with
+     * 'compute()' and stores it if it fits within the budget. 'size_of()'
+     * should return an estimate of the memory used by a result, in bytes.
+     * Callers are responsible for including a tag that is unique to the
+     * result type in the key, so that different types never share a key.
+     * If 'cacheable = false', the cache is bypassed altogether, e.g., for
+     * inputs whose fingerprint does not reflect their contents.
+     */
+    template<class Result_, class Compute_, class Size_>
+    Result_ fetch(uint64_t key, Compute_ compute, Size_ size_of, bool cacheable = true) {
+        if (!cacheable) {
+            return compute();
+        }
+
+        auto it = index.find(key);
+        if (it != index.end()) {
+            ++hits;
+            entries.splice(entries.begin(), entries, it->second);
+            return *std::static_pointer_cast<const Result_>(it->second->value);
+        }
+
+        ++misses;
+        Result_ output = compute();
+        if (budget == 0) {
+            return output;
+        }
+
+        size_t size = size_of(output);
+        if (size > budget) {
+            return output;
+        }
+
+        evict(budget - size);
+        entries.push_front(Entry{ key, std::make_shared<const Result_>(output), size });
+        index[key] = entries.begin();
+        used += size;
+        return output;
+    }
+};
+
+MemoCache& memo_cache();
+
+#endif
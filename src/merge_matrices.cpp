@@ -0,0 +1,446 @@
+#include <emscripten/bind.h>
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "NumericMatrix.h"
+#include "read_utils.h"
+#include "layered_utils.h"
+#include "parallel.h"
+
+#include "H5Cpp.h"
+#include "tatami_hdf5/tatami_hdf5.hpp"
+
+/*
+ * Builds a single compressed sparse column matrix by appending samples one at
+ * a time. Each sample's rows are aligned to a reference set of features via a
+ * mapping supplied by the caller, where unmapped rows are discarded and
+ * reference features missing from a sample are treated as zero.
+ *
+ * Each sample is processed in two passes, with each thread handling the same
+ * contiguous range of columns (or rows, for samples that prefer row access) in
+ * both passes. The first pass counts the non-zero entries in each column and
+ * checks the range of values; the store is then extended once, and the second
+ * pass fills each thread's entries in place. For row access, each thread also
+ * records its own counts for each column so that it can write to disjoint
+ * positions, and the columns are sorted by row index afterwards.
+ *
+ * The store's capacity grows geometrically, so appending many samples takes
+ * amortized linear time. Each reallocation means that peak memory usage
+ * during an append is the old store plus the new store plus the current
+ * sample. This can be avoided by reserving the expected total number of
+ * non-zero entries up front, in which case the store is only reallocated if
+ * the reservation is exceeded.
+ *
+ * Values are stored in the smallest type that can hold all values seen so far,
+ * and are converted to a larger type when a larger (or non-integer) value is
+ * appended. The converted vector is allocated at its new size before the old
+ * vector is released, so peak memory usage during an upgrade is the store in
+ * both the old and new types. Row indices use 16-bit integers when the number
+ * of features permits.
+ */
+class SparseMatrixMerger {
+public:
+    SparseMatrixMerger(int nfeatures) : NR(nfeatures), small_index(nfeatures <= std::numeric_limits<uint16_t>::max() + 1), pointers(1) {}
+
+private:
+    int NR;
+    int NC = 0;
+    bool finalized = false;
+
+    bool small_index;
+    std::vector<uint16_t> indices16;
+    std::vector<int> indices32;
+
+    SparseLayer level = SparseLayer::U8;
+    std::vector<uint8_t> values8;
+    std::vector<uint16_t> values16;
+    std::vector<uint32_t> values32;
+    std::vector<double> values64;
+
+    std::vector<size_t> pointers;
+    size_t reserved = 0;
+
+private:
+    template<class Function_>
+    void dispatch_values(Function_ fun) {
+        switch (level) {
+            case SparseLayer::U8:
+                fun(values8);
+                break;
+            case SparseLayer::U16:
+                fun(values16);
+                break;
+            case SparseLayer::U32:
+                fun(values32);
+                break;
+            default:
+                fun(values64);
+        }
+    }
+
+    template<class Function_>
+    void dispatch(Function_ fun) {
+        dispatch_values([&](auto& values) -> void {
+            if (small_index) {
+                fun(values, indices16);
+            } else {
+                fun(values, indices32);
+            }
+        });
+    }
+
+    // Growing the capacity geometrically, so that the cost of copying
+    // the store is amortized across many appends.
+    static size_t grown_capacity(size_t current, size_t required) {
+        return std::max(required, current + current / 2);
+    }
+
+    // Upgrading the value type, where the new vector is allocated with
+    // enough space for 'total' entries to avoid a further reallocation.
+    // The existing capacity (e.g., from a reservation) is preserved.
+    void upgrade(SparseLayer required, size_t total) {
+        if (required <= level) {
+            return;
+        }
+
+        auto copy_into = [&](auto& target) -> void {
+            dispatch_values([&](auto& source) -> void {
+                auto capacity = source.capacity();
+                target.reserve(capacity >= total ? capacity : grown_capacity(capacity, total));
+                target.insert(target.end(), source.begin(), source.end());
+                source.clear();
+                source.shrink_to_fit();
+            });
+        };
+
+        switch (required) {
+            case SparseLayer::U16:
+                copy_into(values16);
+                break;
+            case SparseLayer::U32:
+                copy_into(values32);
+                break;
+            default:
+                copy_into(values64);
+        }
+        level = required;
+    }
+
+    void check_mapping(const int* mapping, int nrows) const {
+        std::vector<uint8_t> used(NR);
+        for (int r = 0; r < nrows; ++r) {
+            auto m = mapping[r];
+            if (m < 0) {
+                continue;
+            }
+            if (m >= NR) {
+                throw std::runtime_error("row mapping should be less than the number of reference features");
+            }
+            if (used[m]) {
+                throw std::runtime_error("multiple rows should not be mapped to the same reference feature");
+            }
+            used[m] = 1;
+        }
+    }
+
+public:
+    template<typename Value_, typename Index_>
+    void append(const tatami::Matrix<Value_, Index_>* mat, const int* mapping, int nthreads) {
+        if (finalized) {
+            throw std::runtime_error("cannot append to a finalized merger");
+        }
+
+        Index_ nrows = mat->nrow(), ncols = mat->ncol();
+        check_mapping(mapping, nrows);
+
+        // First pass: counting the mapped non-zero entries in each column,
+        // and checking the range of values.
+        std::vector<size_t> counts(ncols);
+        std::vector<Value_> thread_max(nthreads);
+        std::vector<uint8_t> thread_invalid(nthreads);
+
+        auto check_value = [&](int t, Value_ val) -> void {
+            auto& curmax = thread_max[t];
+            if (val > curmax) {
+                curmax = val;
+            }
+            if (val < 0 || val != std::floor(val)) {
+                thread_invalid[t] = 1;
+            }
+        };
+
+        auto loop_over_columns = [&](auto fun) -> void {
+            run_parallel_new([&](int t, Index_ start, Index_ length) -> void {
+                auto ext = mat->sparse_column();
+                std::vector<Value_> vbuffer(nrows);
+                std::vector<Index_> ibuffer(nrows);
+                for (Index_ c = start, end = start + length; c < end; ++c) {
+                    auto range = ext->fetch(c, vbuffer.data(), ibuffer.data());
+                    fun(t, c, range);
+                }
+            }, ncols, nthreads);
+        };
+
+        // Unmapped rows are skipped entirely, and the same partitioning of
+        // rows is used in both passes.
+        auto loop_over_rows = [&](auto fun) -> void {
+            run_parallel_new([&](int t, Index_ start, Index_ length) -> void {
+                auto ext = mat->sparse_row();
+                std::vector<Value_> vbuffer(ncols);
+                std::vector<Index_> ibuffer(ncols);
+                for (Index_ r = start, end = start + length; r < end; ++r) {
+                    if (mapping[r] < 0) {
+                        continue;
+                    }
+                    auto range = ext->fetch(r, vbuffer.data(), ibuffer.data());
+                    fun(t, r, range);
+                }
+            }, nrows, nthreads);
+        };
+
+        // For row-based access, each thread counts its entries in each
+        // column, which are later converted into the start position of that
+        // thread's entries in each column.
+        bool by_row = mat->prefer_rows();
+        std::vector<std::vector<size_t> > thread_offsets;
+
+        if (by_row) {
+            thread_offsets.resize(nthreads);
+            loop_over_rows([&](int t, Index_, const auto& range) -> void {
+                auto& curcounts = thread_offsets[t];
+                if (curcounts.empty()) {
+                    curcounts.resize(ncols);
+                }
+                for (Index_ k = 0; k < range.number; ++k) {
+                    auto val = range.value[k];
+                    if (val == 0) {
+                        continue;
+                    }
+                    ++curcounts[range.index[k]];
+                    check_value(t, val);
+                }
+            });
+
+            for (const auto& curcounts : thread_offsets) {
+                if (!curcounts.empty()) {
+                    for (Index_ c = 0; c < ncols; ++c) {
+                        counts[c] += curcounts[c];
+                    }
+                }
+            }
+
+        } else {
+            loop_over_columns([&](int t, Index_ c, const auto& range) -> void {
+                size_t& count = counts[c];
+                for (Index_ k = 0; k < range.number; ++k) {
+                    auto val = range.value[k];
+                    if (val == 0 || mapping[range.index[k]] < 0) {
+                        continue;
+                    }
+                    ++count;
+                    check_value(t, val);
+                }
+            });
+        }
+
+        SparseLayer required = SparseLayer::F64;
+        if (std::find(thread_invalid.begin(), thread_invalid.end(), 1) == thread_invalid.end()) {
+            Value_ maxed = *std::max_element(thread_max.begin(), thread_max.end());
+            if (maxed <= std::numeric_limits<uint8_t>::max()) {
+                required = SparseLayer::U8;
+            } else if (maxed <= std::numeric_limits<uint16_t>::max()) {
+                required = SparseLayer::U16;
+            } else if (maxed <= std::numeric_limits<uint32_t>::max()) {
+                required = SparseLayer::U32;
+            }
+        }
+        size_t new_total = pointers.back();
+        for (Index_ c = 0; c < ncols; ++c) {
+            new_total += counts[c];
+        }
+        upgrade(required, new_total);
+
+        // Extending the store once, and then filling each column in place.
+        pointers.reserve(pointers.size() + ncols);
+        for (Index_ c = 0; c < ncols; ++c) {
+            pointers.push_back(pointers.back() + counts[c]);
+        }
+        const size_t* new_pointers = pointers.data() + NC;
+
+        dispatch([&](auto& values, auto& indices) -> void {
+            if (values.capacity() < new_total) {
+                auto capacity = grown_capacity(values.capacity(), new_total);
+                values.reserve(capacity);
+                indices.reserve(capacity);
+            }
+            values.resize(new_total);
+            indices.resize(new_total);
+
+            // Mapped indices are not guaranteed to be sorted, so we sort
+            // them (and their values) in place if required.
+            auto sort_column = [&](Index_ c) -> void {
+                size_t start = new_pointers[c], end = new_pointers[c + 1];
+                bool sorted = true;
+                for (size_t i = start + 1; i < end; ++i) {
+                    if (indices[i] < indices[i - 1]) {
+                        sorted = false;
+                        break;
+                    }
+                }
+                if (!sorted) {
+                    std::vector<std::pair<int, double> > tmp;
+                    tmp.reserve(end - start);
+                    for (size_t i = start; i < end; ++i) {
+                        tmp.emplace_back(indices[i], values[i]);
+                    }
+                    std::sort(tmp.begin(), tmp.end());
+                    for (size_t i = start; i < end; ++i) {
+                        indices[i] = tmp[i - start].first;
+                        values[i] = tmp[i - start].second;
+                    }
+                }
+            };
+
+            if (by_row) {
+                for (Index_ c = 0; c < ncols; ++c) {
+                    size_t sofar = new_pointers[c];
+                    for (auto& curoffsets : thread_offsets) {
+                        if (!curoffsets.empty()) {
+                            auto n = curoffsets[c];
+                            curoffsets[c] = sofar;
+                            sofar += n;
+                        }
+                    }
+                }
+
+                loop_over_rows([&](int t, Index_ r, const auto& range) -> void {
+                    auto& curoffsets = thread_offsets[t];
+                    auto m = mapping[r];
+                    for (Index_ k = 0; k < range.number; ++k) {
+                        auto val = range.value[k];
+                        if (val == 0) {
+                            continue;
+                        }
+                        auto& offset = curoffsets[range.index[k]];
+                        values[offset] = val;
+                        indices[offset] = m;
+                        ++offset;
+                    }
+                });
+
+                run_parallel_old(ncols, [&](Index_ first, Index_ last) -> void {
+                    for (Index_ c = first; c < last; ++c) {
+                        sort_column(c);
+                    }
+                }, nthreads);
+
+            } else {
+                loop_over_columns([&](int, Index_ c, const auto& range) -> void {
+                    size_t offset = new_pointers[c];
+                    for (Index_ k = 0; k < range.number; ++k) {
+                        auto val = range.value[k];
+                        auto m = mapping[range.index[k]];
+                        if (val == 0 || m < 0) {
+                            continue;
+                        }
+                        values[offset] = val;
+                        indices[offset] = m;
+                        ++offset;
+                    }
+                    sort_column(c);
+                });
+            }
+        });
+
+        NC += ncols;
+    }
+
+    void append_matrix(const NumericMatrix& mat, uintptr_t mapping, int nthreads) {
+        append(mat.ptr.get(), reinterpret_cast<const int*>(mapping), nthreads);
+    }
+
+    void append_hdf5(std::string path, std::string name, bool force_integer, uintptr_t mapping) {
+        auto details = extract_hdf5_matrix_details_internal(path, name);
+        auto mptr = reinterpret_cast<const int*>(mapping);
+
+        auto process = [&](auto tmp) -> void {
+            typedef decltype(tmp) Value_;
+            std::shared_ptr<tatami::Matrix<Value_, int> > mat;
+            try {
+                if (details.is_dense) {
+                    mat.reset(new tatami_hdf5::Hdf5DenseMatrix<Value_, int, true>(path, name));
+                } else if (details.csc) {
+                    mat.reset(new tatami_hdf5::Hdf5CompressedSparseMatrix<false, Value_, int>(details.nr, details.nc, path, name + "/data", name + "/indices", name + "/indptr"));
+                } else {
+                    mat.reset(new tatami_hdf5::Hdf5CompressedSparseMatrix<true, Value_, int>(details.nr, details.nc, path, name + "/data", name + "/indices", name + "/indptr"));
+                }
+            } catch (H5::Exception& e) {
+                throw std::runtime_error(e.getCDetailMsg());
+            }
+
+            // HDF5 library calls are not thread-safe, so we stick to one thread.
+            // CSR files prefer row access and so are still read by row.
+            append(mat.get(), mptr, 1);
+        };
+
+        if (force_integer || details.is_integer) {
+            process(static_cast<int>(0));
+        } else {
+            process(static_cast<double>(0));
+        }
+    }
+
+    void reserve(double nnz) {
+        if (finalized) {
+            throw std::runtime_error("cannot reserve space in a finalized merger");
+        }
+        reserved = nnz;
+        dispatch([&](auto& values, auto& indices) -> void {
+            values.reserve(reserved);
+            indices.reserve(reserved);
+        });
+    }
+
+    int num_features() const {
+        return NR;
+    }
+
+    int num_columns() const {
+        return NC;
+    }
+
+    NumericMatrix finalize() {
+        if (finalized) {
+            throw std::runtime_error("merger has already been finalized");
+        }
+        finalized = true;
+
+        std::shared_ptr<const tatami::NumericMatrix> output;
+        dispatch([&](auto& values, auto& indices) -> void {
+            typedef typename std::remove_reference<decltype(values)>::type ValueStorage;
+            typedef typename std::remove_reference<decltype(indices)>::type IndexStorage;
+            output.reset(new tatami::CompressedSparseColumnMatrix<double, int, ValueStorage, IndexStorage, std::vector<size_t> >(
+                NR, NC, std::move(values), std::move(indices), std::move(pointers)
+            ));
+        });
+
+        return NumericMatrix(std::move(output));
+    }
+};
+
+EMSCRIPTEN_BINDINGS(merge_matrices) {
+    emscripten::class_<SparseMatrixMerger>("SparseMatrixMerger")
+        .constructor<int>()
+        .function("append_matrix", &SparseMatrixMerger::append_matrix)
+        .function("append_hdf5", &SparseMatrixMerger::append_hdf5)
+        .function("reserve", &SparseMatrixMerger::reserve)
+        .function("num_features", &SparseMatrixMerger::num_features)
+        .function("num_columns", &SparseMatrixMerger::num_columns)
+        .function("finalize", &SparseMatrixMerger::finalize)
+        ;
+}
@@ -0,0 +1,205 @@
+#include <emscripten/bind.h>
+
+#include "NumericMatrix.h"
+#include "parallel.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+/*
+ * Products of a NumericMatrix with dense vectors/blocks or a weighted sparse
+ * selector. We always iterate along the matrix's preferred dimension; if
+ * this is the same as the output dimension, each slice yields one output
+ * entry via a dot product. Otherwise, each slice is scattered into the
+ * output: for dense blocks, each thread handles a contiguous range of the
+ * output dimension and scatters the corresponding part of every slice
+ * directly into the output, so that no per-thread copies of the output are
+ * required; for selectors, each slice is scattered into per-thread
+ * accumulators of length equal to the output, which are summed at the end.
+ * Sparse matrices use sparse extractors so that structural zeros are never
+ * visited.
+ *
+ * Accumulators are reduced in worker order, so the results are identical
+ * for a given number of threads.
+ */
+
+namespace {
+
+// Calls 'fun(t, i, number, values, indices)' for each slice 'which[i]'
+// (or 'i', if 'which' is NULL) with i in [0, n). 'indices' is NULL for
+// dense extraction, in which case 'number' is the full slice length.
+template<class Function_>
+void for_each_slice(const tatami::NumericMatrix* mat, bool byrow, const int32_t* which, int n, Function_ fun, int nthreads) {
+    int len = (byrow ? mat->ncol() : mat->nrow());
+    bool sparse = mat->sparse();
+
+    run_parallel_new([&](int t, int start, int length) -> void {
+        std::vector<double> vbuffer(len);
+        if (sparse) {
+            std::vector<int> ibuffer(len);
+            auto ext = (byrow ? mat->sparse_row() : mat->sparse_column());
+            for (int i = start, end = start + length; i < end; ++i) {
+                auto range = ext->fetch(which ? which[i] : i, vbuffer.data(), ibuffer.data());
+                fun(t, i, range.number, range.value, range.index);
+            }
+        } else {
+            auto ext = (byrow ? mat->dense_row() : mat->dense_column());
+            for (int i = start, end = start + length; i < end; ++i) {
+                auto ptr = ext->fetch(which ? which[i] : i, vbuffer.data());
+                fun(t, i, len, ptr, static_cast<const int*>(NULL));
+            }
+        }
+    }, n, nthreads);
+}
+
+void reduce_accumulators(std::vector<std::vector<double> >& accumulators, size_t total, double* output, int nthreads) {
+    run_parallel_old(total, [&](size_t first, size_t last) -> void {
+        std::fill(output + first, output + last, 0);
+        for (const auto& acc : accumulators) {
+            if (acc.empty()) {
+                continue;
+            }
+            for (size_t i = first; i < last; ++i) {
+                output[i] += acc[i];
+            }
+        }
+    }, nthreads);
+}
+
+}
+
+/*
+ * Computes 'output = mat %*% rhs' for 'rhs' of dimensions (ncol, nvec), or
+ * 'output = t(mat) %*% rhs' for 'rhs' of dimensions (nrow, nvec) if
+ * 'transpose = true'. All blocks are column-major.
+ */
+void multiply_dense(const NumericMatrix& mat, int nvec, uintptr_t rhs, bool transpose, uintptr_t output, int nthreads) {
+    const auto& ptr = mat.ptr;
+    size_t NR = ptr->nrow(), NC = ptr->ncol();
+    size_t inner = (transpose ? NR : NC), outer = (transpose ? NC : NR);
+
+    auto rptr = reinterpret_cast<const double*>(rhs);
+    auto optr = reinterpret_cast<double*>(output);
+    bool byrow = ptr->prefer_rows();
+    int nslices = (byrow ? NR : NC);
+
+    if (byrow != transpose) {
+        // Each slice is a row of 'mat' (or a column, for the transpose), so it
+        // directly yields the corresponding entry of each output vector.
+        for_each_slice(ptr.get(), byrow, NULL, nslices, [&](int, int i, int number, const double* values, const int* indices) -> void {
+            for (int v = 0; v < nvec; ++v) {
+                const double* current = rptr + static_cast<size_t>(v) * inner;
+                double sum = 0;
+                if (indices) {
+                    for (int k = 0; k < number; ++k) {
+                        sum += values[k] * current[indices[k]];
+                    }
+                } else {
+                    for (int k = 0; k < number; ++k) {
+                        sum += values[k] * current[k];
+                    }
+                }
+                optr[i + static_cast<size_t>(v) * outer] = sum;
+            }
+        }, nthreads);
+        return;
+    }
+
+    // Each slice is a column of 'mat' (or a row, for the transpose), so it
+    // contributes to all entries of each output vector. Each thread only
+    // extracts its own block of each slice, so every output entry is summed
+    // across slices in the same order regardless of the number of threads.
+    bool sparse = ptr->sparse();
+    run_parallel_new([&](int, int start, int length) -> void {
+        for (int v = 0; v < nvec; ++v) {
+            double* current = optr + static_cast<size_t>(v) * outer + start;
+            std::fill(current, current + length, 0);
+        }
+
+        std::vector<double> vbuffer(length);
+        if (sparse) {
+            std::vector<int> ibuffer(length);
+            auto ext = (byrow ? ptr->sparse_row(start, length) : ptr->sparse_column(start, length));
+            for (int i = 0; i < nslices; ++i) {
+                auto range = ext->fetch(i, vbuffer.data(), ibuffer.data());
+                for (int v = 0; v < nvec; ++v) {
+                    double mult = rptr[i + static_cast<size_t>(v) * inner];
+                    if (mult == 0) {
+                        continue;
+                    }
+                    double* current = optr + static_cast<size_t>(v) * outer;
+                    for (int k = 0; k < range.number; ++k) {
+                        current[range.index[k]] += range.value[k] * mult;
+                    }
+                }
+            }
+        } else {
+            auto ext = (byrow ? ptr->dense_row(start, length) : ptr->dense_column(start, length));
+            for (int i = 0; i < nslices; ++i) {
+                auto values = ext->fetch(i, vbuffer.data());
+                for (int v = 0; v < nvec; ++v) {
+                    double mult = rptr[i + static_cast<size_t>(v) * inner];
+                    if (mult == 0) {
+                        continue;
+                    }
+                    double* current = optr + static_cast<size_t>(v) * outer + start;
+                    for (int k = 0; k < length; ++k) {
+                        current[k] += values[k] * mult;
+                    }
+                }
+            }
+        }
+    }, static_cast<int>(outer), nthreads);
+
+    return;
+}
+
+/*
+ * Computes 'output = mat %*% x' (or 't(mat) %*% x') where 'x' is a sparse
+ * vector with non-zero 'weights' at 'indices'. Only the selected columns (or
+ * rows, for the transpose) are extracted, regardless of the preferred
+ * dimension, so this is cheap for small selections.
+ */
+void multiply_selector(const NumericMatrix& mat, int nselected, uintptr_t indices, uintptr_t weights, bool transpose, uintptr_t output, int nthreads) {
+    const auto& ptr = mat.ptr;
+    size_t outer = (transpose ? ptr->ncol() : ptr->nrow());
+    size_t inner = (transpose ? ptr->nrow() : ptr->ncol());
+
+    auto iptr = reinterpret_cast<const int32_t*>(indices);
+    for (int s = 0; s < nselected; ++s) {
+        if (iptr[s] < 0 || static_cast<size_t>(iptr[s]) >= inner) {
+            throw std::runtime_error("selector indices are out of range");
+        }
+    }
+
+    auto wptr = reinterpret_cast<const double*>(weights);
+    std::vector<std::vector<double> > accumulators(nthreads);
+    for_each_slice(ptr.get(), transpose, iptr, nselected, [&](int t, int i, int number, const double* values, const int* idx) -> void {
+        auto& acc = accumulators[t];
+        if (acc.empty()) {
+            acc.resize(outer);
+        }
+
+        double mult = wptr[i];
+        if (idx) {
+            for (int k = 0; k < number; ++k) {
+                acc[idx[k]] += values[k] * mult;
+            }
+        } else {
+            for (int k = 0; k < number; ++k) {
+                acc[k] += values[k] * mult;
+            }
+        }
+    }, nthreads);
+
+    reduce_accumulators(accumulators, outer, reinterpret_cast<double*>(output), nthreads);
+    return;
+}
+
+EMSCRIPTEN_BINDINGS(multiply_matrix) {
+    emscripten::function("multiply_dense", &multiply_dense);
+
+    emscripten::function("multiply_selector", &multiply_selector);
+}
@@ -0,0 +1,13 @@
+#include <emscripten/bind.h>
+
+#include "parallel.h"
+
+void set_parallel_thread_limit(int limit) {
+#ifdef __EMSCRIPTEN_PTHREADS__
+    parallel_thread_limit() = (limit > 0 ? limit : 0);
+#endif
+}
+
+EMSCRIPTEN_BINDINGS(parallel) {
+    emscripten::function("set_parallel_thread_limit", &set_parallel_thread_limit);
+}
@@ -5,6 +5,63 @@
 #include <thread>
 #include <cmath>
 #include <vector>
+#include <algorithm>
+
+/*
+ * Each parallel section is split into 'nthreads' logical workers, where the
+ * partitioning of jobs (and any per-worker buffers allocated by the caller)
+ * depends only on the number of logical workers. Logical workers are then
+ * executed on at most parallel_thread_limit() physical threads, with each
+ * thread running its workers in turn; a limit of zero means that each
+ * logical worker gets its own thread.
+ *
+ * This decoupling allows us to fix the number of logical workers across all
+ * calls (see setDeterministicThreading() in the JS bindings), so that results
+ * involving floating-point reductions across workers are bit-identical
+ * regardless of how many threads are actually available.
+ *
+ * Note that a thread runs its logical workers serially, so a worker must never
+ * wait on another worker (e.g., at a barrier, or for work from a queue filled
+ * by another worker). If the limit is less than the number of workers, such a
+ * worker would block its thread forever, as the worker that it waits on would
+ * be scheduled later on the same thread. All callers of these helpers, both
+ * here and in the vendored libraries, must only run independent jobs.
+ */
+inline int& parallel_thread_limit() {
+    static int limit = 0;
+    return limit;
+}
+
+template<class Worker_>
+void run_logical_workers(int nworkers, Worker_ worker) {
+    int nphysical = nworkers;
+    int limit = parallel_thread_limit();
+    if (limit > 0 && limit < nphysical) {
+        nphysical = limit;
+    }
+
+    if (nphysical <= 1) {
+        for (int w = 0; w < nworkers; ++w) {
+            worker(w);
+        }
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(nphysical);
+    for (int p = 0; p < nphysical; ++p) {
+        // Each thread gets its own copy of the worker, as std::thread would.
+        workers.emplace_back([nworkers, nphysical](int start, Worker_ local) -> void {
+            for (int w = start; w < nworkers; w += nphysical) {
+                local(w);
+            }
+        }, p, worker);
+    }
+
+    for (auto& wrk : workers) {
+        wrk.join();
+    }
+}
 
 template<class Function_, typename Index_>
 void run_parallel_new(Function_ fun, Index_ njobs, int nthreads) {
@@ -14,19 +71,16 @@ void run_parallel_new(Function_ fun, Index_ njobs, int nthreads) {
     }
 
     Index_ jobs_per_worker = njobs/nthreads + (njobs % nthreads > 0);
-    std::vector<std::thread> workers;
-    workers.reserve(nthreads);
-    Index_ first = 0;
-
-    for (int w = 0; w < nthreads && first < njobs; ++w) {
-        int len = std::min(jobs_per_worker, njobs - first);
-        workers.emplace_back(fun, w, first, len);
-        first += jobs_per_worker;
+    int nworkers = 0;
+    if (jobs_per_worker > 0) {
+        nworkers = njobs/jobs_per_worker + (njobs % jobs_per_worker > 0);
     }
 
-    for (auto& wrk : workers) {
-        wrk.join();
-    }
+    run_logical_workers(nworkers, [=](int w) mutable -> void {
+        Index_ first = w * jobs_per_worker;
+        Index_ len = std::min(jobs_per_worker, njobs - first);
+        fun(w, first, len);
+    });
 }
 
 template<typename Index_, class Function_>
@@ -37,19 +91,16 @@ void run_parallel_old(Index_ njobs, Function_ fun, size_t nthreads) {
     }
 
     Index_ jobs_per_worker = njobs/nthreads + (njobs % nthreads > 0);
-    std::vector<std::thread> workers;
-    workers.reserve(nthreads);
-    int first = 0;
-
-    for (int w = 0; w < nthreads && first < njobs; ++w) {
-        int last = first + std::min(jobs_per_worker, njobs - first);
-        workers.emplace_back(fun, first, last);
-        first += jobs_per_worker;
+    int nworkers = 0;
+    if (jobs_per_worker > 0) {
+        nworkers = njobs/jobs_per_worker + (njobs % jobs_per_worker > 0);
     }
 
-    for (auto& wrk : workers) {
-        wrk.join();
-    }
+    run_logical_workers(nworkers, [=](int w) mutable -> void {
+        Index_ first = w * jobs_per_worker;
+        Index_ last = first + std::min(jobs_per_worker, njobs - first);
+        fun(first, last);
+    });
 }
 
 template<class Function_>
@@ -59,16 +110,9 @@ void run_parallel_simple(int nthreads, Function_ fun) {
         return;
     }
 
-    std::vector<std::thread> workers;
-    workers.reserve(nthreads);
-
-    for (int w = 0; w < nthreads; ++w) {
-        workers.emplace_back(fun, w);
-    }
-
-    for (auto& wrk : workers) {
-        wrk.join();
-    }
+    run_logical_workers(nthreads, [=](int w) mutable -> void {
+        fun(w);
+    });
 }
 
 /*
@@ -83,6 +127,13 @@ void run_parallel_simple(int nthreads, Function_ fun) {
  * You can figure out which macros need to be defined by checking the
  * dependencies in build_main/_deps; many of Aaron's libraries will support
  * some form of *_CUSTOM_PARALLEL macro.
+ *
+ * Each library only uses its macro to run a loop over disjoint ranges of jobs,
+ * with per-worker results combined after all workers have finished; none of
+ * them synchronize between workers, so they are safe to use with the thread
+ * limit in run_logical_workers(). This should be re-checked when updating the
+ * libraries or adding a new macro, as any library that does synchronize
+ * between workers would deadlock in deterministic mode.
  */
 
 #define TATAMI_CUSTOM_PARALLEL run_parallel_new
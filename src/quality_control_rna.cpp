@@ -3,6 +3,7 @@
 #include "parallel.h"
 #include "utils.h"
 #include "NumericMatrix.h"
+#include "buffer_pool.h"
 
 #include "scran/scran.hpp"
 
@@ -11,24 +12,45 @@
 #include <cmath>
 
 struct PerCellRnaQcMetrics_Results {
-    typedef scran::PerCellRnaQcMetrics::Results Store;
+    typedef scran::PerCellRnaQcMetrics::Buffers<double, int> Store;
 
     Store store;
+    size_t ncells;
+
+    // Only used when the metrics are not stored in caller-provided buffers.
+    PooledBuffer owned_sums, owned_detected;
+    std::vector<PooledBuffer> owned_proportions;
+
+    PerCellRnaQcMetrics_Results(int num_cells, int num_subsets) : 
+        ncells(num_cells), 
+        owned_sums(num_cells * sizeof(double)), 
+        owned_detected(num_cells * sizeof(int))
+    {
+        store.sums = owned_sums.data<double>();
+        store.detected = owned_detected.data<int>();
+        for (int s = 0; s < num_subsets; ++s) {
+            owned_proportions.emplace_back(num_cells * sizeof(double));
+            store.subset_proportions.push_back(owned_proportions.back().data<double>());
+        }
+    }
 
-    PerCellRnaQcMetrics_Results(Store s) : store(std::move(s)) {}
+    PerCellRnaQcMetrics_Results(size_t num_cells, uintptr_t sums, uintptr_t detected, int num_subsets, uintptr_t proportions) : ncells(num_cells) {
+        store.sums = reinterpret_cast<double*>(sums);
+        store.detected = reinterpret_cast<int*>(detected);
+        store.subset_proportions = convert_array_of_offsets<double*>(num_subsets, proportions);
+    }
 
 public:
     emscripten::val sums() const {
-        return emscripten::val(emscripten::typed_memory_view(store.sums.size(), store.sums.data()));
+        return emscripten::val(emscripten::typed_memory_view(ncells, store.sums));
     }
 
     emscripten::val detected() const {
-        return emscripten::val(emscripten::typed_memory_view(store.detected.size(), store.detected.data()));
+        return emscripten::val(emscripten::typed_memory_view(ncells, store.detected));
     }
 
     emscripten::val subset_proportions(int i) const {
-        const auto& current = store.subset_proportions[i];
-        return emscripten::val(emscripten::typed_memory_view(current.size(), current.data()));
+        return emscripten::val(emscripten::typed_memory_view(ncells, store.subset_proportions[i]));
     }
 
     int num_subsets() const {
@@ -36,15 +58,20 @@ public:
     }
 
     int num_cells() const {
-        return store.sums.size();
+        return ncells;
     }
 };
 
-PerCellRnaQcMetrics_Results per_cell_rna_qc_metrics(const NumericMatrix& mat, int nsubsets, uintptr_t subsets, int nthreads) {
+PerCellRnaQcMetrics_Results per_cell_rna_qc_metrics(const NumericMatrix& mat, int nsubsets, uintptr_t subsets, bool use_buffers, uintptr_t sums, uintptr_t detected, uintptr_t proportions, int nthreads) {
+    size_t NC = mat.ptr->ncol();
+    auto output = (use_buffers ? 
+        PerCellRnaQcMetrics_Results(NC, sums, detected, nsubsets, proportions) :
+        PerCellRnaQcMetrics_Results(NC, nsubsets));
+
     scran::PerCellRnaQcMetrics qc;
     qc.set_num_threads(nthreads);
-    auto store = qc.run(mat.ptr.get(), convert_array_of_offsets<const uint8_t*>(nsubsets, subsets));
-    return PerCellRnaQcMetrics_Results(std::move(store));
+    qc.run(mat.ptr.get(), convert_array_of_offsets<const uint8_t*>(nsubsets, subsets), output.store);
+    return output;
 }
 
 struct SuggestRnaQcFilters_Results {
@@ -90,8 +117,8 @@ public:
         if (use_blocks) {
             bptr = reinterpret_cast<const int32_t*>(blocks);
         }
-        const auto& mstore = reinterpret_cast<const PerCellRnaQcMetrics_Results*>(metrics)->store;
-        store.filter_blocked(mstore.sums.size(), bptr, mstore.buffers(), reinterpret_cast<uint8_t*>(output));
+        const auto& mres = *reinterpret_cast<const PerCellRnaQcMetrics_Results*>(metrics);
+        store.filter_blocked(mres.ncells, bptr, mres.store, reinterpret_cast<uint8_t*>(output));
         return;
     }
 };
@@ -105,7 +132,8 @@ SuggestRnaQcFilters_Results suggest_rna_qc_filters(uintptr_t metrics, bool use_b
         bptr = reinterpret_cast<const int32_t*>(blocks);
     }
 
-    auto thresholds = qc.run_blocked(reinterpret_cast<const PerCellRnaQcMetrics_Results*>(metrics)->store, bptr);
+    const auto& mres = *reinterpret_cast<const PerCellRnaQcMetrics_Results*>(metrics);
+    auto thresholds = qc.run_blocked(mres.ncells, bptr, mres.store);
     return SuggestRnaQcFilters_Results(std::move(thresholds));
 }
 
@@ -113,6 +141,7 @@ EMSCRIPTEN_BINDINGS(quality_control_rna) {
     emscripten::function("per_cell_rna_qc_metrics", &per_cell_rna_qc_metrics);
 
     emscripten::class_<PerCellRnaQcMetrics_Results>("PerCellRnaQcMetrics_Results")
+        .constructor<int, int>()
         .function("sums", &PerCellRnaQcMetrics_Results::sums)
         .function("detected", &PerCellRnaQcMetrics_Results::detected)
         .function("subset_proportions", &PerCellRnaQcMetrics_Results::subset_proportions)
@@ -0,0 +1,121 @@
+#include <emscripten/bind.h>
+
+#include "NumericMatrix.h"
+#include "parallel.h"
+#include "sparse_row_utils.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+/*
+ * Quantization of a batch of genes into 8-bit codes for visualization, e.g.,
+ * colouring an embedding by expression. Each gene is scaled to its own range,
+ * either the minimum and maximum or a pair of quantiles, and values are
+ * linearly mapped to [0, 255] after clipping to that range. Genes are
+ * extracted as sparse rows, so the scaling only needs to sort the non-zero
+ * values; the zeros are accounted for by their count.
+ */
+
+namespace {
+
+// Returns the value at (0-based) position 'k' of the sorted vector that is
+// formed from 'sorted' (the sorted non-zero values) and 'nzeros' zeros.
+double value_at(const std::vector<double>& sorted, size_t nneg, size_t nzeros, size_t k) {
+    if (k < nneg) {
+        return sorted[k];
+    } else if (k < nneg + nzeros) {
+        return 0;
+    } else {
+        return sorted[k - nzeros];
+    }
+}
+
+// Quantiles use linear interpolation between order statistics, i.e., type 7
+// in R's quantile().
+double quantile(const std::vector<double>& sorted, size_t nneg, size_t nzeros, double prob) {
+    size_t n = sorted.size() + nzeros;
+    double pos = prob * (n - 1);
+    size_t lower = std::floor(pos);
+    size_t upper = std::min(lower + 1, n - 1);
+    double frac = pos - lower;
+    double left = value_at(sorted, nneg, nzeros, lower);
+    double right = value_at(sorted, nneg, nzeros, upper);
+    return left + (right - left) * frac;
+}
+
+uint8_t quantize(double val, double lower, double scale) {
+    double scaled = (val - lower) * scale;
+    if (scaled <= 0) {
+        return 0;
+    } else if (scaled >= 255) {
+        return 255;
+    } else {
+        return static_cast<uint8_t>(std::round(scaled));
+    }
+}
+
+}
+
+void quantize_expression(const NumericMatrix& mat, int nrows, uintptr_t rows, bool use_quantiles, double lower_prob, double upper_prob, uintptr_t output, uintptr_t ranges, int nthreads) {
+    const auto& ptr = mat.ptr;
+    size_t NR = ptr->nrow(), NC = ptr->ncol();
+    if (use_quantiles && !(lower_prob >= 0 && lower_prob <= upper_prob && upper_prob <= 1)) {
+        throw std::runtime_error("quantiles should satisfy 0 <= lower <= upper <= 1");
+    }
+
+    auto rptr = reinterpret_cast<const int32_t*>(rows);
+    std::vector<int> requested(rptr, rptr + nrows);
+    for (auto r : requested) {
+        if (r < 0 || static_cast<size_t>(r) >= NR) {
+            throw std::runtime_error("row indices should be less than the number of rows");
+        }
+    }
+
+    std::vector<SparseRow> extracted;
+    extract_sparse_rows(ptr.get(), requested, extracted, nthreads);
+
+    auto optr = reinterpret_cast<uint8_t*>(output);
+    auto rangeptr = reinterpret_cast<double*>(ranges);
+
+    run_parallel_old(nrows, [&](int first, int last) -> void {
+        std::vector<double> sorted;
+        for (int g = first; g < last; ++g) {
+            const auto& current = extracted[g];
+            size_t nzeros = NC - current.value.size();
+            double lower = 0, upper = 0;
+
+            if (NC) {
+                sorted = current.value;
+                std::sort(sorted.begin(), sorted.end());
+                size_t nneg = std::lower_bound(sorted.begin(), sorted.end(), 0.0) - sorted.begin();
+
+                if (use_quantiles) {
+                    lower = quantile(sorted, nneg, nzeros, lower_prob);
+                    upper = quantile(sorted, nneg, nzeros, upper_prob);
+                } else {
+                    lower = value_at(sorted, nneg, nzeros, 0);
+                    upper = value_at(sorted, nneg, nzeros, NC - 1);
+                }
+            }
+
+            rangeptr[2 * g] = lower;
+            rangeptr[2 * g + 1] = upper;
+
+            double scale = (upper > lower ? 255 / (upper - lower) : 0);
+            auto out = optr + static_cast<size_t>(g) * NC;
+            std::fill(out, out + NC, quantize(0, lower, scale));
+            for (size_t k = 0, nnz = current.index.size(); k < nnz; ++k) {
+                out[current.index[k]] = quantize(current.value[k], lower, scale);
+            }
+        }
+    }, nthreads);
+
+    return;
+}
+
+EMSCRIPTEN_BINDINGS(quantize_expression) {
+    emscripten::function("quantize_expression", &quantize_expression);
+}
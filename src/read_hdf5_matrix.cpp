@@ -9,13 +9,6 @@
 #include "H5Cpp.h"
 #include "tatami_hdf5/tatami_hdf5.hpp"
 
-struct Hdf5MatrixDetails {
-    bool is_dense;
-    bool csc = true;
-    bool is_integer;
-    size_t nr, nc;
-};
-
 Hdf5MatrixDetails extract_hdf5_matrix_details_internal(const std::string& path, const std::string& name) {
     Hdf5MatrixDetails output;
     auto& is_dense = output.is_dense;
@@ -126,7 +119,8 @@ NumericMatrix read_hdf5_matrix_internal(
     int row_length,
     bool col_subset, 
     uintptr_t col_offset,
-    int col_length)
+    int col_length,
+    int nthreads)
 {
     if (!is_dense && !csc && !layered && !row_subset && !col_subset) {
         return NumericMatrix(new tatami::CompressedSparseRowMatrix<double, int, std::vector<T> >(
@@ -136,12 +130,19 @@ NumericMatrix read_hdf5_matrix_internal(
     } else {
         std::shared_ptr<tatami::Matrix<T, int> > mat;
         try {
+            // HDF5 library calls are not thread-safe, so the compressed sparse
+            // components are loaded into memory before the parallel conversion.
+            // Dense matrices are still read from the file on a single thread,
+            // as the dense array may be much larger than its sparse form.
             if (is_dense) {
                 mat.reset(new tatami_hdf5::Hdf5DenseMatrix<T, int, true>(path, name));
+                nthreads = 1;
             } else if (csc) {
-                mat.reset(new tatami_hdf5::Hdf5CompressedSparseMatrix<false, T, int>(nr, nc, path, name + "/data", name + "/indices", name + "/indptr"));
+                auto loaded = tatami_hdf5::load_hdf5_compressed_sparse_matrix<false, T, int, std::vector<T> >(nr, nc, path, name + "/data", name + "/indices", name + "/indptr");
+                mat.reset(new decltype(loaded)(std::move(loaded)));
             } else {
-                mat.reset(new tatami_hdf5::Hdf5CompressedSparseMatrix<true, T, int>(nr, nc, path, name + "/data", name + "/indices", name + "/indptr"));
+                auto loaded = tatami_hdf5::load_hdf5_compressed_sparse_matrix<true, T, int, std::vector<T> >(nr, nc, path, name + "/data", name + "/indices", name + "/indptr");
+                mat.reset(new decltype(loaded)(std::move(loaded)));
             }
 
         } catch (H5::Exception& e) {
@@ -162,7 +163,7 @@ NumericMatrix read_hdf5_matrix_internal(
             mat = std::move(smat);
         }
 
-        return sparse_from_tatami(mat.get(), layered);
+        return sparse_from_tatami(mat.get(), layered, nthreads);
     }
 }
 
@@ -176,7 +177,8 @@ NumericMatrix read_hdf5_matrix(
     int row_length,
     bool col_subset, 
     uintptr_t col_offset,
-    int col_length)
+    int col_length,
+    int nthreads)
 {
     auto details = extract_hdf5_matrix_details_internal(path, name);
     const auto& is_dense = details.is_dense;
@@ -185,9 +187,9 @@ NumericMatrix read_hdf5_matrix(
     const auto& nc = details.nc;
 
     if (force_integer || details.is_integer) {
-        return read_hdf5_matrix_internal<int>(nr, nc, is_dense, csc, path, name, layered, row_subset, row_offset, row_length, col_subset, col_offset, col_length);
+        return read_hdf5_matrix_internal<int>(nr, nc, is_dense, csc, path, name, layered, row_subset, row_offset, row_length, col_subset, col_offset, col_length, nthreads);
     } else {
-        return read_hdf5_matrix_internal<double>(nr, nc, is_dense, csc, path, name, false, row_subset, row_offset, row_length, col_subset, col_offset, col_length);
+        return read_hdf5_matrix_internal<double>(nr, nc, is_dense, csc, path, name, false, row_subset, row_offset, row_length, col_subset, col_offset, col_length, nthreads);
     }
 }
 
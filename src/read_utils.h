@@ -1,11 +1,13 @@
 #ifndef INIT_UTILS_HPP
 #define INIT_UTILS_HPP
 
+#include <string>
+
 #include "NumericMatrix.h"
 #include "parallel.h"
+#include "layered_utils.h"
 
 #include "tatami/tatami.hpp"
-#include "tatami_layered/tatami_layered.hpp"
 
 template<typename T, class X, class I, class P>
 NumericMatrix copy_into_sparse(size_t nrows, size_t ncols, const X& x, const I& i, const P& p) {
@@ -18,13 +20,26 @@ NumericMatrix copy_into_sparse(size_t nrows, size_t ncols, const X& x, const I&
     ));
 }
 
+// Only the layered conversion is parallelized. Non-layered conversions keep
+// the native value type in a CSC matrix, which is cheaper than a single
+// double-precision layer.
 template<class Matrix>
-NumericMatrix sparse_from_tatami(const Matrix* mat, bool layered) {
+NumericMatrix sparse_from_tatami(const Matrix* mat, bool layered, int nthreads) {
     if (layered) {
-        return NumericMatrix(tatami_layered::convert_to_layered_sparse(mat));
+        return NumericMatrix(convert_to_layered_sparse_parallel(mat, true, nthreads));
     } else {
         return NumericMatrix(tatami::convert_to_sparse<false, double, int, typename Matrix::value_type, typename Matrix::index_type>(mat));
     }
 }
 
+struct Hdf5MatrixDetails {
+    bool is_dense;
+    bool csc = true;
+    bool is_integer;
+    size_t nr, nc;
+};
+
+// Defined in read_hdf5_matrix.cpp.
+Hdf5MatrixDetails extract_hdf5_matrix_details_internal(const std::string& path, const std::string& name);
+
 #endif
@@ -5,6 +5,8 @@
 #include <algorithm>
 
 #include "NumericMatrix.h"
+#include "serialize_utils.h"
+#include "memo_cache.h"
 #include "parallel.h"
 
 #include "scran/scran.hpp"
@@ -36,8 +38,27 @@ public:
     int num_pcs() const {
         return store.variance_explained.size();
     }
+
+public:
+    size_t memory_size() const {
+        return (store.pcs.size() + store.variance_explained.size()) * sizeof(double);
+    }
 };
 
+/*
+ * Results are memoized on the matrix fingerprint, the feature subset and all
+ * parameters except the number of threads. Blocking factors are included in
+ * the key for the blocked variants.
+ */
+Fingerprint pca_fingerprint(const std::string& tag, const NumericMatrix& mat, int number, bool use_subset, uintptr_t subset, bool scale) {
+    Fingerprint fingerprint(mat.fingerprint);
+    fingerprint.add_string(tag).add_scalar<int32_t>(number).add_scalar<uint8_t>(scale).add_scalar<uint8_t>(use_subset);
+    if (use_subset) {
+        fingerprint.add_array(reinterpret_cast<const uint8_t*>(subset), mat.nrow());
+    }
+    return fingerprint;
+}
+
 const uint8_t* precheck_inputs(int number, size_t NC, bool use_subset, uintptr_t subset) {
     if (number < 1) {
         throw std::runtime_error("requested number of PCs should be positive");
@@ -60,12 +81,14 @@ SimplePca_Results run_pca(const NumericMatrix& mat, int number, bool use_subset,
     auto NC = ptr->ncol();
 
     auto subptr = precheck_inputs(number, NC, use_subset, subset);
-
-    scran::SimplePca pca;
-    pca.set_rank(number).set_scale(scale).set_num_threads(nthreads);
-    auto result = pca.run(ptr.get(), subptr);
-
-    return SimplePca_Results(std::move(result)); 
+    auto key = pca_fingerprint("run_pca", mat, number, use_subset, subset, scale).value();
+
+    return memo_cache().fetch<SimplePca_Results>(key, [&]() -> SimplePca_Results {
+        scran::SimplePca pca;
+        pca.set_rank(number).set_scale(scale).set_num_threads(nthreads);
+        auto result = pca.run(ptr.get(), subptr);
+        return SimplePca_Results(std::move(result)); 
+    }, [](const SimplePca_Results& x) -> size_t { return x.memory_size(); }, mat.memoizable);
 }
 
 using ResidualPca_Results = AnyPca_Results<scran::ResidualPca::Results>;
@@ -77,14 +100,18 @@ ResidualPca_Results run_residual_pca(const NumericMatrix& mat, int number, bool
 
     auto subptr = precheck_inputs(number, NC, use_subset, subset);
     auto bptr = reinterpret_cast<const int32_t*>(blocks);
-
-    scran::ResidualPca pca;
-    pca.set_rank(number).set_scale(scale).set_num_threads(nthreads);
-    pca.set_block_weight_policy(equal_weights ? scran::WeightPolicy::VARIABLE : scran::WeightPolicy::NONE);
-
-    auto result = pca.run(ptr.get(), bptr, subptr);
-
-    return ResidualPca_Results(std::move(result)); 
+    auto key = pca_fingerprint("run_residual_pca", mat, number, use_subset, subset, scale)
+        .add_scalar<uint8_t>(equal_weights)
+        .add_array(bptr, NC)
+        .value();
+
+    return memo_cache().fetch<ResidualPca_Results>(key, [&]() -> ResidualPca_Results {
+        scran::ResidualPca pca;
+        pca.set_rank(number).set_scale(scale).set_num_threads(nthreads);
+        pca.set_block_weight_policy(equal_weights ? scran::WeightPolicy::VARIABLE : scran::WeightPolicy::NONE);
+        auto result = pca.run(ptr.get(), bptr, subptr);
+        return ResidualPca_Results(std::move(result)); 
+    }, [](const ResidualPca_Results& x) -> size_t { return x.memory_size(); }, mat.memoizable);
 }
 
 using MultiBatchPca_Results = AnyPca_Results<scran::MultiBatchPca::Results>;
@@ -96,15 +123,53 @@ MultiBatchPca_Results run_multibatch_pca(const NumericMatrix& mat, int number, b
 
     auto subptr = precheck_inputs(number, NC, use_subset, subset);
     auto bptr = reinterpret_cast<const int32_t*>(blocks);
+    auto key = pca_fingerprint("run_multibatch_pca", mat, number, use_subset, subset, scale)
+        .add_scalar<uint8_t>(use_residuals)
+        .add_scalar<uint8_t>(equal_weights)
+        .add_array(bptr, NC)
+        .value();
+
+    return memo_cache().fetch<MultiBatchPca_Results>(key, [&]() -> MultiBatchPca_Results {
+        scran::MultiBatchPca pca;
+        pca.set_rank(number).set_scale(scale).set_num_threads(nthreads);
+        pca.set_use_residuals(use_residuals);
+        pca.set_block_weight_policy(equal_weights ? scran::WeightPolicy::VARIABLE : scran::WeightPolicy::NONE);
+        auto result = pca.run(ptr.get(), bptr, subptr);
+        return MultiBatchPca_Results(std::move(result));
+    }, [](const MultiBatchPca_Results& x) -> size_t { return x.memory_size(); }, mat.memoizable); 
+}
 
-    scran::MultiBatchPca pca;
-    pca.set_rank(number).set_scale(scale).set_num_threads(nthreads);
-    pca.set_use_residuals(use_residuals);
-    pca.set_block_weight_policy(equal_weights ? scran::WeightPolicy::VARIABLE : scran::WeightPolicy::NONE);
+/*
+ * All PCA results are saved from their arrays, so that the same function can
+ * be used regardless of the type of PCA. Loaded results are always returned
+ * as SimplePca_Results, as there is no difference in the available fields.
+ */
+static constexpr uint32_t pca_serialization_version = 1;
+
+SerializedBuffer save_pca_results(int num_pcs, int num_cells, uintptr_t pcs, uintptr_t variance_explained, double total_variance) {
+    SerializedBuffer output("PcaResults", pca_serialization_version);
+    output.write<int32_t>(num_pcs);
+    output.write<int32_t>(num_cells);
+    output.write_block(reinterpret_cast<const double*>(pcs), static_cast<size_t>(num_pcs) * static_cast<size_t>(num_cells));
+    output.write_block(reinterpret_cast<const double*>(variance_explained), num_pcs);
+    output.write(total_variance);
+    return output;
+}
+
+SimplePca_Results load_pca_results(uintptr_t buffer, size_t len) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("PcaResults", pca_serialization_version);
+    auto num_pcs = reader.read_scalar<int32_t>();
+    auto num_cells = reader.read_scalar<int32_t>();
 
-    auto result = pca.run(ptr.get(), bptr, subptr);
+    scran::SimplePca::Results store;
+    store.pcs.resize(num_pcs, num_cells);
+    reader.read_block(store.pcs.data(), static_cast<size_t>(num_pcs) * static_cast<size_t>(num_cells));
+    store.variance_explained.resize(num_pcs);
+    reader.read_block(store.variance_explained.data(), num_pcs);
+    store.total_variance = reader.read_scalar<double>();
 
-    return MultiBatchPca_Results(std::move(result)); 
+    return SimplePca_Results(std::move(store));
 }
 
 EMSCRIPTEN_BINDINGS(run_pca) {
@@ -114,6 +179,10 @@ EMSCRIPTEN_BINDINGS(run_pca) {
 
     emscripten::function("run_multibatch_pca", &run_multibatch_pca);
 
+    emscripten::function("save_pca_results", &save_pca_results);
+
+    emscripten::function("load_pca_results", &load_pca_results);
+
     emscripten::class_<SimplePca_Results>("SimplePca_Results")
         .function("pcs", &SimplePca_Results::pcs)
         .function("variance_explained", &SimplePca_Results::variance_explained)
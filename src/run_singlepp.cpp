@@ -3,6 +3,7 @@
 #include "NumericMatrix.h"
 #include "utils.h"
 #include "parallel.h"
+#include "serialize_utils.h"
 
 #define SINGLEPP_USE_ZLIB
 #include "singlepp/singlepp.hpp"
@@ -12,6 +13,11 @@
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <map>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+#include <cmath>
 
 /*****************************************/
 
@@ -66,10 +72,12 @@ SinglePPReference load_singlepp_reference(
 
 class BuiltSinglePPReference {
 public:
-    BuiltSinglePPReference(singlepp::BasicBuilder::PrebuiltIntersection b) : built(std::move(b)) {}
+    BuiltSinglePPReference(singlepp::BasicBuilder::PrebuiltIntersection b, size_t nf) : built(std::move(b)), nfeatures(nf) {}
 
     singlepp::BasicBuilder::PrebuiltIntersection built;
 
+    size_t nfeatures;
+
 public:
     size_t shared_features() const {
         return built.mat_subset.size();
@@ -78,6 +86,10 @@ public:
     size_t num_labels() const {
         return built.markers.size();
     }
+
+    size_t num_features() const {
+        return nfeatures;
+    }
 };
 
 BuiltSinglePPReference build_singlepp_reference(size_t nfeatures, uintptr_t mat_id, const SinglePPReference& ref, uintptr_t ref_id, int top, int nthreads) {
@@ -92,7 +104,112 @@ BuiltSinglePPReference build_singlepp_reference(size_t nfeatures, uintptr_t mat_
         ref.labels.data(),
         ref.markers
     );
-    return BuiltSinglePPReference(std::move(built));
+    return BuiltSinglePPReference(std::move(built), nfeatures);
+}
+
+/*****************************************/
+
+/*
+ * The built reference is saved as its markers, subsets and ranked profiles.
+ * Upon reloading, the neighbor search indices are reconstructed from the
+ * scaled ranks, which avoids the decompression and re-ranking of the
+ * original reference but still requires a rebuild of each index.
+ */
+static constexpr uint32_t singlepp_serialization_version = 1;
+
+SerializedBuffer save_built_singlepp_reference(const BuiltSinglePPReference& ref) {
+    SerializedBuffer output("BuiltSinglePPReference", singlepp_serialization_version);
+    const auto& built = ref.built;
+    output.write<uint64_t>(ref.nfeatures);
+    output.write(built.markers);
+    output.write(built.mat_subset);
+    output.write(built.ref_subset);
+
+    output.write<uint64_t>(built.references.size());
+    for (const auto& current : built.references) {
+        output.write(current.ranked);
+    }
+
+    return output;
+}
+
+BuiltSinglePPReference load_built_singlepp_reference(uintptr_t buffer, size_t len, int nthreads) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("BuiltSinglePPReference", singlepp_serialization_version);
+
+    auto nfeatures = reader.read_scalar<uint64_t>();
+    singlepp::Markers markers;
+    reader.read(markers);
+    std::vector<int> mat_subset, ref_subset;
+    reader.read(mat_subset);
+    reader.read(ref_subset);
+
+    auto nlabels = reader.read_scalar<uint64_t>();
+    std::vector<singlepp::Reference> references(nlabels);
+    for (auto& current : references) {
+        reader.read(current.ranked);
+    }
+    reader.finish();
+
+    // Validating the contents, as the classification indexes into these
+    // vectors without any further checks.
+    if (markers.size() != nlabels) {
+        throw std::runtime_error("number of marker lists should be equal to the number of labels");
+    }
+    size_t nsubset = mat_subset.size();
+    for (const auto& outer : markers) {
+        if (outer.size() != nlabels) {
+            throw std::runtime_error("each marker list should have length equal to the number of labels");
+        }
+        for (const auto& inner : outer) {
+            for (auto m : inner) {
+                if (m < 0 || static_cast<size_t>(m) >= nsubset) {
+                    throw std::runtime_error("marker indices should be less than the number of subsetted features");
+                }
+            }
+        }
+    }
+
+    if (ref_subset.size() != nsubset) {
+        throw std::runtime_error("reference and test subsets should have the same length");
+    }
+    for (auto s : mat_subset) {
+        if (s < 0 || static_cast<size_t>(s) >= nfeatures) {
+            throw std::runtime_error("subset indices should be less than the number of features");
+        }
+    }
+
+    for (const auto& current : references) {
+        for (const auto& ranked : current.ranked) {
+            if (ranked.size() != nsubset) {
+                throw std::runtime_error("ranked profiles should have length equal to the number of subsetted features");
+            }
+            for (const auto& r : ranked) {
+                if (r.second < 0 || static_cast<size_t>(r.second) >= nsubset) {
+                    throw std::runtime_error("ranked indices should be less than the number of subsetted features");
+                }
+            }
+        }
+    }
+
+    run_parallel_old(nlabels, [&](int first, int last) -> void {
+        for (int l = first; l < last; ++l) {
+            auto& current = references[l];
+            size_t nprofiles = current.ranked.size();
+            size_t NR = mat_subset.size();
+
+            std::vector<double> scaled(NR * nprofiles);
+            for (size_t p = 0; p < nprofiles; ++p) {
+                singlepp::scaled_ranks(current.ranked[p], scaled.data() + p * NR);
+            }
+            current.index.reset(new knncolle::KmknnEuclidean<int, double>(NR, nprofiles, scaled.data()));
+        }
+    }, nthreads);
+
+    return BuiltSinglePPReference(
+        singlepp::BasicBuilder::PrebuiltIntersection(std::move(markers), std::move(mat_subset), std::move(ref_subset), std::move(references)),
+        nfeatures
+    );
 }
 
 /*****************************************/
@@ -125,7 +242,7 @@ struct SinglePPResults {
     }
 
     emscripten::val get_delta() const {
-        return emscripten::val(emscripten::typed_memory_view(best.size(), best.data()));
+        return emscripten::val(emscripten::typed_memory_view(delta.size(), delta.data()));
     }
 };
 
@@ -161,17 +278,424 @@ SinglePPResults run_singlepp(const NumericMatrix& mat, const BuiltSinglePPRefere
 
 /*****************************************/
 
+/*
+ * Fine-tuning with caching of the marker-related work. For each distinct set
+ * of candidate labels, we compute the union of markers from all pairwise
+ * comparisons between those labels and the scaled ranks of the reference
+ * profiles for those markers. This is stored in a cache that is shared
+ * across cells (and threads), so that cells with the same candidates only
+ * need to rank their own expression values at the markers.
+ */
+struct FineTuneCacheEntry {
+    std::vector<int> markers;
+
+    // For each candidate label, a column-major matrix of scaled ranks
+    // where each column is a reference profile and each row is a marker.
+    std::vector<std::vector<double> > scaled;
+};
+
+template<typename Value_>
+void scale_tied_ranks(std::vector<std::pair<Value_, int> >& ranked, double* output) {
+    // Assumes that 'ranked' is already sorted by value.
+    size_t n = ranked.size();
+    size_t start = 0;
+    while (start < n) {
+        size_t end = start + 1;
+        while (end < n && ranked[end].first == ranked[start].first) {
+            ++end;
+        }
+        double average = (static_cast<double>(start) + static_cast<double>(end - 1)) / 2;
+        for (size_t i = start; i < end; ++i) {
+            output[ranked[i].second] = average;
+        }
+        start = end;
+    }
+
+    double center = (static_cast<double>(n) - 1) / 2;
+    double sum_squares = 0;
+    for (size_t i = 0; i < n; ++i) {
+        output[i] -= center;
+        sum_squares += output[i] * output[i];
+    }
+
+    if (sum_squares == 0) {
+        std::fill(output, output + n, 0);
+    } else {
+        double scale = 1 / std::sqrt(sum_squares);
+        for (size_t i = 0; i < n; ++i) {
+            output[i] *= scale;
+        }
+    }
+}
+
+double correlations_to_score(std::vector<double>& correlations, double quantile) {
+    size_t n = correlations.size();
+    if (n == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    } else if (n == 1) {
+        return correlations[0];
+    }
+
+    // Same interpolation as R's type 7 quantile.
+    double position = static_cast<double>(n - 1) * quantile;
+    size_t left = std::floor(position);
+    size_t right = std::ceil(position);
+
+    std::nth_element(correlations.begin(), correlations.begin() + right, correlations.end());
+    double rval = correlations[right];
+    if (left == right) {
+        return rval;
+    }
+
+    double lval = *std::max_element(correlations.begin(), correlations.begin() + right);
+    return lval + (rval - lval) * (position - static_cast<double>(left));
+}
+
+class FineTuneCache {
+public:
+    // The cache is limited by the estimated memory usage of its entries, in
+    // bytes, as the size of each entry scales with the number of markers and
+    // reference profiles. Entries are not stored once the budget is reached.
+    // No caching is performed if 'b = 0', which is useful for checking the
+    // cached results against a fresh calculation.
+    FineTuneCache(const singlepp::BasicBuilder::PrebuiltIntersection& b, size_t m) : built(b), budget(m) {}
+
+private:
+    const singlepp::BasicBuilder::PrebuiltIntersection& built;
+    size_t budget;
+    size_t used = 0;
+
+    std::mutex lock;
+    std::map<std::vector<int>, std::shared_ptr<const FineTuneCacheEntry> > entries;
+
+    static size_t size_of(const std::vector<int>& candidates, const FineTuneCacheEntry& entry) {
+        size_t size = sizeof(FineTuneCacheEntry) + (candidates.size() + entry.markers.size()) * sizeof(int);
+        for (const auto& current : entry.scaled) {
+            size += sizeof(current) + current.size() * sizeof(double);
+        }
+        return size;
+    }
+
+    std::shared_ptr<const FineTuneCacheEntry> create(const std::vector<int>& candidates, std::vector<int>& position) const {
+        auto entry = std::make_shared<FineTuneCacheEntry>();
+        auto& markers = entry->markers;
+        for (auto l1 : candidates) {
+            for (auto l2 : candidates) {
+                if (l1 != l2) {
+                    const auto& current = built.markers[l1][l2];
+                    markers.insert(markers.end(), current.begin(), current.end());
+                }
+            }
+        }
+        std::sort(markers.begin(), markers.end());
+        markers.erase(std::unique(markers.begin(), markers.end()), markers.end());
+
+        size_t nmarkers = markers.size();
+        for (size_t m = 0; m < nmarkers; ++m) {
+            position[markers[m]] = m;
+        }
+
+        entry->scaled.reserve(candidates.size());
+        std::vector<std::pair<double, int> > subranked;
+        subranked.reserve(nmarkers);
+
+        for (auto l : candidates) {
+            const auto& profiles = built.references[l].ranked;
+            entry->scaled.emplace_back(nmarkers * profiles.size());
+            auto& current = entry->scaled.back();
+
+            for (size_t p = 0; p < profiles.size(); ++p) {
+                subranked.clear();
+                for (const auto& x : profiles[p]) {
+                    auto pos = position[x.second];
+                    if (pos >= 0) {
+                        subranked.emplace_back(x.first, pos);
+                    }
+                }
+                scale_tied_ranks(subranked, current.data() + p * nmarkers);
+            }
+        }
+
+        for (auto m : markers) {
+            position[m] = -1;
+        }
+        return entry;
+    }
+
+public:
+    // 'position' should be a workspace of length equal to the number of
+    // subset features, filled with -1; it is restored on return.
+    std::shared_ptr<const FineTuneCacheEntry> get(const std::vector<int>& candidates, std::vector<int>& position) {
+        if (budget) {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = entries.find(candidates);
+            if (it != entries.end()) {
+                return it->second;
+            }
+        }
+
+        auto entry = create(candidates, position);
+
+        if (budget) {
+            size_t size = size_of(candidates, *entry);
+            std::lock_guard<std::mutex> guard(lock);
+            if (size <= budget - used && entries.find(candidates) == entries.end()) {
+                entries[candidates] = entry;
+                used += size;
+            }
+        }
+        return entry;
+    }
+};
+
+SinglePPResults run_singlepp_cached(const NumericMatrix& mat, const BuiltSinglePPReference& built, double quantile, double threshold, double max_cache_bytes, int nthreads) {
+    size_t nlabs = built.num_labels();
+    size_t NC =  mat.ptr->ncol();
+
+    // Computing the initial scores with singlepp, without fine-tuning.
+    std::vector<double> scores(nlabs * NC);
+    std::vector<double*> ptrs;
+    ptrs.reserve(nlabs);
+    for (size_t l = 0; l < nlabs; ++l) {
+        ptrs.push_back(scores.data() + NC * l);
+    }
+
+    SinglePPResults output;
+    output.best.resize(NC);
+    output.delta.resize(NC);
+
+    singlepp::BasicScorer runner;
+    runner.set_quantile(quantile).set_fine_tune(false).set_num_threads(nthreads);
+    runner.run(mat.ptr.get(), built.built, output.best.data(), ptrs, output.delta.data());
+
+    const auto& subset = built.built.mat_subset;
+    size_t NS = subset.size();
+    auto submat = tatami::make_DelayedSubset<0>(mat.ptr, subset);
+    FineTuneCache cache(built.built, static_cast<size_t>(max_cache_bytes));
+
+    run_parallel_old(NC, [&](int first, int last) -> void {
+        auto ext = submat->dense_column();
+        std::vector<double> buffer(NS);
+        std::vector<int> position(NS, -1);
+        std::vector<int> candidates, next;
+        std::vector<double> current_scores(nlabs);
+        std::vector<std::pair<double, int> > cell_ranked;
+        std::vector<double> cell_scaled;
+        std::vector<double> correlations;
+
+        for (int c = first; c < last; ++c) {
+            for (size_t l = 0; l < nlabs; ++l) {
+                current_scores[l] = scores[l * NC + c];
+            }
+
+            // Candidates are sorted by label index for use as a cache key.
+            candidates.clear();
+            auto max_score = *std::max_element(current_scores.begin(), current_scores.end());
+            for (size_t l = 0; l < nlabs; ++l) {
+                if (current_scores[l] >= max_score - threshold) {
+                    candidates.push_back(l);
+                }
+            }
+
+            // Keeping the results from the initial scoring if only one label
+            // is a candidate, or if all labels are candidates; this is the
+            // same behavior as singlepp's own fine-tuning.
+            if (candidates.size() == 1 || candidates.size() == nlabs) {
+                continue;
+            }
+
+            auto ptr = ext->fetch(c, buffer.data());
+            std::vector<double> round_scores;
+
+            while (candidates.size() > 1) {
+                auto entry = cache.get(candidates, position);
+                const auto& markers = entry->markers;
+                size_t nmarkers = markers.size();
+                if (nmarkers == 0) {
+                    break;
+                }
+
+                cell_ranked.clear();
+                for (size_t m = 0; m < nmarkers; ++m) {
+                    cell_ranked.emplace_back(ptr[markers[m]], m);
+                }
+                std::sort(cell_ranked.begin(), cell_ranked.end());
+                cell_scaled.resize(nmarkers);
+                scale_tied_ranks(cell_ranked, cell_scaled.data());
+
+                round_scores.clear();
+                for (size_t i = 0; i < candidates.size(); ++i) {
+                    const auto& scaled = entry->scaled[i];
+                    size_t nprofiles = scaled.size() / nmarkers;
+                    correlations.clear();
+                    for (size_t p = 0; p < nprofiles; ++p) {
+                        auto sptr = scaled.data() + p * nmarkers;
+                        double prod = 0;
+                        for (size_t m = 0; m < nmarkers; ++m) {
+                            prod += sptr[m] * cell_scaled[m];
+                        }
+                        correlations.push_back(prod);
+                    }
+                    round_scores.push_back(correlations_to_score(correlations, quantile));
+                }
+
+                size_t best_index = std::max_element(round_scores.begin(), round_scores.end()) - round_scores.begin();
+                double best_score = round_scores[best_index];
+                next.clear();
+                double second_score = -std::numeric_limits<double>::infinity();
+                for (size_t i = 0; i < candidates.size(); ++i) {
+                    if (round_scores[i] >= best_score - threshold) {
+                        next.push_back(candidates[i]);
+                    }
+                    if (i != best_index) {
+                        second_score = std::max(second_score, round_scores[i]);
+                    }
+                }
+
+                output.best[c] = candidates[best_index];
+                output.delta[c] = best_score - second_score;
+
+                if (next.size() == candidates.size()) {
+                    break;
+                }
+                candidates.swap(next);
+            }
+        }
+    }, nthreads);
+
+    output.scores.reset(new tatami::DenseColumnMatrix<double, int>(NC, nlabs, std::move(scores)));
+    return output;
+}
+
+/*****************************************/
+
+struct SinglePPChunkResults {
+    int ncells, nlabels, ntop;
+    std::vector<int> best;
+    std::vector<double> delta;
+    std::vector<double> scores;
+    std::vector<int> top_labels;
+    std::vector<double> top_scores;
+
+    int num_samples() const {
+        return ncells;
+    }
+
+    int num_labels() const {
+        return nlabels;
+    }
+
+    int num_top() const {
+        return ntop;
+    }
+
+    bool has_scores() const {
+        return !scores.empty();
+    }
+
+    emscripten::val get_best() const {
+        return emscripten::val(emscripten::typed_memory_view(best.size(), best.data()));
+    }
+
+    emscripten::val get_delta() const {
+        return emscripten::val(emscripten::typed_memory_view(delta.size(), delta.data()));
+    }
+
+    emscripten::val get_scores_for_label(int l) const {
+        return emscripten::val(emscripten::typed_memory_view(ncells, scores.data() + static_cast<size_t>(l) * ncells));
+    }
+
+    emscripten::val get_top_labels() const {
+        return emscripten::val(emscripten::typed_memory_view(top_labels.size(), top_labels.data()));
+    }
+
+    emscripten::val get_top_scores() const {
+        return emscripten::val(emscripten::typed_memory_view(top_scores.size(), top_scores.data()));
+    }
+};
+
+/*
+ * Classifies a contiguous block of columns, so that callers can process a
+ * large dataset in bounded memory by iterating over chunks. If 'top' is
+ * non-negative, only the top-scoring labels and their scores are retained
+ * for each cell, and the full score matrix for the chunk is discarded.
+ */
+SinglePPChunkResults run_singlepp_chunk(const NumericMatrix& mat, int start, int length, const BuiltSinglePPReference& built, double quantile, int top, int nthreads) {
+    if (start < 0 || length < 0 || start + length > mat.ncol()) {
+        throw std::runtime_error("chunk should lie within the columns of the matrix");
+    }
+
+    size_t nlabs = built.num_labels();
+    auto chunk = tatami::make_DelayedSubsetBlock<1>(mat.ptr, start, length);
+
+    SinglePPChunkResults output;
+    output.ncells = length;
+    output.nlabels = nlabs;
+    output.best.resize(length);
+    output.delta.resize(length);
+
+    std::vector<double> scores(nlabs * length);
+    std::vector<double*> ptrs;
+    ptrs.reserve(nlabs);
+    for (size_t l = 0; l < nlabs; ++l) {
+        ptrs.push_back(scores.data() + static_cast<size_t>(length) * l);
+    }
+
+    singlepp::BasicScorer runner;
+    runner.set_quantile(quantile).set_num_threads(nthreads);
+    runner.run(chunk.get(), built.built, output.best.data(), ptrs, output.delta.data());
+
+    if (top < 0) {
+        output.ntop = nlabs;
+        output.scores.swap(scores);
+        return output;
+    }
+
+    size_t ntop = std::min(static_cast<size_t>(top), nlabs);
+    output.ntop = ntop;
+    output.top_labels.resize(ntop * length);
+    output.top_scores.resize(ntop * length);
+
+    run_parallel_old(length, [&](int first, int last) -> void {
+        std::vector<std::pair<double, int> > collected(nlabs);
+        for (int c = first; c < last; ++c) {
+            for (size_t l = 0; l < nlabs; ++l) {
+                collected[l].first = -scores[l * length + c]; // negating for a decreasing sort.
+                collected[l].second = l;
+            }
+            std::partial_sort(collected.begin(), collected.begin() + ntop, collected.end());
+
+            auto lptr = output.top_labels.data() + ntop * c;
+            auto sptr = output.top_scores.data() + ntop * c;
+            for (size_t i = 0; i < ntop; ++i) {
+                lptr[i] = collected[i].second;
+                sptr[i] = -collected[i].first;
+            }
+        }
+    }, nthreads);
+
+    return output;
+}
+
+/*****************************************/
+
 class IntegratedSinglePPReferences {
 public:
-    IntegratedSinglePPReferences(singlepp::IntegratedReferences x) : references(std::move(x)) {};
+    IntegratedSinglePPReferences(singlepp::IntegratedReferences x, size_t nf) : references(std::move(x)), nfeatures(nf) {};
 
     IntegratedSinglePPReferences() {};
 
     singlepp::IntegratedReferences references;
 
+    size_t nfeatures = 0;
+
     size_t num_references() const {
         return references.num_references();
     }
+
+    size_t num_features() const {
+        return nfeatures;
+    }
 };
 
 IntegratedSinglePPReferences integrate_singlepp_references(
@@ -202,7 +726,35 @@ IntegratedSinglePPReferences integrate_singlepp_references(
         );
     }
 
-    return IntegratedSinglePPReferences(inter.finish());
+    return IntegratedSinglePPReferences(inter.finish(), nfeatures);
+}
+
+SerializedBuffer save_integrated_singlepp_references(const IntegratedSinglePPReferences& integrated) {
+    SerializedBuffer output("IntegratedSinglePPReferences", singlepp_serialization_version);
+    const auto& refs = integrated.references;
+    output.write<uint64_t>(integrated.nfeatures);
+    output.write(refs.universe);
+    output.write(refs.check_availability);
+    output.write(refs.available);
+    output.write(refs.markers);
+    output.write(refs.ranked);
+    return output;
+}
+
+IntegratedSinglePPReferences load_integrated_singlepp_references(uintptr_t buffer, size_t len) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("IntegratedSinglePPReferences", singlepp_serialization_version);
+
+    IntegratedSinglePPReferences output;
+    output.nfeatures = reader.read_scalar<uint64_t>();
+    auto& refs = output.references;
+    reader.read(refs.universe);
+    reader.read(refs.check_availability);
+    reader.read(refs.available);
+    reader.read(refs.markers);
+    reader.read(refs.ranked);
+    reader.finish();
+    return output;
 }
 
 SinglePPResults integrate_singlepp(const NumericMatrix& mat, uintptr_t assigned, const IntegratedSinglePPReferences& integrated, double quantile, int nthreads) {
@@ -243,6 +795,10 @@ SinglePPResults integrate_singlepp(const NumericMatrix& mat, uintptr_t assigned,
 EMSCRIPTEN_BINDINGS(run_singlepp) {
     emscripten::function("run_singlepp", &run_singlepp);
 
+    emscripten::function("run_singlepp_chunk", &run_singlepp_chunk);
+
+    emscripten::function("run_singlepp_cached", &run_singlepp_cached);
+
     emscripten::function("load_singlepp_reference", &load_singlepp_reference);
 
     emscripten::function("build_singlepp_reference", &build_singlepp_reference);
@@ -250,6 +806,14 @@ EMSCRIPTEN_BINDINGS(run_singlepp) {
     emscripten::function("integrate_singlepp_references", &integrate_singlepp_references);
 
     emscripten::function("integrate_singlepp", &integrate_singlepp);
+
+    emscripten::function("save_built_singlepp_reference", &save_built_singlepp_reference);
+
+    emscripten::function("load_built_singlepp_reference", &load_built_singlepp_reference);
+
+    emscripten::function("save_integrated_singlepp_references", &save_integrated_singlepp_references);
+
+    emscripten::function("load_integrated_singlepp_references", &load_integrated_singlepp_references);
     
     emscripten::class_<SinglePPReference>("SinglePPReference")
         .function("num_samples", &SinglePPReference::num_samples)
@@ -260,10 +824,12 @@ EMSCRIPTEN_BINDINGS(run_singlepp) {
     emscripten::class_<BuiltSinglePPReference>("BuiltSinglePPReference")
         .function("shared_features", &BuiltSinglePPReference::shared_features)
         .function("num_labels", &BuiltSinglePPReference::num_labels)
+        .function("num_features", &BuiltSinglePPReference::num_features)
         ;
 
     emscripten::class_<IntegratedSinglePPReferences>("IntegratedSinglePPReferences")
         .function("num_references", &IntegratedSinglePPReferences::num_references)
+        .function("num_features", &IntegratedSinglePPReferences::num_features)
         ;
 
     emscripten::class_<SinglePPResults>("SinglePPResults")
@@ -274,4 +840,16 @@ EMSCRIPTEN_BINDINGS(run_singlepp) {
         .function("get_scores_for_label", &SinglePPResults::get_scores_for_label)
         .function("get_delta", &SinglePPResults::get_delta)
         ;
+
+    emscripten::class_<SinglePPChunkResults>("SinglePPChunkResults")
+        .function("num_samples", &SinglePPChunkResults::num_samples) 
+        .function("num_labels", &SinglePPChunkResults::num_labels)
+        .function("num_top", &SinglePPChunkResults::num_top)
+        .function("has_scores", &SinglePPChunkResults::has_scores)
+        .function("get_best", &SinglePPChunkResults::get_best)
+        .function("get_delta", &SinglePPChunkResults::get_delta)
+        .function("get_scores_for_label", &SinglePPChunkResults::get_scores_for_label)
+        .function("get_top_labels", &SinglePPChunkResults::get_top_labels)
+        .function("get_top_scores", &SinglePPChunkResults::get_top_scores)
+        ;
 }
@@ -3,6 +3,7 @@
 #include "utils.h"
 #include "parallel.h"
 #include "NeighborIndex.h"
+#include "serialize_utils.h"
 #include "qdtsne/qdtsne.hpp"
 
 #include <vector>
@@ -14,17 +15,19 @@
 struct InitializedTsneStatus {
     typedef qdtsne::Tsne<>::Status<int> Status;
 
-    InitializedTsneStatus(Status s) : status(std::move(s)) {}
+    InitializedTsneStatus(Status s, double p) : status(std::move(s)), perplexity(p) {}
 
     Status status;
 
+    double perplexity;
+
 public:
     int iterations () const {
         return status.iteration();
     }
 
     InitializedTsneStatus deepcopy() const {
-        return InitializedTsneStatus(status);
+        return InitializedTsneStatus(status, perplexity);
     }
 
     int num_obs() const {
@@ -36,7 +39,7 @@ InitializedTsneStatus initialize_tsne(const NeighborResults& neighbors, double p
     qdtsne::Tsne factory;
     factory.set_perplexity(perplexity).set_num_threads(nthreads);
     factory.set_max_depth(7); // speed up iterations, avoid problems with duplicates.
-    return InitializedTsneStatus(factory.template initialize<>(neighbors.neighbors));
+    return InitializedTsneStatus(factory.template initialize<>(neighbors.neighbors), perplexity);
 }
 
 void randomize_tsne_start(size_t n, uintptr_t Y, int seed) {
@@ -64,6 +67,35 @@ void run_tsne(InitializedTsneStatus& status, int runtime, int maxiter, uintptr_t
     return;
 }
 
+/*
+ * The optimizer state is not exposed by qdtsne, so we only save the
+ * parameters and the current coordinates. Restoration re-initializes the
+ * status from the neighbors and starts from the saved coordinates, i.e.,
+ * the iteration counter is reset to zero.
+ */
+static constexpr uint32_t tsne_serialization_version = 1;
+
+SerializedBuffer save_tsne(const InitializedTsneStatus& status, uintptr_t Y) {
+    SerializedBuffer output("TsneStatus", tsne_serialization_version);
+    output.write(status.perplexity);
+    output.write<int32_t>(status.iterations());
+    size_t nobs = status.num_obs();
+    output.write_block(reinterpret_cast<const double*>(Y), nobs * 2);
+    return output;
+}
+
+InitializedTsneStatus load_tsne(uintptr_t buffer, size_t len, const NeighborResults& neighbors, uintptr_t Y, int nthreads) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("TsneStatus", tsne_serialization_version);
+    auto perplexity = reader.read_scalar<double>();
+    reader.read_scalar<int32_t>(); // iterations, not currently restorable.
+
+    auto output = initialize_tsne(neighbors, perplexity, nthreads);
+    size_t nobs = output.num_obs();
+    reader.read_block(reinterpret_cast<double*>(Y), nobs * 2);
+    return output;
+}
+
 EMSCRIPTEN_BINDINGS(run_tsne) {
     emscripten::function("perplexity_to_k", &perplexity_to_k);
 
@@ -73,6 +105,10 @@ EMSCRIPTEN_BINDINGS(run_tsne) {
 
     emscripten::function("run_tsne", &run_tsne);
 
+    emscripten::function("save_tsne", &save_tsne);
+
+    emscripten::function("load_tsne", &load_tsne);
+
     emscripten::class_<InitializedTsneStatus>("InitializedTsneStatus")
         .function("iterations", &InitializedTsneStatus::iterations)
         .function("deepcopy", &InitializedTsneStatus::deepcopy)
@@ -3,6 +3,7 @@
 #include "utils.h"
 #include "parallel.h"
 #include "NeighborIndex.h"
+#include "serialize_utils.h"
 
 #include "umappp/Umap.hpp"
 #include "knncolle/knncolle.hpp"
@@ -16,10 +17,12 @@
 struct InitializedUmapStatus {
     typedef umappp::Umap<>::Status Status;
 
-    InitializedUmapStatus(Status s) : status(std::move(s)) {}
+    InitializedUmapStatus(Status s, double md) : status(std::move(s)), min_dist(md) {}
 
     Status status;
 
+    double min_dist;
+
 public:
     int epoch() const {
         return status.epoch();
@@ -32,7 +35,7 @@ public:
     InitializedUmapStatus deepcopy(uintptr_t Y) const {
         auto copy = status;
         copy.set_embedding(reinterpret_cast<double*>(Y), false);
-        return InitializedUmapStatus(std::move(copy));
+        return InitializedUmapStatus(std::move(copy), min_dist);
     }
 
     int num_obs() const {
@@ -47,7 +50,7 @@ InitializedUmapStatus initialize_umap(const NeighborResults& neighbors, int num_
 
     // Don't move from neighbors; this means that we can easily re-use the
     // existing neighbors if someone wants to change the number of epochs.
-    return InitializedUmapStatus(factory.initialize(neighbors.neighbors, 2, embedding));
+    return InitializedUmapStatus(factory.initialize(neighbors.neighbors, 2, embedding), min_dist);
 }
 
 void run_umap(InitializedUmapStatus& status, int runtime) {
@@ -64,11 +67,45 @@ void run_umap(InitializedUmapStatus& status, int runtime) {
     }
 }
 
+/*
+ * Only the parameters and current coordinates are saved, as the epoch
+ * schedule is rebuilt from the neighbors upon restoration. The restored
+ * status starts from the saved coordinates with its epoch counter reset.
+ */
+static constexpr uint32_t umap_serialization_version = 1;
+
+SerializedBuffer save_umap(const InitializedUmapStatus& status, uintptr_t Y) {
+    SerializedBuffer output("UmapStatus", umap_serialization_version);
+    output.write<int32_t>(status.num_epochs());
+    output.write(status.min_dist);
+    output.write<int32_t>(status.epoch());
+    size_t nobs = status.num_obs();
+    output.write_block(reinterpret_cast<const double*>(Y), nobs * 2);
+    return output;
+}
+
+InitializedUmapStatus load_umap(uintptr_t buffer, size_t len, const NeighborResults& neighbors, uintptr_t Y, int nthreads) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("UmapStatus", umap_serialization_version);
+    auto num_epochs = reader.read_scalar<int32_t>();
+    auto min_dist = reader.read_scalar<double>();
+    reader.read_scalar<int32_t>(); // epoch, not currently restorable.
+
+    auto output = initialize_umap(neighbors, num_epochs, min_dist, Y, nthreads);
+    size_t nobs = output.num_obs();
+    reader.read_block(reinterpret_cast<double*>(Y), nobs * 2);
+    return output;
+}
+
 EMSCRIPTEN_BINDINGS(run_umap) {
     emscripten::function("initialize_umap", &initialize_umap);
 
     emscripten::function("run_umap", &run_umap);
 
+    emscripten::function("save_umap", &save_umap);
+
+    emscripten::function("load_umap", &load_umap);
+
     emscripten::class_<InitializedUmapStatus>("InitializedUmapStatus")
         .function("epoch", &InitializedUmapStatus::epoch)
         .function("num_epochs", &InitializedUmapStatus::num_epochs)
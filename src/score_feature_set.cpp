@@ -3,8 +3,15 @@
 #include "NumericMatrix.h"
 #include "utils.h"
 #include "parallel.h"
+#include "buffer_pool.h"
+#include "sparse_row_utils.h"
 
 #include "scran/scran.hpp"
+#include "tatami/tatami.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 
 struct ScoreFeatureSet_Results {
     typedef scran::ScoreFeatureSet::Results Store;
@@ -39,12 +46,188 @@ ScoreFeatureSet_Results score_feature_set(const NumericMatrix& mat, uintptr_t fe
     return ScoreFeatureSet_Results(std::move(output));
 }
 
+/*****************************************/
+
+struct ScoreFeatureSets_Results {
+    int ncells;
+    std::vector<std::vector<double> > all_weights;
+
+    // Pooled, as the JS wrapper copies the scores and immediately frees this
+    // object, so the storage can be recycled by the next call.
+    PooledBuffer all_scores;
+
+    int num_sets() const {
+        return all_weights.size();
+    }
+
+    emscripten::val weights(int s) const {
+        const auto& current = all_weights[s];
+        return emscripten::val(emscripten::typed_memory_view(current.size(), current.data()));
+    }
+
+    emscripten::val scores(int s) const {
+        return emscripten::val(emscripten::typed_memory_view(ncells, all_scores.data<double>() + static_cast<size_t>(s) * ncells));
+    }
+};
+
+ScoreFeatureSets_Results score_feature_sets(
+    const NumericMatrix& mat, 
+    int nsets, 
+    uintptr_t set_pointers, 
+    uintptr_t set_indices, 
+    bool use_blocks, 
+    uintptr_t blocks, 
+    bool scale, 
+    int nthreads) 
+{
+    size_t NR = mat.nrow();
+    size_t NC = mat.ncol();
+    const int32_t* pptr = reinterpret_cast<const int32_t*>(set_pointers);
+    const int32_t* iptr = reinterpret_cast<const int32_t*>(set_indices);
+
+    const int32_t* bptr = NULL;
+    if (use_blocks) {
+        bptr = reinterpret_cast<const int32_t*>(blocks);
+    }
+
+    // Collecting the union of all feature sets, so that each row only needs
+    // to be extracted once from the (possibly delayed) input matrix.
+    std::vector<int> remapping(NR, -1);
+    for (int s = 0; s < nsets; ++s) {
+        for (int32_t i = pptr[s], end = pptr[s + 1]; i < end; ++i) {
+            auto r = iptr[i];
+            if (r < 0 || static_cast<size_t>(r) >= NR) {
+                throw std::runtime_error("feature set indices should be non-negative and less than the number of rows");
+            }
+            remapping[r] = 0;
+        }
+    }
+
+    std::vector<int> in_union;
+    for (size_t r = 0; r < NR; ++r) {
+        if (remapping[r] == 0) {
+            remapping[r] = in_union.size();
+            in_union.push_back(r);
+        }
+    }
+
+    // The union is realized in memory so that each set's scorer does not
+    // have to go back to the (possibly delayed) input. Sparse inputs are
+    // realized in compressed sparse row form, so memory usage is proportional
+    // to the number of non-zero entries in the union rather than NU * NC;
+    // dense inputs are realized densely, which is no larger than the input.
+    size_t NU = in_union.size();
+    std::shared_ptr<const tatami::NumericMatrix> shared;
+    PooledBuffer realized_buffer;
+
+    if (mat.ptr->sparse()) {
+        std::vector<SparseRow> extracted;
+        extract_sparse_rows(mat.ptr.get(), in_union, extracted, nthreads);
+
+        std::vector<size_t> pointers(NU + 1);
+        for (size_t u = 0; u < NU; ++u) {
+            pointers[u + 1] = pointers[u] + extracted[u].index.size();
+        }
+
+        // Releasing each row as it is copied, to avoid holding two full
+        // copies of the union at once.
+        std::vector<double> values;
+        std::vector<int> indices;
+        values.reserve(pointers[NU]);
+        indices.reserve(pointers[NU]);
+        for (auto& row : extracted) {
+            values.insert(values.end(), row.value.begin(), row.value.end());
+            indices.insert(indices.end(), row.index.begin(), row.index.end());
+            std::vector<int>().swap(row.index);
+            std::vector<double>().swap(row.value);
+        }
+
+        shared.reset(new tatami::CompressedSparseRowMatrix<double, int, std::vector<double>, std::vector<int>, std::vector<size_t> >(
+            NU, NC, std::move(values), std::move(indices), std::move(pointers)
+        ));
+
+    } else {
+        // The dense submatrix is only needed for the duration of this call,
+        // so its storage is taken from (and returned to) the pool.
+        realized_buffer = PooledBuffer(NU * NC * sizeof(double));
+        double* realized = realized_buffer.data<double>();
+        auto sub = tatami::make_DelayedSubset<0>(mat.ptr, in_union);
+
+        if (sub->prefer_rows()) {
+            run_parallel_old(NU, [&](int first, int last) -> void {
+                auto ext = sub->dense_row();
+                for (int u = first; u < last; ++u) {
+                    ext->fetch_copy(u, realized + static_cast<size_t>(u) * NC);
+                }
+            }, nthreads);
+        } else {
+            run_parallel_old(NC, [&](int first, int last) -> void {
+                auto ext = sub->dense_column();
+                std::vector<double> buffer(NU);
+                for (int c = first; c < last; ++c) {
+                    auto ptr = ext->fetch(c, buffer.data());
+                    for (size_t u = 0; u < NU; ++u) {
+                        realized[u * NC + c] = ptr[u];
+                    }
+                }
+            }, nthreads);
+        }
+
+        shared.reset(new tatami::DenseRowMatrix<double, int, tatami::ArrayView<double> >(NU, NC, tatami::ArrayView<double>(realized, NU * NC)));
+    }
+
+    ScoreFeatureSets_Results output;
+    output.ncells = NC;
+    output.all_weights.resize(nsets);
+    output.all_scores = PooledBuffer(static_cast<size_t>(nsets) * NC * sizeof(double));
+
+    // Parallelizing across sets if there are enough of them, otherwise we
+    // process each set in turn and parallelize within the scorer.
+    bool across_sets = (nsets >= nthreads);
+
+    auto process = [&](int first, int last) -> void {
+        scran::ScoreFeatureSet scorer;
+        scorer.set_num_threads(across_sets ? 1 : nthreads);
+        scorer.set_scale(scale);
+
+        std::vector<uint8_t> features(NU);
+        for (int s = first; s < last; ++s) {
+            std::fill(features.begin(), features.end(), 0);
+            for (int32_t i = pptr[s], end = pptr[s + 1]; i < end; ++i) {
+                features[remapping[iptr[i]]] = 1;
+            }
+
+            auto res = scorer.run_blocked(shared.get(), features.data(), bptr);
+            output.all_weights[s] = std::move(res.weights);
+            std::copy(res.scores.begin(), res.scores.end(), output.all_scores.data<double>() + static_cast<size_t>(s) * NC);
+        }
+    };
+
+    if (across_sets) {
+        run_parallel_old(nsets, process, nthreads);
+    } else {
+        process(0, nsets);
+    }
+
+    return output;
+}
+
+/*****************************************/
+
 EMSCRIPTEN_BINDINGS(score_feature_set) {
     emscripten::function("score_feature_set", &score_feature_set);
 
+    emscripten::function("score_feature_sets", &score_feature_sets);
+
     emscripten::class_<ScoreFeatureSet_Results>("ScoreFeatureSet_Results")
         .function("weights", &ScoreFeatureSet_Results::weights)
         .function("scores", &ScoreFeatureSet_Results::scores)
         ;
+
+    emscripten::class_<ScoreFeatureSets_Results>("ScoreFeatureSets_Results")
+        .function("num_sets", &ScoreFeatureSets_Results::num_sets)
+        .function("weights", &ScoreFeatureSets_Results::weights)
+        .function("scores", &ScoreFeatureSets_Results::scores)
+        ;
 }
 
@@ -2,6 +2,8 @@
 
 #include "NumericMatrix.h"
 #include "utils.h"
+#include "serialize_utils.h"
+#include "memo_cache.h"
 #include "parallel.h"
 
 #include "scran/scran.hpp"
@@ -68,6 +70,24 @@ public:
         return emscripten::val(emscripten::typed_memory_view(current.size(), current.data()));
     }
 
+    size_t memory_size() const {
+        size_t total = 0;
+        auto add = [&](const std::vector<std::vector<double> >& x) -> void {
+            for (const auto& y : x) {
+                total += y.size() * sizeof(double);
+            }
+        };
+        add(store.means);
+        add(store.detected);
+        for (const auto* effect : { &store.cohen, &store.auc, &store.lfc, &store.delta_detected }) {
+            for (const auto& summary : *effect) {
+                add(summary);
+            }
+        }
+        return total;
+    }
+
+public:
     emscripten::val delta_detected(int g, int s) const {
         const auto& current0 = store.delta_detected[s];
         if (current0.size() == 0) {
@@ -96,14 +116,60 @@ ScoreMarkers_Results score_markers(
         bptr = reinterpret_cast<const int32_t*>(blocks);
     }
 
-    scran::ScoreMarkers mrk;
-    mrk.set_summary_max(compute_med);
-    mrk.set_summary_median(compute_max);
-    mrk.set_num_threads(nthreads);
-    mrk.set_threshold(lfc_threshold);
-    mrk.set_compute_auc(compute_auc);
+    // Memoized on everything except the number of threads.
+    size_t NC = mat.ncol();
+    Fingerprint fingerprint(mat.fingerprint);
+    fingerprint.add_string("score_markers")
+        .add_scalar(lfc_threshold)
+        .add_scalar<uint8_t>(compute_auc)
+        .add_scalar<uint8_t>(compute_med)
+        .add_scalar<uint8_t>(compute_max)
+        .add_scalar<uint8_t>(use_blocks)
+        .add_array(gptr, NC);
+    if (use_blocks) {
+        fingerprint.add_array(bptr, NC);
+    }
 
-    auto store = mrk.run_blocked(mat.ptr.get(), gptr, bptr);
+    return memo_cache().fetch<ScoreMarkers_Results>(fingerprint.value(), [&]() -> ScoreMarkers_Results {
+        scran::ScoreMarkers mrk;
+        mrk.set_summary_max(compute_med);
+        mrk.set_summary_median(compute_max);
+        mrk.set_num_threads(nthreads);
+        mrk.set_threshold(lfc_threshold);
+        mrk.set_compute_auc(compute_auc);
+        auto store = mrk.run_blocked(mat.ptr.get(), gptr, bptr);
+        return ScoreMarkers_Results(std::move(store));
+    }, [](const ScoreMarkers_Results& x) -> size_t { return x.memory_size(); }, mat.memoizable);
+}
+
+static constexpr uint32_t markers_serialization_version = 1;
+
+SerializedBuffer save_marker_results(const ScoreMarkers_Results& results) {
+    const auto& store = results.store;
+    SerializedBuffer output("ScoreMarkers", markers_serialization_version);
+    output.write(store.means);
+    output.write(store.detected);
+    output.write(store.cohen);
+    output.write(store.auc);
+    output.write(store.lfc);
+    output.write(store.delta_detected);
+    return output;
+}
+
+ScoreMarkers_Results load_marker_results(uintptr_t buffer, size_t len) {
+    SerializedReader reader(buffer, len);
+    reader.check_header("ScoreMarkers", markers_serialization_version);
+
+    ScoreMarkers_Results::Store store;
+    reader.read(store.means);
+    reader.read(store.detected);
+    reader.read(store.cohen);
+    reader.read(store.auc);
+    reader.read(store.lfc);
+    reader.read(store.delta_detected);
+    if (store.means.size() != store.detected.size()) {
+        throw std::runtime_error("inconsistent number of groups in the serialized marker results");
+    }
 
     return ScoreMarkers_Results(std::move(store));
 }
@@ -111,6 +177,10 @@ ScoreMarkers_Results score_markers(
 EMSCRIPTEN_BINDINGS(score_markers) {
     emscripten::function("score_markers", &score_markers);
 
+    emscripten::function("save_marker_results", &save_marker_results);
+
+    emscripten::function("load_marker_results", &load_marker_results);
+
     emscripten::class_<ScoreMarkers_Results>("ScoreMarkers_Results")
         .function("means", &ScoreMarkers_Results::means)
         .function("detected", &ScoreMarkers_Results::detected)
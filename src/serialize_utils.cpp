@@ -0,0 +1,10 @@
+#include <emscripten/bind.h>
+#include "serialize_utils.h"
+
+EMSCRIPTEN_BINDINGS(serialize_utils) {
+    emscripten::class_<SerializedBuffer>("SerializedBuffer")
+        .function("size", &SerializedBuffer::size)
+        .function("buffer", &SerializedBuffer::buffer)
+        .function("offset", &SerializedBuffer::offset)
+        ;
+}
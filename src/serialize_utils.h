@@ -0,0 +1,228 @@
+#ifndef SERIALIZE_UTILS_H
+#define SERIALIZE_UTILS_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+#include <algorithm>
+#include <utility>
+
+#include <emscripten/bind.h>
+
+/*
+ * Minimal binary (de)serialization for the native objects, used when saving
+ * results to buffers that can be reloaded in a later session. Everything is
+ * stored in the native (little-endian) byte order of the Wasm heap, with
+ * vectors of arithmetic types copied in a single block. Vectors of other
+ * types are handled recursively, so nesting depth doesn't matter.
+ */
+
+class SerializedBuffer {
+public:
+    SerializedBuffer() {}
+
+    SerializedBuffer(std::string tag, uint32_t version) {
+        write_string(tag);
+        write_scalar(version);
+    }
+
+    std::vector<unsigned char> contents;
+
+public:
+    template<typename T>
+    void write_scalar(T x) {
+        static_assert(std::is_arithmetic<T>::value);
+        auto start = contents.size();
+        contents.resize(start + sizeof(T));
+        std::memcpy(contents.data() + start, &x, sizeof(T));
+    }
+
+    void write_string(const std::string& x) {
+        write_scalar<uint64_t>(x.size());
+        contents.insert(contents.end(), x.begin(), x.end());
+    }
+
+    template<typename T>
+    void write(T x) {
+        write_scalar(x);
+    }
+
+    template<typename A, typename B>
+    void write(const std::pair<A, B>& x) {
+        write(x.first);
+        write(x.second);
+    }
+
+    template<typename T>
+    void write_block(const T* x, size_t n) {
+        static_assert(std::is_arithmetic<T>::value);
+        write_scalar<uint64_t>(n);
+        auto start = contents.size();
+        auto nbytes = n * sizeof(T);
+        contents.resize(start + nbytes);
+        if (nbytes) {
+            std::memcpy(contents.data() + start, x, nbytes);
+        }
+    }
+
+    template<typename T>
+    void write(const std::vector<T>& x) {
+        if constexpr(std::is_arithmetic<T>::value) {
+            write_block(x.data(), x.size());
+        } else {
+            write_scalar<uint64_t>(x.size());
+            for (const auto& y : x) {
+                write(y);
+            }
+        }
+    }
+
+    template<typename T>
+    void write(const std::unordered_set<T>& x) {
+        // Sorting for a deterministic output.
+        std::vector<T> sorted(x.begin(), x.end());
+        std::sort(sorted.begin(), sorted.end());
+        write(sorted);
+    }
+
+public:
+    size_t size() const {
+        return contents.size();
+    }
+
+    emscripten::val buffer() const {
+        return emscripten::val(emscripten::typed_memory_view(contents.size(), contents.data()));
+    }
+
+    uintptr_t offset() const {
+        return reinterpret_cast<uintptr_t>(contents.data());
+    }
+};
+
+class SerializedReader {
+public:
+    SerializedReader(const unsigned char* p, size_t n) : ptr(p), remaining(n) {}
+
+    SerializedReader(uintptr_t p, size_t n) : SerializedReader(reinterpret_cast<const unsigned char*>(p), n) {}
+
+private:
+    const unsigned char* ptr;
+    size_t remaining;
+
+    void check(size_t n) const {
+        if (n > remaining) {
+            throw std::runtime_error("serialized buffer is truncated");
+        }
+    }
+
+public:
+    template<typename T>
+    T read_scalar() {
+        static_assert(std::is_arithmetic<T>::value);
+        check(sizeof(T));
+        T output;
+        std::memcpy(&output, ptr, sizeof(T));
+        ptr += sizeof(T);
+        remaining -= sizeof(T);
+        return output;
+    }
+
+    std::string read_string() {
+        auto n = read_scalar<uint64_t>();
+        check(n);
+        std::string output(reinterpret_cast<const char*>(ptr), n);
+        ptr += n;
+        remaining -= n;
+        return output;
+    }
+
+    void check_header(const std::string& tag, uint32_t version) {
+        if (read_string() != tag) {
+            throw std::runtime_error("serialized buffer does not contain a '" + tag + "' object");
+        }
+        if (read_scalar<uint32_t>() > version) {
+            throw std::runtime_error("serialized '" + tag + "' object was created by a newer version of scran.js");
+        }
+    }
+
+    template<typename T>
+    void read(T& x) {
+        x = read_scalar<T>();
+    }
+
+    template<typename A, typename B>
+    void read(std::pair<A, B>& x) {
+        read(x.first);
+        read(x.second);
+    }
+
+    // Reads a block written by SerializedBuffer::write_block() into a
+    // pre-allocated array, which should have length equal to 'n'.
+    template<typename T>
+    void read_block(T* x, size_t n) {
+        static_assert(std::is_arithmetic<T>::value);
+        if (read_scalar<uint64_t>() != n) {
+            throw std::runtime_error("unexpected length for a serialized array");
+        }
+        auto nbytes = n * sizeof(T);
+        check(nbytes);
+        if (nbytes) {
+            std::memcpy(x, ptr, nbytes);
+        }
+        ptr += nbytes;
+        remaining -= nbytes;
+    }
+
+    template<typename T>
+    void read(std::vector<T>& x) {
+        auto n = read_scalar<uint64_t>();
+        if constexpr(std::is_arithmetic<T>::value) {
+            // Dividing rather than multiplying, to avoid overflow for corrupt lengths.
+            if (n > remaining / sizeof(T)) {
+                throw std::runtime_error("serialized buffer is truncated");
+            }
+            auto nbytes = n * sizeof(T);
+            x.resize(n);
+            if (nbytes) {
+                std::memcpy(x.data(), ptr, nbytes);
+            }
+            ptr += nbytes;
+            remaining -= nbytes;
+        } else {
+            // Every serialized element occupies at least one byte, so this
+            // check ensures that corrupt lengths cannot trigger huge allocations.
+            check(n);
+            x.clear();
+            x.resize(n);
+            for (auto& y : x) {
+                read(y);
+            }
+        }
+    }
+
+    template<typename T>
+    void read(std::unordered_set<T>& x) {
+        std::vector<T> sorted;
+        read(sorted);
+        x.clear();
+        x.insert(sorted.begin(), sorted.end());
+    }
+
+    size_t left() const {
+        return remaining;
+    }
+
+    // Checks that the entire buffer has been consumed, as trailing bytes
+    // indicate that the buffer is corrupted or was not written for this object.
+    void finish() const {
+        if (remaining) {
+            throw std::runtime_error("serialized buffer contains trailing bytes");
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include <emscripten/bind.h>
+
+#include "parallel.h"
+#include "fingerprint.h"
+
+#include "knncolle/knncolle.hpp"
+#include "aarand/aarand.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+/*
+ * Geometric sketching (Hie et al., 2019). Coordinates are shifted and scaled
+ * so that the largest range is unity, and the space is partitioned into
+ * hypercubes of a common side length. We search for the largest side length
+ * that yields at least 'nsketch' non-empty boxes, and then sample one cell
+ * from each box in a random order, cycling through the boxes again if more
+ * cells are required. This favors rare populations that occupy their own
+ * boxes over dense populations that are spread across fewer boxes.
+ *
+ * Box identities are hashed into 64-bit fingerprints rather than stored as
+ * integer coordinates, which keeps memory usage independent of the number of
+ * dimensions; collisions are negligible at any realistic number of cells.
+ */
+
+namespace {
+
+void compute_box_keys(const double* ptr, int ndim, int ncells, const std::vector<double>& mins, double unit, std::vector<uint64_t>& keys, int nthreads) {
+    run_parallel_old(ncells, [&](int left, int right) -> void {
+        for (int c = left; c < right; ++c) {
+            auto current = ptr + static_cast<size_t>(c) * ndim;
+            Fingerprint fp;
+            for (int d = 0; d < ndim; ++d) {
+                fp.add_scalar<int64_t>(std::floor((current[d] - mins[d]) / unit));
+            }
+            keys[c] = fp.value();
+        }
+    }, nthreads);
+}
+
+size_t count_boxes(const std::vector<uint64_t>& keys, std::vector<uint64_t>& work) {
+    work = keys;
+    std::sort(work.begin(), work.end());
+    return std::unique(work.begin(), work.end()) - work.begin();
+}
+
+}
+
+void geometric_sketch(uintptr_t mat, int ndim, int ncells, int nsketch, int nsteps, int seed, uintptr_t output, int nthreads) {
+    if (nsketch <= 0) {
+        throw std::runtime_error("sketch size should be positive");
+    }
+
+    auto optr = reinterpret_cast<int32_t*>(output);
+    if (nsketch >= ncells) {
+        std::iota(optr, optr + ncells, 0);
+        return;
+    }
+
+    const double* ptr = reinterpret_cast<const double*>(mat);
+    std::vector<double> mins(ndim, std::numeric_limits<double>::infinity()), maxs(ndim, -std::numeric_limits<double>::infinity());
+    for (int c = 0; c < ncells; ++c) {
+        auto current = ptr + static_cast<size_t>(c) * ndim;
+        for (int d = 0; d < ndim; ++d) {
+            mins[d] = std::min(mins[d], current[d]);
+            maxs[d] = std::max(maxs[d], current[d]);
+        }
+    }
+
+    double range = 0;
+    for (int d = 0; d < ndim; ++d) {
+        range = std::max(range, maxs[d] - mins[d]);
+    }
+    if (range == 0) {
+        range = 1;
+    }
+
+    // Bisection on the side length, relative to the largest range. A side
+    // length of 1 puts (nearly) everything in one box, while the lower bound
+    // is halved until we get enough boxes or every cell is in its own box.
+    std::vector<uint64_t> keys(ncells), best_keys, work;
+    double lower = 0.5, upper = 1;
+    while (true) {
+        compute_box_keys(ptr, ndim, ncells, mins, lower * range, keys, nthreads);
+        size_t nboxes = count_boxes(keys, work);
+        if (nboxes >= static_cast<size_t>(nsketch) || lower < 1e-12) {
+            best_keys = keys;
+            break;
+        }
+        upper = lower;
+        lower /= 2;
+    }
+
+    for (int s = 0; s < nsteps; ++s) {
+        double mid = (lower + upper) / 2;
+        compute_box_keys(ptr, ndim, ncells, mins, mid * range, keys, nthreads);
+        if (count_boxes(keys, work) >= static_cast<size_t>(nsketch)) {
+            lower = mid;
+            best_keys.swap(keys);
+        } else {
+            upper = mid;
+        }
+    }
+
+    // Grouping cells by box.
+    std::vector<std::pair<uint64_t, int> > sorted;
+    sorted.reserve(ncells);
+    for (int c = 0; c < ncells; ++c) {
+        sorted.emplace_back(best_keys[c], c);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<std::vector<int> > boxes;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (i == 0 || sorted[i].first != sorted[i - 1].first) {
+            boxes.emplace_back();
+        }
+        boxes.back().push_back(sorted[i].second);
+    }
+
+    std::mt19937_64 rng(seed);
+    aarand::shuffle(boxes.begin(), boxes.size(), rng);
+    for (auto& b : boxes) {
+        aarand::shuffle(b.begin(), b.size(), rng);
+    }
+
+    // Round-robin across boxes; each box's cells were shuffled above, so
+    // taking them in order is equivalent to sampling without replacement.
+    int taken = 0;
+    for (size_t round = 0; taken < nsketch; ++round) {
+        for (const auto& b : boxes) {
+            if (round < b.size()) {
+                optr[taken] = b[round];
+                ++taken;
+                if (taken == nsketch) {
+                    break;
+                }
+            }
+        }
+    }
+
+    std::sort(optr, optr + nsketch);
+    return;
+}
+
+/*
+ * Propagation of sketch-level results back to all cells, by finding the
+ * nearest sketched cells for each cell in the full dataset. Labels are
+ * assigned by majority vote among the neighbors, with ties broken in favor
+ * of the closest neighbor; coordinates are averaged across the neighbors.
+ */
+
+namespace {
+
+void check_propagation_inputs(int nsketch, int k) {
+    if (nsketch <= 0) {
+        throw std::runtime_error("sketch should contain at least one cell");
+    }
+    if (k < 1) {
+        throw std::runtime_error("number of neighbors should be positive");
+    }
+}
+
+std::unique_ptr<knncolle::Base<> > build_sketch_index(const double* ptr, int ndim, int nsketch, const int32_t* sketch, bool approximate, std::vector<double>& buffer) {
+    buffer.resize(static_cast<size_t>(nsketch) * ndim);
+    for (int s = 0; s < nsketch; ++s) {
+        auto src = ptr + static_cast<size_t>(sketch[s]) * ndim;
+        std::copy(src, src + ndim, buffer.begin() + static_cast<size_t>(s) * ndim);
+    }
+
+    std::unique_ptr<knncolle::Base<> > output;
+    if (approximate) {
+        output.reset(new knncolle::AnnoyEuclidean<>(ndim, nsketch, buffer.data()));
+    } else {
+        output.reset(new knncolle::VpTreeEuclidean<>(ndim, nsketch, buffer.data()));
+    }
+    return output;
+}
+
+}
+
+void propagate_sketch_labels(uintptr_t mat, int ndim, int ncells, int nsketch, uintptr_t sketch, uintptr_t labels, int k, bool approximate, uintptr_t output, int nthreads) {
+    check_propagation_inputs(nsketch, k);
+    const double* ptr = reinterpret_cast<const double*>(mat);
+    std::vector<double> buffer;
+    auto index = build_sketch_index(ptr, ndim, nsketch, reinterpret_cast<const int32_t*>(sketch), approximate, buffer);
+
+    auto lptr = reinterpret_cast<const int32_t*>(labels);
+    auto optr = reinterpret_cast<int32_t*>(output);
+
+    run_parallel_old(ncells, [&](int left, int right) -> void {
+        std::vector<std::pair<int32_t, int> > counts;
+        for (int c = left; c < right; ++c) {
+            auto neighbors = index->find_nearest_neighbors(ptr + static_cast<size_t>(c) * ndim, k);
+
+            // Neighbors are sorted by distance, so the first label to reach
+            // the maximum count is also the closest among the tied labels.
+            counts.clear();
+            for (const auto& n : neighbors) {
+                auto l = lptr[n.first];
+                auto it = std::find_if(counts.begin(), counts.end(), [&](const std::pair<int32_t, int>& x) -> bool { return x.first == l; });
+                if (it == counts.end()) {
+                    counts.emplace_back(l, 1);
+                } else {
+                    ++(it->second);
+                }
+            }
+
+            int best = 0;
+            for (size_t i = 1; i < counts.size(); ++i) {
+                if (counts[i].second > counts[best].second) {
+                    best = i;
+                }
+            }
+            optr[c] = counts[best].first;
+        }
+    }, nthreads);
+
+    return;
+}
+
+void propagate_sketch_coordinates(uintptr_t mat, int ndim, int ncells, int nsketch, uintptr_t sketch, uintptr_t coordinates, int ncoords, int k, bool approximate, uintptr_t output, int nthreads) {
+    check_propagation_inputs(nsketch, k);
+    const double* ptr = reinterpret_cast<const double*>(mat);
+    std::vector<double> buffer;
+    auto index = build_sketch_index(ptr, ndim, nsketch, reinterpret_cast<const int32_t*>(sketch), approximate, buffer);
+
+    auto cptr = reinterpret_cast<const double*>(coordinates);
+    auto optr = reinterpret_cast<double*>(output);
+
+    run_parallel_old(ncells, [&](int left, int right) -> void {
+        for (int c = left; c < right; ++c) {
+            auto neighbors = index->find_nearest_neighbors(ptr + static_cast<size_t>(c) * ndim, k);
+            auto current = optr + static_cast<size_t>(c) * ncoords;
+            std::fill(current, current + ncoords, 0);
+
+            for (const auto& n : neighbors) {
+                auto src = cptr + static_cast<size_t>(n.first) * ncoords;
+                for (int d = 0; d < ncoords; ++d) {
+                    current[d] += src[d];
+                }
+            }
+
+            for (int d = 0; d < ncoords; ++d) {
+                current[d] /= neighbors.size();
+            }
+        }
+    }, nthreads);
+
+    return;
+}
+
+EMSCRIPTEN_BINDINGS(sketch_cells) {
+    emscripten::function("geometric_sketch", &geometric_sketch);
+
+    emscripten::function("propagate_sketch_labels", &propagate_sketch_labels);
+
+    emscripten::function("propagate_sketch_coordinates", &propagate_sketch_coordinates);
+}
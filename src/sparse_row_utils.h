@@ -0,0 +1,128 @@
+#ifndef SPARSE_ROW_UTILS_H
+#define SPARSE_ROW_UTILS_H
+
+#include <vector>
+
+#include "parallel.h"
+
+#include "tatami/tatami.hpp"
+
+/*
+ * Extraction of a subset of rows as sparse vectors, containing only the
+ * non-zero values and their (sorted) column indices. This is efficient for
+ * both row- and column-preferred matrices; in the latter case, each worker
+ * scans its own range of columns in a single pass, rather than extracting
+ * each row separately.
+ */
+
+struct SparseRow {
+    std::vector<int> index;
+    std::vector<double> value;
+};
+
+template<class Row_>
+void extract_sparse_rows(const tatami::NumericMatrix* mat, const std::vector<int>& rows, std::vector<Row_>& output, int nthreads) {
+    size_t NR = mat->nrow(), NC = mat->ncol();
+    size_t nrows = rows.size();
+    output.resize(nrows);
+    bool sparse = mat->sparse();
+
+    if (mat->prefer_rows()) {
+        run_parallel_old(nrows, [&](size_t first, size_t last) -> void {
+            std::vector<double> vbuffer(NC);
+            std::vector<int> ibuffer(NC);
+            auto sext = (sparse ? mat->sparse_row() : nullptr);
+            auto dext = (sparse ? nullptr : mat->dense_row());
+
+            for (size_t r = first; r < last; ++r) {
+                auto& current = output[r];
+                if (sparse) {
+                    auto range = sext->fetch(rows[r], vbuffer.data(), ibuffer.data());
+                    for (int k = 0; k < range.number; ++k) {
+                        if (range.value[k]) {
+                            current.index.push_back(range.index[k]);
+                            current.value.push_back(range.value[k]);
+                        }
+                    }
+                } else {
+                    auto ptr = dext->fetch(rows[r], vbuffer.data());
+                    for (size_t c = 0; c < NC; ++c) {
+                        if (ptr[c]) {
+                            current.index.push_back(c);
+                            current.value.push_back(ptr[c]);
+                        }
+                    }
+                }
+            }
+        }, nthreads);
+        return;
+    }
+
+    // Otherwise, each worker collects the non-zeros from its own range of
+    // columns, and these are concatenated in worker order so that the cell
+    // indices of each row remain sorted. Rows that are requested multiple
+    // times are only collected for their first request, and then copied to
+    // all other requests at the end.
+    std::vector<int> position(NR, -1);
+    std::vector<size_t> first_request(nrows);
+    for (size_t r = 0; r < nrows; ++r) {
+        auto& pos = position[rows[r]];
+        if (pos < 0) {
+            pos = r;
+        }
+        first_request[r] = pos;
+    }
+
+    std::vector<std::vector<SparseRow> > by_worker(nthreads);
+    run_parallel_new([&](int t, size_t start, size_t length) -> void {
+        auto& local = by_worker[t];
+        local.resize(nrows);
+        std::vector<double> vbuffer(NR);
+        std::vector<int> ibuffer(NR);
+        auto sext = (sparse ? mat->sparse_column() : nullptr);
+        auto dext = (sparse ? nullptr : mat->dense_column());
+
+        for (size_t c = start, end = start + length; c < end; ++c) {
+            if (sparse) {
+                auto range = sext->fetch(c, vbuffer.data(), ibuffer.data());
+                for (int k = 0; k < range.number; ++k) {
+                    auto pos = position[range.index[k]];
+                    if (pos >= 0 && range.value[k]) {
+                        local[pos].index.push_back(c);
+                        local[pos].value.push_back(range.value[k]);
+                    }
+                }
+            } else {
+                auto ptr = dext->fetch(c, vbuffer.data());
+                for (size_t r = 0; r < nrows; ++r) {
+                    if (first_request[r] != r) {
+                        continue;
+                    }
+                    auto val = ptr[rows[r]];
+                    if (val) {
+                        local[r].index.push_back(c);
+                        local[r].value.push_back(val);
+                    }
+                }
+            }
+        }
+    }, NC, nthreads);
+
+    for (size_t r = 0; r < nrows; ++r) {
+        auto& current = output[r];
+        if (first_request[r] != r) {
+            current = output[first_request[r]];
+            continue;
+        }
+        for (auto& local : by_worker) {
+            if (local.empty()) {
+                continue;
+            }
+            const auto& src = local[r];
+            current.index.insert(current.index.end(), src.index.begin(), src.index.end());
+            current.value.insert(current.value.end(), src.value.begin(), src.value.end());
+        }
+    }
+}
+
+#endif
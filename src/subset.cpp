@@ -6,6 +6,7 @@
 
 #include "NumericMatrix.h"
 #include "utils.h"
+#include "subset_utils.h"
 #include "parallel.h"
 
 #include "tatami/tatami.hpp"
@@ -13,14 +14,16 @@
 void column_subset(NumericMatrix& matrix, uintptr_t offset, size_t length) {
     auto offset_ptr = reinterpret_cast<const int*>(offset);
     check_subset_indices<false>(offset_ptr, length, matrix.ncol());
-    matrix.reset_ptr(tatami::make_DelayedSubset<1>(matrix.ptr, std::vector<int>(offset_ptr, offset_ptr + length)));
+    matrix.reset_ptr(subset_by_runs<1>(std::move(matrix.ptr), std::vector<int>(offset_ptr, offset_ptr + length)));
+    matrix.fingerprint = Fingerprint(matrix.fingerprint).add_string("column_subset").add_array(offset_ptr, length).value();
     return;
 }
 
 void row_subset(NumericMatrix& matrix, uintptr_t offset, size_t length) {
     auto offset_ptr = reinterpret_cast<const int*>(offset);
     check_subset_indices<true>(offset_ptr, length, matrix.nrow());
-    matrix.reset_ptr(tatami::make_DelayedSubset<0>(std::move(matrix.ptr), std::vector<int>(offset_ptr, offset_ptr + length)));
+    matrix.reset_ptr(subset_by_runs<0>(std::move(matrix.ptr), std::vector<int>(offset_ptr, offset_ptr + length)));
+    matrix.fingerprint = Fingerprint(matrix.fingerprint).add_string("row_subset").add_array(offset_ptr, length).value();
     return;
 }
 
@@ -0,0 +1,63 @@
+#ifndef SUBSET_UTILS_H
+#define SUBSET_UTILS_H
+
+#include <vector>
+#include <memory>
+#include <utility>
+
+#include "tatami/tatami.hpp"
+
+/*
+ * Subsetting that recognizes when the indices are sorted, unique and form a
+ * small number of contiguous runs, e.g., after QC filtering where most cells
+ * are retained in order. Each run is represented by a block subset, which
+ * passes the run boundaries directly to the seed's own block extraction; for
+ * compressed sparse seeds, this means that the run is sliced from the
+ * pointers without any remapping of each index. Multiple runs are combined
+ * with a delayed bind. All other cases fall back to a generic subset.
+ */
+
+// Beyond this number of runs, the overhead of binding outweighs the benefits.
+constexpr size_t max_subset_runs = 16;
+
+template<int margin_>
+std::shared_ptr<const tatami::NumericMatrix> subset_by_runs(std::shared_ptr<const tatami::NumericMatrix> mat, std::vector<int> indices) {
+    size_t full = (margin_ == 0 ? mat->nrow() : mat->ncol());
+    size_t n = indices.size();
+    if (n == 0) {
+        return tatami::make_DelayedSubset<margin_>(std::move(mat), std::move(indices));
+    }
+
+    std::vector<std::pair<int, int> > runs; // start and length of each run.
+    runs.emplace_back(indices[0], 1);
+    for (size_t i = 1; i < n; ++i) {
+        if (indices[i] <= indices[i - 1]) {
+            return tatami::make_DelayedSubset<margin_>(std::move(mat), std::move(indices));
+        }
+
+        if (indices[i] == indices[i - 1] + 1) {
+            ++(runs.back().second);
+        } else {
+            if (runs.size() == max_subset_runs) {
+                return tatami::make_DelayedSubset<margin_>(std::move(mat), std::move(indices));
+            }
+            runs.emplace_back(indices[i], 1);
+        }
+    }
+
+    if (runs.size() == 1) {
+        if (n == full) {
+            return mat; // no-op subset.
+        }
+        return tatami::make_DelayedSubsetBlock<margin_>(std::move(mat), runs[0].first, runs[0].second);
+    }
+
+    std::vector<std::shared_ptr<const tatami::NumericMatrix> > blocks;
+    blocks.reserve(runs.size());
+    for (const auto& r : runs) {
+        blocks.push_back(tatami::make_DelayedSubsetBlock<margin_>(mat, r.first, r.second));
+    }
+    return tatami::make_DelayedBind<margin_>(std::move(blocks));
+}
+
+#endif
@@ -74,3 +74,104 @@ test("aggregation works as expected", () => {
     mat.free();
     res.free();
 });
+
+test("sparse aggregation works as expected", () => {
+    var ngenes = 1000;
+    var ncells = 100;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+
+    var first = [];
+    var second = [];
+    for (var i = 0; i < ncells; i++) {
+        first.push(i % 3);
+        second.push(i % 4);
+    }
+
+    var res = scran.aggregateAcrossCellsSparse(mat, [ first, second ], { numberOfThreads: 2 });
+    expect(res.numberOfGroups()).toBe(12);
+    expect(res.numberOfGenes()).toBe(ngenes);
+
+    let combos = res.combinations();
+    expect(combos.length).toBe(2);
+    expect(Array.from(combos[0])).toEqual([0,0,0,0,1,1,1,1,2,2,2,2]);
+    expect(Array.from(combos[1])).toEqual([0,1,2,3,0,1,2,3,0,1,2,3]);
+
+    let groups = res.groups();
+    for (var i = 0; i < ncells; i++) {
+        expect(combos[0][groups[i]]).toBe(first[i]);
+        expect(combos[1][groups[i]]).toBe(second[i]);
+    }
+
+    // Comparing to the dense reference.
+    var ref = scran.aggregateAcrossCells(mat, groups);
+    let agmat = res.asMatrix();
+    let detmat = res.asMatrix({ detected: true });
+    for (var g = 0; g < 12; g++) {
+        let expected = ref.sums(g);
+        let observed = res.sums(g);
+        let densified = new Float64Array(ngenes);
+        observed.indices.forEach((r, i) => { densified[r] = observed.values[i]; });
+        expect(densified).toEqual(expected);
+        expect(agmat.column(g)).toEqual(expected);
+        expect(detmat.column(g)).toEqual(ref.detected(g));
+    }
+
+    // Works with averages.
+    {
+        var ares = scran.aggregateAcrossCellsSparse(mat, [ first, second ], { average: true });
+        let sizes = ares.groupSizes();
+        for (var g = 0; g < 12; g++) {
+            let expected = res.sums(g).values.map(x => x / sizes[g]);
+            expect(ares.sums(g).values).toEqual(expected);
+        }
+        ares.free();
+    }
+
+    expect(() => scran.aggregateAcrossCellsSparse(mat, [ first.slice(0, 10) ])).toThrow("number of columns");
+
+    // Cleaning up.
+    mat.free();
+    ref.free();
+    res.free();
+    agmat.free();
+    detmat.free();
+});
+
+test("sparse aggregation gives the same results for row- and column-preferred matrices", () => {
+    let ngenes = 200, ncells = 150;
+    let sim = simulate.simulateSparseData(ncells, ngenes);
+
+    // The layered matrix prefers row access, while the unlayered CSC matrix prefers column access.
+    let layered = scran.initializeSparseMatrixFromCompressedVectors(ngenes, ncells, sim.data, sim.indices, sim.indptrs, { byRow: false });
+    let csc = scran.initializeSparseMatrixFromCompressedVectors(ngenes, ncells, sim.data, sim.indices, sim.indptrs, { byRow: false, layered: false });
+
+    let first = [];
+    let second = [];
+    for (var i = 0; i < ncells; i++) {
+        first.push(i % 5);
+        second.push((i * 7) % 3);
+    }
+
+    for (const average of [ false, true ]) {
+        for (const nthreads of [ 1, 3 ]) {
+            let rowres = scran.aggregateAcrossCellsSparse(layered, [ first, second ], { average, numberOfThreads: nthreads });
+            let colres = scran.aggregateAcrossCellsSparse(csc, [ first, second ], { average, numberOfThreads: nthreads });
+            expect(rowres.numberOfGroups()).toBe(colres.numberOfGroups());
+            expect(rowres.groups()).toEqual(colres.groups());
+
+            for (var g = 0; g < colres.numberOfGroups(); g++) {
+                let expected = colres.sums(g);
+                let observed = rowres.sums(g);
+                expect(observed.indices).toEqual(expected.indices);
+                expect(observed.values).toEqual(expected.values);
+                expect(rowres.detected(g)).toEqual(colres.detected(g));
+            }
+
+            rowres.free();
+            colres.free();
+        }
+    }
+
+    layered.free();
+    csc.free();
+});
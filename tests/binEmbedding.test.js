@@ -0,0 +1,100 @@
+import * as scran from "../js/index.js";
+import * as compare from "./compare.js";
+import * as simulate from "./simulate.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+function referenceBins(x, y, nx, ny, range) {
+    let counts = new Int32Array(nx * ny);
+    let bins = new Int32Array(x.length);
+    let xwidth = (range.xmax - range.xmin) / nx;
+    let ywidth = (range.ymax - range.ymin) / ny;
+    for (var i = 0; i < x.length; i++) {
+        let bx = Math.min(nx - 1, Math.floor((x[i] - range.xmin) / xwidth));
+        let by = Math.min(ny - 1, Math.floor((y[i] - range.ymin) / ywidth));
+        if (bx < 0 || by < 0 || x[i] > range.xmax || y[i] > range.ymax) {
+            bins[i] = -1;
+            continue;
+        }
+        bins[i] = by * nx + bx;
+        counts[bins[i]]++;
+    }
+    return { counts, bins };
+}
+
+test("embedding binning works for counts, means and groups", () => {
+    let ncells = 1000;
+    let x = new Float64Array(ncells);
+    let y = new Float64Array(ncells);
+    let values = new Float64Array(ncells);
+    let groups = new Int32Array(ncells);
+    for (var i = 0; i < ncells; i++) {
+        x[i] = Math.random() * 10 - 5;
+        y[i] = Math.random() * 4;
+        values[i] = Math.random();
+        groups[i] = i % 3;
+    }
+
+    let res = scran.binEmbedding({ x, y }, { numberOfXBins: 10, numberOfYBins: 7, values, groups });
+    expect(res.range.xmin).toBe(Math.min(...x));
+    expect(res.range.ymax).toBe(Math.max(...y));
+    expect(res.counts.reduce((a, b) => a + b, 0)).toBe(ncells);
+
+    let ref = referenceBins(x, y, 10, 7, res.range);
+    expect(compare.equalArrays(res.counts, ref.counts)).toBe(true);
+
+    let sums = new Float64Array(70);
+    let gcounts = Array.from({ length: 70 }, () => [0, 0, 0]);
+    ref.bins.forEach((b, i) => {
+        sums[b] += values[i];
+        gcounts[b][groups[i]]++;
+    });
+    for (var b = 0; b < 70; b++) {
+        if (ref.counts[b] == 0) {
+            expect(Number.isNaN(res.means[b])).toBe(true);
+            expect(res.majority[b]).toBe(-1);
+        } else {
+            expect(Math.abs(res.means[b] - sums[b] / ref.counts[b])).toBeLessThan(1e-10);
+            expect(gcounts[b][res.majority[b]]).toBe(Math.max(...gcounts[b]));
+        }
+    }
+
+    // Same results for interleaved coordinates and multiple threads.
+    let interleaved = new Float64Array(2 * ncells);
+    x.forEach((v, i) => { interleaved[2 * i] = v; });
+    y.forEach((v, i) => { interleaved[2 * i + 1] = v; });
+    let res2 = scran.binEmbedding(interleaved, { numberOfXBins: 10, numberOfYBins: 7, numberOfThreads: 3 });
+    expect(compare.equalArrays(res2.counts, res.counts)).toBe(true);
+    expect(res2.means).toBeUndefined();
+    expect(res2.majority).toBeUndefined();
+
+    let res2b = scran.binEmbedding(interleaved, { numberOfXBins: 10, numberOfYBins: 7, values, groups, numberOfThreads: 3 });
+    expect(Array.from(res2b.means)).toEqual(Array.from(res.means));
+    expect(Array.from(res2b.majority)).toEqual(Array.from(res.majority));
+
+    // Points outside of a custom range are ignored.
+    let res3 = scran.binEmbedding({ x, y }, { numberOfXBins: 4, numberOfYBins: 4, range: { xmin: 0, xmax: 5, ymin: 0, ymax: 2 } });
+    let ref3 = referenceBins(x, y, 4, 4, { xmin: 0, xmax: 5, ymin: 0, ymax: 2 });
+    expect(compare.equalArrays(res3.counts, ref3.counts)).toBe(true);
+
+    expect(() => scran.binEmbedding({ x, y }, { values: [ 1 ] })).toThrow("length of 'values'");
+})
+
+test("embedding binning works with t-SNE status objects", () => {
+    var ndim = 5;
+    var ncells = 100;
+    var index = simulate.simulateIndex(ndim, ncells);
+
+    var init = scran.initializeTsne(index);
+    init.run({ maxIterations: 10 });
+    let coords = init.extractCoordinates();
+
+    let res = scran.binEmbedding(init, { numberOfXBins: 5, numberOfYBins: 5 });
+    let res2 = scran.binEmbedding(coords, { numberOfXBins: 5, numberOfYBins: 5 });
+    expect(compare.equalArrays(res.counts, res2.counts)).toBe(true);
+    expect(res.counts.reduce((a, b) => a + b, 0)).toBe(ncells);
+
+    init.free();
+    index.free();
+})
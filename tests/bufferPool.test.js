@@ -0,0 +1,137 @@
+import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
+import * as compare from "./compare.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+test("result buffers are recycled after freeing", () => {
+    var ngenes = 100;
+    var ncells = 50;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var subs = [ new Uint8Array(ngenes) ];
+    subs[0][0] = 1;
+
+    // Disabled by default.
+    var ref0 = scran.perCellRnaQcMetrics(mat, subs);
+    ref0.free();
+    let stats = scran.bufferPoolStatistics({ reset: true });
+    expect(stats.limit).toBe(0);
+    expect(stats.idle).toBe(0);
+
+    scran.setBufferPoolLimit(64 * 1024 * 1024);
+    var ref = scran.perCellRnaQcMetrics(mat, subs);
+    stats = scran.bufferPoolStatistics({ reset: true });
+    expect(stats.allocated).toBeGreaterThan(0);
+
+    ref.free();
+    expect(scran.bufferPoolStatistics().idle).toBeGreaterThan(0);
+
+    var qc = scran.perCellRnaQcMetrics(mat, subs);
+    stats = scran.bufferPoolStatistics({ reset: true });
+    expect(stats.reused).toBe(3);
+    expect(stats.allocated).toBe(0);
+    expect(stats.idle).toBe(0);
+
+    // Disabling the pool releases everything.
+    qc.free();
+    scran.setBufferPoolLimit(0);
+    expect(scran.bufferPoolStatistics().idle).toBe(0);
+
+    mat.free();
+})
+
+test("feature set scoring recycles its internal buffers", () => {
+    var ngenes = 100;
+    var ncells = 50;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+    var sets = [ [0, 1, 2, 3, 4], [10, 20, 30, 40] ];
+
+    var ref = scran.scoreFeatureSets(norm, sets);
+
+    scran.setBufferPoolLimit(64 * 1024 * 1024);
+    scran.clearBufferPool();
+    var first = scran.scoreFeatureSets(norm, sets);
+    scran.bufferPoolStatistics({ reset: true });
+    var second = scran.scoreFeatureSets(norm, sets);
+    let stats = scran.bufferPoolStatistics({ reset: true });
+    expect(stats.reused).toBe(1); // only the scores, as the union of a sparse matrix is not pooled.
+    expect(stats.allocated).toBe(0);
+
+    for (var s = 0; s < sets.length; s++) {
+        expect(compare.equalArrays(first[s].scores, ref[s].scores)).toBe(true);
+        expect(compare.equalArrays(second[s].scores, ref[s].scores)).toBe(true);
+    }
+
+    scran.setBufferPoolLimit(0);
+    mat.free();
+    norm.free();
+})
+
+test("QC metrics can be written into caller-provided buffers", () => {
+    var ngenes = 100;
+    var ncells = 50;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var subs = [ new Uint8Array(ngenes) ];
+    subs[0][0] = 1;
+    subs[0][5] = 1;
+
+    var ref = scran.perCellRnaQcMetrics(mat, subs);
+
+    let buffers = {
+        sums: scran.createFloat64WasmArray(ncells),
+        detected: scran.createInt32WasmArray(ncells),
+        subsetProportions: [ scran.createFloat64WasmArray(ncells) ]
+    };
+    var qc = scran.perCellRnaQcMetrics(mat, subs, { buffers });
+    expect(compare.equalArrays(buffers.sums.array(), ref.sums())).toBe(true);
+    expect(compare.equalArrays(buffers.detected.array(), ref.detected())).toBe(true);
+    expect(compare.equalArrays(buffers.subsetProportions[0].array(), ref.subsetProportions(0))).toBe(true);
+    expect(compare.equalArrays(qc.sums(), ref.sums())).toBe(true);
+
+    // Downstream functions work as usual.
+    var filt = scran.suggestRnaQcFilters(qc);
+    var filt2 = scran.suggestRnaQcFilters(ref);
+    expect(compare.equalArrays(filt.thresholdsSums(), filt2.thresholdsSums())).toBe(true);
+
+    buffers.detected.free();
+    buffers.detected = scran.createInt32WasmArray(ncells + 1);
+    expect(() => scran.perCellRnaQcMetrics(mat, subs, { buffers })).toThrow("number of cells");
+
+    qc.free();
+    ref.free();
+    filt.free();
+    filt2.free();
+    buffers.sums.free();
+    buffers.detected.free();
+    buffers.subsetProportions[0].free();
+    mat.free();
+})
+
+test("k-means results can be written into caller-provided buffers", () => {
+    var ndim = 5;
+    var ncells = 200;
+    var k = 4;
+    var x = new Float64Array(ndim * ncells);
+    x.forEach((y, i) => x[i] = Math.random());
+
+    var ref = scran.clusterKmeans(x, k, { numberOfDims: ndim, numberOfCells: ncells });
+
+    let buffers = {
+        centers: scran.createFloat64WasmArray(ndim * k),
+        clusters: scran.createInt32WasmArray(ncells)
+    };
+    var res = scran.clusterKmeans(x, k, { numberOfDims: ndim, numberOfCells: ncells, buffers });
+    expect(compare.equalArrays(buffers.clusters.array(), ref.clusters())).toBe(true);
+    expect(compare.equalArrays(buffers.centers.array(), ref.clusterCenters())).toBe(true);
+    expect(compare.equalArrays(res.clusterSizes(), ref.clusterSizes())).toBe(true);
+    expect(res.iterations()).toBe(ref.iterations());
+
+    expect(() => scran.clusterKmeans(x, k + 1, { numberOfDims: ndim, numberOfCells: ncells, buffers })).toThrow("centers");
+
+    res.free();
+    ref.free();
+    buffers.centers.free();
+    buffers.clusters.free();
+})
@@ -122,3 +122,36 @@ test("cbindWithNames works correctly (duplicates)", () => {
     mat2.free();
     mat3.free();
 })
+
+test("cbindWithNames works correctly with realization", () => {
+    var mat1 = simulate.simulateMatrix(50, 10);
+    var names1 = [];
+    for (var i = 0; i < 50; i++) {
+        names1.push("Gene" + String(i));
+    }
+    var mat2 = simulate.simulateMatrix(40, 20);
+    var names2 = names1.slice(10).reverse();
+    var mat3 = simulate.simulateMatrix(30, 30);
+    var names3 = names1.slice(5, 35);
+
+    let ref = scran.cbindWithNames([mat1, mat2, mat3], [names1, names2, names3]);
+    let realized = scran.cbindWithNames([mat1, mat2, mat3], [names1, names2, names3], { realize: true, numberOfThreads: 2 });
+
+    expect(compare.equalArrays(ref.names, realized.names)).toBe(true);
+    expect(compare.equalArrays(ref.indices, realized.indices)).toBe(true);
+    expect(realized.matrix.numberOfRows()).toBe(25);
+    expect(realized.matrix.isSparse()).toBe(true);
+    for (var c = 0; c < 60; c++) {
+        expect(compare.equalArrays(ref.matrix.column(c), realized.matrix.column(c))).toBe(true);
+    }
+    for (var r = 0; r < 25; r++) {
+        expect(compare.equalArrays(ref.matrix.row(r), realized.matrix.row(r))).toBe(true);
+    }
+
+    // Freeing all the bits and pieces.
+    ref.matrix.free();
+    realized.matrix.free();
+    mat1.free();
+    mat2.free();
+    mat3.free();
+})
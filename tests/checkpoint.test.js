@@ -0,0 +1,132 @@
+import * as scran from "../js/index.js";
+import * as fs from "fs";
+import * as simulate from "./simulate.js";
+import * as compare from "./compare.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+test("checkpoints save and restore analysis results", () => {
+    var ngenes = 500;
+    var ncells = 100;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+    var pca = scran.runPca(norm, { numberOfPCs: 5 });
+    var index = scran.buildNeighborSearchIndex(pca);
+    var neighbors = scran.findNearestNeighbors(index, 15);
+    var graph = scran.buildSnnGraph(neighbors);
+    var tsne = scran.initializeTsne(index, { perplexity: 5 });
+    tsne.run({ maxIterations: 50 });
+    var umap = scran.initializeUmap(index, { epochs: 50 });
+    umap.run();
+
+    var groups = new Int32Array(ncells).map((x, i) => i % 3);
+    var markers = scran.scoreMarkers(norm, groups);
+
+    var writer = scran.createCheckpointWriter();
+    writer.addMatrix("counts", mat);
+    writer.addMatrix("logcounts", norm);
+    writer.addPca("pca", pca);
+    writer.addNeighbors("neighbors", neighbors);
+    writer.addSnnGraph("graph", graph);
+    writer.addTsne("tsne", tsne);
+    writer.addUmap("umap", umap);
+    writer.addMarkers("markers", markers);
+    expect(writer.numberOfSections()).toBe(8);
+    expect(() => writer.addPca("pca", pca)).toThrow("duplicate");
+
+    var buffer = writer.save();
+    expect(writer.numberOfSections()).toBe(0);
+    writer.free();
+
+    var reader = scran.openCheckpoint(buffer);
+    let sections = reader.sections();
+    expect(sections.map(x => x.name)).toEqual(["counts", "logcounts", "pca", "neighbors", "graph", "tsne", "umap", "markers"]);
+    expect(sections[2].kind).toBe("pca");
+    expect(reader.has("pca")).toBe(true);
+    expect(reader.has("foo")).toBe(false);
+    expect(() => reader.restorePca("foo")).toThrow("no section");
+
+    // Checking that the matrices are the same.
+    var mat2 = reader.restoreMatrix("counts");
+    expect(mat2.isSparse()).toBe(true);
+    expect(mat2.numberOfRows()).toBe(ngenes);
+    expect(mat2.numberOfColumns()).toBe(ncells);
+    for (var c = 0; c < ncells; c += 10) {
+        expect(compare.equalArrays(mat2.column(c), mat.column(c))).toBe(true);
+    }
+
+    var norm2 = reader.restoreMatrix("logcounts");
+    expect(compare.equalArrays(norm2.row(5), norm.row(5))).toBe(true);
+
+    // Checking the other results.
+    var pca2 = reader.restorePca("pca");
+    expect(compare.equalArrays(pca2.principalComponents(), pca.principalComponents())).toBe(true);
+    expect(compare.equalArrays(pca2.varianceExplained(), pca.varianceExplained())).toBe(true);
+    expect(pca2.totalVariance()).toBe(pca.totalVariance());
+
+    var neighbors2 = reader.restoreNeighbors("neighbors");
+    expect(neighbors2.serialize()).toEqual(neighbors.serialize());
+
+    var graph2 = reader.restoreSnnGraph("graph");
+    var clust = scran.clusterSnnGraph(graph);
+    var clust2 = scran.clusterSnnGraph(graph2);
+    expect(compare.equalArrays(clust2.membership(), clust.membership())).toBe(true);
+
+    var tsne2 = reader.restoreTsne("tsne", neighbors2);
+    expect(tsne2.extractCoordinates()).toEqual(tsne.extractCoordinates());
+    expect(tsne2.iterations()).toBe(0);
+
+    var umap2 = reader.restoreUmap("umap", neighbors2);
+    expect(umap2.extractCoordinates()).toEqual(umap.extractCoordinates());
+    expect(umap2.totalEpochs()).toBe(umap.totalEpochs());
+
+    var markers2 = reader.restoreMarkers("markers");
+    expect(markers2.numberOfGroups()).toBe(3);
+    expect(compare.equalArrays(markers2.cohen(1), markers.cohen(1))).toBe(true);
+    expect(compare.equalArrays(markers2.auc(2), markers.auc(2))).toBe(true);
+
+    // Restoring from a file without compression.
+    const path = "checkpoint-test.bin";
+    var writer2 = scran.createCheckpointWriter();
+    writer2.addPca("pca", pca);
+    writer2.addNeighbors("neighbors", neighbors);
+    writer2.saveToFile(path, { compression: -1 });
+    writer2.free();
+
+    var reader2 = scran.openCheckpoint(path);
+    expect(reader2.sections().length).toBe(2);
+    var pca3 = reader2.restorePca("pca");
+    expect(compare.equalArrays(pca3.principalComponents(), pca.principalComponents())).toBe(true);
+    reader2.free();
+    fs.unlinkSync(path);
+
+    // Streaming to a file gives the same contents as saving to a buffer.
+    var writer3 = scran.createCheckpointWriter();
+    writer3.addPca("pca", pca);
+    writer3.addMarkers("markers", markers);
+    var inmemory = writer3.save();
+    writer3.free();
+
+    var writer4 = scran.createCheckpointWriter();
+    writer4.addPca("pca", pca);
+    writer4.addMarkers("markers", markers);
+    writer4.saveToFile(path);
+    writer4.free();
+    expect(new Uint8Array(fs.readFileSync(path))).toEqual(inmemory);
+    fs.unlinkSync(path);
+
+    // WasmArrays are copied upon opening, so they can be freed immediately.
+    var wasmbuffer = scran.createUint8WasmArray(inmemory.length);
+    wasmbuffer.set(inmemory);
+    var reader3 = scran.openCheckpoint(wasmbuffer);
+    wasmbuffer.free();
+    var pca4 = reader3.restorePca("pca");
+    expect(compare.equalArrays(pca4.principalComponents(), pca.principalComponents())).toBe(true);
+    reader3.free();
+    pca4.free();
+
+    for (const x of [ mat, norm, pca, index, neighbors, graph, tsne, umap, markers, reader, mat2, norm2, pca2, neighbors2, graph2, clust, clust2, tsne2, umap2, markers2, pca3 ]) {
+        x.free();
+    }
+});
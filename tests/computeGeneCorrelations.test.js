@@ -0,0 +1,113 @@
+import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+function pearson(x, y) {
+    let n = x.length;
+    let mx = x.reduce((a, b) => a + b, 0) / n;
+    let my = y.reduce((a, b) => a + b, 0) / n;
+    let sxy = 0, sxx = 0, syy = 0;
+    for (var i = 0; i < n; i++) {
+        sxy += (x[i] - mx) * (y[i] - my);
+        sxx += (x[i] - mx) * (x[i] - mx);
+        syy += (y[i] - my) * (y[i] - my);
+    }
+    return sxy / Math.sqrt(sxx * syy);
+}
+
+function ranks(x) {
+    let order = Array.from(x.keys()).sort((a, b) => x[a] - x[b]);
+    let output = new Float64Array(x.length);
+    let start = 0;
+    while (start < order.length) {
+        let end = start + 1;
+        while (end < order.length && x[order[end]] == x[order[start]]) {
+            end++;
+        }
+        for (var i = start; i < end; i++) {
+            output[order[i]] = (start + end + 1) / 2;
+        }
+        start = end;
+    }
+    return output;
+}
+
+function referencePartners(x, q, transform) {
+    let qrow = transform(x.row(q));
+    let all = [];
+    for (var t = 0; t < x.numberOfRows(); t++) {
+        if (t != q) {
+            let r = pearson(qrow, transform(x.row(t)));
+            if (!Number.isNaN(r)) {
+                all.push(r);
+            }
+        }
+    }
+    return all.sort((a, b) => b - a);
+}
+
+test("gene correlations are computed correctly", () => {
+    var ngenes = 40;
+    var ncells = 60;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    for (const method of [ "pearson", "spearman" ]) {
+        let transform = (method == "pearson" ? (y => y) : ranks);
+        let res = scran.computeGeneCorrelations(norm, { method, numberOfPartners: 5, queries: [ 0, 5, 20 ] });
+        expect(res.numberOfQueries()).toBe(3);
+
+        [ 0, 5, 20 ].forEach((q, i) => {
+            let ref = referencePartners(norm, q, transform);
+            let found = res.partners(i);
+            expect(found.indices.length).toBe(5);
+            for (var k = 0; k < 5; k++) {
+                expect(Math.abs(found.correlations[k] - ref[k])).toBeLessThan(1e-8);
+                expect(found.indices[k]).not.toBe(q);
+            }
+        });
+
+        res.free();
+    }
+
+    norm.free();
+    mat.free();
+})
+
+test("gene correlations respect thresholds, targets and block sizes", () => {
+    var ngenes = 40;
+    var ncells = 60;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    let full = scran.computeGeneCorrelations(norm, { numberOfPartners: 0 });
+    expect(full.numberOfQueries()).toBe(ngenes);
+
+    let blocked = scran.computeGeneCorrelations(norm, { numberOfPartners: 0, blockSize: 3, numberOfThreads: 2 });
+    for (var i = 0; i < ngenes; i++) {
+        expect(blocked.partners(i)).toEqual(full.partners(i));
+    }
+
+    let thresholded = scran.computeGeneCorrelations(norm, { numberOfPartners: 0, threshold: 0.1 });
+    for (var i = 0; i < ngenes; i++) {
+        let expected = full.partners(i).correlations.filter(r => r >= 0.1);
+        expect(Array.from(thresholded.partners(i).correlations)).toEqual(Array.from(expected));
+    }
+
+    let restricted = scran.computeGeneCorrelations(norm, { targets: [ 1, 2, 3 ], numberOfPartners: 0 });
+    for (const p of restricted.partners(0).indices) {
+        expect([ 1, 2, 3 ]).toContain(p);
+    }
+
+    expect(() => scran.computeGeneCorrelations(norm, { method: "foo" })).toThrow("method");
+    expect(() => scran.computeGeneCorrelations(norm, { queries: [ ngenes ] })).toThrow("number of rows");
+
+    full.free();
+    blocked.free();
+    thresholded.free();
+    restricted.free();
+    norm.free();
+    mat.free();
+})
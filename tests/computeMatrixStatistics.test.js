@@ -0,0 +1,87 @@
+import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+function referenceStatistics(values) {
+    let n = values.length;
+    let sum = values.reduce((a, b) => a + b, 0);
+    let mean = sum / n;
+    let variance = values.reduce((a, b) => a + (b - mean) * (b - mean), 0) / (n - 1);
+    let detected = values.filter(v => v != 0).length;
+    return { sum, mean, variance, detected, proportion: detected / n, min: Math.min(...values), max: Math.max(...values) };
+}
+
+function expectClose(left, right) {
+    expect(Math.abs(left - right)).toBeLessThan(1e-8 * (1 + Math.abs(right)));
+}
+
+const all = [ "sum", "mean", "variance", "detected", "proportion", "min", "max" ];
+
+test("matrix statistics are computed correctly for each margin", () => {
+    var ngenes = 50;
+    var ncells = 40;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    for (const x of [ mat, norm ]) {
+        let rowstats = scran.computeMatrixStatistics(x, { statistics: all });
+        for (var r = 0; r < ngenes; r++) {
+            let ref = referenceStatistics(Array.from(x.row(r)));
+            for (const s of all) {
+                expectClose(rowstats[s][r], ref[s]);
+            }
+        }
+
+        let colstats = scran.computeMatrixStatistics(x, { margin: "column", statistics: all, numberOfThreads: 3 });
+        for (var c = 0; c < ncells; c++) {
+            let ref = referenceStatistics(Array.from(x.column(c)));
+            for (const s of all) {
+                expectClose(colstats[s][c], ref[s]);
+            }
+        }
+    }
+
+    // Only the requested statistics are reported.
+    let sums = scran.computeMatrixStatistics(mat, { statistics: [ "sum" ] });
+    expect(Object.keys(sums)).toEqual([ "sum" ]);
+    expect(sums.sum.length).toBe(ngenes);
+
+    expect(() => scran.computeMatrixStatistics(mat, { statistics: [ "foo" ] })).toThrow("unknown statistic");
+    expect(() => scran.computeMatrixStatistics(mat, { margin: "foo" })).toThrow("margin");
+
+    mat.free();
+    norm.free();
+})
+
+test("matrix statistics can be computed within groups", () => {
+    var ngenes = 50;
+    var ncells = 40;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+
+    var groups = new Int32Array(ncells);
+    groups.forEach((x, i) => { groups[i] = i % 3; });
+
+    let stats = scran.computeMatrixStatistics(mat, { statistics: all, groups });
+    for (var g = 0; g < 3; g++) {
+        for (var r = 0; r < ngenes; r++) {
+            let row = mat.row(r);
+            let ref = referenceStatistics(Array.from(row).filter((x, i) => groups[i] == g));
+            for (const s of all) {
+                expectClose(stats[s][g][r], ref[s]);
+            }
+        }
+    }
+
+    // Empty groups are handled.
+    groups[0] = 4;
+    let stats2 = scran.computeMatrixStatistics(mat, { statistics: [ "sum", "mean" ], groups });
+    expect(stats2.sum.length).toBe(5);
+    expect(stats2.sum[3][0]).toBe(0);
+    expect(Number.isNaN(stats2.mean[3][0])).toBe(true);
+
+    expect(() => scran.computeMatrixStatistics(mat, { groups: [ 0, 1 ] })).toThrow("length of 'groups'");
+
+    mat.free();
+})
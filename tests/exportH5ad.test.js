@@ -0,0 +1,93 @@
+import * as scran from "../js/index.js";
+import * as fs from "fs";
+import * as hdf5 from "h5wasm";
+import * as simulate from "./simulate.js";
+import * as compare from "./compare.js";
+
+beforeAll(async () => {
+    await scran.initialize({ localFile: true });
+    await hdf5.ready;
+});
+afterAll(async () => { await scran.terminate() });
+
+const dir = "hdf5-test-files";
+if (!fs.existsSync(dir)) {
+    fs.mkdirSync(dir);
+}
+
+function purge(path) {
+    if (fs.existsSync(path)) {
+        fs.unlinkSync(path);
+    }
+}
+
+test("exporting results to H5AD works as expected", () => {
+    const path = dir + "/test.export.h5ad";
+    purge(path);
+
+    let ngenes = 200;
+    let ncells = 50;
+    let mat = simulate.simulateMatrix(ngenes, ncells);
+    scran.writeSparseMatrixToHdf5(mat, path, "X", { format: "csr_matrix" });
+
+    let pca = scran.runPca(mat, { numberOfPCs: 5 });
+    let tx = new Float64Array(ncells).map(Math.random);
+    let ty = new Float64Array(ncells).map(Math.random);
+    let sums = new Float64Array(ncells).map((x, i) => i * 1.5);
+    let clusters = Array.from(Array(ncells).keys()).map(i => "cluster_" + String(i % 3));
+    let genes = Array.from(Array(ngenes).keys()).map(i => "GENE_" + String(i));
+
+    scran.exportToH5ad(path, {
+        obs: { sums: sums, clusters: clusters },
+        var: { means: new Float64Array(ngenes) },
+        varNames: genes,
+        obsm: { X_pca: pca, X_tsne: [ tx, ty ] },
+        uns: { total: 100, method: "foo", vars: pca.varianceExplained({ copy: false }), params: { k: 10 } }
+    });
+
+    let f = new hdf5.File(path, "r");
+    expect(f.attrs["encoding-type"].value).toBe("anndata");
+    expect(f.get("X").attrs["encoding-type"].value).toBe("csr_matrix");
+
+    // Checking the embeddings.
+    let pcs = f.get("obsm/X_pca");
+    expect(pcs.shape).toEqual([ncells, 5]);
+    expect(compare.equalArrays(pcs.value, pca.principalComponents())).toBe(true);
+
+    let tsne = f.get("obsm/X_tsne");
+    expect(tsne.shape).toEqual([ncells, 2]);
+    let tvals = tsne.value;
+    expect(compare.equalArrays(tvals.filter((x, i) => i % 2 == 0), tx)).toBe(true);
+    expect(compare.equalArrays(tvals.filter((x, i) => i % 2 == 1), ty)).toBe(true);
+
+    // Checking the data frames.
+    let obs = f.get("obs");
+    expect(obs.attrs["encoding-type"].value).toBe("dataframe");
+    expect(obs.attrs["_index"].value).toBe("_index");
+    expect(Array.from(obs.attrs["column-order"].value)).toEqual(["sums", "clusters"]);
+    expect(f.get("obs/_index").value).toEqual(Array.from(Array(ncells).keys()).map(String));
+    expect(compare.equalArrays(f.get("obs/sums").value, sums)).toBe(true);
+
+    let cl = f.get("obs/clusters");
+    expect(cl.attrs["encoding-type"].value).toBe("categorical");
+    let levels = f.get("obs/clusters/categories").value;
+    let codes = f.get("obs/clusters/codes").value;
+    expect(Array.from(codes).map(i => levels[i])).toEqual(clusters);
+
+    expect(f.get("var/_index").value).toEqual(genes);
+    expect(f.get("var/means").value.length).toBe(ngenes);
+
+    // Checking the unstructured data.
+    expect(f.get("uns/total").value).toBe(100);
+    expect(f.get("uns/method").value).toBe("foo");
+    expect(compare.equalArrays(f.get("uns/vars").value, pca.varianceExplained())).toBe(true);
+    expect(f.get("uns/params").attrs["encoding-type"].value).toBe("dict");
+    expect(f.get("uns/params/k").value).toBe(10);
+    f.close();
+
+    // Errors on inconsistent lengths.
+    expect(() => scran.exportToH5ad(path, { obs: { sums: sums }, obsm: { X_tsne: [ tx.slice(1), ty.slice(1) ] } })).toThrow("not consistent");
+
+    mat.free();
+    pca.free();
+})
@@ -1,4 +1,5 @@
 import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
 
 beforeAll(async () => { await scran.initialize({ localFile: true }) });
 afterAll(async () => { await scran.terminate() });
@@ -96,6 +97,25 @@ test("dropUnusedLevels works as expected", () => {
     mapping = scran.dropUnusedLevels(arr);
     expect(arr).toEqual([1,2,0,3,1]);
     expect(mapping).toEqual([2,3,5,9]);
+
+    // Same ordering for all input types, even with multi-digit codes.
+    let codes = [10, 2, 33, 2, 100, 10];
+    let expected_ids = [1, 0, 2, 0, 3, 1];
+    let expected_mapping = [2, 10, 33, 100];
+
+    let wcodes = scran.createInt32WasmArray(codes.length);
+    wcodes.set(codes);
+    expect(scran.dropUnusedLevels(wcodes)).toEqual(expected_mapping);
+    expect(Array.from(wcodes.array())).toEqual(expected_ids);
+    wcodes.free();
+
+    let tcodes = new Int32Array(codes);
+    expect(scran.dropUnusedLevels(tcodes)).toEqual(expected_mapping);
+    expect(Array.from(tcodes)).toEqual(expected_ids);
+
+    let acodes = codes.slice();
+    expect(scran.dropUnusedLevels(acodes)).toEqual(expected_mapping);
+    expect(acodes).toEqual(expected_ids);
 })
 
 test("resetLevels works as expected", () => {
@@ -198,3 +218,42 @@ test("subsetFactor works as expected for TypedArray inputs", () => {
     }
 })
 
+
+test("native factorization is consistent with the JS implementation", () => {
+    let choices = ["alpha", "beta", "gamma", "delta", "épsilon", "zeta", ""];
+    let rng = simulate.createRandomGenerator(42);
+    let x = [];
+    for (var i = 0; i < 1000; i++) {
+        x.push(choices[Math.floor(rng() * choices.length)]);
+    }
+
+    let expected_levels = Array.from(new Set(x)).sort();
+    for (const nthreads of [1, 3]) {
+        let out = scran.convertToFactor(x, { numberOfThreads: nthreads, asWasmArray: false });
+        expect(out.levels).toEqual(expected_levels);
+        expect(Array.from(out.ids).map(i => out.levels[i])).toEqual(x);
+    }
+
+    // Works for numbers, with placeholders that collide with valid codes.
+    let y = x.map(s => s.length);
+    y[10] = Number.NaN;
+    let out = scran.convertToFactor(y, { numberOfThreads: 2, action: "none", placeholder: 0 });
+    let expected_num = Array.from(new Set(y.filter(Number.isFinite))).sort((a, b) => a - b);
+    expect(out.levels).toEqual(expected_num);
+    let ids = out.ids.array();
+    expect(ids[10]).toBe(0);
+    ids.forEach((id, i) => {
+        if (i != 10) {
+            expect(out.levels[id]).toBe(y[i]);
+        }
+    });
+
+    // Dropping and subsetting also works natively.
+    let sub = scran.subsetFactor(out, [1, 2, 3, 4, 5], { drop: false });
+    expect(Array.from(sub.ids.array())).toEqual(Array.from(ids.slice(1, 6)));
+    let mapping = scran.dropUnusedLevels(sub.ids);
+    expect(Array.from(sub.ids.array()).map(i => mapping[i])).toEqual(Array.from(ids.slice(1, 6)));
+
+    sub.ids.free();
+    out.ids.free();
+})
@@ -245,6 +245,59 @@ test("HDF5 numeric dataset creation works as expected", () => {
     expect(() => ghandle.writeDataSet("stuffZ", "Int32", [0], null)).toThrow(/null/)
 })
 
+test("HDF5 dataset writers work as expected", () => {
+    const path = dir + "/test.writer.h5";
+    purge(path)
+
+    let fhandle = scran.createNewHdf5File(path);
+    let ghandle = fhandle.createGroup("foo");
+
+    let NR = 1001, NC = 7;
+    let full = new Float64Array(NR * NC);
+    full.forEach((x, i) => { full[i] = Math.round(Math.random() * 1000) / 10; });
+
+    for (const compression of [ 6, -1 ]) {
+        let name = "stream" + String(compression);
+        let writer = ghandle.createDataSetWriter(name, "Float64", [NR, NC], { compression, chunkLength: 50 });
+
+        // Appending slabs of various sizes, including WasmArrays and partial chunks.
+        let sofar = 0;
+        for (const n of [ 3, 120, 1, 400, 471 ]) {
+            let slab = full.slice(sofar * NC, (sofar + n) * NC);
+            if (n % 2) {
+                let wrapped = scran.createFloat64WasmArray(slab.length);
+                wrapped.set(slab);
+                writer.append(wrapped, { numberOfThreads: 3 });
+                wrapped.free();
+            } else {
+                writer.append(slab);
+            }
+            sofar += n;
+            expect(writer.numberOfWritten()).toBe(sofar);
+        }
+
+        expect(() => writer.finish()).toThrow("less than");
+        let slab = full.slice(sofar * NC);
+        writer.append(slab);
+        let dhandle = writer.finish();
+        expect(dhandle.shape).toEqual([NR, NC]);
+        expect(compare.equalArrays(dhandle.load(), full)).toBe(true);
+
+        let f = new hdf5.File(path, "r");
+        expect(compare.equalArrays(f.get("foo/" + name).value, full)).toBe(true);
+        f.close();
+    }
+
+    // Conversion to a different type on disk.
+    let writer = ghandle.createDataSetWriter("ints", "Int32", [20]);
+    expect(() => writer.append(new Float64Array(21))).toThrow("exceed");
+    writer.append(new Float64Array(20).map((x, i) => i * 2));
+    let ihandle = writer.finish();
+    let loaded = ihandle.load();
+    expect(loaded instanceof Int32Array).toBe(true);
+    expect(Array.from(loaded)).toEqual(Array.from(Array(20).keys()).map(i => i * 2));
+})
+
 test("HDF5 string dataset creation works as expected", () => {
     const path = dir + "/test.write.h5";
     purge(path)
@@ -287,6 +340,39 @@ test("HDF5 string dataset creation works as expected", () => {
     expect(content3[2]).toBe("");
 })
 
+test("HDF5 variable-length string datasets work as expected", () => {
+    const path = dir + "/test.write.vls.h5";
+    purge(path)
+
+    let fhandle = scran.createNewHdf5File(path);
+    let ghandle = fhandle.createGroup("foo");
+
+    let barcodes = [];
+    for (var i = 0; i < 1000; i++) {
+        barcodes.push("ACGT".repeat(i % 5) + String(i));
+    }
+    barcodes[10] = "β-globin";
+    barcodes[20] = "";
+    barcodes[30] = "🧬 helix";
+
+    let dhandle = ghandle.writeDataSet("barcodes", "String", null, barcodes, { variableLength: true });
+    let vals = dhandle.load();
+    expect(vals).toEqual(barcodes);
+
+    let reloaded = new scran.H5DataSet(path, "foo/barcodes", { load: true });
+    expect(reloaded.values).toEqual(barcodes);
+
+    // Cross-checking with another reader.
+    let f = new hdf5.File(path, "r");
+    expect(f.get("foo/barcodes").value).toEqual(barcodes);
+    f.close();
+
+    // Also works for attributes.
+    dhandle.writeAttribute("vl_attr", "String", null, ["foo", "ß", ""], { variableLength: true });
+    let attr = dhandle.readAttribute("vl_attr");
+    expect(attr.values).toEqual(["foo", "ß", ""]);
+})
+
 test("HDF5 enum dataset creation and loading works as expected", () => {
     const path = dir + "/test.write.h5";
     purge(path)
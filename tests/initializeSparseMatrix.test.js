@@ -169,6 +169,32 @@ test("initialization from compressed values works with layering", () => {
     mat.free();
 })
 
+test("initialization from compressed values is consistent across threads", () => {
+    let nr = 100, nc = 50;
+    let sim = simulate.simulateSparseData(nc, nr, true);
+
+    let ref = scran.initializeSparseMatrixFromCompressedVectors(nr, nc, sim.data, sim.indices, sim.indptrs, { byRow: false, numberOfThreads: 1 });
+    let multi = scran.initializeSparseMatrixFromCompressedVectors(nr, nc, sim.data, sim.indices, sim.indptrs, { byRow: false, numberOfThreads: 3 });
+    let unlayered = scran.initializeSparseMatrixFromCompressedVectors(nr, nc, sim.data, sim.indices, sim.indptrs, { byRow: false, layered: false, numberOfThreads: 3 });
+
+    for (var r = 0; r < nr; r++) {
+        let expected = ref.row(r);
+        expect(compare.equalArrays(multi.row(r), expected)).toBe(true);
+        expect(compare.equalArrays(unlayered.row(r), expected)).toBe(true);
+    }
+    for (var c = 0; c < nc; c++) {
+        let expected = new Float64Array(nr);
+        for (var j = sim.indptrs[c]; j < sim.indptrs[c + 1]; j++) {
+            expected[sim.indices[j]] = sim.data[j];
+        }
+        expect(compare.equalArrays(multi.column(c), expected)).toBe(true);
+    }
+
+    ref.free();
+    multi.free();
+    unlayered.free();
+})
+
 function convertToMatrixMarket(nr, nc, data, indices, indptrs) {
     let triplets = [];
     for (var i = 0; i < nc; i++) {
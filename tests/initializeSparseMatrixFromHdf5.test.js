@@ -156,10 +156,17 @@ test("initialization from HDF5 works correctly with 10X inputs", () => {
     // Integer status is automatically detected, allowing the layering to be attempted.
     var mat2 = scran.initializeSparseMatrixFromHdf5(path, "foobar", { forceInteger: false });
 
+    // Same results with multiple threads.
+    var multi = scran.initializeSparseMatrixFromHdf5(path, "foobar", { numberOfThreads: 3 });
+    for (var c = 0; c < nc; c++) {
+        expect(compare.equalArrays(multi.column(c), mat.column(c))).toBe(true);
+    }
+
     // Freeing.
     mat.free();
     raw_mat.free();
     mat2.free();
+    multi.free();
 })
 
 test("initialization from HDF5 works correctly with H5AD inputs", () => {
@@ -207,9 +214,16 @@ test("initialization from HDF5 works correctly with H5AD inputs", () => {
     expect(mat2.numberOfColumns()).toBe(nc);
     expect(compare.equalArrays(mat2.row(0), ref)).toBe(true);
 
+    // Same results with multiple threads, which use row-wise conversion for CSR inputs.
+    var multi = scran.initializeSparseMatrixFromHdf5(path, "layers/counts", { numberOfThreads: 3 });
+    for (var r = 0; r < nr; r++) {
+        expect(compare.equalArrays(multi.row(r), mat2.row(r))).toBe(true);
+    }
+
     // Freeing.
     mat.free();
     mat2.free();
+    multi.free();
 })
 
 test("initialization from HDF5 works correctly with forced integers", () => {
@@ -432,3 +432,172 @@ test("multi-reference integration works correctly", () => {
     resA.free();
 });
 
+
+test("built and integrated references can be saved and reloaded", () => {
+    let mockids = mockIDs(nfeatures);
+    let test = simulate.simulateMatrix(nfeatures, 30);
+
+    let refA = mockReferenceData(nlabels, profiles_per_label, nfeatures, 20); 
+    let refinfoA = scran.loadLabelledReferenceFromBuffers(refA.ranks, refA.markers, refA.labels);
+    let builtA = scran.buildLabelledReference(mockids, refinfoA, mockids);
+
+    let savedA = scran.saveBuiltLabelledReference(builtA);
+    expect(savedA instanceof Uint8Array).toBe(true);
+    let reloadedA = scran.loadBuiltLabelledReferenceFromBuffer(savedA);
+    expect(reloadedA.sharedFeatures()).toBe(builtA.sharedFeatures());
+    expect(reloadedA.expectedNumberOfFeatures).toBe(nfeatures);
+
+    let resA = scran.labelCells(test, builtA);
+    let reresA = scran.labelCells(test, reloadedA);
+    expect(reresA.predictedLabels()).toEqual(resA.predictedLabels());
+    expect(reresA.scoresForLabel(0)).toEqual(resA.scoresForLabel(0));
+    expect(reresA.fineTuningDelta()).toEqual(resA.fineTuningDelta());
+
+    // Same for the integrated references.
+    let refB = mockReferenceData(nlabels, profiles_per_label, nfeatures, 20); 
+    let refinfoB = scran.loadLabelledReferenceFromBuffers(refB.ranks, refB.markers, refB.labels);
+    let builtB = scran.buildLabelledReference(mockids, refinfoB, mockids);
+    let resB = scran.labelCells(test, builtB);
+
+    let inter = scran.integrateLabelledReferences(mockids, [refinfoA, refinfoB], [mockids, mockids], [builtA, builtB]);
+    let reinter = scran.loadIntegratedLabelledReferencesFromBuffer(scran.saveIntegratedLabelledReferences(inter));
+    expect(reinter.numberOfReferences()).toBe(2);
+
+    let combined = scran.integrateCellLabels(test, [resA, resB], inter);
+    let recombined = scran.integrateCellLabels(test, [resA, resB], reinter);
+    expect(recombined.predictedReferences()).toEqual(combined.predictedReferences());
+    expect(recombined.scoresForReference(1)).toEqual(combined.scoresForReference(1));
+
+    // Fails for the wrong buffers.
+    expect(() => scran.loadBuiltLabelledReferenceFromBuffer(savedA.slice(0, 50))).toThrow("truncated");
+    expect(() => scran.loadIntegratedLabelledReferencesFromBuffer(savedA)).toThrow("does not contain");
+
+    // Corrupt lengths are caught before any allocation. The number of labels
+    // in the markers follows the header and the number of features.
+    let corrupted = savedA.slice();
+    let offset = 8 + "BuiltSinglePPReference".length + 4 + 8;
+    corrupted[offset + 6] = 127;
+    expect(() => scran.loadBuiltLabelledReferenceFromBuffer(corrupted)).toThrow("truncated");
+
+    // Trailing bytes are not allowed.
+    let extended = new Uint8Array(savedA.length + 1);
+    extended.set(savedA);
+    expect(() => scran.loadBuiltLabelledReferenceFromBuffer(extended)).toThrow("trailing");
+
+    // Out-of-range marker indices are caught. We skip the number of labels
+    // and the number of marker lists for the first label, and then corrupt
+    // the first index of the first non-empty list.
+    let badmarkers = savedA.slice();
+    let view = new DataView(badmarkers.buffer, badmarkers.byteOffset, badmarkers.byteLength);
+    let pos = offset + 16;
+    while (view.getBigUint64(pos, true) == 0n) {
+        pos += 8;
+    }
+    view.setInt32(pos + 8, 1000000, true);
+    expect(() => scran.loadBuiltLabelledReferenceFromBuffer(badmarkers)).toThrow("marker indices");
+
+    // Freeing all the bits and pieces.
+    for (const x of [ refinfoA, builtA, reloadedA, resA, reresA, refinfoB, builtB, resB, inter, reinter, test ]) {
+        x.free();
+    }
+});
+
+test("labelCellsInChunks gives the same results as labelCells", () => {
+    let ref = mockReferenceData(nlabels, profiles_per_label, nfeatures, 20); 
+    let refinfo = scran.loadLabelledReferenceFromBuffers(ref.ranks, ref.markers, ref.labels);
+
+    let ncells = 55;
+    let mat = simulate.simulateMatrix(nfeatures, ncells);
+    let mockids = mockIDs(nfeatures);
+    let built = scran.buildLabelledReference(mockids, refinfo, mockids);
+    let results = scran.labelCells(mat, built);
+    let best = results.predictedLabels();
+
+    // Keeping the top scores.
+    let chunks = Array.from(scran.labelCellsInChunks(mat, built, { chunkSize: 20, numberOfTopScores: 2 }));
+    expect(chunks.length).toBe(3);
+    expect(chunks[2].start).toBe(40);
+    expect(chunks[2].end).toBe(ncells);
+
+    for (const chunk of chunks) {
+        expect(chunk.predictedLabels).toEqual(best.slice(chunk.start, chunk.end));
+        expect(chunk.topLabels.length).toBe(2 * (chunk.end - chunk.start));
+        expect("scores" in chunk).toBe(false);
+
+        for (var c = chunk.start; c < chunk.end; c++) {
+            let expected = results.scoresForCell(c);
+            let i = c - chunk.start;
+            expect(chunk.topScores[2 * i]).toEqual(expected[chunk.topLabels[2 * i]]);
+            expect(chunk.topScores[2 * i] >= chunk.topScores[2 * i + 1]).toBe(true);
+            expect(chunk.topScores[2 * i]).toEqual(Math.max(...expected));
+        }
+    }
+
+    // Keeping all scores, which is the default.
+    for (const chunk of scran.labelCellsInChunks(mat, built, { chunkSize: 30 })) {
+        expect(chunk.scores.length).toBe(nlabels);
+        expect("topLabels" in chunk).toBe(false);
+        expect(chunk.scores[1]).toEqual(results.scoresForLabel(1).slice(chunk.start, chunk.end));
+        expect(chunk.fineTuningDelta.length).toBe(chunk.end - chunk.start);
+    }
+
+    expect(() => scran.labelCellsInChunks(mat, built, { chunkSize: 0 }).next()).toThrow("chunkSize");
+
+    refinfo.free();
+    built.free();
+    results.free();
+    mat.free();
+})
+
+test("labelCells works correctly with cached fine-tuning", () => {
+    let ref = mockReferenceData(nlabels, profiles_per_label, nfeatures, 20); 
+    let refinfo = scran.loadLabelledReferenceFromBuffers(ref.ranks, ref.markers, ref.labels);
+
+    let ncells = 50;
+    let mat = simulate.simulateMatrix(nfeatures, ncells);
+    let mockids = mockIDs(nfeatures);
+    let built = scran.buildLabelledReference(mockids, refinfo, mockids);
+
+    let results = scran.labelCells(mat, built);
+    let cached = scran.labelCells(mat, built, { cacheMarkers: true });
+    expect(cached.numberOfCells()).toBe(ncells);
+    expect(cached.numberOfLabels()).toBe(nlabels);
+
+    // Same results as singlepp's own fine-tuning. Deltas are subject to
+    // round-off as the correlations are computed differently.
+    for (var l = 0; l < nlabels; l++) {
+        expect(cached.scoresForLabel(l)).toEqual(results.scoresForLabel(l));
+    }
+    expect(cached.predictedLabels()).toEqual(results.predictedLabels());
+    let refdelta = results.fineTuningDelta();
+    cached.fineTuningDelta().forEach((x, i) => {
+        expect(x).toBeCloseTo(refdelta[i], 10);
+    });
+
+    // Without any fine-tuning candidates, the best label is the top-scoring one.
+    let nofine = scran.labelCells(mat, built, { cacheMarkers: true, fineTuneThreshold: 0 });
+    let best = nofine.predictedLabels();
+    for (var c = 0; c < ncells; c++) {
+        let scores = nofine.scoresForCell(c);
+        expect(scores[best[c]]).toEqual(Math.max(...scores));
+    }
+
+    // Results are independent of the number of threads.
+    let serial = scran.labelCells(mat, built, { cacheMarkers: true, numberOfThreads: 1 });
+    let parallel = scran.labelCells(mat, built, { cacheMarkers: true, numberOfThreads: 3 });
+    expect(serial.predictedLabels()).toEqual(parallel.predictedLabels());
+
+    // Cached results are the same as those from fresh calculations for each cell,
+    // as well as when the cache fills up.
+    let uncached = scran.labelCells(mat, built, { cacheMarkers: true, fineTuneCacheBytes: 0 });
+    expect(uncached.predictedLabels()).toEqual(cached.predictedLabels());
+    expect(uncached.fineTuningDelta()).toEqual(cached.fineTuningDelta());
+
+    let tiny = scran.labelCells(mat, built, { cacheMarkers: true, fineTuneCacheBytes: 2000 });
+    expect(tiny.predictedLabels()).toEqual(cached.predictedLabels());
+    expect(tiny.fineTuningDelta()).toEqual(cached.fineTuningDelta());
+
+    for (const x of [ refinfo, built, results, cached, nofine, serial, parallel, uncached, tiny, mat ]) {
+        x.free();
+    }
+})
@@ -0,0 +1,25 @@
+import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true, lazyThreads: true }) });
+afterAll(async () => { await scran.terminate() });
+
+test("computations work before and after lazy loading of threads", async () => {
+    let mat = simulate.simulateMatrix(1000, 200);
+    let norm = scran.logNormCounts(mat);
+
+    // Falls back to the main thread while the workers are loading.
+    let early = scran.modelGeneVariances(norm, { numberOfThreads: 3 });
+    let p = scran.loadThreads();
+    await p;
+
+    let late = scran.modelGeneVariances(norm, { numberOfThreads: 3 });
+    let serial = scran.modelGeneVariances(norm, { numberOfThreads: 1 });
+    expect(Array.from(early.variances())).toEqual(Array.from(serial.variances()));
+    expect(late.variances().length).toEqual(serial.variances().length);
+    late.variances().forEach((x, i) => { expect(x).toBeCloseTo(serial.variances()[i]); });
+
+    for (const x of [ mat, norm, early, late, serial ]) {
+        x.free();
+    }
+})
@@ -0,0 +1,123 @@
+import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
+import * as compare from "./compare.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+test("memoization cache reuses results for identical calls", () => {
+    var ngenes = 500;
+    var ncells = 100;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    // Disabled by default.
+    scran.memoizationStatistics({ reset: true });
+    var ref = scran.runPca(norm, { numberOfPCs: 5 });
+    var ref2 = scran.runPca(norm, { numberOfPCs: 5 });
+    let stats = scran.memoizationStatistics({ reset: true });
+    expect(stats.budget).toBe(0);
+    expect(stats.hits).toBe(0);
+    expect(stats.entries).toBe(0);
+
+    scran.setMemoizationBudget(10000000);
+    var pca1 = scran.runPca(norm, { numberOfPCs: 5 });
+    var pca2 = scran.runPca(norm, { numberOfPCs: 5 });
+    expect(compare.equalArrays(pca1.principalComponents(), pca2.principalComponents())).toBe(true);
+    expect(compare.equalArrays(pca1.principalComponents(), ref.principalComponents())).toBe(true);
+
+    // Freeing one copy doesn't affect the cache.
+    pca1.free();
+    var pca3 = scran.runPca(norm, { numberOfPCs: 5 });
+    expect(compare.equalArrays(pca3.principalComponents(), pca2.principalComponents())).toBe(true);
+
+    stats = scran.memoizationStatistics();
+    expect(stats.misses).toBe(1);
+    expect(stats.hits).toBe(2);
+    expect(stats.entries).toBe(1);
+    expect(stats.used).toBeGreaterThan(0);
+
+    // Different parameters lead to a miss, but the same chain of operations
+    // on the same seed yields a hit, even for different ScranMatrix objects.
+    var pca4 = scran.runPca(norm, { numberOfPCs: 4 });
+    var norm2 = scran.logNormCounts(mat);
+    var pca5 = scran.runPca(norm2, { numberOfPCs: 5 });
+    var sub = scran.subsetColumns(norm, [1,2,3,4,5,6,7,8,9,10]);
+    var pca6 = scran.runPca(sub, { numberOfPCs: 5 });
+    var sub2 = scran.subsetColumns(norm, [1,2,3,4,5,6,7,8,9,10]);
+    var pca7 = scran.runPca(sub2, { numberOfPCs: 5 });
+
+    stats = scran.memoizationStatistics({ reset: true });
+    expect(stats.misses).toBe(2);
+    expect(stats.hits).toBe(2);
+
+    // Same for the markers.
+    var groups = new Int32Array(ncells).map((x, i) => i % 3);
+    var mrk1 = scran.scoreMarkers(norm, groups);
+    var mrk2 = scran.scoreMarkers(norm, groups);
+    expect(compare.equalArrays(mrk1.cohen(1), mrk2.cohen(1))).toBe(true);
+    var mrk3 = scran.scoreMarkers(norm, groups.map(x => (x + 1) % 3));
+    stats = scran.memoizationStatistics();
+    expect(stats.hits).toBe(1);
+    expect(stats.misses).toBe(2);
+
+    // Evicts everything when the budget is too small.
+    scran.setMemoizationBudget(100);
+    stats = scran.memoizationStatistics();
+    expect(stats.entries).toBe(0);
+    expect(stats.evictions).toBeGreaterThan(0);
+
+    scran.setMemoizationBudget(10000000);
+    var pca8 = scran.runPca(norm, { numberOfPCs: 5 });
+    scran.clearMemoizationCache();
+    expect(scran.memoizationStatistics().entries).toBe(0);
+    scran.setMemoizationBudget(0);
+
+    for (const x of [ mat, norm, norm2, sub, sub2, ref, ref2, pca2, pca3, pca4, pca5, pca6, pca7, pca8, mrk1, mrk2, mrk3 ]) {
+        x.free();
+    }
+});
+
+test("memoization cache skips matrices that are views of mutable buffers", () => {
+    var ngenes = 50;
+    var ncells = 40;
+    var rng = simulate.createRandomGenerator(42);
+    var buffer = scran.createFloat64WasmArray(ngenes * ncells);
+    buffer.array().forEach((x, i, arr) => { arr[i] = rng(); });
+
+    var view = scran.ScranMatrix.createDenseMatrix(ngenes, ncells, buffer, { copy: false });
+    var copied = scran.ScranMatrix.createDenseMatrix(ngenes, ncells, buffer);
+    var sub = scran.subsetColumns(view, [1,2,3,4,5,6,7,8,9,10]);
+
+    scran.setMemoizationBudget(10000000);
+    scran.memoizationStatistics({ reset: true });
+    var pca1 = scran.runPca(view, { numberOfPCs: 5 });
+    var pcasub = scran.runPca(sub, { numberOfPCs: 5 });
+    let stats = scran.memoizationStatistics();
+    expect(stats.hits).toBe(0);
+    expect(stats.misses).toBe(0);
+    expect(stats.entries).toBe(0);
+
+    // Modifying the buffer in place is reflected in the next call.
+    buffer.array().forEach((x, i, arr) => { arr[i] = rng(); });
+    var pca2 = scran.runPca(view, { numberOfPCs: 5 });
+    expect(compare.equalArrays(pca1.principalComponents(), pca2.principalComponents())).toBe(false);
+    expect(compare.equalArrays(pca1.varianceExplained(), pca2.varianceExplained())).toBe(false);
+
+    var groups = new Int32Array(ncells).map((x, i) => i % 2);
+    var mrk = scran.scoreMarkers(view, groups);
+
+    // Copies are still memoized.
+    var pca3 = scran.runPca(copied, { numberOfPCs: 5 });
+    var pca4 = scran.runPca(copied, { numberOfPCs: 5 });
+    stats = scran.memoizationStatistics({ reset: true });
+    expect(stats.hits).toBe(1);
+    expect(stats.misses).toBe(1);
+    expect(stats.entries).toBe(1);
+
+    scran.clearMemoizationCache();
+    scran.setMemoizationBudget(0);
+    for (const x of [ buffer, view, copied, sub, pca1, pcasub, pca2, pca3, pca4, mrk ]) {
+        x.free();
+    }
+});
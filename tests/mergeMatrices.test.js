@@ -0,0 +1,157 @@
+import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
+import * as compare from "./compare.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+test("sparse matrix merger works correctly", () => {
+    var mat1 = simulate.simulateMatrix(20, 10);
+    var names1 = [];
+    for (var i = 0; i < 20; i++) {
+        names1.push("Gene" + String(i));
+    }
+    var mat2 = simulate.simulateMatrix(15, 20);
+    var names2 = names1.slice(5).reverse();
+    var mat3 = simulate.simulateMatrix(12, 30);
+    var names3 = names1.slice(0, 10).concat(["Foo", "Bar"]);
+
+    let merger = scran.createSparseMatrixMerger(names1);
+    merger.addMatrix(mat1, names1);
+    merger.addMatrix(mat2, names2, { numberOfThreads: 2 });
+    merger.addMatrix(mat3, names3);
+    expect(merger.numberOfFeatures()).toBe(20);
+    expect(merger.numberOfColumns()).toBe(60);
+
+    let merged = merger.finalize();
+    expect(merged.numberOfRows()).toBe(20);
+    expect(merged.numberOfColumns()).toBe(60);
+    expect(merged.isSparse()).toBe(true);
+    expect(() => merger.numberOfColumns()).toThrow("finalized");
+
+    // Comparing to a reference from manual alignment.
+    for (var c = 0; c < 10; c++) {
+        expect(compare.equalArrays(merged.column(c), mat1.column(c))).toBe(true);
+    }
+
+    for (var c = 0; c < 20; c++) {
+        let original = mat2.column(c);
+        let expected = new Float64Array(20);
+        names2.forEach((x, i) => { expected[Number(x.slice(4))] = original[i]; });
+        expect(compare.equalArrays(merged.column(c + 10), expected)).toBe(true);
+    }
+
+    for (var c = 0; c < 30; c++) {
+        let original = mat3.column(c);
+        let expected = new Float64Array(20);
+        for (var i = 0; i < 10; i++) {
+            expected[i] = original[i];
+        }
+        expect(compare.equalArrays(merged.column(c + 30), expected)).toBe(true);
+    }
+
+    // Same results as cbindWithNames.
+    let sub = scran.subsetRows(merged, [5, 6, 7, 8, 9]);
+    let ref = scran.cbindWithNames([mat1, mat2, mat3], [names1, names2, names3]);
+    for (var r = 0; r < 5; r++) {
+        expect(compare.equalArrays(sub.row(r), ref.matrix.row(r))).toBe(true);
+    }
+
+    sub.free();
+    ref.matrix.free();
+    merged.free();
+    mat1.free();
+    mat2.free();
+    mat3.free();
+})
+
+test("sparse matrix merger handles large and non-integer values", () => {
+    let names = ["A", "B", "C"];
+    let merger = scran.createSparseMatrixMerger(names);
+
+    let mat1 = scran.initializeSparseMatrixFromDenseArray(3, 2, [1, 0, 2, 0, 3, 0], { layered: false });
+    merger.addMatrix(mat1, names, { free: true });
+
+    let mat2 = scran.initializeSparseMatrixFromDenseArray(3, 2, [0, 1000, 0, 100000, 0, 0], { layered: false });
+    merger.addMatrix(mat2, ["C", "B", "A"], { free: true });
+
+    let mat3 = scran.initializeSparseMatrixFromDenseArray(3, 1, [0.5, 0, 1.5], { forceInteger: false });
+    merger.addMatrix(mat3, names, { free: true });
+
+    let merged = merger.finalize();
+    expect(compare.equalArrays(merged.row(0), [1, 0, 0, 0, 0.5])).toBe(true);
+    expect(compare.equalArrays(merged.row(1), [0, 3, 1000, 0, 0])).toBe(true);
+    expect(compare.equalArrays(merged.row(2), [2, 0, 0, 100000, 1.5])).toBe(true);
+    merged.free();
+})
+
+test("sparse matrix merger gives the same results with reserved space", () => {
+    let names = ["A", "B", "C"];
+    let dense = [ [1, 0, 2, 0, 3, 0], [0, 1000, 0, 100000, 0, 0], [0.5, 0, 1.5, 0, 2, 0] ];
+
+    let rows = [];
+    for (const expectedNonZero of [ null, 2, 100 ]) {
+        let merger = scran.createSparseMatrixMerger(names, { expectedNonZero });
+        for (const d of dense) {
+            let mat = scran.initializeSparseMatrixFromDenseArray(3, 2, d, { forceInteger: false, layered: false });
+            merger.addMatrix(mat, names, { free: true });
+        }
+
+        let merged = merger.finalize();
+        rows.push([merged.row(0), merged.row(1), merged.row(2)]);
+        merged.free();
+    }
+
+    for (var i = 1; i < rows.length; i++) {
+        for (var r = 0; r < 3; r++) {
+            expect(compare.equalArrays(rows[i][r], rows[0][r])).toBe(true);
+        }
+    }
+    expect(compare.equalArrays(rows[0][1], [0, 3, 1000, 0, 0, 2])).toBe(true);
+})
+
+test("sparse matrix merger gives the same results for row- and column-preferred inputs", () => {
+    let nr = 30, nc = 25;
+    let sim = simulate.simulateSparseData(nc, nr);
+    let csc = scran.initializeSparseMatrixFromCompressedVectors(nr, nc, sim.data, sim.indices, sim.indptrs, { byRow: false, layered: false });
+    let layered = scran.initializeSparseMatrixFromCompressedVectors(nr, nc, sim.data, sim.indices, sim.indptrs, { byRow: false });
+
+    let names = [];
+    for (var i = 0; i < nr; i++) {
+        names.push("Gene" + String(i));
+    }
+    let reference = names.slice(5).concat(["Foo"]).reverse();
+
+    let collected = [];
+    for (const nthreads of [ 1, 3 ]) {
+        for (const mat of [ csc, layered ]) {
+            let merger = scran.createSparseMatrixMerger(reference);
+            merger.addMatrix(mat, names, { numberOfThreads: nthreads });
+            merger.addMatrix(mat, names, { numberOfThreads: nthreads });
+            let merged = merger.finalize();
+
+            let columns = [];
+            for (var c = 0; c < 2 * nc; c++) {
+                columns.push(merged.column(c));
+            }
+            collected.push(columns);
+            merged.free();
+        }
+    }
+
+    for (var c = 0; c < 2 * nc; c++) {
+        let original = csc.column(c % nc);
+        let expected = new Float64Array(reference.length);
+        reference.forEach((x, i) => {
+            if (x != "Foo") {
+                expected[i] = original[Number(x.slice(4))];
+            }
+        });
+        for (const columns of collected) {
+            expect(compare.equalArrays(columns[c], expected)).toBe(true);
+        }
+    }
+
+    csc.free();
+    layered.free();
+});
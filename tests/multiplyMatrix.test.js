@@ -0,0 +1,122 @@
+import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+function referenceProduct(mat, y, nvec, transpose) {
+    let NR = mat.numberOfRows();
+    let NC = mat.numberOfColumns();
+    let outer = (transpose ? NC : NR);
+    let inner = (transpose ? NR : NC);
+    let output = new Float64Array(outer * nvec);
+
+    for (var c = 0; c < NC; c++) {
+        let col = mat.column(c);
+        for (var v = 0; v < nvec; v++) {
+            for (var r = 0; r < NR; r++) {
+                if (transpose) {
+                    output[c + v * outer] += col[r] * y[r + v * inner];
+                } else {
+                    output[r + v * outer] += col[r] * y[c + v * inner];
+                }
+            }
+        }
+    }
+
+    return output;
+}
+
+function expectClose(left, right) {
+    expect(left.length).toBe(right.length);
+    for (var i = 0; i < left.length; i++) {
+        expect(Math.abs(left[i] - right[i])).toBeLessThan(1e-8 * (1 + Math.abs(right[i])));
+    }
+}
+
+test("matrix products work for dense vectors and blocks", () => {
+    var ngenes = 100;
+    var ncells = 50;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    var rng = simulate.createRandomGenerator(42);
+    for (const x of [ mat, norm ]) {
+        for (const transpose of [ false, true ]) {
+            let inner = (transpose ? ngenes : ncells);
+            for (const nvec of [ 1, 3 ]) {
+                let y = new Float64Array(inner * nvec);
+                y.forEach((z, i) => { y[i] = rng() - 0.5; });
+
+                let ref = referenceProduct(x, y, nvec, transpose);
+                let serial = scran.multiplyMatrix(x, y, { numberOfVectors: nvec, transpose });
+                expectClose(serial, ref);
+
+                // Each output entry is computed by a single thread, so the results are identical.
+                let parallel = scran.multiplyMatrix(x, y, { numberOfVectors: nvec, transpose, numberOfThreads: 3 });
+                expect(Array.from(parallel)).toEqual(Array.from(serial));
+            }
+        }
+    }
+
+    // Works with a buffer.
+    let y = new Float64Array(ncells);
+    y.fill(1);
+    let buffer = scran.createFloat64WasmArray(ngenes);
+    let out = scran.multiplyMatrix(mat, y, { buffer });
+    expect(out).toBe(buffer);
+    expectClose(buffer.array(), referenceProduct(mat, y, 1, false));
+    buffer.free();
+
+    expect(() => scran.multiplyMatrix(mat, new Float64Array(ngenes))).toThrow("columns");
+
+    mat.free();
+    norm.free();
+})
+
+test("matrix products work for layered and subsetted matrices", () => {
+    var ngenes = 100;
+    var ncells = 50;
+    var dense = simulate.simulateMatrix(ngenes, ncells);
+    var vals = new Int32Array(ngenes * ncells);
+    for (var c = 0; c < ncells; c++) {
+        vals.set(dense.column(c), c * ngenes);
+    }
+    var layered = scran.initializeSparseMatrixFromDenseArray(ngenes, ncells, vals, { layered: true });
+    var sub = scran.subsetColumns(layered, [ 1, 5, 10, 20, 30 ]);
+
+    for (const x of [ layered, sub ]) {
+        let y = new Float64Array(x.numberOfColumns());
+        y.forEach((z, i) => { y[i] = i + 1; });
+        expectClose(scran.multiplyMatrix(x, y), referenceProduct(x, y, 1, false));
+    }
+
+    dense.free();
+    layered.free();
+    sub.free();
+})
+
+test("matrix products work for sparse selectors", () => {
+    var ngenes = 100;
+    var ncells = 50;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+
+    let indices = [ 2, 10, 30 ];
+    let weights = [ 1.5, -1, 2 ];
+    let dense = new Float64Array(ncells);
+    indices.forEach((i, j) => { dense[i] = weights[j]; });
+    expectClose(scran.multiplyMatrixSparse(mat, indices, weights), referenceProduct(mat, dense, 1, false));
+
+    let tdense = new Float64Array(ngenes);
+    indices.forEach((i, j) => { tdense[i] = weights[j]; });
+    expectClose(scran.multiplyMatrixSparse(mat, indices, weights, { transpose: true }), referenceProduct(mat, tdense, 1, true));
+
+    // Unit weights.
+    let ones = new Float64Array(ngenes);
+    indices.forEach(i => { ones[i] = 1; });
+    expectClose(scran.multiplyMatrixSparse(mat, indices, null, { transpose: true }), referenceProduct(mat, ones, 1, true));
+
+    expect(() => scran.multiplyMatrixSparse(mat, [ ncells ], null)).toThrow("out of range");
+
+    mat.free();
+})
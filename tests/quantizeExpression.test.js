@@ -0,0 +1,104 @@
+import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+function referenceQuantile(values, prob) {
+    let sorted = Array.from(values).sort((a, b) => a - b);
+    let pos = prob * (sorted.length - 1);
+    let lower = Math.floor(pos);
+    let upper = Math.min(lower + 1, sorted.length - 1);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (pos - lower);
+}
+
+function referenceCodes(values, lower, upper) {
+    return values.map(v => {
+        if (upper <= lower) {
+            return 0;
+        }
+        let scaled = (v - lower) / (upper - lower) * 255;
+        return Math.round(Math.min(255, Math.max(0, scaled)));
+    });
+}
+
+test("expression quantization works with min/max scaling", () => {
+    var ngenes = 50;
+    var ncells = 80;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    let rows = [ 1, 5, 10, 49 ];
+    let res = scran.quantizeExpression(norm, rows);
+    expect(res.values instanceof Uint8Array).toBe(true);
+    expect(res.values.length).toBe(rows.length * ncells);
+
+    rows.forEach((r, i) => {
+        let row = norm.row(r);
+        expect(res.lower[i]).toBe(Math.min(...row));
+        expect(res.upper[i]).toBe(Math.max(...row));
+        let expected = referenceCodes(Array.from(row), res.lower[i], res.upper[i]);
+        expect(Array.from(res.values.slice(i * ncells, (i + 1) * ncells))).toEqual(expected);
+    });
+
+    // Same results with multiple threads and a buffer.
+    let buffer = scran.createUint8WasmArray(rows.length * ncells);
+    let res2 = scran.quantizeExpression(norm, rows, { buffer, numberOfThreads: 2 });
+    expect(res2.values).toBe(buffer);
+    expect(Array.from(buffer.array())).toEqual(Array.from(res.values));
+    buffer.free();
+
+    norm.free();
+    mat.free();
+})
+
+test("expression quantization works with quantile scaling", () => {
+    var ngenes = 50;
+    var ncells = 80;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    let rows = [ 0, 2, 4 ];
+    let res = scran.quantizeExpression(norm, rows, { scale: "quantile", lowerQuantile: 0.1, upperQuantile: 0.9 });
+    rows.forEach((r, i) => {
+        let row = norm.row(r);
+        expect(Math.abs(res.lower[i] - referenceQuantile(row, 0.1))).toBeLessThan(1e-10);
+        expect(Math.abs(res.upper[i] - referenceQuantile(row, 0.9))).toBeLessThan(1e-10);
+        let expected = referenceCodes(Array.from(row), res.lower[i], res.upper[i]);
+        expect(Array.from(res.values.slice(i * ncells, (i + 1) * ncells))).toEqual(expected);
+    });
+
+    expect(() => scran.quantizeExpression(norm, rows, { scale: "foo" })).toThrow("scale");
+    expect(() => scran.quantizeExpression(norm, rows, { scale: "quantile", lowerQuantile: 0.9, upperQuantile: 0.1 })).toThrow("quantiles");
+    expect(() => scran.quantizeExpression(norm, [ ngenes ])).toThrow("number of rows");
+
+    norm.free();
+    mat.free();
+})
+
+test("expression quantization works with repeated rows of a column-major sparse matrix", () => {
+    var ngenes = 40;
+    var ncells = 60;
+    var sim = simulate.simulateSparseData(ncells, ngenes);
+    var mat = scran.initializeSparseMatrixFromCompressedVectors(ngenes, ncells, sim.data, sim.indices, sim.indptrs, { byRow: false, layered: false });
+
+    let rows = [ 3, 7, 3, 39, 7, 3 ];
+    let unique = [ 3, 7, 39 ];
+    for (const nthreads of [ 1, 3 ]) {
+        let res = scran.quantizeExpression(mat, rows, { numberOfThreads: nthreads });
+        let ref = scran.quantizeExpression(mat, unique, { numberOfThreads: nthreads });
+
+        rows.forEach((r, i) => {
+            let row = mat.row(r);
+            expect(res.lower[i]).toBe(Math.min(...row));
+            expect(res.upper[i]).toBe(Math.max(...row));
+            let expected = referenceCodes(Array.from(row), res.lower[i], res.upper[i]);
+            expect(Array.from(res.values.slice(i * ncells, (i + 1) * ncells))).toEqual(expected);
+
+            let j = unique.indexOf(r);
+            expect(Array.from(res.values.slice(i * ncells, (i + 1) * ncells))).toEqual(Array.from(ref.values.slice(j * ncells, (j + 1) * ncells)));
+        });
+    }
+
+    mat.free();
+})
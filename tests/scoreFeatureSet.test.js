@@ -57,3 +57,53 @@ test("scoreFeatureSet works with blocking", () => {
     expect(() => scran.scoreFeatureSet(norm, features, { block: block.slice(0, 10) })).toThrow("number of columns");
 })
 
+
+test("scoreFeatureSets is consistent with scoreFeatureSet", () => {
+    var ngenes = 1000;
+    var ncells = 50;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var norm = scran.logNormCounts(mat);
+
+    let sets = [ [ 10, 11, 12, 13, 14 ], [ 500, 20, 30, 40, 600, 5 ], [ 12, 13, 999 ] ];
+    let block = new Int32Array(ncells);
+    block.fill(1, 20, ncells);
+
+    for (const scale of [ false, true ]) {
+        let multi = scran.scoreFeatureSets(norm, sets, { block, scale });
+        expect(multi.length).toEqual(sets.length);
+
+        sets.forEach((set, s) => {
+            let features = new Uint8Array(ngenes);
+            set.forEach(i => { features[i] = 1; });
+            let single = scran.scoreFeatureSet(norm, features, { block, scale });
+            expect(compare.equalFloatArrays(multi[s].weights, single.weights)).toBe(true);
+            expect(compare.equalFloatArrays(multi[s].scores, single.scores)).toBe(true);
+        });
+    }
+
+    // Single-threaded processing gives the same results.
+    let serial = scran.scoreFeatureSets(norm, sets, { numberOfThreads: 1 });
+    let parallel = scran.scoreFeatureSets(norm, sets, { numberOfThreads: 3 });
+    expect(serial).toEqual(parallel);
+
+    expect(() => scran.scoreFeatureSets(norm, [[ 0, ngenes ]])).toThrow("out-of-range");
+
+    // Same results for a dense input, which is realized differently.
+    let contents = scran.createFloat64WasmArray(ngenes * ncells);
+    let carr = contents.array();
+    for (var c = 0; c < ncells; c++) {
+        carr.set(norm.column(c), c * ngenes);
+    }
+    let dense = scran.ScranMatrix.createDenseMatrix(ngenes, ncells, contents);
+    let dmulti = scran.scoreFeatureSets(dense, sets, { block });
+    let smulti = scran.scoreFeatureSets(norm, sets, { block });
+    sets.forEach((set, s) => {
+        expect(compare.equalFloatArrays(dmulti[s].weights, smulti[s].weights)).toBe(true);
+        expect(compare.equalFloatArrays(dmulti[s].scores, smulti[s].scores)).toBe(true);
+    });
+
+    contents.free();
+    dense.free();
+    mat.free();
+    norm.free();
+})
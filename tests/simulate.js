@@ -140,3 +140,15 @@ export function simulateIndex(ndim, ncells) {
     }
     return index;
 }
+
+// Seeded generator (mulberry32) for tests that need reproducible values.
+export function createRandomGenerator(seed) {
+    let state = seed >>> 0;
+    return () => {
+        state = (state + 0x6D2B79F5) >>> 0;
+        let t = state;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
@@ -0,0 +1,84 @@
+import * as scran from "../js/index.js";
+import * as compare from "./compare.js";
+import * as simulate from "./simulate.js";
+
+beforeAll(async () => { await scran.initialize({ localFile: true }) });
+afterAll(async () => { await scran.terminate() });
+
+test("geometric sketching works as expected", () => {
+    var ngenes = 1000;
+    var ncells = 200;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var pca = scran.runPca(mat);
+
+    var sketch = scran.sketchCells(pca, 50);
+    expect(sketch.length).toBe(50);
+    expect(sketch instanceof Int32Array).toBe(true);
+    expect(new Set(sketch).size).toBe(50);
+    for (var i = 1; i < sketch.length; i++) {
+        expect(sketch[i]).toBeGreaterThan(sketch[i-1]);
+    }
+
+    // Same results with an array input, and deterministic with the same seed.
+    var sketch2 = scran.sketchCells(pca.principalComponents(), 50, { numberOfDims: pca.numberOfPCs(), numberOfCells: ncells });
+    expect(compare.equalArrays(sketch, sketch2)).toBe(true);
+    var sketch3 = scran.sketchCells(pca, 50, { numberOfThreads: 2 });
+    expect(compare.equalArrays(sketch, sketch3)).toBe(true);
+
+    // Requesting more cells than available returns everything.
+    var all = scran.sketchCells(pca, 1000);
+    expect(all.length).toBe(ncells);
+
+    pca.free();
+    mat.free();
+})
+
+test("geometric sketching retains rare populations", () => {
+    var ndim = 2;
+    var ncells = 1100;
+    var x = new Float64Array(ndim * ncells);
+    var rng = simulate.createRandomGenerator(42);
+    for (var i = 0; i < ncells; i++) {
+        let shift = (i < 1000 ? 0 : 100);
+        x[i * ndim] = rng() * 10 + shift;
+        x[i * ndim + 1] = rng() * 10 + shift;
+    }
+
+    var sketch = scran.sketchCells(x, 100, { numberOfDims: ndim, numberOfCells: ncells });
+    var rare = sketch.filter(i => i >= 1000).length;
+    expect(rare).toBeGreaterThan(0);
+})
+
+test("sketch results can be propagated to all cells", () => {
+    var ngenes = 1000;
+    var ncells = 200;
+    var mat = simulate.simulateMatrix(ngenes, ncells);
+    var pca = scran.runPca(mat);
+
+    var sketch = scran.sketchCells(pca, 50);
+    var labels = new Int32Array(sketch.length);
+    labels.forEach((x, i) => { labels[i] = i % 3; });
+
+    var propagated = scran.propagateSketchLabels(pca, sketch, labels, { numberOfNeighbors: 1, approximate: false });
+    expect(propagated.length).toBe(ncells);
+    sketch.forEach((s, i) => { expect(propagated[s]).toBe(labels[i]); });
+
+    var coords = new Float64Array(sketch.length * 2);
+    coords.forEach((x, i) => { coords[i] = i; });
+    var full = scran.propagateSketchCoordinates(pca, sketch, coords, 2, { numberOfNeighbors: 1, approximate: false });
+    expect(full.length).toBe(ncells * 2);
+    sketch.forEach((s, i) => { 
+        expect(full[2 * s]).toBe(coords[2 * i]);
+        expect(full[2 * s + 1]).toBe(coords[2 * i + 1]);
+    });
+
+    expect(() => scran.propagateSketchLabels(pca, sketch, labels.slice(1))).toThrow("same length");
+    expect(() => scran.propagateSketchLabels(pca, [ ncells ], [ 0 ])).toThrow("out-of-range");
+    expect(() => scran.propagateSketchLabels(pca, [], [])).toThrow("at least one cell");
+    expect(() => scran.propagateSketchCoordinates(pca, [], [], 2)).toThrow("at least one cell");
+    expect(() => scran.propagateSketchLabels(pca, sketch, labels, { numberOfNeighbors: 0 })).toThrow("number of neighbors");
+    expect(() => scran.propagateSketchCoordinates(pca, sketch, coords, 2, { numberOfNeighbors: 0 })).toThrow("number of neighbors");
+
+    pca.free();
+    mat.free();
+})
@@ -48,6 +48,41 @@ test("row subset works", () => {
     subset.free();
 })
 
+test("subsetting works with contiguous runs", () => {
+    var mat = simulate.simulateMatrix(30, 40);
+
+    let scenarios = [
+        [...Array(40).keys()], // identity
+        [...Array(20).keys()].map(i => i + 5), // single run
+        [0, 1, 2, 10, 11, 12, 13, 25, 39], // multiple runs
+        [...Array(20).keys()].map(i => i * 2), // too many runs
+        [5, 4, 3, 3, 20] // unsorted, duplicated
+    ];
+
+    for (const keep of scenarios) {
+        var csub = scran.subsetColumns(mat, keep);
+        expect(csub.numberOfColumns()).toBe(keep.length);
+        keep.forEach((k, i) => {
+            expect(compare.equalArrays(mat.column(k), csub.column(i))).toBe(true);
+        });
+        for (var r = 0; r < 30; r++) {
+            let full = mat.row(r);
+            expect(compare.equalArrays(keep.map(k => full[k]), csub.row(r))).toBe(true);
+        }
+        csub.free();
+
+        let rkeep = keep.filter(k => k < 30);
+        var rsub = scran.subsetRows(mat, rkeep);
+        expect(rsub.numberOfRows()).toBe(rkeep.length);
+        rkeep.forEach((k, i) => {
+            expect(compare.equalArrays(mat.row(k), rsub.row(i))).toBe(true);
+        });
+        rsub.free();
+    }
+
+    mat.free();
+});
+
 test("subsetting works in place", () => {
     var mat = simulate.simulateDenseMatrix(20, 10);
     let ref7 = mat.row(7);
@@ -32,3 +32,69 @@ test("remapFeatureSets works as expected", () => {
     }
 })
 
+
+function reldiff(observed, expected) {
+    return Math.abs(observed - expected) / (Math.abs(observed + expected))/2;
+}
+
+test("testFeatureSetEnrichmentForGroups is consistent with testFeatureSetEnrichment", () => {
+    let markers = [ [0,2,4,6,8], [1,3,5], [], [9,8,7,6,5,4,3,2,1,0] ];
+    let sets = [[0,2,4], [0,1,2,3,4,5,6,7,8,9], [1,3,5,7,9], []];
+    let output = scran.testFeatureSetEnrichmentForGroups(markers, sets, 10);
+
+    expect(output.count.length).toEqual(markers.length);
+    expect(output.pvalue.length).toEqual(markers.length);
+    expect(output.size).toEqual(new Int32Array([3, 10, 5, 0]));
+
+    markers.forEach((m, g) => {
+        let ref = scran.testFeatureSetEnrichment(m, sets, 10);
+        expect(output.count[g]).toEqual(ref.count);
+        ref.pvalue.forEach((p, s) => {
+            expect(reldiff(output.pvalue[g][s], p)).toBeLessThan(1e-8);
+        });
+    });
+
+    // Works with more features and threads.
+    {
+        let markers = [];
+        for (var g = 0; g < 5; g++) {
+            let current = [];
+            for (var i = g; i < 1000; i += 7 + g) {
+                current.push(i);
+            }
+            markers.push(current);
+        }
+
+        let sets = [];
+        for (var s = 0; s < 20; s++) {
+            let current = [];
+            for (var i = s; i < 1000; i += 11 + s) {
+                current.push(i);
+            }
+            sets.push(current);
+        }
+
+        let serial = scran.testFeatureSetEnrichmentForGroups(markers, sets, 1000, { numberOfThreads: 1 });
+        let parallel = scran.testFeatureSetEnrichmentForGroups(markers, sets, 1000, { numberOfThreads: 3 });
+        expect(serial).toEqual(parallel);
+
+        let ref = scran.testFeatureSetEnrichment(markers[2], sets, 1000);
+        expect(serial.count[2]).toEqual(ref.count);
+        ref.pvalue.forEach((p, s) => {
+            expect(reldiff(serial.pvalue[2][s], p)).toBeLessThan(1e-8);
+        });
+    }
+
+    // Duplicated indices are only counted once, even if the duplicated size exceeds the number of features.
+    {
+        let dups = [[0,0,2,2,4], new Array(15).fill(1), [3,3,3,5]];
+        let deduped = [[0,2,4], [1], [3,5]];
+        let dupout = scran.testFeatureSetEnrichmentForGroups(markers, dups, 10);
+        let refout = scran.testFeatureSetEnrichmentForGroups(markers, deduped, 10);
+        expect(dupout.size).toEqual(new Int32Array([3, 1, 2]));
+        expect(dupout).toEqual(refout);
+    }
+
+    expect(() => scran.testFeatureSetEnrichmentForGroups([[0, 20]], sets, 10)).toThrow("markers for group 0");
+    expect(() => scran.testFeatureSetEnrichmentForGroups(markers, [[0, 1, 300]], 10)).toThrow("feature set 0");
+})
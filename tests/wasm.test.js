@@ -1,4 +1,5 @@
 import * as scran from "../js/index.js";
+import * as simulate from "./simulate.js";
 
 beforeAll(async () => { await scran.initialize({ localFile: true }) });
 afterAll(async () => { await scran.terminate() });
@@ -13,3 +14,36 @@ test("wasm heap memory is reported correctly", () => {
 test("maximum number of threads is reported correctly", () => {
     expect(scran.maximumThreads()).toBeGreaterThan(0);
 })
+
+test("deterministic threading gives identical results for any number of threads", () => {
+    let mat = simulate.simulateMatrix(1000, 200);
+    let norm = scran.logNormCounts(mat);
+
+    scran.setDeterministicThreading(8, { numberOfThreads: 1 });
+    let serial = scran.modelGeneVariances(norm);
+    let pca1 = scran.runPca(norm, { numberOfPCs: 5 });
+
+    scran.setDeterministicThreading(8, { numberOfThreads: 3 });
+    let parallel = scran.modelGeneVariances(norm);
+    expect(Array.from(parallel.variances())).toEqual(Array.from(serial.variances()));
+    let pca3 = scran.runPca(norm, { numberOfPCs: 5 });
+    expect(Array.from(pca3.principalComponents())).toEqual(Array.from(pca1.principalComponents()));
+
+    // The per-function number of threads is ignored.
+    let pca3b = scran.runPca(norm, { numberOfPCs: 5, numberOfThreads: 2 });
+    expect(Array.from(pca3b.principalComponents())).toEqual(Array.from(pca1.principalComponents()));
+
+    expect(() => scran.setDeterministicThreading(0)).toThrow("positive integer");
+    expect(() => scran.setDeterministicThreading(8, { numberOfThreads: 0 })).toThrow("positive integer");
+    scran.setDeterministicThreading(null);
+
+    for (const x of [ mat, norm, serial, parallel, pca1, pca3, pca3b ]) {
+        x.free();
+    }
+})
+
+test("loading of threads is only performed once", async () => {
+    let p = scran.loadThreads();
+    expect(scran.loadThreads()).toBe(p);
+    await p;
+})